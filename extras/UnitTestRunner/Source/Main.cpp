@@ -42,10 +42,34 @@ class ConsoleUnitTestRunner : public UnitTestRunner
     }
 };
 
+//==============================================================================
+// The OutOfProcessPluginScanner tests launch this executable as one of their workers
+static bool runAsPluginScannerWorker (int argc, char* argv[])
+{
+    if (argc < 2)
+        return false;
+
+    AudioPluginFormatManager formatManager;
+    OutOfProcessPluginScanner::Worker worker (formatManager);
+
+    if (! worker.initialiseFromCommandLine (argv[1], "juceUnitTestPluginScanner"))
+        return false;
+
+    // (the scan requests are handled on the message thread, so they can't arrive before this)
+    formatManager.addDefaultFormats();
+
+    MessageManager::getInstance()->runDispatchLoop();
+    return true;
+}
+
 //==============================================================================
 int main (int argc, char* argv[])
 {
-    ignoreUnused (argc, argv);
+    // this deletes the singletons that the tests create, so that they don't show up as leaks
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    if (runAsPluginScannerWorker (argc, argv))
+        return 0;
 
     ScopedPointer<ConsoleLogger> logger;
     Logger::setCurrentLogger (logger);
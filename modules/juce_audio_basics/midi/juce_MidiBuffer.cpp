@@ -78,33 +78,156 @@ namespace MidiBufferHelpers
 }
 
 //==============================================================================
-MidiBuffer::MidiBuffer() noexcept {}
+MidiBuffer::MidiBuffer() noexcept
+    : lastEventOffset (-1), fixedCapacity (0), numDroppedEvents (0)
+{
+}
+
 MidiBuffer::~MidiBuffer() {}
 
-MidiBuffer::MidiBuffer (const MidiBuffer& other) noexcept  : data (other.data) {}
+MidiBuffer::MidiBuffer (const MidiBuffer& other) noexcept
+    : data (other.data),
+      lastEventOffset (other.lastEventOffset),
+      fixedCapacity (other.fixedCapacity),
+      numDroppedEvents (other.numDroppedEvents)
+{
+    if (fixedCapacity > 0)
+    {
+        data.ensureStorageAllocated (fixedCapacity);
+        spareData.ensureStorageAllocated (fixedCapacity);
+    }
+}
 
 MidiBuffer& MidiBuffer::operator= (const MidiBuffer& other) noexcept
 {
-    data = other.data;
+    if (this == &other)
+        return *this;
+
+    if (fixedCapacity > 0)
+    {
+        // copying into a fixed-capacity buffer mustn't reallocate it, so only
+        // the events that fit will be copied
+        clear();
+        addEvents (other, 0, -1, 0);
+    }
+    else
+    {
+        data = other.data;
+        lastEventOffset = other.lastEventOffset;
+        fixedCapacity = other.fixedCapacity;
+        numDroppedEvents = other.numDroppedEvents;
+
+        if (fixedCapacity > 0)
+        {
+            data.ensureStorageAllocated (fixedCapacity);
+            spareData.ensureStorageAllocated (fixedCapacity);
+        }
+    }
+
     return *this;
 }
 
 MidiBuffer::MidiBuffer (const MidiMessage& message) noexcept
+    : lastEventOffset (-1), fixedCapacity (0), numDroppedEvents (0)
 {
     addEvent (message, 0);
 }
 
-void MidiBuffer::swapWith (MidiBuffer& other) noexcept      { data.swapWith (other.data); }
-void MidiBuffer::clear() noexcept                           { data.clearQuick(); }
+void MidiBuffer::swapWith (MidiBuffer& other) noexcept
+{
+    data.swapWith (other.data);
+    spareData.swapWith (other.spareData);
+    std::swap (lastEventOffset, other.lastEventOffset);
+    std::swap (fixedCapacity, other.fixedCapacity);
+    std::swap (numDroppedEvents, other.numDroppedEvents);
+}
+
+void MidiBuffer::clear() noexcept
+{
+    data.clearQuick();
+    lastEventOffset = -1;
+    numDroppedEvents = 0;
+}
+
 void MidiBuffer::ensureSize (size_t minimumNumBytes)        { data.ensureStorageAllocated ((int) minimumNumBytes); }
 bool MidiBuffer::isEmpty() const noexcept                   { return data.size() == 0; }
 
+void MidiBuffer::setFixedCapacity (const int maxNumBytes)
+{
+    fixedCapacity = jmax (0, maxNumBytes);
+
+    if (fixedCapacity > 0)
+    {
+        data.ensureStorageAllocated (fixedCapacity);
+        spareData.ensureStorageAllocated (fixedCapacity);
+
+        if (data.size() > fixedCapacity)
+            clear();
+    }
+    else
+    {
+        spareData.clear();
+    }
+}
+
 void MidiBuffer::clear (const int startSample, const int numSamples)
 {
     uint8* const start = MidiBufferHelpers::findEventAfter (data.begin(), data.end(), startSample - 1);
     uint8* const end   = MidiBufferHelpers::findEventAfter (start,        data.end(), startSample + numSamples - 1);
 
-    data.removeRange ((int) (start - data.begin()), (int) (end - data.begin()));
+    if (start == end)
+        return;
+
+    if (fixedCapacity > 0)
+    {
+        // removeRange() can shrink the array's storage, so in fixed-capacity mode the events
+        // that are left get copied into the spare block, which then takes over
+        spareData.clearQuick();
+        spareData.addArray (static_cast<const uint8*> (data.begin()), (int) (start - data.begin()));
+        spareData.addArray (static_cast<const uint8*> (end), (int) (data.end() - end));
+        data.swapWith (spareData);
+    }
+    else
+    {
+        data.removeRange ((int) (start - data.begin()), (int) (end - start));
+    }
+
+    lastEventOffset = -1;
+}
+
+const uint8* MidiBuffer::findLastEvent() const noexcept
+{
+    const int size = data.size();
+
+    if (size == 0)
+        return nullptr;
+
+    // The offset is only a cache, which the methods that change the buffer keep up to date,
+    // so if the data has been changed behind our back, fall back to walking the whole buffer.
+    if (isPositiveAndBelow (lastEventOffset, size)
+         && lastEventOffset + MidiBufferHelpers::getEventTotalSize (data.begin() + lastEventOffset) == size)
+        return data.begin() + lastEventOffset;
+
+    const uint8* const endData = data.end();
+
+    for (const uint8* d = data.begin();;)
+    {
+        const uint8* const nextOne = d + MidiBufferHelpers::getEventTotalSize (d);
+
+        if (nextOne >= endData)
+            return d;
+
+        d = nextOne;
+    }
+}
+
+bool MidiBuffer::hasSpaceFor (const int numBytes) noexcept
+{
+    if (fixedCapacity <= 0 || data.size() + numBytes <= fixedCapacity)
+        return true;
+
+    ++numDroppedEvents;
+    return false;
 }
 
 void MidiBuffer::addEvent (const MidiMessage& m, const int sampleNumber)
@@ -118,10 +241,28 @@ void MidiBuffer::addEvent (const void* const newData, const int maxBytes, const
 
     if (numBytes > 0)
     {
-        const size_t newItemSize = (size_t) numBytes + sizeof (int32) + sizeof (uint16);
-        const int offset = (int) (MidiBufferHelpers::findEventAfter (data.begin(), data.end(), sampleNumber) - data.begin());
+        const int newItemSize = numBytes + (int) (sizeof (int32) + sizeof (uint16));
+
+        if (! hasSpaceFor (newItemSize))
+            return;
 
-        data.insertMultiple (offset, 0, (int) newItemSize);
+        const uint8* const last = findLastEvent();
+        int offset;
+
+        if (last == nullptr || MidiBufferHelpers::getEventTime (last) <= sampleNumber)
+        {
+            // the common case of events arriving in order can just append them
+            offset = data.size();
+            data.insertMultiple (offset, 0, newItemSize);
+            lastEventOffset = offset;
+        }
+        else
+        {
+            const int oldLastOffset = (int) (last - data.begin());
+            offset = (int) (MidiBufferHelpers::findEventAfter (data.begin(), data.end(), sampleNumber) - data.begin());
+            data.insertMultiple (offset, 0, newItemSize);
+            lastEventOffset = oldLastOffset + newItemSize;
+        }
 
         uint8* const d = data.begin() + offset;
         writeUnaligned<int32>  (d, sampleNumber);
@@ -135,17 +276,75 @@ void MidiBuffer::addEvents (const MidiBuffer& otherBuffer,
                             const int numSamples,
                             const int sampleDeltaToAdd)
 {
-    Iterator i (otherBuffer);
-    i.setNextSamplePosition (startSample);
+    jassert (&otherBuffer != this);
+
+    // find the range of source events that we need..
+    const uint8* const sourceEnd = otherBuffer.data.end();
+    const uint8* const sourceStart = MidiBufferHelpers::findEventAfter (const_cast<uint8*> (otherBuffer.data.begin()),
+                                                                        const_cast<uint8*> (sourceEnd), startSample - 1);
+    const uint8* sourceStop = sourceStart;
+    int numSourceBytes = 0;
+
+    while (sourceStop < sourceEnd)
+    {
+        if (numSamples >= 0 && MidiBufferHelpers::getEventTime (sourceStop) >= startSample + numSamples)
+            break;
+
+        const int size = MidiBufferHelpers::getEventTotalSize (sourceStop);
+
+        if (fixedCapacity > 0 && data.size() + numSourceBytes + size > fixedCapacity)
+            break;
+
+        numSourceBytes += size;
+        sourceStop += size;
+    }
 
-    const uint8* eventData;
-    int eventSize, position;
+    if (fixedCapacity > 0)
+        for (const uint8* d = sourceStop; d < sourceEnd && (numSamples < 0 || MidiBufferHelpers::getEventTime (d) < startSample + numSamples);
+               d += MidiBufferHelpers::getEventTotalSize (d))
+            ++numDroppedEvents;
 
-    while (i.getNextEvent (eventData, eventSize, position)
-            && (position < startSample + numSamples || numSamples < 0))
+    if (numSourceBytes == 0)
+        return;
+
+    // ..then merge them with our own events in a single pass. Our existing events are first moved
+    // up to the end of the enlarged buffer, and then the two sorted lists are merged into the space
+    // in front of them, which can never overtake the events still waiting to be read.
+    const int oldSize = data.size();
+    data.insertMultiple (oldSize, 0, numSourceBytes);
+
+    uint8* const base = data.begin();
+    memmove (base + numSourceBytes, base, (size_t) oldSize);
+
+    const uint8* ours = base + numSourceBytes;
+    const uint8* const oursEnd = base + numSourceBytes + oldSize;
+    const uint8* theirs = sourceStart;
+    uint8* dest = base;
+    uint8* lastWritten = nullptr;
+
+    while (ours < oursEnd || theirs < sourceStop)
     {
-        addEvent (eventData, eventSize, position + sampleDeltaToAdd);
+        if (theirs >= sourceStop
+             || (ours < oursEnd && MidiBufferHelpers::getEventTime (ours) <= MidiBufferHelpers::getEventTime (theirs) + sampleDeltaToAdd))
+        {
+            const int size = MidiBufferHelpers::getEventTotalSize (ours);
+            memmove (dest, ours, (size_t) size);
+            ours += size;
+            lastWritten = dest;
+            dest += size;
+        }
+        else
+        {
+            const int size = MidiBufferHelpers::getEventTotalSize (theirs);
+            memcpy (dest, theirs, (size_t) size);
+            writeUnaligned<int32> (dest, MidiBufferHelpers::getEventTime (theirs) + sampleDeltaToAdd);
+            theirs += size;
+            lastWritten = dest;
+            dest += size;
+        }
     }
+
+    lastEventOffset = (int) (lastWritten - base);
 }
 
 int MidiBuffer::getNumEvents() const noexcept
@@ -166,20 +365,8 @@ int MidiBuffer::getFirstEventTime() const noexcept
 
 int MidiBuffer::getLastEventTime() const noexcept
 {
-    if (data.size() == 0)
-        return 0;
-
-    const uint8* const endData = data.end();
-
-    for (const uint8* d = data.begin();;)
-    {
-        const uint8* const nextOne = d + MidiBufferHelpers::getEventTotalSize (d);
-
-        if (nextOne >= endData)
-            return MidiBufferHelpers::getEventTime (d);
-
-        d = nextOne;
-    }
+    const uint8* const last = findLastEvent();
+    return last != nullptr ? MidiBufferHelpers::getEventTime (last) : 0;
 }
 
 //==============================================================================
@@ -227,3 +414,240 @@ bool MidiBuffer::Iterator::getNextEvent (MidiMessage& result, int& samplePositio
 
     return true;
 }
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MidiBufferTests  : public UnitTest
+{
+public:
+    MidiBufferTests() : UnitTest ("MidiBuffer class") {}
+
+    // Each test event is a controller message whose value is its sequence number, so the
+    // order of events with the same position can be checked.
+    static MidiMessage makeEvent (int sequenceNumber)
+    {
+        return MidiMessage::controllerEvent (1 + (sequenceNumber >> 14) % 16, (sequenceNumber >> 7) & 127, sequenceNumber & 127);
+    }
+
+    struct Item
+    {
+        int time, sequence;
+        bool operator< (const Item& other) const noexcept  { return time < other.time; }
+    };
+
+    static Array<Item> getItems (const MidiBuffer& buffer)
+    {
+        Array<Item> items;
+        MidiBuffer::Iterator i (buffer);
+        const uint8* d;
+        int size, time;
+
+        while (i.getNextEvent (d, size, time))
+        {
+            Item item = { time, (((d[0] & 15) << 14) | (d[1] << 7) | d[2]) };
+            items.add (item);
+        }
+
+        return items;
+    }
+
+    void expectSameItems (const Array<Item>& a, const Array<Item>& b)
+    {
+        expectEquals (a.size(), b.size());
+        int numDifferent = 0;
+
+        for (int i = 0; i < jmin (a.size(), b.size()); ++i)
+            if (a.getReference (i).time != b.getReference (i).time || a.getReference (i).sequence != b.getReference (i).sequence)
+                ++numDifferent;
+
+        expectEquals (numDifferent, 0);
+    }
+
+    void runTest() override
+    {
+        Random r (getRandom());
+
+        beginTest ("Events are kept sorted");
+        {
+            MidiBuffer buffer;
+            std::vector<Item> expected;
+
+            for (int i = 0; i < 2000; ++i)
+            {
+                // mostly in order, with some out-of-order ones to exercise both paths
+                const int time = r.nextInt (10) == 0 ? r.nextInt (1000) : i / 2;
+                buffer.addEvent (makeEvent (i), time);
+
+                Item item = { time, i };
+                expected.push_back (item);
+            }
+
+            std::stable_sort (expected.begin(), expected.end());
+            expectSameItems (getItems (buffer), Array<Item> (expected.data(), (int) expected.size()));
+            expectEquals (buffer.getLastEventTime(), expected.back().time);
+            expectEquals (buffer.getFirstEventTime(), expected.front().time);
+        }
+
+        beginTest ("Merging buffers");
+        {
+            for (int n = 0; n < 20; ++n)
+            {
+                MidiBuffer a, b;
+
+                for (int i = 0; i < 500; ++i)
+                {
+                    a.addEvent (makeEvent (i), r.nextInt (1000));
+                    b.addEvent (makeEvent (1000 + i), r.nextInt (1000));
+                }
+
+                const int start = r.nextInt (500), num = r.nextInt (700) - 100, delta = r.nextInt (200) - 100;
+
+                // the slow way, one event at a time
+                MidiBuffer expected (a);
+                MidiBuffer::Iterator i (b);
+                i.setNextSamplePosition (start);
+                const uint8* d;
+                int size, time;
+
+                while (i.getNextEvent (d, size, time) && (num < 0 || time < start + num))
+                    expected.addEvent (d, size, time + delta);
+
+                a.addEvents (b, start, num, delta);
+                expectSameItems (getItems (a), getItems (expected));
+                expectEquals (a.getLastEventTime(), expected.getLastEventTime());
+            }
+        }
+
+        beginTest ("Clearing a range");
+        {
+            MidiBuffer buffer;
+
+            for (int i = 0; i < 100; ++i)
+                buffer.addEvent (makeEvent (i), i);
+
+            buffer.clear (10, 20);
+            expectEquals (buffer.getNumEvents(), 80);
+            expectEquals (buffer.getLastEventTime(), 99);
+
+            buffer.clear (90, 100);
+            expectEquals (buffer.getNumEvents(), 70);
+            expectEquals (buffer.getLastEventTime(), 89);
+        }
+
+        beginTest ("Fixed capacity");
+        {
+            const int eventSize = 6 + 3;
+            MidiBuffer buffer;
+            buffer.setFixedCapacity (100 * eventSize);
+            const uint8* const storage = buffer.data.getRawDataPointer();
+
+            for (int i = 0; i < 150; ++i)
+                buffer.addEvent (makeEvent (i), 150 - i);
+
+            expectEquals (buffer.getNumEvents(), 100);
+            expectEquals (buffer.getNumDroppedEvents(), 50);
+
+            // clearing a range swaps to the spare block, and can then only ever flip between the two
+            buffer.clear (0, 100);
+            const uint8* const spareStorage = buffer.data.getRawDataPointer();
+            expect (spareStorage != storage);
+            expectEquals (buffer.getNumEvents(), 51);
+            expectEquals (buffer.getFirstEventTime(), 100);
+            expectEquals (buffer.getLastEventTime(), 150);
+
+            buffer.clear (100, 10);
+            expect (buffer.data.getRawDataPointer() == storage);
+            expectEquals (buffer.getNumEvents(), 41);
+
+            buffer.clear (140, 5);
+            expect (buffer.data.getRawDataPointer() == spareStorage);
+            expectEquals (buffer.getNumEvents(), 36);
+            expectEquals (buffer.getLastEventTime(), 150);
+
+            buffer.clear (0, 10);   // nothing to remove, so nothing is copied
+            expect (buffer.data.getRawDataPointer() == spareStorage);
+
+            const int numLeft = buffer.getNumEvents();
+
+            MidiBuffer other;
+
+            for (int i = 0; i < 200; ++i)
+                other.addEvent (makeEvent (i), i);
+
+            buffer.addEvents (other, 0, -1, 0);
+            expectEquals (buffer.getNumEvents(), 100);
+            expectEquals (buffer.getNumDroppedEvents(), 50 + 200 - (100 - numLeft));
+
+            buffer = other;
+            expectEquals (buffer.getNumEvents(), 100);
+            expect (buffer.data.getRawDataPointer() == spareStorage);
+
+            MidiBuffer& sameBuffer = buffer;
+            buffer = sameBuffer;
+            expectEquals (buffer.getNumEvents(), 100);
+
+            buffer.clear();
+            expectEquals (buffer.getNumDroppedEvents(), 0);
+            expect (buffer.data.getRawDataPointer() == spareStorage);
+        }
+
+        beginTest ("Benchmark with 10k events per block");
+        {
+            const int numEvents = 10000, blockSize = 512, numBlocks = 20;
+            MidiBuffer ordered, first, second, merged, oneAtATime;
+            double appendMs = 0, mergeMs = 0, insertMs = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                double start = Time::getMillisecondCounterHiRes();
+                ordered.clear();
+
+                for (int i = 0; i < numEvents; ++i)
+                    ordered.addEvent (makeEvent (i), (i * blockSize) / numEvents);
+
+                appendMs += Time::getMillisecondCounterHiRes() - start;
+
+                first.clear();
+                second.clear();
+
+                for (int i = 0; i < numEvents; ++i)
+                {
+                    first.addEvent (makeEvent (i), (i * blockSize) / numEvents);
+                    second.addEvent (makeEvent (i), ((i * blockSize) / numEvents + 7) % blockSize);
+                }
+
+                merged = first;
+                start = Time::getMillisecondCounterHiRes();
+                merged.addEvents (second, 0, -1, 0);
+                mergeMs += Time::getMillisecondCounterHiRes() - start;
+
+                // this is what addEvents used to do, which is too slow to run for every block
+                if (block > 0)
+                    continue;
+
+                oneAtATime = first;
+                start = Time::getMillisecondCounterHiRes();
+                MidiBuffer::Iterator i (second);
+                const uint8* d;
+                int size, time;
+
+                while (i.getNextEvent (d, size, time))
+                    oneAtATime.addEvent (d, size, time);
+
+                insertMs += Time::getMillisecondCounterHiRes() - start;
+
+                expect (merged.data == oneAtATime.data);
+            }
+
+            logMessage ("Per block of " + String (numEvents) + " events: in-order addEvent "
+                          + String (appendMs / numBlocks, 3) + " ms, addEvents merge " + String (mergeMs / numBlocks, 3)
+                          + " ms, merging with addEvent " + String (insertMs, 3) + " ms");
+        }
+    }
+};
+
+static MidiBufferTests midiBufferTests;
+
+#endif // JUCE_UNIT_TESTS
@@ -92,6 +92,9 @@ public:
         If an event is added whose sample position is the same as one or more events
         already in the buffer, the new event will be placed after the existing ones.
 
+        Adding an event whose position is at or after the last one in the buffer is a
+        quick operation that just appends it, so it's best to add events in order.
+
         To retrieve events, use a MidiBuffer::Iterator object
     */
     void addEvent (const MidiMessage& midiMessage, int sampleNumber);
@@ -129,6 +132,10 @@ public:
                                     startSample will be taken.
         @param sampleDeltaToAdd     a value which will be added to the source timestamps of the events
                                     that are added to this buffer
+
+        The events are merged with the existing ones in a single pass, so this is much
+        quicker than adding them one at a time. Where events have the same position, the
+        ones that were already in this buffer will come first.
     */
     void addEvents (const MidiBuffer& otherBuffer,
                     int startSample,
@@ -159,6 +166,32 @@ public:
     */
     void ensureSize (size_t minimumNumBytes);
 
+    //==============================================================================
+    /** Puts the buffer into a mode where it will never allocate memory.
+
+        This allocates space for the given number of bytes up-front, and from then on,
+        any events that won't fit into that space are dropped instead of making the buffer
+        grow, so it's safe to use on the audio thread. Each event takes up 6 bytes plus the
+        size of its midi data. You can find out whether anything was lost with
+        getNumDroppedEvents(). The buffer also keeps a spare block of the same size, which
+        clear (int, int) uses to compact the remaining events without reallocating.
+
+        Calling this with 0 returns the buffer to its normal, growable behaviour.
+        Note that MidiBuffer::Iterator::getNextEvent (MidiMessage&, int&) may still allocate
+        for sysex messages that are too big for a MidiMessage's internal storage, so use the
+        raw-data version of getNextEvent() if that matters.
+    */
+    void setFixedCapacity (int maxNumBytes);
+
+    /** Returns the capacity that was set with setFixedCapacity(), or 0 if the buffer can grow. */
+    int getFixedCapacity() const noexcept                       { return fixedCapacity; }
+
+    /** Returns the number of events that have been dropped because a fixed-capacity buffer
+        was full, since the last time clear() was called.
+        @see setFixedCapacity
+    */
+    int getNumDroppedEvents() const noexcept                    { return numDroppedEvents; }
+
     //==============================================================================
     /**
         Used to iterate through the events in a MidiBuffer.
@@ -228,6 +261,12 @@ public:
     Array<uint8> data;
 
 private:
+    Array<uint8> spareData;
+    int lastEventOffset, fixedCapacity, numDroppedEvents;
+
+    const uint8* findLastEvent() const noexcept;
+    bool hasSpaceFor (int numBytes) noexcept;
+
     JUCE_LEAK_DETECTOR (MidiBuffer)
 };
 
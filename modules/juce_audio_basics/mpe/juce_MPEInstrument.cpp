@@ -26,6 +26,10 @@ namespace
 {
     const uint8 noLSBValueReceived = 0xff;
     const Range<int> allChannels = Range<int> (1, 17);
+
+    // enough space for a full 15-channel zone with plenty of sustained notes, so that
+    // incoming notes won't normally cause allocations on the audio thread
+    const int numNotesToPreallocate = 128;
 }
 
 //==============================================================================
@@ -45,6 +49,10 @@ MPEInstrument::MPEInstrument() noexcept
     legacyMode.isEnabled = false;
     legacyMode.pitchbendRange = 2;
     legacyMode.channelRange = Range<int> (1, 17);
+
+    notes.ensureStorageAllocated (numNotesToPreallocate);
+    notesGroupedByChannel.ensureStorageAllocated (numNotesToPreallocate);
+    updateNoteIndexes();
 }
 
 MPEInstrument::~MPEInstrument()
@@ -225,8 +233,9 @@ void MPEInstrument::processMidiAllNotesOffMessage (const MidiMessage& message)
             {
                 note.keyState = MPENote::off;
                 note.noteOffVelocity = MPEValue::from7BitInt (64); // some reasonable number
+                updateNoteIndexes();
                 listeners.call (&MPEInstrument::Listener::noteReleased, note);
-                notes.remove (i);
+                removeNote (i);
             }
         }
     }
@@ -240,8 +249,9 @@ void MPEInstrument::processMidiAllNotesOffMessage (const MidiMessage& message)
             {
                 note.keyState = MPENote::off;
                 note.noteOffVelocity = MPEValue::from7BitInt (64); // some reasonable number
+                updateNoteIndexes();
                 listeners.call (&MPEInstrument::Listener::noteReleased, note);
-                notes.remove (i);
+                removeNote (i);
             }
         }
     }
@@ -298,11 +308,13 @@ void MPEInstrument::noteOn (int midiChannel,
         // pathological case: second note-on received for same note -> retrigger it
         alreadyPlayingNote->keyState = MPENote::off;
         alreadyPlayingNote->noteOffVelocity = MPEValue::from7BitInt (64); // some reasonable number
+        updateNoteIndexes();
         listeners.call (&MPEInstrument::Listener::noteReleased, *alreadyPlayingNote);
-        notes.remove (alreadyPlayingNote);
+        removeNote ((int) (alreadyPlayingNote - notes.begin()));
     }
 
     notes.add (newNote);
+    updateNoteIndexes();
     listeners.call (&MPEInstrument::Listener::noteAdded, newNote);
 }
 
@@ -327,10 +339,12 @@ void MPEInstrument::noteOff (int midiChannel,
         pitchbendDimension.lastValueReceivedOnChannel[midiChannel - 1] = MPEValue::centreValue();
         timbreDimension.lastValueReceivedOnChannel[midiChannel - 1] = MPEValue::centreValue();
 
+        updateNoteIndexes();
+
         if (note->keyState == MPENote::off)
         {
             listeners.call (&MPEInstrument::Listener::noteReleased, *note);
-            notes.remove (note);
+            removeNote ((int) (note - notes.begin()));
         }
         else
         {
@@ -382,13 +396,8 @@ void MPEInstrument::updateDimension (int midiChannel, MPEDimension& dimension, M
     {
         if (dimension.trackingMode == allNotesOnChannel)
         {
-            for (int i = notes.size(); --i >= 0;)
-            {
-                MPENote& note = notes.getReference (i);
-
-                if (note.midiChannel == midiChannel)
-                    updateDimensionForNote (note, dimension, value);
-            }
+            for (int i = firstNoteOnChannel[midiChannel]; --i >= firstNoteOnChannel[midiChannel - 1];)
+                updateDimensionForNote (*getNoteAtIndex (notesGroupedByChannel.getUnchecked (i)), dimension, value);
         }
         else
         {
@@ -507,10 +516,12 @@ void MPEInstrument::handleSustainOrSostenuto (int midiChannel, bool isDown, bool
             else if (note.keyState == MPENote::keyDownAndSustained && ! isDown)
                 note.keyState = MPENote::keyDown;
 
+            updateNoteIndexes();
+
             if (note.keyState == MPENote::off)
             {
                 listeners.call (&MPEInstrument::Listener::noteReleased, note);
-                notes.remove (i);
+                removeNote (i);
             }
             else
             {
@@ -588,15 +599,15 @@ MPENote MPEInstrument::getMostRecentNoteOtherThan (MPENote otherThanThisNote) co
 }
 
 //==============================================================================
-MPENote* MPEInstrument::getNotePtr (int midiChannel, int midiNoteNumber) const noexcept
+MPENote* MPEInstrument::getNoteAtIndex (int index) const noexcept
 {
-    for (int i = 0; i < notes.size(); ++i)
-    {
-        MPENote& note = notes.getReference (i);
+    return index != noNote ? &(notes.getReference (index)) : nullptr;
+}
 
-        if (note.midiChannel == midiChannel && note.initialNote == midiNoteNumber)
-            return &note;
-    }
+MPENote* MPEInstrument::getNotePtr (int midiChannel, int midiNoteNumber) const noexcept
+{
+    if (isPositiveAndBelow (midiChannel - 1, 16) && isPositiveAndBelow (midiNoteNumber, 128))
+        return getNoteAtIndex (noteIndexByChannelAndNumber[(midiChannel - 1) * 128 + midiNoteNumber]);
 
     return nullptr;
 }
@@ -618,59 +629,83 @@ MPENote* MPEInstrument::getNotePtr (int midiChannel, TrackingMode mode) const no
 //==============================================================================
 MPENote* MPEInstrument::getLastNotePlayedPtr (int midiChannel) const noexcept
 {
-    for (int i = notes.size(); --i >= 0;)
-    {
-        MPENote& note = notes.getReference (i);
+    return isPositiveAndBelow (midiChannel - 1, 16) ? getNoteAtIndex (lastNotePlayedOnChannelIndex[midiChannel - 1]) : nullptr;
+}
 
-        if (note.midiChannel == midiChannel
-             && (note.keyState == MPENote::keyDown || note.keyState == MPENote::keyDownAndSustained))
-            return &note;
-    }
+MPENote* MPEInstrument::getHighestNotePtr (int midiChannel) const noexcept
+{
+    return isPositiveAndBelow (midiChannel - 1, 16) ? getNoteAtIndex (highestNoteOnChannelIndex[midiChannel - 1]) : nullptr;
+}
 
-    return nullptr;
+MPENote* MPEInstrument::getLowestNotePtr (int midiChannel) const noexcept
+{
+    return isPositiveAndBelow (midiChannel - 1, 16) ? getNoteAtIndex (lowestNoteOnChannelIndex[midiChannel - 1]) : nullptr;
 }
 
 //==============================================================================
-MPENote* MPEInstrument::getHighestNotePtr (int midiChannel) const noexcept
+void MPEInstrument::removeNote (int index)
 {
-    int initialNoteMax = -1;
-    MPENote* result = nullptr;
+    notes.remove (index);
+    updateNoteIndexes();
+}
 
-    for (int i = notes.size(); --i >= 0;)
+void MPEInstrument::updateNoteIndexes() noexcept
+{
+    std::fill_n (noteIndexByChannelAndNumber, 16 * 128, (int16) noNote);
+    std::fill_n (lastNotePlayedOnChannelIndex, 16, (int16) noNote);
+    std::fill_n (lowestNoteOnChannelIndex, 16, (int16) noNote);
+    std::fill_n (highestNoteOnChannelIndex, 16, (int16) noNote);
+    std::fill_n (firstNoteOnChannel, 17, (int16) 0);
+
+    // (notes on invalid channels can only come from a bad zone layout, and are never looked up)
+    for (int i = 0; i < notes.size(); ++i)
     {
-        MPENote& note = notes.getReference (i);
+        const MPENote& note = notes.getReference (i);
 
-        if (note.midiChannel == midiChannel
-             && (note.keyState == MPENote::keyDown || note.keyState == MPENote::keyDownAndSustained)
-             && note.initialNote > initialNoteMax)
-        {
-            result = &note;
-            initialNoteMax = note.initialNote;
-        }
+        if (isPositiveAndBelow (note.midiChannel - 1, 16))
+            ++firstNoteOnChannel[note.midiChannel];
     }
 
-    return result;
-}
+    for (int i = 1; i < 17; ++i)
+        firstNoteOnChannel[i] += firstNoteOnChannel[i - 1];
 
-MPENote* MPEInstrument::getLowestNotePtr (int midiChannel) const noexcept
-{
-    int initialNoteMin = 128;
-    MPENote* result = nullptr;
+    notesGroupedByChannel.resize (firstNoteOnChannel[16]);
 
+    // this goes backwards through the notes so that each channel's group ends up in age order
     for (int i = notes.size(); --i >= 0;)
     {
-        MPENote& note = notes.getReference (i);
+        const MPENote& note = notes.getReference (i);
+        const int channelIndex = note.midiChannel - 1;
+
+        if (! isPositiveAndBelow (channelIndex, 16))
+            continue;
+
+        notesGroupedByChannel.setUnchecked (--firstNoteOnChannel[note.midiChannel], (int16) i);
+
+        if (isPositiveAndBelow ((int) note.initialNote, 128))
+            noteIndexByChannelAndNumber[channelIndex * 128 + note.initialNote] = (int16) i;
 
-        if (note.midiChannel == midiChannel
-             && (note.keyState == MPENote::keyDown || note.keyState == MPENote::keyDownAndSustained)
-             && note.initialNote < initialNoteMin)
+        if (note.keyState == MPENote::keyDown || note.keyState == MPENote::keyDownAndSustained)
         {
-            result = &note;
-            initialNoteMin = note.initialNote;
+            if (lastNotePlayedOnChannelIndex[channelIndex] == noNote)
+                lastNotePlayedOnChannelIndex[channelIndex] = (int16) i;
+
+            if (highestNoteOnChannelIndex[channelIndex] == noNote
+                 || note.initialNote > notes.getReference (highestNoteOnChannelIndex[channelIndex]).initialNote)
+                highestNoteOnChannelIndex[channelIndex] = (int16) i;
+
+            if (lowestNoteOnChannelIndex[channelIndex] == noNote
+                 || note.initialNote < notes.getReference (lowestNoteOnChannelIndex[channelIndex]).initialNote)
+                lowestNoteOnChannelIndex[channelIndex] = (int16) i;
         }
     }
 
-    return result;
+    // The decrements above have left each channel's entry pointing at the start of its
+    // own group, so shift them down to make channel n's notes lie between entries n - 1 and n
+    for (int i = 0; i < 16; ++i)
+        firstNoteOnChannel[i] = firstNoteOnChannel[i + 1];
+
+    firstNoteOnChannel[16] = (int16) notesGroupedByChannel.size();
 }
 
 //==============================================================================
@@ -683,10 +718,12 @@ void MPEInstrument::releaseAllNotes()
         MPENote& note = notes.getReference (i);
         note.keyState = MPENote::off;
         note.noteOffVelocity = MPEValue::from7BitInt (64); // some reasonable number
+        updateNoteIndexes();
         listeners.call (&MPEInstrument::Listener::noteReleased, note);
     }
 
     notes.clear();
+    updateNoteIndexes();
 }
 
 //==============================================================================
@@ -1995,6 +2032,110 @@ public:
                 expectEquals (test.getNumPlayingNotes(), 0);
             }
         }
+
+        beginTest ("note lookups after random note activity");
+        {
+            UnitTestInstrument test;
+            test.enableLegacyMode();
+            test.setPressureTrackingMode (MPEInstrument::lowestNoteOnChannel);
+            test.setTimbreTrackingMode (MPEInstrument::highestNoteOnChannel);
+
+            Random r (0x1234);
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                const int channel = 1 + r.nextInt (16);
+                const int action = r.nextInt (10);
+
+                if (action < 4)
+                    test.noteOn (channel, 50 + r.nextInt (12), MPEValue::from7BitInt (100));
+                else if (action < 8)
+                    test.noteOff (channel, 50 + r.nextInt (12), MPEValue::from7BitInt (64));
+                else
+                    test.sustainPedal (channel, action == 8);
+
+                expectNoteLookupsMatchNoteList (test, channel, r);
+            }
+
+            test.releaseAllNotes();
+            expectEquals (test.getNumPlayingNotes(), 0);
+            expect (! test.getMostRecentNote (1).isValid());
+        }
+
+        beginTest ("MPE throughput benchmark");
+        {
+            // a synthetic controller stream: a note held on each of 15 channels, with every
+            // one of them sending continuous pitchbend, pressure and timbre (each message
+            // has a different value to the last one, so they all reach the voices)
+            const int numMessagesPerChannel = 20000;
+            Array<MidiMessage> stream;
+
+            for (int channel = 2; channel <= 16; ++channel)
+                stream.add (MidiMessage::noteOn (channel, 48 + channel, (uint8) 100));
+
+            for (int i = 0; i < numMessagesPerChannel; ++i)
+            {
+                for (int channel = 2; channel <= 16; ++channel)
+                {
+                    switch (i % 3)
+                    {
+                        case 0:  stream.add (MidiMessage::pitchWheel (channel, ((i / 3) * 37 + channel) % 16384)); break;
+                        case 1:  stream.add (MidiMessage::channelPressureChange (channel, (i / 3 + channel) % 128)); break;
+                        default: stream.add (MidiMessage::controllerEvent (channel, 74, (i / 3 + channel) % 128)); break;
+                    }
+                }
+            }
+
+            MPEZoneLayout layout;
+            layout.addZone (MPEZone (1, 15));
+
+            {
+                MPEInstrument instrument;
+                instrument.setZoneLayout (layout);
+
+                const double start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < stream.size(); ++i)
+                    instrument.processNextMidiEvent (stream.getReference (i));
+
+                logMessage ("MPEInstrument: " + getThroughput (stream.size(), Time::getMillisecondCounterHiRes() - start));
+                expectEquals (instrument.getNumPlayingNotes(), 15);
+            }
+
+            {
+                MPESynthesiser synth;
+                synth.setZoneLayout (layout);
+                synth.setCurrentPlaybackSampleRate (44100.0);
+
+                for (int i = 0; i < 16; ++i)
+                    synth.addVoice (new CountingVoice());
+
+                const int blockSize = 256, messagesPerBlock = 256;
+                AudioBuffer<float> buffer (2, blockSize);
+                MidiBuffer midi;
+
+                const double start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < stream.size(); i += messagesPerBlock)
+                {
+                    midi.clear();
+
+                    for (int j = i; j < jmin (stream.size(), i + messagesPerBlock); ++j)
+                        midi.addEvent (stream.getReference (j), j - i);
+
+                    synth.renderNextBlock (buffer, midi, 0, blockSize);
+                }
+
+                logMessage ("MPESynthesiser: " + getThroughput (stream.size(), Time::getMillisecondCounterHiRes() - start));
+
+                int numUpdates = 0;
+
+                for (int i = 0; i < synth.getNumVoices(); ++i)
+                    numUpdates += static_cast<CountingVoice*> (synth.getVoice (i))->numUpdates;
+
+                expectEquals (numUpdates, 15 * numMessagesPerChannel);
+            }
+        }
     }
 
 private:
@@ -2111,6 +2252,68 @@ private:
         }
     };
 
+    //==============================================================================
+    // A voice that just counts the expression changes that it receives.
+    struct CountingVoice  : public MPESynthesiserVoice
+    {
+        CountingVoice() : numUpdates (0) {}
+
+        void noteStarted() override                         {}
+        void noteStopped (bool) override                    { clearCurrentNote(); }
+        void notePressureChanged() override                 { ++numUpdates; }
+        void notePitchbendChanged() override                { ++numUpdates; }
+        void noteTimbreChanged() override                   { ++numUpdates; }
+        void noteKeyStateChanged() override                 {}
+        void renderNextBlock (AudioBuffer<float>&, int, int) override {}
+
+        int numUpdates;
+    };
+
+    static String getThroughput (int numMessages, double milliseconds)
+    {
+        return String (numMessages) + " messages in " + String (milliseconds, 1) + " ms ("
+                 + String ((int64) (numMessages / jmax (0.001, milliseconds * 0.001))) + " per second)";
+    }
+
+    // (MPENote::operator== asserts that both notes are valid)
+    static bool isSameNote (const MPENote& a, const MPENote& b) noexcept
+    {
+        return a.isValid() == b.isValid() && (! a.isValid() || a.noteID == b.noteID);
+    }
+
+    // Checks the instrument's indexed lookups against a plain search through its notes.
+    void expectNoteLookupsMatchNoteList (UnitTestInstrument& test, int channel, Random& r)
+    {
+        MPENote mostRecent, lowest, highest;
+
+        for (int i = 0; i < test.getNumPlayingNotes(); ++i)
+        {
+            const MPENote note (test.getNote (i));
+            expect (isSameNote (test.getNote (note.midiChannel, note.initialNote), note));
+
+            if (note.midiChannel == channel
+                 && (note.keyState == MPENote::keyDown || note.keyState == MPENote::keyDownAndSustained))
+            {
+                mostRecent = note;
+
+                if (! lowest.isValid() || note.initialNote < lowest.initialNote)     lowest = note;
+                if (! highest.isValid() || note.initialNote > highest.initialNote)   highest = note;
+            }
+        }
+
+        expect (isSameNote (test.getMostRecentNote (channel), mostRecent));
+
+        const MPEValue value (MPEValue::from7BitInt (r.nextInt (128)));
+        test.pressure (channel, value);
+        test.timbre (channel, value);
+
+        if (lowest.isValid())
+        {
+            expect (test.getNote (channel, lowest.initialNote).pressure == value);
+            expect (test.getNote (channel, highest.initialNote).timbre == value);
+        }
+    }
+
     //==============================================================================
     void expectNote (MPENote noteToTest,
                      int noteOnVelocity7Bit,
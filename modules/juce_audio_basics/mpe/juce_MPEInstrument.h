@@ -324,6 +324,15 @@ private:
     //==============================================================================
     CriticalSection lock;
     Array<MPENote> notes;
+
+    // Indexes into the notes array, so that per-note messages can find their
+    // notes without searching. These get rebuilt whenever a note is added or
+    // removed, or its key state changes.
+    enum { noNote = -1 };
+    int16 noteIndexByChannelAndNumber[16 * 128];
+    int16 lastNotePlayedOnChannelIndex[16], lowestNoteOnChannelIndex[16], highestNoteOnChannelIndex[16];
+    int16 firstNoteOnChannel[17];
+    Array<int16> notesGroupedByChannel;
     MPEZoneLayout zoneLayout;
     ListenerList<Listener> listeners;
 
@@ -373,7 +382,10 @@ private:
     MPENote* getLastNotePlayedPtr (int midiChannel) const noexcept;
     MPENote* getHighestNotePtr (int midiChannel) const noexcept;
     MPENote* getLowestNotePtr (int midiChannel) const noexcept;
+    MPENote* getNoteAtIndex (int index) const noexcept;
     void updateNoteTotalPitchbend (MPENote&);
+    void removeNote (int index);
+    void updateNoteIndexes() noexcept;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MPEInstrument)
 };
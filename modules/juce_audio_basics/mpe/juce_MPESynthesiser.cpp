@@ -24,10 +24,12 @@
 
 MPESynthesiser::MPESynthesiser()
 {
+    std::fill_n (voiceIndexForNote, 16 * 128, (int16) -1);
 }
 
 MPESynthesiser::MPESynthesiser (MPEInstrument* instrument)  : MPESynthesiserBase (instrument)
 {
+    std::fill_n (voiceIndexForNote, 16 * 128, (int16) -1);
 }
 
 MPESynthesiser::~MPESynthesiser()
@@ -39,9 +41,37 @@ void MPESynthesiser::startVoice (MPESynthesiserVoice* voice, MPENote noteToStart
 {
     jassert (voice != nullptr);
     voice->currentlyPlayingNote = noteToStart;
+
+    if (isPositiveAndBelow (noteToStart.midiChannel - 1, 16) && isPositiveAndBelow ((int) noteToStart.initialNote, 128))
+        voiceIndexForNote[(noteToStart.midiChannel - 1) * 128 + noteToStart.initialNote] = (int16) voices.indexOf (voice);
+
     voice->noteStarted();
 }
 
+MPESynthesiserVoice* MPESynthesiser::findVoicePlayingNote (MPENote note) noexcept
+{
+    if (isPositiveAndBelow (note.midiChannel - 1, 16) && isPositiveAndBelow ((int) note.initialNote, 128))
+    {
+        int16& index = voiceIndexForNote[(note.midiChannel - 1) * 128 + note.initialNote];
+
+        if (isPositiveAndBelow ((int) index, voices.size()) && voices.getUnchecked (index)->isCurrentlyPlayingNote (note))
+            return voices.getUnchecked (index);
+
+        // The table's out of date, which can happen if the voices array has been changed
+        // directly, so fall back to a search..
+        for (int i = 0; i < voices.size(); ++i)
+        {
+            if (voices.getUnchecked (i)->isCurrentlyPlayingNote (note))
+            {
+                index = (int16) i;
+                return voices.getUnchecked (i);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
 void MPESynthesiser::stopVoice (MPESynthesiserVoice* voice, MPENote noteToStop, bool allowTailOff)
 {
     jassert (voice != nullptr);
@@ -62,15 +92,10 @@ void MPESynthesiser::notePressureChanged (MPENote changedNote)
 {
     const ScopedLock sl (voicesLock);
 
-    for (int i = 0; i < voices.size(); ++i)
+    if (MPESynthesiserVoice* const voice = findVoicePlayingNote (changedNote))
     {
-        MPESynthesiserVoice* voice = voices.getUnchecked (i);
-
-        if (voice->isCurrentlyPlayingNote (changedNote))
-        {
-            voice->currentlyPlayingNote = changedNote;
-            voice->notePressureChanged();
-        }
+        voice->currentlyPlayingNote = changedNote;
+        voice->notePressureChanged();
     }
 }
 
@@ -78,15 +103,10 @@ void MPESynthesiser::notePitchbendChanged (MPENote changedNote)
 {
     const ScopedLock sl (voicesLock);
 
-    for (int i = 0; i < voices.size(); ++i)
+    if (MPESynthesiserVoice* const voice = findVoicePlayingNote (changedNote))
     {
-        MPESynthesiserVoice* voice = voices.getUnchecked (i);
-
-        if (voice->isCurrentlyPlayingNote (changedNote))
-        {
-            voice->currentlyPlayingNote = changedNote;
-            voice->notePitchbendChanged();
-        }
+        voice->currentlyPlayingNote = changedNote;
+        voice->notePitchbendChanged();
     }
 }
 
@@ -94,15 +114,10 @@ void MPESynthesiser::noteTimbreChanged (MPENote changedNote)
 {
     const ScopedLock sl (voicesLock);
 
-    for (int i = 0; i < voices.size(); ++i)
+    if (MPESynthesiserVoice* const voice = findVoicePlayingNote (changedNote))
     {
-        MPESynthesiserVoice* voice = voices.getUnchecked (i);
-
-        if (voice->isCurrentlyPlayingNote (changedNote))
-        {
-            voice->currentlyPlayingNote = changedNote;
-            voice->noteTimbreChanged();
-        }
+        voice->currentlyPlayingNote = changedNote;
+        voice->noteTimbreChanged();
     }
 }
 
@@ -110,15 +125,10 @@ void MPESynthesiser::noteKeyStateChanged (MPENote changedNote)
 {
     const ScopedLock sl (voicesLock);
 
-    for (int i = 0; i < voices.size(); ++i)
+    if (MPESynthesiserVoice* const voice = findVoicePlayingNote (changedNote))
     {
-        MPESynthesiserVoice* voice = voices.getUnchecked (i);
-
-        if (voice->isCurrentlyPlayingNote (changedNote))
-        {
-            voice->currentlyPlayingNote = changedNote;
-            voice->noteKeyStateChanged();
-        }
+        voice->currentlyPlayingNote = changedNote;
+        voice->noteKeyStateChanged();
     }
 }
 
@@ -206,7 +206,7 @@ protected:
     */
     virtual void noteReleased (MPENote finishedNote) override;
 
-    /** Will find any voice that is currently playing changedNote, update its
+    /** Will find the voice that is currently playing changedNote, update its
         currently playing note, and call its notePressureChanged method.
 
         This method will be called automatically according to the midi data passed into
@@ -214,7 +214,7 @@ protected:
     */
     virtual void notePressureChanged (MPENote changedNote) override;
 
-    /** Will find any voice that is currently playing changedNote, update its
+    /** Will find the voice that is currently playing changedNote, update its
         currently playing note, and call its notePitchbendChanged method.
 
         This method will be called automatically according to the midi data passed into
@@ -222,7 +222,7 @@ protected:
     */
     virtual void notePitchbendChanged (MPENote changedNote) override;
 
-    /** Will find any voice that is currently playing changedNote, update its
+    /** Will find the voice that is currently playing changedNote, update its
         currently playing note, and call its noteTimbreChanged method.
 
         This method will be called automatically according to the midi data passed into
@@ -230,7 +230,7 @@ protected:
     */
     virtual void noteTimbreChanged (MPENote changedNote) override;
 
-    /** Will find any voice that is currently playing changedNote, update its
+    /** Will find the voice that is currently playing changedNote, update its
         currently playing note, and call its noteKeyStateChanged method.
 
         This method will be called automatically according to the midi data passed into
@@ -306,6 +306,12 @@ private:
     bool shouldStealVoices;
     CriticalSection voicesLock;
 
+    // The index of the voice that was last started for each channel and note number, so
+    // that expression changes can be sent straight to the right voice.
+    int16 voiceIndexForNote[16 * 128];
+
+    MPESynthesiserVoice* findVoicePlayingNote (MPENote) noexcept;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MPESynthesiser)
 };
 
@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+AudioCallbackTelemetry::Histogram::Histogram() noexcept {}
+
+void AudioCallbackTelemetry::Histogram::addTime (const double milliseconds) noexcept
+{
+    const double micros = milliseconds * 1000.0;
+    const int bucket = micros < 1.0 ? 0 : jmin ((int) numBuckets - 1, (int) (std::log (micros) * (bucketsPerOctave / std::log (2.0))));
+    const int intMicros = (int) jmin (micros, (double) std::numeric_limits<int>::max());
+
+    ++buckets[bucket];
+    ++total;
+    totalMicroseconds += intMicros;
+
+    if (intMicros > maxMicroseconds.get())
+        maxMicroseconds = intMicros;
+}
+
+void AudioCallbackTelemetry::Histogram::reset() noexcept
+{
+    for (int i = 0; i < numBuckets; ++i)
+        buckets[i] = 0;
+
+    total = 0;
+    totalMicroseconds = 0;
+    maxMicroseconds = 0;
+}
+
+int64 AudioCallbackTelemetry::Histogram::getTotalCount() const noexcept
+{
+    return total.get();
+}
+
+int AudioCallbackTelemetry::Histogram::getBucketCount (const int bucketIndex) const noexcept
+{
+    return isPositiveAndBelow (bucketIndex, (int) numBuckets) ? buckets[bucketIndex].get() : 0;
+}
+
+double AudioCallbackTelemetry::Histogram::getBucketUpperLimitMs (const int bucketIndex) noexcept
+{
+    return std::pow (2.0, (bucketIndex + 1) / (double) bucketsPerOctave) / 1000.0;
+}
+
+double AudioCallbackTelemetry::Histogram::getPercentileMs (const double percentile) const noexcept
+{
+    int64 counts [numBuckets];
+    int64 num = 0;
+
+    for (int i = 0; i < numBuckets; ++i)
+        num += (counts[i] = buckets[i].get());
+
+    if (num == 0)
+        return 0;
+
+    const int64 target = jmax ((int64) 1, (int64) std::ceil (num * jlimit (0.0, 100.0, percentile) / 100.0));
+    int64 sum = 0;
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        sum += counts[i];
+
+        if (sum >= target)
+            return jmin (getBucketUpperLimitMs (i), jmax (getMaximumMs(), getBucketUpperLimitMs (i - 1)));
+    }
+
+    return getMaximumMs();
+}
+
+double AudioCallbackTelemetry::Histogram::getMaximumMs() const noexcept
+{
+    return maxMicroseconds.get() / 1000.0;
+}
+
+double AudioCallbackTelemetry::Histogram::getAverageMs() const noexcept
+{
+    const int64 num = total.get();
+    return num > 0 ? totalMicroseconds.get() / (1000.0 * num) : 0.0;
+}
+
+//==============================================================================
+AudioCallbackTelemetry::AudioCallbackTelemetry() noexcept
+    : device (nullptr), sampleRate (0), lastStartTicks (0), lastBlockTicks (0)
+{
+}
+
+void AudioCallbackTelemetry::reset() noexcept
+{
+    numCallbacks = 0;
+    numDeadlineMisses = 0;
+    durations.reset();
+    jitter.reset();
+
+    for (int i = 0; i < maxNumTrackedCallbacks; ++i)
+    {
+        CostSlot& slot = costs[i];
+        slot.numCalls = 0;
+        slot.totalMicroseconds = 0;
+        slot.maxMicroseconds = 0;
+    }
+}
+
+double AudioCallbackTelemetry::getDeadlineUsagePercentile (const double percentile) const noexcept
+{
+    const int blockMicros = blockMicroseconds.get();
+    return blockMicros > 0 ? durations.getPercentileMs (percentile) * 100000.0 / blockMicros : 0.0;
+}
+
+Array<AudioCallbackTelemetry::CallbackCost> AudioCallbackTelemetry::getCallbackCosts() const
+{
+    Array<CallbackCost> result;
+
+    for (int i = 0; i < maxNumTrackedCallbacks; ++i)
+    {
+        const CostSlot& slot = costs[i];
+
+        if (AudioIODeviceCallback* const cb = slot.callback.get())
+        {
+            const int64 num = slot.numCalls.get();
+
+            CallbackCost cost;
+            cost.callback = cb;
+            cost.numCalls = num;
+            cost.averageMs = num > 0 ? slot.totalMicroseconds.get() / (1000.0 * num) : 0.0;
+            cost.maximumMs = slot.maxMicroseconds.get() / 1000.0;
+            result.add (cost);
+        }
+    }
+
+    return result;
+}
+
+String AudioCallbackTelemetry::getSummary() const
+{
+    const int blockMicros = blockMicroseconds.get();
+
+    String s;
+    s << "Callbacks: " << getNumCallbacks()
+      << ", block duration: " << String (blockMicros / 1000.0, 3) << " ms"
+      << ", deadline misses: " << getNumDeadlineMisses()
+      << ", xruns: " << (getXRunCount() >= 0 ? String (getXRunCount()) : String ("n/a"))
+      << ", reported round-trip latency: " << getReportedRoundTripLatencySamples() << " samples" << newLine;
+
+    const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+    s << "Duration (ms): avg " << String (durations.getAverageMs(), 3)
+      << ", max " << String (durations.getMaximumMs(), 3);
+
+    for (int i = 0; i < numElementsInArray (percentiles); ++i)
+        s << ", p" << percentiles[i] << " " << String (durations.getPercentileMs (percentiles[i]), 3)
+          << " (" << String (getDeadlineUsagePercentile (percentiles[i]), 1) << "%)";
+
+    s << newLine << "Jitter (ms): avg " << String (jitter.getAverageMs(), 3)
+      << ", max " << String (jitter.getMaximumMs(), 3);
+
+    for (int i = 0; i < numElementsInArray (percentiles); ++i)
+        s << ", p" << percentiles[i] << " " << String (jitter.getPercentileMs (percentiles[i]), 3);
+
+    s << newLine;
+
+    const Array<CallbackCost> callbackCosts (getCallbackCosts());
+
+    for (int i = 0; i < callbackCosts.size(); ++i)
+    {
+        const CallbackCost& c = callbackCosts.getReference (i);
+        s << "Callback " << i << ": " << c.numCalls << " calls, avg "
+          << String (c.averageMs, 3) << " ms, max " << String (c.maximumMs, 3) << " ms" << newLine;
+    }
+
+    return s;
+}
+
+//==============================================================================
+void AudioCallbackTelemetry::deviceAboutToStart (AudioIODevice& newDevice) noexcept
+{
+    device = &newDevice;
+    sampleRate = newDevice.getCurrentSampleRate();
+    lastStartTicks = 0;
+    lastBlockTicks = 0;
+    xruns = newDevice.getXRunCount();
+    roundTripLatency = newDevice.getInputLatencyInSamples() + newDevice.getOutputLatencyInSamples();
+
+    if (sampleRate > 0)
+        blockMicroseconds = (int) (1.0e6 * newDevice.getCurrentBufferSizeSamples() / sampleRate);
+}
+
+void AudioCallbackTelemetry::blockStarted (const int64 startTicks, const int numSamples) noexcept
+{
+    if (lastStartTicks != 0)
+        jitter.addTime (1000.0 * Time::highResolutionTicksToSeconds (std::abs ((startTicks - lastStartTicks) - lastBlockTicks)));
+
+    lastStartTicks = startTicks;
+    lastBlockTicks = sampleRate > 0 ? Time::secondsToHighResolutionTicks (numSamples / sampleRate) : 0;
+}
+
+void AudioCallbackTelemetry::callbackFinished (const int callbackIndex, AudioIODeviceCallback* const callback,
+                                               const int64 ticksTaken) noexcept
+{
+    if (isPositiveAndBelow (callbackIndex, (int) maxNumTrackedCallbacks))
+    {
+        CostSlot& slot = costs[callbackIndex];
+
+        if (slot.callback.get() != callback)
+        {
+            slot.numCalls = 0;
+            slot.totalMicroseconds = 0;
+            slot.maxMicroseconds = 0;
+            slot.callback = callback;
+        }
+
+        const int micros = (int) jmin ((int64) std::numeric_limits<int>::max(),
+                                       (int64) (1.0e6 * Time::highResolutionTicksToSeconds (ticksTaken)));
+        ++slot.numCalls;
+        slot.totalMicroseconds += micros;
+
+        if (micros > slot.maxMicroseconds.get())
+            slot.maxMicroseconds = micros;
+    }
+}
+
+void AudioCallbackTelemetry::blockFinished (const int64 ticksTaken, const int numSamples, const int numCallbacksMade) noexcept
+{
+    const double secondsTaken = Time::highResolutionTicksToSeconds (ticksTaken);
+
+    ++numCallbacks;
+    durations.addTime (1000.0 * secondsTaken);
+
+    if (sampleRate > 0 && secondsTaken * sampleRate > numSamples)
+        ++numDeadlineMisses;
+
+    if (device != nullptr)
+        xruns = device->getXRunCount();
+
+    for (int i = numCallbacksMade; i < maxNumTrackedCallbacks; ++i)
+        if (costs[i].callback.get() != nullptr)
+            costs[i].callback = nullptr;
+}
+
+void AudioCallbackTelemetry::deviceStopped() noexcept
+{
+    device = nullptr;
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+#ifndef JUCE_AUDIOCALLBACKTELEMETRY_H_INCLUDED
+#define JUCE_AUDIOCALLBACKTELEMETRY_H_INCLUDED
+
+
+//==============================================================================
+/**
+    Collects timing statistics about the audio callbacks that an AudioDeviceManager
+    makes.
+
+    You don't create one of these yourself - each AudioDeviceManager has one, which
+    you can get with AudioDeviceManager::getCallbackTelemetry(). Collection is off by
+    default, and while it's disabled the audio thread does nothing more than check a
+    flag, so it can safely be left compiled into release builds and switched on with
+    AudioDeviceManager::setCallbackTelemetryEnabled() when you need it.
+
+    All the values are held in atomic counters which are only ever written by the
+    audio thread, so any other thread can read them at any time without locking.
+    The individual values are each consistent, but because the audio thread may be
+    updating them while you read, the set of values you get back won't necessarily
+    all describe exactly the same number of callbacks.
+
+    @see AudioDeviceManager::setCallbackTelemetryEnabled
+*/
+class JUCE_API  AudioCallbackTelemetry
+{
+public:
+    //==============================================================================
+    /** A lock-free histogram of times.
+
+        The buckets are spaced logarithmically, with several buckets per octave,
+        starting at 1 microsecond and going up to many seconds, so percentiles read
+        back from it are accurate to within about 20%.
+    */
+    class JUCE_API  Histogram
+    {
+    public:
+        Histogram() noexcept;
+
+        enum
+        {
+            bucketsPerOctave = 4,
+            numBuckets = bucketsPerOctave * 24
+        };
+
+        /** Adds a time to the histogram. This must only be called by one thread at a time. */
+        void addTime (double milliseconds) noexcept;
+
+        /** Clears all the buckets. */
+        void reset() noexcept;
+
+        /** Returns the number of times that have been added since the last reset. */
+        int64 getTotalCount() const noexcept;
+
+        /** Returns the number of times that fell into the given bucket. */
+        int getBucketCount (int bucketIndex) const noexcept;
+
+        /** Returns the (exclusive) upper limit of the times that fall into a bucket. */
+        static double getBucketUpperLimitMs (int bucketIndex) noexcept;
+
+        /** Returns an estimate of the time below which the given percentage of the
+            times fell, e.g. getPercentileMs (99.0). Returns 0 if it's empty.
+        */
+        double getPercentileMs (double percentile) const noexcept;
+
+        /** Returns the longest time that has been added. */
+        double getMaximumMs() const noexcept;
+
+        /** Returns the mean of the times that have been added. */
+        double getAverageMs() const noexcept;
+
+    private:
+        Atomic<int> buckets [numBuckets];
+        Atomic<int64> total, totalMicroseconds;
+        Atomic<int> maxMicroseconds;
+
+        JUCE_DECLARE_NON_COPYABLE (Histogram)
+    };
+
+    //==============================================================================
+    /** Returns true if the AudioDeviceManager is currently collecting statistics. */
+    bool isEnabled() const noexcept                                 { return enabled.get() != 0; }
+
+    /** Clears all the statistics that have been gathered so far.
+        This can be called from any thread, although if the audio thread is running at
+        the same time, a callback that's in progress may be only partially counted.
+    */
+    void reset() noexcept;
+
+    //==============================================================================
+    /** Returns the number of device callbacks that have been measured. */
+    int64 getNumCallbacks() const noexcept                          { return numCallbacks.get(); }
+
+    /** Returns a histogram of the total time taken by each device callback, i.e. the
+        time spent inside all the registered AudioIODeviceCallbacks together.
+    */
+    const Histogram& getCallbackDurations() const noexcept          { return durations; }
+
+    /** Returns a histogram of the jitter between device callbacks.
+
+        Each value is the difference between the time that elapsed since the previous
+        callback started and the duration of the previous block, so a device that calls
+        back perfectly regularly would put everything into the lowest bucket.
+    */
+    const Histogram& getCallbackJitter() const noexcept             { return jitter; }
+
+    /** Returns the number of callbacks that took longer than the duration of the block
+        that they were processing, and which would therefore have caused a glitch on a
+        device that needs the data in real-time.
+    */
+    int64 getNumDeadlineMisses() const noexcept                     { return numDeadlineMisses.get(); }
+
+    /** Returns the time taken by a callback as a percentage of the block duration, for
+        the given percentile of callbacks, e.g. getDeadlineUsagePercentile (99.0).
+        A value over 100 means that at least that proportion of callbacks missed their
+        deadline.
+    */
+    double getDeadlineUsagePercentile (double percentile) const noexcept;
+
+    /** Returns the number of over- or under-runs the device has reported since it was
+        started, or -1 if the device doesn't keep count.
+        @see AudioIODevice::getXRunCount
+    */
+    int getXRunCount() const noexcept                               { return xruns.get(); }
+
+    /** Returns the round-trip latency that the device reported when it started, i.e.
+        its input latency plus its output latency, in samples.
+    */
+    int getReportedRoundTripLatencySamples() const noexcept         { return roundTripLatency.get(); }
+
+    //==============================================================================
+    /** The cost of one of the AudioIODeviceCallbacks registered with the manager. */
+    struct CallbackCost
+    {
+        AudioIODeviceCallback* callback;
+        int64 numCalls;
+        double averageMs, maximumMs;
+    };
+
+    /** Returns the costs of the callbacks that are currently registered, in the order
+        that the manager calls them. Only the first maxNumTrackedCallbacks are measured.
+    */
+    Array<CallbackCost> getCallbackCosts() const;
+
+    enum { maxNumTrackedCallbacks = 16 };
+
+    //==============================================================================
+    /** Returns a multi-line, human-readable summary of all the statistics. */
+    String getSummary() const;
+
+private:
+    //==============================================================================
+    friend class AudioDeviceManager;
+    friend class AudioCallbackTelemetryTests;
+
+    struct CostSlot
+    {
+        Atomic<AudioIODeviceCallback*> callback;
+        Atomic<int64> numCalls, totalMicroseconds;
+        Atomic<int> maxMicroseconds;
+    };
+
+    Atomic<int> enabled, xruns, roundTripLatency, blockMicroseconds;
+    Atomic<int64> numCallbacks, numDeadlineMisses;
+    Histogram durations, jitter;
+    CostSlot costs [maxNumTrackedCallbacks];
+    AudioIODevice* device;
+    double sampleRate;
+    int64 lastStartTicks, lastBlockTicks;
+
+    AudioCallbackTelemetry() noexcept;
+
+    void deviceAboutToStart (AudioIODevice&) noexcept;
+    void blockStarted (int64 startTicks, int numSamples) noexcept;
+    void callbackFinished (int callbackIndex, AudioIODeviceCallback*, int64 ticksTaken) noexcept;
+    void blockFinished (int64 ticksTaken, int numSamples, int numCallbacksMade) noexcept;
+    void deviceStopped() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (AudioCallbackTelemetry)
+};
+
+
+#endif   // JUCE_AUDIOCALLBACKTELEMETRY_H_INCLUDED
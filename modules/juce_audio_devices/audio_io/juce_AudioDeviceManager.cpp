@@ -766,19 +766,32 @@ void AudioDeviceManager::audioDeviceIOCallbackInt (const float** inputChannelDat
     if (callbacks.size() > 0)
     {
         const double callbackStartTime = Time::getMillisecondCounterHiRes();
+        const bool measuring = telemetry.isEnabled();
+        const int64 blockStartTicks = measuring ? Time::getHighResolutionTicks() : 0;
+
+        if (measuring)
+            telemetry.blockStarted (blockStartTicks, numSamples);
 
         tempBuffer.setSize (jmax (1, numOutputChannels), jmax (1, numSamples), false, false, true);
 
         callbacks.getUnchecked(0)->audioDeviceIOCallback (inputChannelData, numInputChannels,
                                                           outputChannelData, numOutputChannels, numSamples);
 
+        if (measuring)
+            telemetry.callbackFinished (0, callbacks.getUnchecked(0), Time::getHighResolutionTicks() - blockStartTicks);
+
         float** const tempChans = tempBuffer.getArrayOfWritePointers();
 
         for (int i = callbacks.size(); --i > 0;)
         {
+            const int64 startTicks = measuring ? Time::getHighResolutionTicks() : 0;
+
             callbacks.getUnchecked(i)->audioDeviceIOCallback (inputChannelData, numInputChannels,
                                                               tempChans, numOutputChannels, numSamples);
 
+            if (measuring)
+                telemetry.callbackFinished (i, callbacks.getUnchecked(i), Time::getHighResolutionTicks() - startTicks);
+
             for (int chan = 0; chan < numOutputChannels; ++chan)
             {
                 if (const float* const src = tempChans [chan])
@@ -788,6 +801,9 @@ void AudioDeviceManager::audioDeviceIOCallbackInt (const float** inputChannelDat
             }
         }
 
+        if (measuring)
+            telemetry.blockFinished (Time::getHighResolutionTicks() - blockStartTicks, numSamples, callbacks.size());
+
         const double msTaken = Time::getMillisecondCounterHiRes() - callbackStartTime;
         const double filterAmount = 0.2;
         cpuUsageMs += filterAmount * (msTaken - cpuUsageMs);
@@ -812,6 +828,8 @@ void AudioDeviceManager::audioDeviceAboutToStartInt (AudioIODevice* const device
         timeToCpuScale = (msPerBlock > 0.0) ? (1.0 / msPerBlock) : 0.0;
     }
 
+    telemetry.deviceAboutToStart (*device);
+
     {
         const ScopedLock sl (audioCallbackLock);
         for (int i = callbacks.size(); --i >= 0;)
@@ -825,6 +843,7 @@ void AudioDeviceManager::audioDeviceStoppedInt()
 {
     cpuUsageMs = 0;
     timeToCpuScale = 0;
+    telemetry.deviceStopped();
     sendChangeMessage();
 
     const ScopedLock sl (audioCallbackLock);
@@ -844,6 +863,11 @@ double AudioDeviceManager::getCpuUsage() const
     return jlimit (0.0, 1.0, timeToCpuScale * cpuUsageMs);
 }
 
+void AudioDeviceManager::setCallbackTelemetryEnabled (const bool shouldBeEnabled) noexcept
+{
+    telemetry.enabled.set (shouldBeEnabled ? 1 : 0);
+}
+
 //==============================================================================
 void AudioDeviceManager::setMidiInputEnabled (const String& name, const bool enabled)
 {
@@ -1165,3 +1189,265 @@ double AudioDeviceManager::getCurrentOutputLevel() const noexcept   { return out
 
 void AudioDeviceManager::enableInputLevelMeasurement  (bool enable) noexcept  { inputLevelMeter.setEnabled (enable); }
 void AudioDeviceManager::enableOutputLevelMeasurement (bool enable) noexcept  { outputLevelMeter.setEnabled (enable); }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioCallbackTelemetryTests  : public UnitTest
+{
+public:
+    AudioCallbackTelemetryTests() : UnitTest ("AudioCallbackTelemetry") {}
+
+    // A headless device which runs a fixed number of callbacks on its own thread, as
+    // fast as they'll go, so that the results don't depend on any real hardware.
+    struct DummyDevice  : public AudioIODevice,
+                          public Thread
+    {
+        DummyDevice (int blocksToRun)
+            : AudioIODevice ("Dummy", "Dummy"), Thread ("Dummy audio"),
+              numBlocksToRun (blocksToRun), callback (nullptr), opened (false)
+        {}
+
+        ~DummyDevice()              { close(); }
+
+        StringArray getOutputChannelNames() override        { return StringArray::fromTokens ("Left Right", false); }
+        StringArray getInputChannelNames() override         { return StringArray(); }
+        Array<double> getAvailableSampleRates() override    { Array<double> r; r.add (48000.0); return r; }
+        Array<int> getAvailableBufferSizes() override       { Array<int> r; r.add (480); return r; }
+        int getDefaultBufferSize() override                 { return 480; }
+
+        String open (const BigInteger&, const BigInteger&, double, int) override
+        {
+            opened = true;
+            return String();
+        }
+
+        void close() override                               { stop(); opened = false; }
+        bool isOpen() override                              { return opened; }
+
+        void start (AudioIODeviceCallback* cb) override
+        {
+            stop();
+            callback = cb;
+            callback->audioDeviceAboutToStart (this);
+            startThread();
+        }
+
+        void stop() override
+        {
+            stopThread (5000);
+
+            if (callback != nullptr)
+            {
+                callback->audioDeviceStopped();
+                callback = nullptr;
+            }
+        }
+
+        bool isPlaying() override                           { return callback != nullptr; }
+        String getLastError() override                      { return String(); }
+        int getCurrentBufferSizeSamples() override          { return 480; }
+        double getCurrentSampleRate() override              { return 48000.0; }
+        int getCurrentBitDepth() override                   { return 32; }
+        BigInteger getActiveOutputChannels() const override { return BigInteger (3); }
+        BigInteger getActiveInputChannels() const override  { return BigInteger(); }
+        int getOutputLatencyInSamples() override            { return 480; }
+        int getInputLatencyInSamples() override             { return 0; }
+        int getXRunCount() const noexcept override          { return 0; }
+
+        void run() override
+        {
+            AudioSampleBuffer buffer (2, 480);
+
+            for (int i = 0; i < numBlocksToRun && ! threadShouldExit(); ++i)
+                callback->audioDeviceIOCallback (nullptr, 0, buffer.getArrayOfWritePointers(), 2, 480);
+        }
+
+        const int numBlocksToRun;
+        AudioIODeviceCallback* callback;
+        bool opened;
+    };
+
+    struct DummyDeviceType  : public AudioIODeviceType
+    {
+        DummyDeviceType (int blocksToRun) : AudioIODeviceType ("Dummy"), numBlocksToRun (blocksToRun) {}
+
+        void scanForDevices() override                                      {}
+        StringArray getDeviceNames (bool wantInputNames) const override     { return wantInputNames ? StringArray() : StringArray ("Dummy"); }
+        int getDefaultDeviceIndex (bool forInput) const override            { return forInput ? -1 : 0; }
+        int getIndexOfDevice (AudioIODevice*, bool asInput) const override  { return asInput ? -1 : 0; }
+        bool hasSeparateInputsAndOutputs() const override                   { return false; }
+
+        AudioIODevice* createDevice (const String&, const String&) override { return new DummyDevice (numBlocksToRun); }
+
+        const int numBlocksToRun;
+    };
+
+    // Takes about 1 ms per block, and every tenth block takes 15 ms, i.e. longer than
+    // the 10 ms that a 480-sample block at 48 kHz lasts.
+    struct SlowCallback  : public AudioIODeviceCallback
+    {
+        SlowCallback() : numCalls (0) {}
+
+        void audioDeviceIOCallback (const float**, int, float**, int, int) override
+        {
+            Thread::sleep (++numCalls % 10 == 0 ? 15 : 1);
+        }
+
+        void audioDeviceAboutToStart (AudioIODevice*) override {}
+        void audioDeviceStopped() override {}
+
+        int numCalls;
+    };
+
+    struct QuietCallback  : public AudioIODeviceCallback
+    {
+        void audioDeviceIOCallback (const float**, int, float** outs, int numOuts, int numSamples) override
+        {
+            for (int i = 0; i < numOuts; ++i)
+                FloatVectorOperations::clear (outs[i], numSamples);
+        }
+
+        void audioDeviceAboutToStart (AudioIODevice*) override {}
+        void audioDeviceStopped() override {}
+    };
+
+    void runTest() override
+    {
+        beginTest ("Histogram");
+        {
+            AudioCallbackTelemetry::Histogram h;
+
+            for (int i = 1; i <= 100; ++i)
+                h.addTime (i * 0.1);
+
+            expectEquals ((int) h.getTotalCount(), 100);
+            expectWithinAbsoluteError (h.getAverageMs(), 5.05, 0.01);
+            expectWithinAbsoluteError (h.getMaximumMs(), 10.0, 0.001);
+
+            // percentiles are quantised to quarter-octaves, so allow ~20%
+            expectWithinAbsoluteError (h.getPercentileMs (50.0), 5.0, 1.0);
+            expectWithinAbsoluteError (h.getPercentileMs (90.0), 9.0, 1.8);
+            expectWithinAbsoluteError (h.getPercentileMs (100.0), 10.0, 0.001);
+
+            h.reset();
+            expectEquals ((int) h.getTotalCount(), 0);
+            expectEquals (h.getPercentileMs (99.0), 0.0);
+        }
+
+        beginTest ("Statistics from a simulated timeline");
+        {
+            // Feeds in exact timings, so that the counts don't depend on the scheduler
+            DummyDevice device (0);
+            QuietCallback quiet;
+            SlowCallback slow;
+
+            AudioCallbackTelemetry t;
+            t.deviceAboutToStart (device);
+
+            const int64 blockTicks = Time::secondsToHighResolutionTicks (480 / 48000.0);
+            const int64 msTicks    = Time::secondsToHighResolutionTicks (0.001);
+            int64 startTicks = 1000 * blockTicks;
+
+            for (int i = 1; i <= 100; ++i)
+            {
+                // every tenth block takes 15 ms, and every fifth one starts 2 ms late
+                const int64 slowTicks = (i % 10 == 0 ? 15 : 1) * msTicks;
+                const int64 quietTicks = msTicks / 10;
+
+                t.blockStarted (startTicks + (i % 5 == 0 ? 2 * msTicks : 0), 480);
+                t.callbackFinished (0, &quiet, quietTicks);
+                t.callbackFinished (1, &slow, quietTicks + slowTicks);
+                t.blockFinished (quietTicks + slowTicks, 480, 2);
+                startTicks += blockTicks;
+            }
+
+            expectEquals ((int) t.getNumCallbacks(), 100);
+            expectEquals ((int) t.getNumDeadlineMisses(), 10);
+            expectEquals ((int) t.getCallbackJitter().getTotalCount(), 99);
+            expectWithinAbsoluteError (t.getCallbackJitter().getMaximumMs(), 2.0, 0.01);
+            expectEquals (t.getReportedRoundTripLatencySamples(), 480);
+            expectGreaterThan (t.getDeadlineUsagePercentile (95.0), 100.0);
+            expectLessThan (t.getDeadlineUsagePercentile (50.0), 100.0);
+
+            const Array<AudioCallbackTelemetry::CallbackCost> costs (t.getCallbackCosts());
+            expectEquals (costs.size(), 2);
+            expect (costs[1].callback == &slow);
+            expectEquals ((int) costs[1].numCalls, 100);
+            expectWithinAbsoluteError (costs[1].maximumMs, 15.1, 0.01);
+            expectWithinAbsoluteError (costs[1].averageMs, 2.5, 0.01);
+            expectWithinAbsoluteError (costs[0].averageMs, 0.1, 0.01);
+        }
+
+        const int numBlocks = 100;
+        AudioDeviceManager manager;
+        manager.addAudioDeviceType (new DummyDeviceType (numBlocks));
+
+        beginTest ("Disabled telemetry records nothing");
+        {
+            QuietCallback quiet;
+            manager.addAudioCallback (&quiet);
+            expect (manager.initialise (0, 2, nullptr, true).isEmpty());
+            waitForDevice (manager);
+            manager.closeAudioDevice();
+            manager.removeAudioCallback (&quiet);
+
+            expect (! manager.getCallbackTelemetry().isEnabled());
+            expectEquals ((int) manager.getCallbackTelemetry().getNumCallbacks(), 0);
+        }
+
+        beginTest ("Headless dump from a dummy device");
+        {
+            QuietCallback quiet;
+            SlowCallback slow;
+            manager.addAudioCallback (&quiet);
+            manager.addAudioCallback (&slow);
+            manager.setCallbackTelemetryEnabled (true);
+            manager.restartLastAudioDevice();
+            waitForDevice (manager);
+            manager.closeAudioDevice();
+
+            const AudioCallbackTelemetry& t = manager.getCallbackTelemetry();
+            logMessage (t.getSummary());
+
+            expectEquals ((int) t.getNumCallbacks(), numBlocks);
+            expectEquals ((int) t.getCallbackDurations().getTotalCount(), numBlocks);
+            expectEquals ((int) t.getCallbackJitter().getTotalCount(), numBlocks - 1);
+            // The slow blocks always miss, but on a loaded machine some of the others may too
+            expectGreaterOrEqual ((int) t.getNumDeadlineMisses(), numBlocks / 10);
+            expectLessThan ((int) t.getNumDeadlineMisses(), numBlocks / 2);
+            expectEquals (t.getXRunCount(), 0);
+            expectEquals (t.getReportedRoundTripLatencySamples(), 480);
+            expectGreaterThan (t.getDeadlineUsagePercentile (95.0), 100.0);
+
+            const Array<AudioCallbackTelemetry::CallbackCost> costs (t.getCallbackCosts());
+            expectEquals (costs.size(), 2);
+            expect (costs[0].callback == &quiet);
+            expect (costs[1].callback == &slow);
+            expectEquals ((int) costs[1].numCalls, numBlocks);
+            // (the sleep only sets a lower bound on how long the slow blocks take, so the
+            // actual timings aren't checked)
+            expectGreaterThan (costs[1].averageMs, 0.0);
+            expectGreaterOrEqual (costs[1].maximumMs, costs[1].averageMs);
+            expectGreaterThan (costs[1].averageMs, costs[0].averageMs);
+
+            manager.resetCallbackTelemetry();
+            expectEquals ((int) t.getNumCallbacks(), 0);
+            expectEquals ((int) t.getNumDeadlineMisses(), 0);
+
+            manager.removeAudioCallback (&slow);
+            manager.removeAudioCallback (&quiet);
+        }
+    }
+
+    static void waitForDevice (AudioDeviceManager& manager)
+    {
+        if (DummyDevice* d = dynamic_cast<DummyDevice*> (manager.getCurrentAudioDevice()))
+            while (d->isThreadRunning())
+                Thread::sleep (5);
+    }
+};
+
+static AudioCallbackTelemetryTests audioCallbackTelemetryTests;
+
+#endif
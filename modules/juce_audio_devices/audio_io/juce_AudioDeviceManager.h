@@ -307,6 +307,25 @@ public:
     */
     double getCpuUsage() const;
 
+    /** Turns the collection of detailed audio callback statistics on or off.
+
+        When enabled, the manager times each device callback and each of the registered
+        AudioIODeviceCallbacks, and keeps histograms of the results which can be read
+        lock-free from any thread via getCallbackTelemetry(). It's off by default, and
+        costs almost nothing while disabled.
+
+        @see getCallbackTelemetry
+    */
+    void setCallbackTelemetryEnabled (bool shouldBeEnabled) noexcept;
+
+    /** Returns the statistics that have been collected about the audio callbacks.
+        @see setCallbackTelemetryEnabled
+    */
+    const AudioCallbackTelemetry& getCallbackTelemetry() const noexcept    { return telemetry; }
+
+    /** Clears the statistics that have been collected about the audio callbacks. */
+    void resetCallbackTelemetry() noexcept                                  { telemetry.reset(); }
+
     //==============================================================================
     /** Enables or disables a midi input device.
 
@@ -520,6 +539,7 @@ private:
     CriticalSection audioCallbackLock, midiCallbackLock;
 
     double cpuUsageMs, timeToCpuScale;
+    AudioCallbackTelemetry telemetry;
 
     struct LevelMeter
     {
@@ -274,6 +274,14 @@ public:
     */
     virtual int getInputLatencyInSamples() = 0;
 
+    /** Returns the number of under- or overruns that the device has reported since it
+        was opened.
+
+        This can be used to detect whether the device is being overloaded, e.g. so that
+        the user can be warned. Not all device types are able to report this, in which
+        case the method will return -1.
+    */
+    virtual int getXRunCount() const noexcept;
 
     //==============================================================================
     /** True if this device can show a pop-up control panel for editing its settings.
@@ -164,6 +164,12 @@ public:
     static AudioIODeviceType* createAudioIODeviceType_Android();
     /** Creates an Android OpenSLES device type if it's available on this platform, or returns null. */
     static AudioIODeviceType* createAudioIODeviceType_OpenSLES();
+    /** Creates a device type with a single device that isn't connected to any hardware, and which
+        renders as fast as possible. This is available on all platforms, but isn't included in the
+        list that AudioDeviceManager::createAudioDeviceTypes() returns.
+        @see OfflineAudioIODevice
+    */
+    static AudioIODeviceType* createAudioIODeviceType_Offline();
 
 protected:
     explicit AudioIODeviceType (const String& typeName);
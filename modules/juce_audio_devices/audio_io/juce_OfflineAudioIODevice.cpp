@@ -0,0 +1,692 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+OfflineAudioIODevice::OfflineAudioIODevice (const String& deviceName, int maxNumInputChannels, int maxNumOutputChannels)
+    : AudioIODevice (deviceName, "Offline"),
+      Thread ("Offline audio render"),
+      maxNumInputs (jmax (0, maxNumInputChannels)),
+      maxNumOutputs (jmax (0, maxNumOutputChannels)),
+      sampleRate (44100.0), speedMultiple (0),
+      bufferSize (512), length (-1),
+      deviceIsOpen (false),
+      callback (nullptr),
+      finishedEvent (true),
+      renderStartTime (0)
+{
+}
+
+OfflineAudioIODevice::~OfflineAudioIODevice()
+{
+    close();
+}
+
+//==============================================================================
+void OfflineAudioIODevice::setInputSource (AudioFormatReader* newReader, bool deleteWhenNoLongerNeeded)
+{
+    jassert (! isPlaying());
+    reader.set (newReader, deleteWhenNoLongerNeeded);
+}
+
+void OfflineAudioIODevice::setOutputDestination (AudioFormatWriter* newWriter, bool deleteWhenNoLongerNeeded)
+{
+    jassert (! isPlaying());
+    writer.set (newWriter, deleteWhenNoLongerNeeded);
+}
+
+void OfflineAudioIODevice::setLengthInSamples (int64 numSamples) noexcept   { length = numSamples; }
+int64 OfflineAudioIODevice::getLengthInSamples() const noexcept             { return getTotalLength(); }
+void OfflineAudioIODevice::setSpeedMultiple (double multiple) noexcept      { speedMultiple = multiple; }
+
+int64 OfflineAudioIODevice::getTotalLength() const noexcept
+{
+    if (length >= 0)
+        return length;
+
+    return reader != nullptr ? reader->lengthInSamples : -1;
+}
+
+//==============================================================================
+StringArray OfflineAudioIODevice::getOutputChannelNames()
+{
+    StringArray names;
+
+    for (int i = 0; i < maxNumOutputs; ++i)
+        names.add ("Output " + String (i + 1));
+
+    return names;
+}
+
+StringArray OfflineAudioIODevice::getInputChannelNames()
+{
+    StringArray names;
+
+    for (int i = 0; i < maxNumInputs; ++i)
+        names.add ("Input " + String (i + 1));
+
+    return names;
+}
+
+Array<double> OfflineAudioIODevice::getAvailableSampleRates()
+{
+    static const double rates[] = { 22050.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+    Array<double> result (rates, numElementsInArray (rates));
+
+    if (reader != nullptr && ! result.contains (reader->sampleRate))
+        result.addUsingDefaultSort (reader->sampleRate);
+
+    return result;
+}
+
+Array<int> OfflineAudioIODevice::getAvailableBufferSizes()
+{
+    Array<int> sizes;
+
+    for (int i = 32; i <= 8192; i *= 2)
+        sizes.add (i);
+
+    return sizes;
+}
+
+int OfflineAudioIODevice::getDefaultBufferSize()                    { return 512; }
+
+String OfflineAudioIODevice::open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+                                   double newSampleRate, int newBufferSize)
+{
+    close();
+
+    activeInputs = inputChannels;
+    activeInputs.setRange (maxNumInputs, activeInputs.getHighestBit() + 1, false);
+    activeOutputs = outputChannels;
+    activeOutputs.setRange (maxNumOutputs, activeOutputs.getHighestBit() + 1, false);
+
+    sampleRate = newSampleRate > 0 ? newSampleRate
+                                   : (reader != nullptr ? reader->sampleRate : 44100.0);
+    bufferSize = newBufferSize > 0 ? newBufferSize : getDefaultBufferSize();
+
+    deviceIsOpen = true;
+    lastError.clear();
+    return lastError;
+}
+
+void OfflineAudioIODevice::close()
+{
+    stop();
+    deviceIsOpen = false;
+}
+
+bool OfflineAudioIODevice::isOpen()                                 { return deviceIsOpen; }
+bool OfflineAudioIODevice::isPlaying()                              { return callback != nullptr && ! hasStoppedRendering(); }
+String OfflineAudioIODevice::getLastError()                         { return lastError; }
+int OfflineAudioIODevice::getCurrentBufferSizeSamples()             { return bufferSize; }
+double OfflineAudioIODevice::getCurrentSampleRate()                 { return sampleRate; }
+int OfflineAudioIODevice::getCurrentBitDepth()                      { return 32; }
+BigInteger OfflineAudioIODevice::getActiveOutputChannels() const    { return activeOutputs; }
+BigInteger OfflineAudioIODevice::getActiveInputChannels() const     { return activeInputs; }
+int OfflineAudioIODevice::getOutputLatencyInSamples()               { return 0; }
+int OfflineAudioIODevice::getInputLatencyInSamples()                { return 0; }
+
+void OfflineAudioIODevice::start (AudioIODeviceCallback* newCallback)
+{
+    jassert (deviceIsOpen);
+
+    if (deviceIsOpen && newCallback != callback)
+    {
+        stop();
+
+        if (newCallback != nullptr)
+        {
+            newCallback->audioDeviceAboutToStart (this);
+            prepareBuffers();
+
+            const ScopedLock sl (startStopLock);
+            callback = newCallback;
+            startThread (8);
+        }
+    }
+}
+
+void OfflineAudioIODevice::stop()
+{
+    AudioIODeviceCallback* oldCallback;
+
+    {
+        const ScopedLock sl (startStopLock);
+        oldCallback = callback;
+    }
+
+    if (oldCallback != nullptr)
+    {
+        stopThread (10000);
+
+        {
+            const ScopedLock sl (startStopLock);
+            callback = nullptr;
+        }
+
+        oldCallback->audioDeviceStopped();
+    }
+}
+
+bool OfflineAudioIODevice::waitForCompletion (int timeoutMilliseconds)
+{
+    jassert (getTotalLength() >= 0); // an unlimited render never completes!
+    return finishedEvent.wait (timeoutMilliseconds) && hasFinishedRendering();
+}
+
+bool OfflineAudioIODevice::renderSynchronously (AudioIODeviceCallback& cb)
+{
+    jassert (deviceIsOpen && ! isPlaying());
+
+    if (getTotalLength() < 0 || ! deviceIsOpen)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    cb.audioDeviceAboutToStart (this);
+    prepareBuffers();
+
+    for (;;)
+    {
+        const int msToWait = getMillisecondsUntilNextBlock();
+
+        if (msToWait > 0)
+            Thread::sleep (msToWait);
+
+        if (! renderNextBlock (cb))
+            break;
+    }
+
+    cb.audioDeviceStopped();
+    return hasFinishedRendering();
+}
+
+//==============================================================================
+void OfflineAudioIODevice::prepareBuffers()
+{
+    const int numIns  = activeInputs.getHighestBit() + 1;
+    const int numOuts = jmax (activeOutputs.getHighestBit() + 1,
+                              writer != nullptr ? (int) writer->getNumChannels() : 0);
+
+    inputBuffer.setSize (jmax (1, numIns), bufferSize);
+    outputBuffer.setSize (jmax (1, numOuts), bufferSize);
+    inputBuffer.clear();
+
+    numSamplesRendered = 0;
+    finished = stillRendering;
+    finishedEvent.reset();
+    renderStartTime = Time::getMillisecondCounterHiRes();
+}
+
+int OfflineAudioIODevice::getMillisecondsUntilNextBlock() const noexcept
+{
+    if (speedMultiple <= 0)
+        return 0;
+
+    const double due = renderStartTime + 1000.0 * numSamplesRendered.get() / (sampleRate * speedMultiple);
+    return (int) (due - Time::getMillisecondCounterHiRes());
+}
+
+bool OfflineAudioIODevice::renderNextBlock (AudioIODeviceCallback& cb)
+{
+    const int64 totalLength = getTotalLength();
+    const int64 position = numSamplesRendered.get();
+
+    if (hasStoppedRendering())
+        return false;
+
+    const int numSamples = totalLength < 0 ? bufferSize
+                                           : (int) jmin ((int64) bufferSize, totalLength - position);
+
+    if (numSamples <= 0)
+    {
+        if (writer != nullptr)
+            writer->flush();
+
+        finishRendering (renderCompleted);
+        return false;
+    }
+
+    const int numIns  = activeInputs.getHighestBit() + 1;
+    const int numOuts = activeOutputs.getHighestBit() + 1;
+
+    if (reader != nullptr && numIns > 0)
+    {
+        // the callback may have scribbled on its inputs last time, and the final block may be short
+        if (numSamples < bufferSize)
+            inputBuffer.clear();
+
+        reader->read (&inputBuffer, 0, numSamples, position, true, true);
+    }
+
+    for (int i = numIns; --i >= 0;)
+        if (! activeInputs[i])
+            inputBuffer.clear (i, 0, bufferSize);
+
+    outputBuffer.clear();
+
+    cb.audioDeviceIOCallback (inputBuffer.getArrayOfReadPointers(), numIns,
+                              outputBuffer.getArrayOfWritePointers(), numOuts, bufferSize);
+
+    if (writer != nullptr)
+    {
+        for (int i = numOuts; --i >= 0;)
+            if (! activeOutputs[i])
+                outputBuffer.clear (i, 0, bufferSize);
+
+        if (! writer->writeFromFloatArrays (outputBuffer.getArrayOfReadPointers(),
+                                            (int) writer->getNumChannels(), numSamples))
+        {
+            lastError = "Couldn't write to the output";
+            finishRendering (renderFailed);
+            return false;
+        }
+    }
+
+    numSamplesRendered = position + numSamples;
+    return true;
+}
+
+void OfflineAudioIODevice::finishRendering (int state)
+{
+    finished = state;
+    finishedEvent.signal();
+}
+
+void OfflineAudioIODevice::run()
+{
+    while (! threadShouldExit())
+    {
+        const int msToWait = getMillisecondsUntilNextBlock();
+
+        if (msToWait > 0)
+        {
+            wait (msToWait);
+            continue;
+        }
+
+        AudioIODeviceCallback* cb;
+
+        {
+            const ScopedLock sl (startStopLock);
+            cb = callback;
+        }
+
+        if (cb == nullptr || ! renderNextBlock (*cb))
+            break;
+    }
+}
+
+//==============================================================================
+OfflineAudioIODevice::RenderJob::RenderJob (OfflineAudioIODevice* d, AudioIODeviceCallback& cb)
+    : ThreadPoolJob ("Offline render: " + (d != nullptr ? d->getName() : String())),
+      device (d), callback (cb), succeeded (false)
+{
+    jassert (device != nullptr && device->isOpen());
+}
+
+OfflineAudioIODevice::RenderJob::~RenderJob() {}
+
+ThreadPoolJob::JobStatus OfflineAudioIODevice::RenderJob::runJob()
+{
+    if (device == nullptr || ! device->isOpen() || device->getTotalLength() < 0)
+        return jobHasFinished;
+
+    OfflineAudioIODevice& d = *device;
+
+    callback.audioDeviceAboutToStart (&d);
+    d.prepareBuffers();
+
+    while (! shouldExit())
+    {
+        const int msToWait = d.getMillisecondsUntilNextBlock();
+
+        if (msToWait > 0)
+            Thread::sleep (jmin (msToWait, 50));
+        else if (! d.renderNextBlock (callback))
+            break;
+    }
+
+    succeeded = d.hasFinishedRendering();
+    callback.audioDeviceStopped();
+    return jobHasFinished;
+}
+
+//==============================================================================
+class OfflineAudioIODeviceType  : public AudioIODeviceType
+{
+public:
+    OfflineAudioIODeviceType()  : AudioIODeviceType ("Offline") {}
+
+    void scanForDevices() override {}
+
+    StringArray getDeviceNames (bool) const override        { return StringArray (getDeviceName()); }
+    int getDefaultDeviceIndex (bool) const override         { return 0; }
+    bool hasSeparateInputsAndOutputs() const override       { return false; }
+
+    int getIndexOfDevice (AudioIODevice* device, bool) const override
+    {
+        return dynamic_cast<OfflineAudioIODevice*> (device) != nullptr ? 0 : -1;
+    }
+
+    AudioIODevice* createDevice (const String& outputDeviceName, const String& inputDeviceName) override
+    {
+        if (outputDeviceName == getDeviceName() || inputDeviceName == getDeviceName())
+            return new OfflineAudioIODevice (getDeviceName(), 2, 2);
+
+        return nullptr;
+    }
+
+private:
+    static const char* getDeviceName() noexcept             { return "Offline Renderer"; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineAudioIODeviceType)
+};
+
+AudioIODeviceType* AudioIODeviceType::createAudioIODeviceType_Offline()
+{
+    return new OfflineAudioIODeviceType();
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class OfflineAudioIODeviceTests  : public UnitTest
+{
+public:
+    OfflineAudioIODeviceTests() : UnitTest ("OfflineAudioIODevice") {}
+
+    // Copies its inputs to its outputs at half the level.
+    struct HalfGainCallback  : public AudioIODeviceCallback
+    {
+        HalfGainCallback() : numStarts (0), numStops (0) {}
+
+        void audioDeviceIOCallback (const float** ins, int numIns, float** outs, int numOuts, int numSamples) override
+        {
+            for (int i = 0; i < numOuts; ++i)
+            {
+                if (i < numIns)
+                    FloatVectorOperations::copyWithMultiply (outs[i], ins[i], 0.5f, numSamples);
+                else
+                    FloatVectorOperations::clear (outs[i], numSamples);
+            }
+        }
+
+        void audioDeviceAboutToStart (AudioIODevice*) override  { ++numStarts; }
+        void audioDeviceStopped() override                      { ++numStops; }
+
+        int numStarts, numStops;
+    };
+
+    struct FailingWriter  : public AudioFormatWriter
+    {
+        FailingWriter (int samplesBeforeFailing)
+            : AudioFormatWriter (nullptr, "Failing", 44100.0, 2, 32),
+              samplesLeft (samplesBeforeFailing)
+        {
+        }
+
+        bool write (const int**, int numSamples) override
+        {
+            samplesLeft -= numSamples;
+            return samplesLeft >= 0;
+        }
+
+        int samplesLeft;
+    };
+
+    static MemoryBlock createWavData (int numSamples, float phaseOffset)
+    {
+        MemoryBlock data;
+
+        {
+            WavAudioFormat wav;
+            ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (new MemoryOutputStream (data, false),
+                                                                          44100.0, 2, 32, StringPairArray(), 0));
+            AudioSampleBuffer buffer (2, numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                buffer.setSample (0, i, std::sin (phaseOffset + i * 0.01f) * 0.8f);
+                buffer.setSample (1, i, std::cos (phaseOffset + i * 0.01f) * 0.8f);
+            }
+
+            writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+        }
+
+        return data;
+    }
+
+    static OfflineAudioIODevice* createDevice (const MemoryBlock& input, MemoryBlock& output)
+    {
+        WavAudioFormat wav;
+        OfflineAudioIODevice* device = new OfflineAudioIODevice ("Test", 2, 2);
+        device->setInputSource (wav.createReaderFor (new MemoryInputStream (input, false), true), true);
+        device->setOutputDestination (wav.createWriterFor (new MemoryOutputStream (output, false),
+                                                           44100.0, 2, 32, StringPairArray(), 0), true);
+        device->open (3, 3, 44100.0, 500);
+        return device;
+    }
+
+    void expectHalfGainCopy (const MemoryBlock& input, const MemoryBlock& output)
+    {
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatReader> in  (wav.createReaderFor (new MemoryInputStream (input, false), true));
+        ScopedPointer<AudioFormatReader> out (wav.createReaderFor (new MemoryInputStream (output, false), true));
+
+        expect (in != nullptr && out != nullptr);
+
+        if (in != nullptr && out != nullptr)
+        {
+            expectEquals (out->lengthInSamples, in->lengthInSamples);
+
+            const int num = (int) in->lengthInSamples;
+            AudioSampleBuffer a (2, num), b (2, num);
+            in->read (&a, 0, num, 0, true, true);
+            out->read (&b, 0, num, 0, true, true);
+
+            float maxError = 0;
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < num; ++i)
+                    maxError = jmax (maxError, std::abs (a.getSample (ch, i) * 0.5f - b.getSample (ch, i)));
+
+            expectLessThan (maxError, 1.0e-6f);
+        }
+    }
+
+    void runTest() override
+    {
+        const int numSamples = 44100 + 123; // not a multiple of the block size
+
+        beginTest ("Synchronous render");
+        {
+            const MemoryBlock input (createWavData (numSamples, 0));
+            MemoryBlock output;
+
+            {
+                ScopedPointer<OfflineAudioIODevice> device (createDevice (input, output));
+                HalfGainCallback cb;
+
+                expect (device->renderSynchronously (cb));
+                expectEquals (device->getNumSamplesRendered(), (int64) numSamples);
+                expectEquals (cb.numStarts, 1);
+                expectEquals (cb.numStops, 1);
+            }
+
+            expectHalfGainCopy (input, output);
+        }
+
+        beginTest ("Speed multiple");
+        {
+            const MemoryBlock input (createWavData (4410, 0));
+            MemoryBlock output;
+            ScopedPointer<OfflineAudioIODevice> device (createDevice (input, output));
+            device->setSpeedMultiple (1.0);
+            HalfGainCallback cb;
+
+            const uint32 start = Time::getMillisecondCounter();
+            expect (device->renderSynchronously (cb));
+            expectGreaterOrEqual ((int) (Time::getMillisecondCounter() - start), 85);
+        }
+
+        beginTest ("Playback state after the render ends");
+        {
+            const MemoryBlock input (createWavData (4410, 0));
+            MemoryBlock output;
+
+            {
+                ScopedPointer<OfflineAudioIODevice> device (createDevice (input, output));
+                HalfGainCallback cb;
+
+                device->start (&cb);
+                expect (device->waitForCompletion (10000));
+                expect (device->hasStoppedRendering());
+                expect (! device->isPlaying());
+                expectEquals (cb.numStops, 0);
+
+                device->stop();
+                expectEquals (cb.numStops, 1);
+            }
+
+            expectHalfGainCopy (input, output);
+        }
+
+        beginTest ("Output write failure");
+        {
+            const MemoryBlock input (createWavData (numSamples, 0));
+            WavAudioFormat wav;
+
+            {
+                OfflineAudioIODevice device ("Test", 2, 2);
+                device.setInputSource (wav.createReaderFor (new MemoryInputStream (input, false), true), true);
+                device.setOutputDestination (new FailingWriter (2000), true);
+                device.open (3, 3, 44100.0, 500);
+                HalfGainCallback cb;
+
+                expect (! device.renderSynchronously (cb));
+                expect (device.hasStoppedRendering());
+                expect (! device.hasFinishedRendering());
+                expect (device.getLastError().isNotEmpty());
+                expectEquals (device.getNumSamplesRendered(), (int64) 2000);
+                expectEquals (cb.numStops, 1);
+            }
+
+            {
+                OfflineAudioIODevice device ("Test", 2, 2);
+                device.setInputSource (wav.createReaderFor (new MemoryInputStream (input, false), true), true);
+                device.setOutputDestination (new FailingWriter (2000), true);
+                device.open (3, 3, 44100.0, 500);
+                HalfGainCallback cb;
+
+                device.start (&cb);
+                expect (! device.waitForCompletion (10000));
+                expect (device.hasStoppedRendering());
+                expect (! device.isPlaying());
+                device.stop();
+                expectEquals (cb.numStops, 1);
+            }
+
+            {
+                OfflineAudioIODevice* device = new OfflineAudioIODevice ("Test", 2, 2);
+                device->setInputSource (wav.createReaderFor (new MemoryInputStream (input, false), true), true);
+                device->setOutputDestination (new FailingWriter (2000), true);
+                device->open (3, 3, 44100.0, 500);
+                HalfGainCallback cb;
+
+                OfflineAudioIODevice::RenderJob job (device, cb);
+                job.runJob();
+                expect (! job.wasSuccessful());
+                expectEquals (cb.numStops, 1);
+            }
+        }
+
+        beginTest ("Running from an AudioDeviceManager");
+        {
+            AudioDeviceManager manager;
+            manager.addAudioDeviceType (AudioIODeviceType::createAudioIODeviceType_Offline());
+            expect (manager.initialise (2, 2, nullptr, true).isEmpty());
+
+            OfflineAudioIODevice* device = dynamic_cast<OfflineAudioIODevice*> (manager.getCurrentAudioDevice());
+            expect (device != nullptr);
+
+            if (device != nullptr)
+            {
+                // with no reader and no length set, it just keeps going until it's stopped
+                HalfGainCallback cb;
+                manager.addAudioCallback (&cb);
+
+                while (device->getNumSamplesRendered() < numSamples)
+                    Thread::sleep (1);
+
+                expect (device->isPlaying());
+                expect (! device->hasFinishedRendering());
+
+                manager.closeAudioDevice();
+                manager.removeAudioCallback (&cb);
+                expectEquals (cb.numStarts, 1);
+                expectEquals (cb.numStops, 1);
+            }
+        }
+
+        beginTest ("Concurrent renders in a ThreadPool");
+        {
+            const int numJobs = 8;
+            OwnedArray<MemoryBlock> inputs, outputs;
+            OwnedArray<HalfGainCallback> callbacks;
+            ThreadPool pool (4);
+
+            for (int i = 0; i < numJobs; ++i)
+            {
+                inputs.add (new MemoryBlock (createWavData (numSamples, (float) i)));
+                outputs.add (new MemoryBlock());
+                callbacks.add (new HalfGainCallback());
+            }
+
+            const double start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numJobs; ++i)
+                pool.addJob (new OfflineAudioIODevice::RenderJob (createDevice (*inputs[i], *outputs[i]),
+                                                                  *callbacks[i]), true);
+
+            while (pool.getNumJobs() > 0)
+                Thread::sleep (2);
+
+            logMessage ("Rendered " + String (numJobs) + " x " + String (numSamples) + " samples in "
+                          + String (Time::getMillisecondCounterHiRes() - start, 1) + " ms");
+
+            for (int i = 0; i < numJobs; ++i)
+            {
+                expectEquals (callbacks[i]->numStops, 1);
+                expectHalfGainCopy (*inputs[i], *outputs[i]);
+            }
+        }
+    }
+};
+
+static OfflineAudioIODeviceTests offlineAudioIODeviceTests;
+
+#endif
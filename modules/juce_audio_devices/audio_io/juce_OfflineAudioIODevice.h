@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+#ifndef JUCE_OFFLINEAUDIOIODEVICE_H_INCLUDED
+#define JUCE_OFFLINEAUDIOIODEVICE_H_INCLUDED
+
+
+//==============================================================================
+/**
+    An AudioIODevice that isn't connected to any hardware, and which runs its
+    callback as fast as possible, or at a chosen multiple of real-time.
+
+    The device's input can be fed from an AudioFormatReader, and its output can be
+    sent to an AudioFormatWriter, so it can be used to bounce a file through any
+    AudioIODeviceCallback, such as an AudioProcessorPlayer or AudioSourcePlayer.
+
+    It can be used in three ways:
+    - like any other device, by calling start(), in which case it renders on its own
+      thread until it reaches the end of its input (or the length you've set), or until
+      stop() is called. The AudioIODeviceType::createAudioIODeviceType_Offline() method
+      creates a type that an AudioDeviceManager can open in the normal way.
+    - synchronously, by calling renderSynchronously() on the current thread.
+    - by handing it to a RenderJob and adding that to a ThreadPool, so that many
+      independent renders can run concurrently.
+
+    @code
+    OfflineAudioIODevice* device = new OfflineAudioIODevice ("Bounce", 2, 2);
+    device->setInputSource (formatManager.createReaderFor (inFile), true);
+    device->setOutputDestination (wavFormat.createWriterFor (outStream, 44100.0, 2, 24, StringPairArray(), 0), true);
+    device->open (3, 3, 44100.0, 512);
+
+    pool.addJob (new OfflineAudioIODevice::RenderJob (device, myPlayer), true);
+    @endcode
+
+    @see AudioIODeviceType::createAudioIODeviceType_Offline
+*/
+class JUCE_API  OfflineAudioIODevice  : public AudioIODevice,
+                                        private Thread
+{
+public:
+    //==============================================================================
+    /** Creates a device with the given maximum numbers of input and output channels. */
+    OfflineAudioIODevice (const String& deviceName,
+                          int maxNumInputChannels,
+                          int maxNumOutputChannels);
+
+    /** Destructor. */
+    ~OfflineAudioIODevice();
+
+    //==============================================================================
+    /** Sets a reader which will provide the data for the device's input channels.
+
+        If no reader is set, the inputs are silent. Unless you call setLengthInSamples(),
+        the render will stop when it reaches the end of the reader.
+        This must not be called while the device is rendering.
+    */
+    void setInputSource (AudioFormatReader* reader, bool deleteWhenNoLongerNeeded);
+
+    /** Sets a writer which will receive the data that the callback produces.
+
+        If the writer has more channels than the device has active outputs, the extra
+        ones will be silent. This must not be called while the device is rendering.
+    */
+    void setOutputDestination (AudioFormatWriter* writer, bool deleteWhenNoLongerNeeded);
+
+    /** Sets the number of samples to render. A negative number (the default) means
+        the length of the input reader, or, if there's no reader, to keep going until
+        the device is stopped.
+    */
+    void setLengthInSamples (int64 numSamples) noexcept;
+
+    /** Returns the number of samples that will be rendered, or -1 if it's unlimited. */
+    int64 getLengthInSamples() const noexcept;
+
+    /** Sets the speed at which to render, as a multiple of real-time.
+        A value of 1.0 runs at real-time, 10.0 runs ten times faster, etc. A value of
+        zero or less (the default) renders as fast as possible.
+    */
+    void setSpeedMultiple (double multipleOfRealTime) noexcept;
+
+    /** Returns the number of samples that have been rendered since the last start. */
+    int64 getNumSamplesRendered() const noexcept                    { return numSamplesRendered.get(); }
+
+    /** Returns true if the last render reached the end of its length. */
+    bool hasFinishedRendering() const noexcept                      { return finished.get() == renderCompleted; }
+
+    /** Returns true if the last render has stopped, either because it reached the end
+        of its length or because the output couldn't be written.
+    */
+    bool hasStoppedRendering() const noexcept                       { return finished.get() != stillRendering; }
+
+    /** After calling start(), this waits for the render to reach the end of its length.
+        Returns true if it finished, or false if it timed-out or the output couldn't be written.
+    */
+    bool waitForCompletion (int timeoutMilliseconds = -1);
+
+    /** Runs a complete render on the current thread, calling audioDeviceAboutToStart(),
+        audioDeviceIOCallback() and audioDeviceStopped() on the callback.
+        The device must have been opened first. Returns false if the length is unlimited,
+        or if the output couldn't be written.
+    */
+    bool renderSynchronously (AudioIODeviceCallback& callback);
+
+    //==============================================================================
+    /**
+        A ThreadPoolJob which runs a render on an OfflineAudioIODevice.
+
+        The job takes ownership of the device, which must already have been opened.
+        Each job must be given its own callback object, because jobs in the same pool
+        can be running at the same time.
+    */
+    class JUCE_API  RenderJob  : public ThreadPoolJob
+    {
+    public:
+        RenderJob (OfflineAudioIODevice* deviceToRender, AudioIODeviceCallback& callback);
+        ~RenderJob();
+
+        /** Returns the device that this job is rendering. */
+        OfflineAudioIODevice& getDevice() const noexcept             { return *device; }
+
+        /** Returns true if the job rendered everything successfully. */
+        bool wasSuccessful() const noexcept                         { return succeeded; }
+
+        /** @internal */
+        JobStatus runJob() override;
+
+    private:
+        ScopedPointer<OfflineAudioIODevice> device;
+        AudioIODeviceCallback& callback;
+        bool succeeded;
+
+        JUCE_DECLARE_NON_COPYABLE (RenderJob)
+    };
+
+    //==============================================================================
+    StringArray getOutputChannelNames() override;
+    StringArray getInputChannelNames() override;
+    Array<double> getAvailableSampleRates() override;
+    Array<int> getAvailableBufferSizes() override;
+    int getDefaultBufferSize() override;
+    String open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+                 double sampleRate, int bufferSizeSamples) override;
+    void close() override;
+    bool isOpen() override;
+    void start (AudioIODeviceCallback*) override;
+    void stop() override;
+    bool isPlaying() override;
+    String getLastError() override;
+    int getCurrentBufferSizeSamples() override;
+    double getCurrentSampleRate() override;
+    int getCurrentBitDepth() override;
+    BigInteger getActiveOutputChannels() const override;
+    BigInteger getActiveInputChannels() const override;
+    int getOutputLatencyInSamples() override;
+    int getInputLatencyInSamples() override;
+
+private:
+    //==============================================================================
+    const int maxNumInputs, maxNumOutputs;
+    OptionalScopedPointer<AudioFormatReader> reader;
+    OptionalScopedPointer<AudioFormatWriter> writer;
+    BigInteger activeInputs, activeOutputs;
+    double sampleRate, speedMultiple;
+    int bufferSize;
+    int64 length;
+    bool deviceIsOpen;
+    String lastError;
+
+    AudioIODeviceCallback* callback;
+    CriticalSection startStopLock;
+    AudioSampleBuffer inputBuffer, outputBuffer;
+    Atomic<int64> numSamplesRendered;
+    Atomic<int> finished;
+    WaitableEvent finishedEvent;
+    double renderStartTime;
+
+    void run() override;
+    void prepareBuffers();
+    int64 getTotalLength() const noexcept;
+    bool renderNextBlock (AudioIODeviceCallback&);
+    int getMillisecondsUntilNextBlock() const noexcept;
+    void finishRendering (int state);
+
+    enum { stillRendering = 0, renderCompleted, renderFailed };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineAudioIODevice)
+};
+
+
+#endif   // JUCE_OFFLINEAUDIOIODEVICE_H_INCLUDED
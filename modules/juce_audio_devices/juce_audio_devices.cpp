@@ -138,9 +138,11 @@
 namespace juce
 {
 
+#include "audio_io/juce_AudioCallbackTelemetry.cpp"
 #include "audio_io/juce_AudioDeviceManager.cpp"
 #include "audio_io/juce_AudioIODevice.cpp"
 #include "audio_io/juce_AudioIODeviceType.cpp"
+#include "audio_io/juce_OfflineAudioIODevice.cpp"
 #include "midi_io/juce_MidiMessageCollector.cpp"
 #include "midi_io/juce_MidiOutput.cpp"
 #include "audio_cd/juce_AudioCDReader.cpp"
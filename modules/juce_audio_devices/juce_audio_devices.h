@@ -100,6 +100,25 @@
  #define JUCE_ALSA 1
 #endif
 
+/** Config: JUCE_ALSA_MMAP
+    If enabled, ALSA devices will use mmap access when the device supports it, so that
+    samples are converted straight into the device's ring buffer instead of being copied
+    through an intermediate buffer. Devices which can't do this will fall back to the
+    normal read/write access.
+*/
+#ifndef JUCE_ALSA_MMAP
+ #define JUCE_ALSA_MMAP 0
+#endif
+
+/** Config: JUCE_ALSA_SCHED_FIFO
+    If enabled, the ALSA audio thread will try to switch itself to the SCHED_FIFO
+    scheduling policy at its maximum priority. This needs the process to have permission
+    to use realtime scheduling - if it fails, the thread keeps its normal priority.
+*/
+#ifndef JUCE_ALSA_SCHED_FIFO
+ #define JUCE_ALSA_SCHED_FIFO 0
+#endif
+
 /** Config: JUCE_JACK
     Enables JACK audio devices (Linux only).
 */
@@ -139,6 +158,7 @@ namespace juce
 
 #include "audio_io/juce_AudioIODevice.h"
 #include "audio_io/juce_AudioIODeviceType.h"
+#include "audio_io/juce_OfflineAudioIODevice.h"
 #include "audio_io/juce_SystemAudioVolume.h"
 #include "midi_io/juce_MidiInput.h"
 #include "midi_io/juce_MidiMessageCollector.h"
@@ -147,6 +167,7 @@ namespace juce
 #include "sources/juce_AudioTransportSource.h"
 #include "audio_cd/juce_AudioCDBurner.h"
 #include "audio_cd/juce_AudioCDReader.h"
+#include "audio_io/juce_AudioCallbackTelemetry.h"
 #include "audio_io/juce_AudioDeviceManager.h"
 
 }
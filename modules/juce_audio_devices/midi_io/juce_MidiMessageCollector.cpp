@@ -22,10 +22,57 @@
   ==============================================================================
 */
 
-MidiMessageCollector::MidiMessageCollector()
+namespace MidiCollectorFifoHelpers
+{
+    // A message is stored in the fifo as its timestamp, its size, and then its raw data.
+    static const int headerSize = (int) (sizeof (double) + sizeof (int));
+
+    static void copyToFifo (uint8* fifoData, int start1, int size1, int start2,
+                            int offset, const void* source, int numBytes) noexcept
+    {
+        const uint8* src = static_cast<const uint8*> (source);
+
+        if (offset < size1)
+        {
+            const int num = jmin (numBytes, size1 - offset);
+            memcpy (fifoData + start1 + offset, src, (size_t) num);
+            src += num;
+            offset += num;
+            numBytes -= num;
+        }
+
+        if (numBytes > 0)
+            memcpy (fifoData + start2 + (offset - size1), src, (size_t) numBytes);
+    }
+
+    static void copyFromFifo (const uint8* fifoData, int start1, int size1, int start2,
+                              int offset, void* dest, int numBytes) noexcept
+    {
+        uint8* dst = static_cast<uint8*> (dest);
+
+        if (offset < size1)
+        {
+            const int num = jmin (numBytes, size1 - offset);
+            memcpy (dst, fifoData + start1 + offset, (size_t) num);
+            dst += num;
+            offset += num;
+            numBytes -= num;
+        }
+
+        if (numBytes > 0)
+            memcpy (dst, fifoData + start2 + (offset - size1), (size_t) numBytes);
+    }
+}
+
+MidiMessageCollector::MidiMessageCollector (const int queueSizeInBytes)
     : lastCallbackTime (0),
+      fifo (queueSizeInBytes),
+      fifoData ((size_t) queueSizeInBytes),
+      messageData ((size_t) queueSizeInBytes),
       sampleRate (44100.0001)
 {
+    jassert (queueSizeInBytes > MidiCollectorFifoHelpers::headerSize);
+    incomingMessages.setFixedCapacity (queueSizeInBytes);
 }
 
 MidiMessageCollector::~MidiMessageCollector()
@@ -37,7 +84,10 @@ void MidiMessageCollector::reset (const double newSampleRate)
 {
     jassert (newSampleRate > 0);
 
-    const ScopedLock sl (midiCallbackLock);
+    // this is called from the consuming side, so it mustn't touch the write position
+    fifo.finishedRead (fifo.getNumReady());
+    numDroppedMessages = 0;
+
     sampleRate = newSampleRate;
     incomingMessages.clear();
     lastCallbackTime = Time::getMillisecondCounterHiRes();
@@ -45,6 +95,8 @@ void MidiMessageCollector::reset (const double newSampleRate)
 
 void MidiMessageCollector::addMessageToQueue (const MidiMessage& message)
 {
+    using namespace MidiCollectorFifoHelpers;
+
     // you need to call reset() to set the correct sample rate before using this object
     jassert (sampleRate != 44100.0001);
 
@@ -52,17 +104,63 @@ void MidiMessageCollector::addMessageToQueue (const MidiMessage& message)
     // for details of what the number should be.
     jassert (message.getTimeStamp() != 0);
 
-    const ScopedLock sl (midiCallbackLock);
+    const double timeStamp = message.getTimeStamp();
+    const int numBytes = message.getRawDataSize();
+    const int totalSize = headerSize + numBytes;
+
+    const SpinLock::ScopedLockType sl (producerLock);
 
-    const int sampleNumber
-        = (int) ((message.getTimeStamp() - 0.001 * lastCallbackTime) * sampleRate);
+    if (fifo.getFreeSpace() < totalSize)
+    {
+        // if the messages aren't being used, the queue will fill up and
+        // any new ones will have to be thrown away
+        ++numDroppedMessages;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (totalSize, start1, size1, start2, size2);
+    jassert (size1 + size2 == totalSize);
+
+    copyToFifo (fifoData, start1, size1, start2, 0, &timeStamp, (int) sizeof (timeStamp));
+    copyToFifo (fifoData, start1, size1, start2, (int) sizeof (timeStamp), &numBytes, (int) sizeof (numBytes));
+    copyToFifo (fifoData, start1, size1, start2, headerSize, message.getRawData(), numBytes);
+
+    fifo.finishedWrite (totalSize);
+}
+
+void MidiMessageCollector::readPendingMessages()
+{
+    using namespace MidiCollectorFifoHelpers;
+
+    for (;;)
+    {
+        const int numReady = fifo.getNumReady();
 
-    incomingMessages.addEvent (message, sampleNumber);
+        if (numReady < headerSize)
+            break;
 
-    // if the messages don't get used for over a second, we'd better
-    // get rid of any old ones to avoid the queue getting too big
-    if (sampleNumber > sampleRate)
-        incomingMessages.clear (0, sampleNumber - (int) sampleRate);
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+        double timeStamp;
+        int numBytes;
+        copyFromFifo (fifoData, start1, size1, start2, 0, &timeStamp, (int) sizeof (timeStamp));
+        copyFromFifo (fifoData, start1, size1, start2, (int) sizeof (timeStamp), &numBytes, (int) sizeof (numBytes));
+
+        jassert (headerSize + numBytes <= numReady);
+        copyFromFifo (fifoData, start1, size1, start2, headerSize, messageData, numBytes);
+        fifo.finishedRead (headerSize + numBytes);
+
+        const int sampleNumber = (int) ((timeStamp - 0.001 * lastCallbackTime) * sampleRate);
+
+        incomingMessages.addEvent (messageData, numBytes, sampleNumber);
+
+        // if the messages haven't been used for over a second, we'd better
+        // get rid of any old ones to avoid the queue getting too big
+        if (sampleNumber > sampleRate)
+            incomingMessages.clear (0, sampleNumber - (int) sampleRate);
+    }
 }
 
 void MidiMessageCollector::removeNextBlockOfMessages (MidiBuffer& destBuffer,
@@ -72,10 +170,15 @@ void MidiMessageCollector::removeNextBlockOfMessages (MidiBuffer& destBuffer,
     jassert (sampleRate != 44100.0001);
     jassert (numSamples > 0);
 
+    readPendingMessages();
+
+    // a producer that keeps the fifo busy while it's being read can overflow the fixed
+    // storage, and those messages are thrown away rather than allocating more space
+    if (const int numOverflowed = incomingMessages.getNumDroppedEvents())
+        numDroppedMessages += numOverflowed;
+
     const double timeNow = Time::getMillisecondCounterHiRes();
     const double msElapsed = timeNow - lastCallbackTime;
-
-    const ScopedLock sl (midiCallbackLock);
     lastCallbackTime = timeNow;
 
     if (! incomingMessages.isEmpty())
@@ -151,3 +254,304 @@ void MidiMessageCollector::handleIncomingMidiMessage (MidiInput*, const MidiMess
 {
     addMessageToQueue (message);
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MidiMessageCollectorTests  : public UnitTest
+{
+public:
+    MidiMessageCollectorTests() : UnitTest ("MidiMessageCollector") {}
+
+    void runTest() override
+    {
+        beginTest ("Messages keep their timestamps");
+        {
+            const double sampleRate = 44100.0;
+            MidiMessageCollector collector;
+            collector.reset (sampleRate);
+
+            // the messages need to have been stamped before the block is requested,
+            // otherwise they'd all be clamped to its last sample
+            const double startTime = Time::getMillisecondCounterHiRes() * 0.001;
+            Thread::sleep (20);
+
+            for (int i = 0; i < 10; ++i)
+                collector.addMessageToQueue (withTimeStamp (MidiMessage::noteOn (1, 60 + i, (uint8) 100), startTime + i * 0.001));
+
+            // a long block, so that the events are just offset and not squeezed together
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 48000);
+            expectEquals (buffer.getNumEvents(), 10);
+
+            MidiBuffer::Iterator iter (buffer);
+            MidiMessage m;
+            int pos, lastPos = -1, note = 60;
+
+            while (iter.getNextEvent (m, pos))
+            {
+                expectEquals (m.getNoteNumber(), note++);
+
+                if (lastPos >= 0)
+                    expect (std::abs (pos - lastPos - 44) <= 1);
+
+                lastPos = pos;
+            }
+
+            buffer.clear();
+            collector.removeNextBlockOfMessages (buffer, 512);
+            expect (buffer.isEmpty());
+        }
+
+        beginTest ("Full queue drops new messages");
+        {
+            MidiMessageCollector collector (64);
+            collector.reset (44100.0);
+
+            const double now = Time::getMillisecondCounterHiRes() * 0.001;
+
+            for (int i = 0; i < 10; ++i)
+                collector.addMessageToQueue (withTimeStamp (MidiMessage::noteOn (1, 60 + i, (uint8) 100), now));
+
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 512);
+
+            expectEquals (buffer.getNumEvents(), 4);
+            expectEquals (collector.getNumDroppedMessages(), 6);
+
+            collector.addMessageToQueue (withTimeStamp (MidiMessage::noteOn (1, 60, (uint8) 100), now));
+            buffer.clear();
+            collector.removeNextBlockOfMessages (buffer, 512);
+            expectEquals (buffer.getNumEvents(), 1);
+
+            collector.reset (44100.0);
+            expectEquals (collector.getNumDroppedMessages(), 0);
+        }
+
+        beginTest ("Sysex wrapping around the queue");
+        {
+            MidiMessageCollector collector (256);
+            collector.reset (44100.0);
+
+            uint8 sysexData[100];
+
+            for (int i = 0; i < numElementsInArray (sysexData); ++i)
+                sysexData[i] = (uint8) (i & 0x7f);
+
+            for (int i = 0; i < 20; ++i)
+            {
+                const double now = Time::getMillisecondCounterHiRes() * 0.001;
+                collector.addMessageToQueue (withTimeStamp (MidiMessage::createSysExMessage (sysexData, i + 40), now));
+
+                MidiBuffer buffer;
+                collector.removeNextBlockOfMessages (buffer, 512);
+                expectEquals (buffer.getNumEvents(), 1);
+
+                MidiBuffer::Iterator iter (buffer);
+                MidiMessage m;
+                int pos;
+
+                if (iter.getNextEvent (m, pos))
+                    expect (m.getSysExDataSize() == i + 40
+                             && memcmp (m.getSysExData(), sysexData, (size_t) (i + 40)) == 0);
+            }
+        }
+
+        beginTest ("Concurrent producer");
+        {
+            const int numMessages = 20000;
+            MidiMessageCollector collector (numMessages * 16);
+            collector.reset (44100.0);
+
+            ProducerThread producer (collector, numMessages);
+            producer.startThread();
+
+            int numReceived = 0, numOutOfOrder = 0, lastValue = -1;
+            MidiBuffer buffer;
+
+            for (int tries = 0; numReceived < numMessages && tries < 10000; ++tries)
+            {
+                buffer.clear();
+                collector.removeNextBlockOfMessages (buffer, 256);
+
+                MidiBuffer::Iterator iter (buffer);
+                MidiMessage m;
+                int pos;
+
+                while (iter.getNextEvent (m, pos))
+                {
+                    const int value = m.getControllerValue();
+
+                    if (lastValue >= 0 && value != ((lastValue + 1) & 0x7f))
+                        ++numOutOfOrder;
+
+                    lastValue = value;
+                    ++numReceived;
+                }
+
+                Thread::sleep (1);
+            }
+
+            producer.stopThread (2000);
+
+            expectEquals (numReceived, numMessages);
+            expectEquals (numOutOfOrder, 0);
+            expectEquals (collector.getNumDroppedMessages(), 0);
+        }
+
+        beginTest ("Virtual port latency and jitter");
+        {
+            measureVirtualPortLatency();
+        }
+    }
+
+private:
+    static MidiMessage withTimeStamp (MidiMessage m, double timeStamp)
+    {
+        m.setTimeStamp (timeStamp);
+        return m;
+    }
+
+    //==============================================================================
+    struct ProducerThread  : public Thread
+    {
+        ProducerThread (MidiMessageCollector& c, int num)
+            : Thread ("MIDI collector test"), collector (c), numMessages (num)
+        {}
+
+        void run() override
+        {
+            for (int i = 0; i < numMessages && ! threadShouldExit(); ++i)
+            {
+                collector.addMessageToQueue (withTimeStamp (MidiMessage::controllerEvent (1, 7, i & 0x7f), Time::getMillisecondCounterHiRes() * 0.001));
+
+                if ((i & 255) == 0)
+                    Thread::yield();
+            }
+        }
+
+        MidiMessageCollector& collector;
+        const int numMessages;
+    };
+
+    //==============================================================================
+    // Sends notes from a virtual output port back into one of our own inputs, and
+    // compares the time each was sent with its timestamp and with the time that the
+    // input callback actually received it.
+    struct LatencyRecorder  : public MidiInputCallback
+    {
+        LatencyRecorder()
+        {
+            for (int i = 0; i < numElementsInArray (sendTimes); ++i)
+                sendTimes[i] = timeStamps[i] = arrivalTimes[i] = 0;
+        }
+
+        void handleIncomingMidiMessage (MidiInput*, const MidiMessage& m) override
+        {
+            if (m.isNoteOn())
+            {
+                const int index = m.getNoteNumber();
+                arrivalTimes[index] = Time::getMillisecondCounterHiRes() * 0.001;
+                timeStamps[index] = m.getTimeStamp();
+                ++numReceived;
+            }
+        }
+
+        static const int numNotes = 128;
+        double sendTimes[numNotes], timeStamps[numNotes], arrivalTimes[numNotes];
+        Atomic<int> numReceived;
+    };
+
+    struct Stats
+    {
+        Stats() : total (0), totalSquared (0), minimum (1.0e9), maximum (-1.0e9), num (0) {}
+
+        void add (double value) noexcept
+        {
+            total += value;
+            totalSquared += value * value;
+            minimum = jmin (minimum, value);
+            maximum = jmax (maximum, value);
+            ++num;
+        }
+
+        double getMean() const noexcept       { return num > 0 ? total / num : 0.0; }
+        double getStdDev() const noexcept     { return num > 1 ? std::sqrt (jmax (0.0, totalSquared / num - getMean() * getMean())) : 0.0; }
+
+        String toString() const
+        {
+            return "mean " + String (getMean() * 1000.0, 3) + " ms, min " + String (minimum * 1000.0, 3)
+                     + " ms, max " + String (maximum * 1000.0, 3) + " ms, jitter " + String (getStdDev() * 1000.0, 3) + " ms";
+        }
+
+        double total, totalSquared, minimum, maximum;
+        int num;
+    };
+
+    void measureVirtualPortLatency()
+    {
+        const String portName ("JUCE MIDI latency test");
+        ScopedPointer<MidiOutput> output (MidiOutput::createNewDevice (portName));
+
+        if (output == nullptr)
+        {
+            logMessage ("Virtual MIDI ports aren't available - skipping");
+            return;
+        }
+
+        // depending on the platform, the port may be listed with its client's name as a prefix
+        const StringArray inputNames (MidiInput::getDevices());
+        int inputIndex = -1;
+
+        for (int i = 0; i < inputNames.size(); ++i)
+            if (inputNames[i].endsWith (portName))
+                inputIndex = i;
+
+        LatencyRecorder recorder;
+        ScopedPointer<MidiInput> input (inputIndex >= 0 ? MidiInput::openDevice (inputIndex, &recorder) : nullptr);
+
+        if (input == nullptr)
+        {
+            logMessage ("Couldn't open an input connected to the virtual port - skipping");
+            return;
+        }
+
+        input->start();
+        Thread::sleep (100);
+
+        for (int i = 0; i < LatencyRecorder::numNotes; ++i)
+        {
+            recorder.sendTimes[i] = Time::getMillisecondCounterHiRes() * 0.001;
+            output->sendMessageNow (MidiMessage::noteOn (1, i, (uint8) 100));
+            Thread::sleep (1);
+        }
+
+        for (int i = 0; i < 200 && recorder.numReceived.get() < LatencyRecorder::numNotes; ++i)
+            Thread::sleep (10);
+
+        input->stop();
+
+        expectEquals (recorder.numReceived.get(), (int) LatencyRecorder::numNotes);
+
+        Stats timeStampLatency, deliveryLatency;
+
+        for (int i = 0; i < LatencyRecorder::numNotes; ++i)
+        {
+            if (recorder.arrivalTimes[i] > 0)
+            {
+                timeStampLatency.add (recorder.timeStamps[i] - recorder.sendTimes[i]);
+                deliveryLatency.add (recorder.arrivalTimes[i] - recorder.sendTimes[i]);
+            }
+        }
+
+        logMessage ("Timestamp latency: " + timeStampLatency.toString());
+        logMessage ("Delivery latency:  " + deliveryLatency.toString());
+
+        // a timestamp can't be (much) earlier than the moment the message was sent
+        expect (timeStampLatency.minimum > -0.002);
+    }
+};
+
+static MidiMessageCollectorTests midiMessageCollectorTests;
+
+#endif
@@ -34,6 +34,15 @@
     The class can also be used as either a MidiKeyboardStateListener or a MidiInputCallback
     so it can easily use a midi input or keyboard component as its source.
 
+    Messages are passed from the thread that adds them to the audio thread through a
+    pre-allocated lock-free fifo, so removeNextBlockOfMessages() never blocks, and it only
+    allocates if the MidiBuffer that you give it needs to grow. Each message keeps its
+    original timestamp until the audio thread converts it into a sample position.
+
+    If more than one thread adds messages (e.g. a MidiInput and a MidiKeyboardState),
+    those threads are serialised against each other with a spin-lock, but the audio
+    thread is never made to wait for them.
+
     @see MidiMessage, MidiInput
 */
 class JUCE_API  MidiMessageCollector    : public MidiKeyboardStateListener,
@@ -41,8 +50,14 @@ class JUCE_API  MidiMessageCollector    : public MidiKeyboardStateListener,
 {
 public:
     //==============================================================================
-    /** Creates a MidiMessageCollector. */
-    MidiMessageCollector();
+    /** Creates a MidiMessageCollector.
+
+        The queue size is the number of bytes of message storage that can be waiting
+        between two calls to removeNextBlockOfMessages(). Each message uses 12 bytes
+        plus its raw data size, and any messages that arrive when the queue is full
+        are discarded - see getNumDroppedMessages().
+    */
+    explicit MidiMessageCollector (int queueSizeInBytes = 32768);
 
     /** Destructor. */
     ~MidiMessageCollector();
@@ -61,7 +76,9 @@ public:
         of the block returned by the next call to removeNextBlockOfMessages().
 
         This method is fully thread-safe when overlapping calls are made with
-        removeNextBlockOfMessages().
+        removeNextBlockOfMessages(), and won't block the thread that's calling that
+        method. It doesn't allocate any memory, so if the queue is full, the message
+        will be dropped.
     */
     void addMessageToQueue (const MidiMessage& message);
 
@@ -75,12 +92,19 @@ public:
         midi event positions.
 
         This method is fully thread-safe when overlapping calls are made with
-        addMessageToQueue().
+        addMessageToQueue(), and is wait-free, so it's safe to call from an audio
+        callback. The collector's own storage is fixed, so it won't allocate unless
+        destBuffer has to grow - to rule that out, see MidiBuffer::setFixedCapacity().
 
         Precondition: numSamples must be greater than 0.
     */
     void removeNextBlockOfMessages (MidiBuffer& destBuffer, int numSamples);
 
+    /** Returns the number of messages that have been discarded because the queue was
+        full when they arrived, or because there were too many to fit into the collector's
+        storage before the next block was removed. This is reset to zero by reset().
+    */
+    int getNumDroppedMessages() const noexcept          { return numDroppedMessages.get(); }
 
     //==============================================================================
     /** @internal */
@@ -93,10 +117,15 @@ public:
 private:
     //==============================================================================
     double lastCallbackTime;
-    CriticalSection midiCallbackLock;
+    AbstractFifo fifo;
+    HeapBlock<uint8> fifoData, messageData;
+    SpinLock producerLock;
+    Atomic<int> numDroppedMessages;
     MidiBuffer incomingMessages;
     double sampleRate;
 
+    void readPendingMessages();
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiMessageCollector)
 };
 
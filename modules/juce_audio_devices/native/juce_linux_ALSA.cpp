@@ -153,9 +153,11 @@ public:
           bitDepth (16),
           numChannelsRunning (0),
           latency (0),
+          numXRuns (0),
           deviceID (devID),
           isInput (forInput),
-          isInterleaved (true)
+          isInterleaved (true),
+          isMmap (false)
     {
         JUCE_ALSA_LOG ("snd_pcm_open (" << deviceID.toUTF8().getAddress() << ", forInput=" << forInput << ")");
 
@@ -209,6 +211,16 @@ public:
             return false;
         }
 
+        isMmap = false;
+
+       #if JUCE_ALSA_MMAP
+        if (snd_pcm_hw_params_set_access (handle, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) >= 0)
+        {
+            isMmap = true;
+            isInterleaved = true;
+        }
+        else
+       #endif
         if (snd_pcm_hw_params_set_access (handle, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED) >= 0) // works better for plughw..
             isInterleaved = true;
         else if (snd_pcm_hw_params_set_access (handle, hwParams, SND_PCM_ACCESS_RW_NONINTERLEAVED) >= 0)
@@ -303,10 +315,30 @@ public:
        #endif
 
         numChannelsRunning = numChannels;
+        numXRuns = 0;
 
         return true;
     }
 
+    /** Capture streams using mmap access don't start by themselves, so this kicks them off. */
+    void startIfNeeded()
+    {
+        if (isMmap && isInput && snd_pcm_state (handle) == SND_PCM_STATE_PREPARED)
+            JUCE_ALSA_FAILED (snd_pcm_start (handle));
+    }
+
+    bool recoverFromError (const int err)
+    {
+        if (err == -EPIPE)
+            ++numXRuns;
+
+        if (JUCE_ALSA_FAILED (snd_pcm_recover (handle, err, 1 /* silent */)))
+            return false;
+
+        startIfNeeded();
+        return true;
+    }
+
     //==============================================================================
     bool writeToOutputDevice (AudioSampleBuffer& outputChannelBuffer, const int numSamples)
     {
@@ -314,6 +346,9 @@ public:
         float* const* const data = outputChannelBuffer.getArrayOfWritePointers();
         snd_pcm_sframes_t numDone = 0;
 
+        if (isMmap)
+            return writeToMappedBuffer (data, numSamples);
+
         if (isInterleaved)
         {
             scratch.ensureSize ((size_t) ((int) sizeof (float) * numSamples * numChannelsRunning), false);
@@ -331,7 +366,7 @@ public:
             numDone = snd_pcm_writen (handle, (void**) data, (snd_pcm_uframes_t) numSamples);
         }
 
-        if (numDone < 0 && JUCE_ALSA_FAILED (snd_pcm_recover (handle, (int) numDone, 1 /* silent */)))
+        if (numDone < 0 && ! recoverFromError ((int) numDone))
             return false;
 
         if (numDone < numSamples)
@@ -345,6 +380,9 @@ public:
         jassert (numChannelsRunning <= inputChannelBuffer.getNumChannels());
         float* const* const data = inputChannelBuffer.getArrayOfWritePointers();
 
+        if (isMmap)
+            return readFromMappedBuffer (data, numSamples);
+
         if (isInterleaved)
         {
             scratch.ensureSize ((size_t) ((int) sizeof (float) * numSamples * numChannelsRunning), false);
@@ -352,7 +390,7 @@ public:
 
             snd_pcm_sframes_t num = snd_pcm_readi (handle, scratch.getData(), (snd_pcm_uframes_t) numSamples);
 
-            if (num < 0 && JUCE_ALSA_FAILED (snd_pcm_recover (handle, (int) num, 1 /* silent */)))
+            if (num < 0 && ! recoverFromError ((int) num))
                 return false;
 
             if (num < numSamples)
@@ -365,7 +403,7 @@ public:
         {
             snd_pcm_sframes_t num = snd_pcm_readn (handle, (void**) data, (snd_pcm_uframes_t) numSamples);
 
-            if (num < 0 && JUCE_ALSA_FAILED (snd_pcm_recover (handle, (int) num, 1 /* silent */)))
+            if (num < 0 && ! recoverFromError ((int) num))
                 return false;
 
             if (num < numSamples)
@@ -382,15 +420,136 @@ public:
     snd_pcm_t* handle;
     String error;
     int bitDepth, numChannelsRunning, latency;
+    Atomic<int> numXRuns; // (incremented on the audio thread, read from others by getXRunCount())
 
 private:
     //==============================================================================
     String deviceID;
     const bool isInput;
-    bool isInterleaved;
+    bool isInterleaved, isMmap;
     MemoryBlock scratch;
     ScopedPointer<AudioData::Converter> converter;
 
+    //==============================================================================
+    // In mmap mode, the converters write straight into (or read straight out of) the
+    // device's ring buffer, which may need to be accessed in more than one chunk.
+    bool writeToMappedBuffer (float* const* data, const int numSamples)
+    {
+        for (int offset = 0; offset < numSamples;)
+        {
+            const snd_pcm_channel_area_t* areas;
+            snd_pcm_uframes_t frameOffset, numFrames;
+
+            if (! beginMappedAccess (areas, frameOffset, numFrames, numSamples - offset))
+                return false;
+
+            void* const dest = getMappedFrame (areas, frameOffset);
+
+            for (int i = 0; i < numChannelsRunning; ++i)
+                converter->convertSamples (dest, i, data[i] + offset, 0, (int) numFrames);
+
+            if (! endMappedAccess (frameOffset, numFrames))
+                return false;
+
+            offset += (int) numFrames;
+        }
+
+        if (snd_pcm_state (handle) == SND_PCM_STATE_PREPARED)
+            JUCE_ALSA_FAILED (snd_pcm_start (handle));
+
+        return true;
+    }
+
+    bool readFromMappedBuffer (float* const* data, const int numSamples)
+    {
+        for (int offset = 0; offset < numSamples;)
+        {
+            const snd_pcm_channel_area_t* areas;
+            snd_pcm_uframes_t frameOffset, numFrames;
+
+            if (! beginMappedAccess (areas, frameOffset, numFrames, numSamples - offset))
+                return false;
+
+            const void* const source = getMappedFrame (areas, frameOffset);
+
+            for (int i = 0; i < numChannelsRunning; ++i)
+                converter->convertSamples (data[i] + offset, 0, source, i, (int) numFrames);
+
+            if (! endMappedAccess (frameOffset, numFrames))
+                return false;
+
+            offset += (int) numFrames;
+        }
+
+        return true;
+    }
+
+    bool beginMappedAccess (const snd_pcm_channel_area_t*& areas, snd_pcm_uframes_t& frameOffset,
+                            snd_pcm_uframes_t& numFrames, const int maxFrames)
+    {
+        for (;;)
+        {
+            startIfNeeded();
+
+            const snd_pcm_sframes_t avail = snd_pcm_avail_update (handle);
+
+            if (avail < 0)
+            {
+                if (! recoverFromError ((int) avail))
+                    return false;
+
+                continue;
+            }
+
+            if (avail == 0)
+            {
+                const int result = snd_pcm_wait (handle, 1000);
+
+                if (result == 0)
+                {
+                    error = "timed out waiting for the device";
+                    return false;
+                }
+
+                if (result < 0 && ! recoverFromError (result))
+                    return false;
+
+                continue;
+            }
+
+            numFrames = (snd_pcm_uframes_t) jmin ((snd_pcm_sframes_t) maxFrames, avail);
+            const int result = snd_pcm_mmap_begin (handle, &areas, &frameOffset, &numFrames);
+
+            if (result < 0)
+            {
+                if (! recoverFromError (result))
+                    return false;
+
+                continue;
+            }
+
+            if (numFrames > 0)
+                return true;
+        }
+    }
+
+    bool endMappedAccess (snd_pcm_uframes_t frameOffset, snd_pcm_uframes_t numFrames)
+    {
+        const snd_pcm_sframes_t numCommitted = snd_pcm_mmap_commit (handle, frameOffset, numFrames);
+
+        if (numCommitted >= 0 && (snd_pcm_uframes_t) numCommitted == numFrames)
+            return true;
+
+        return recoverFromError (numCommitted < 0 ? (int) numCommitted : -EPIPE);
+    }
+
+    static void* getMappedFrame (const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t frameOffset) noexcept
+    {
+        // With interleaved access all the channels share the first area, and the
+        // converters step through the channels within each frame.
+        return addBytesToPointer (areas[0].addr, (areas[0].first + frameOffset * areas[0].step) / 8);
+    }
+
     //==============================================================================
     template <class SampleType>
     struct ConverterHelper
@@ -592,6 +751,9 @@ public:
         if (outputDevice != nullptr && JUCE_ALSA_FAILED (snd_pcm_prepare (outputDevice->handle)))
             return;
 
+        if (inputDevice != nullptr)
+            inputDevice->startIfNeeded();
+
         startThread (9);
 
         int count = 1000;
@@ -648,6 +810,10 @@ public:
 
     void run() override
     {
+       #if JUCE_ALSA_SCHED_FIFO
+        setFifoPriority();
+       #endif
+
         while (! threadShouldExit())
         {
             if (inputDevice != nullptr && inputDevice->handle != nullptr)
@@ -662,7 +828,7 @@ public:
                     snd_pcm_sframes_t avail = snd_pcm_avail_update (inputDevice->handle);
 
                     if (avail < 0)
-                        JUCE_ALSA_FAILED (snd_pcm_recover (inputDevice->handle, (int) avail, 0));
+                        inputDevice->recoverFromError ((int) avail);
                 }
 
                 audioIoInProgress = true;
@@ -708,7 +874,7 @@ public:
                 snd_pcm_sframes_t avail = snd_pcm_avail_update (outputDevice->handle);
 
                 if (avail < 0)
-                    JUCE_ALSA_FAILED (snd_pcm_recover (outputDevice->handle, (int) avail, 0));
+                    outputDevice->recoverFromError ((int) avail);
 
                 audioIoInProgress = true;
 
@@ -736,6 +902,19 @@ public:
         return 16;
     }
 
+    int getXRunCount() const noexcept
+    {
+        int numXRuns = 0;
+
+        if (outputDevice != nullptr)
+            numXRuns += outputDevice->numXRuns.get();
+
+        if (inputDevice != nullptr)
+            numXRuns += inputDevice->numXRuns.get();
+
+        return numXRuns;
+    }
+
     //==============================================================================
     String error;
     double sampleRate;
@@ -772,6 +951,17 @@ private:
         return true;
     }
 
+   #if JUCE_ALSA_SCHED_FIFO
+    static void setFifoPriority()
+    {
+        struct sched_param param;
+        param.sched_priority = sched_get_priority_max (SCHED_FIFO);
+
+        if (pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) != 0)
+            JUCE_ALSA_LOG ("Couldn't switch the audio thread to SCHED_FIFO");
+    }
+   #endif
+
     void initialiseRatesAndChannels()
     {
         sampleRates.clear();
@@ -895,6 +1085,8 @@ public:
     int getOutputLatencyInSamples() override         { return internal.outputLatency; }
     int getInputLatencyInSamples() override          { return internal.inputLatency; }
 
+    int getXRunCount() const noexcept override       { return internal.getXRunCount(); }
+
     void start (AudioIODeviceCallback* callback) override
     {
         if (! isOpen_)
@@ -88,9 +88,46 @@ public:
 
     snd_seq_t* get() const noexcept     { return handle; }
 
+    /** Asks the sequencer to stamp incoming events on the given port with the
+        real-time clock of our queue, so that their timestamps reflect when they
+        arrived at the sequencer rather than when our input thread got to them.
+    */
+    void enableTimestamping (int portId)
+    {
+        snd_seq_port_info_t* portInfo = nullptr;
+
+        if (timestampQueue >= 0 && snd_seq_port_info_malloc (&portInfo) == 0)
+        {
+            if (snd_seq_get_port_info (handle, portId, portInfo) == 0)
+            {
+                snd_seq_port_info_set_timestamping (portInfo, 1);
+                snd_seq_port_info_set_timestamp_real (portInfo, 1);
+                snd_seq_port_info_set_timestamp_queue (portInfo, timestampQueue);
+                snd_seq_set_port_info (handle, portId, portInfo);
+            }
+
+            snd_seq_port_info_free (portInfo);
+        }
+    }
+
+    /** Returns the time in seconds, on the Time::getMillisecondCounterHiRes() clock,
+        at which an incoming event arrived.
+    */
+    double getEventTime (const snd_seq_event_t* event) const noexcept
+    {
+        if (timestampQueue >= 0
+             && event->queue == timestampQueue
+             && (event->flags & SND_SEQ_TIME_STAMP_MASK) == SND_SEQ_TIME_STAMP_REAL)
+            return queueStartTime + event->time.time.tv_sec + event->time.time.tv_nsec * 1.0e-9;
+
+        return Time::getMillisecondCounterHiRes() * 0.001;
+    }
+
 private:
     bool input;
     snd_seq_t* handle;
+    int timestampQueue;
+    double queueStartTime;
 
     Array<AlsaPortAndCallback*> activeCallbacks;
     CriticalSection callbackLock;
@@ -103,7 +140,7 @@ private:
     friend struct ContainerDeletePolicy<AlsaClient>;
 
     AlsaClient (bool forInput)
-        : input (forInput), handle (nullptr)
+        : input (forInput), handle (nullptr), timestampQueue (-1), queueStartTime (0)
     {
         AlsaClient*& instance = (input ? inInstance : outInstance);
         jassert (instance == nullptr);
@@ -115,6 +152,40 @@ private:
 
         snd_seq_set_client_name (handle, forInput ? JUCE_ALSA_MIDI_INPUT_NAME
                                  : JUCE_ALSA_MIDI_OUTPUT_NAME);
+
+        if (forInput && handle != nullptr)
+            startTimestampQueue();
+    }
+
+    void startTimestampQueue()
+    {
+        timestampQueue = snd_seq_alloc_queue (handle);
+
+        if (timestampQueue < 0)
+            return;
+
+        snd_seq_start_queue (handle, timestampQueue, nullptr);
+        snd_seq_drain_output (handle);
+
+        // The queue's clock and our own hi-res counter both run from the monotonic
+        // system clock, so a single measurement of the offset between them is enough
+        // to map the sequencer's timestamps onto the timebase that MidiInput uses.
+        snd_seq_queue_status_t* status = nullptr;
+        const double timeBefore = Time::getMillisecondCounterHiRes();
+        queueStartTime = timeBefore * 0.001;
+
+        if (snd_seq_queue_status_malloc (&status) == 0)
+        {
+            if (snd_seq_get_queue_status (handle, timestampQueue, status) == 0)
+            {
+                const double timeNow = 0.0005 * (timeBefore + Time::getMillisecondCounterHiRes());
+                const snd_seq_real_time_t* queueTime = snd_seq_queue_status_get_real_time (status);
+
+                queueStartTime = timeNow - (queueTime->tv_sec + queueTime->tv_nsec * 1.0e-9);
+            }
+
+            snd_seq_queue_status_free (status);
+        }
     }
 
     ~AlsaClient()
@@ -126,6 +197,9 @@ private:
 
         if (handle != nullptr)
         {
+            if (timestampQueue >= 0)
+                snd_seq_free_queue (handle, timestampQueue);
+
             snd_seq_close (handle);
             handle = nullptr;
         }
@@ -185,7 +259,7 @@ private:
                                 snd_midi_event_reset_decode (midiParser);
 
                                 concatenator.pushMidiData (buffer, (int) numBytes,
-                                                           Time::getMillisecondCounter() * 0.001,
+                                                           client.getEventTime (inputEvent),
                                                            inputEvent, client);
 
                                 snd_seq_free_event (inputEvent);
@@ -227,6 +301,9 @@ public:
                                                  forInput ? (SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE)
                                                           : (SND_SEQ_PORT_CAP_READ  | SND_SEQ_PORT_CAP_SUBS_READ),
                                                  SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+
+        if (forInput && portId >= 0)
+            client->enableTimestamping (portId);
     }
 
     void deletePort()
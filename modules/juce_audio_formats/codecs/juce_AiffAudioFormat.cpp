@@ -826,7 +826,10 @@ public:
         clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
                                            startSampleInFile, numSamples, lengthInSamples);
 
-        if (map == nullptr || ! mappedSection.contains (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
+        if (numSamples <= 0)
+            return true;
+
+        if (! ensureSamplesAreMapped (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
         {
             jassertfalse; // you must make sure that the window contains all the samples you're going to attempt to read.
             return false;
@@ -848,7 +851,7 @@ public:
     {
         const int num = (int) numChannels;
 
-        if (map == nullptr || ! mappedSection.contains (sample))
+        if (! isMapped (Range<int64> (sample, sample + 1)))
         {
             jassertfalse; // you must make sure that the window contains all the samples you're going to attempt to read.
 
@@ -889,7 +892,7 @@ public:
     {
         numSamples = jmin (numSamples, lengthInSamples - startSampleInFile);
 
-        if (map == nullptr || numSamples <= 0 || ! mappedSection.contains (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
+        if (numSamples <= 0 || ! ensureSamplesAreMapped (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
         {
             jassert (numSamples <= 0); // you must make sure that the window contains all the samples you're going to attempt to read.
 
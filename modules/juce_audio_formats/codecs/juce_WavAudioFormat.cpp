@@ -964,7 +964,7 @@ public:
             {
                 const int chunkType = input->readInt();
                 uint32 length = (uint32) input->readInt();
-                const int64 chunkEnd = input->getPosition() + length + (length & 1);
+                int64 chunkEnd = input->getPosition() + length + (length & 1);
 
                 if (chunkType == chunkName ("fmt "))
                 {
@@ -1020,7 +1020,9 @@ public:
                 }
                 else if (chunkType == chunkName ("data"))
                 {
-                    if (! isRF64) // data size is expected to be -1, actual data size is in ds64 chunk
+                    if (isRF64) // data size is expected to be -1, actual data size is in ds64 chunk
+                        chunkEnd = input->getPosition() + dataLength + (dataLength & 1);
+                    else
                         dataLength = length;
 
                     dataChunkStart = input->getPosition();
@@ -1483,7 +1485,10 @@ public:
         clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
                                            startSampleInFile, numSamples, lengthInSamples);
 
-        if (map == nullptr || ! mappedSection.contains (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
+        if (numSamples <= 0)
+            return true;
+
+        if (! ensureSamplesAreMapped (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
         {
             jassertfalse; // you must make sure that the window contains all the samples you're going to attempt to read.
             return false;
@@ -1499,7 +1504,7 @@ public:
     {
         const int num = (int) numChannels;
 
-        if (map == nullptr || ! mappedSection.contains (sample))
+        if (! isMapped (Range<int64> (sample, sample + 1)))
         {
             jassertfalse; // you must make sure that the window contains all the samples you're going to attempt to read.
 
@@ -1525,7 +1530,7 @@ public:
     {
         numSamples = jmin (numSamples, lengthInSamples - startSampleInFile);
 
-        if (map == nullptr || numSamples <= 0 || ! mappedSection.contains (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
+        if (numSamples <= 0 || ! ensureSamplesAreMapped (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
         {
             jassert (numSamples <= 0); // you must make sure that the window contains all the samples you're going to attempt to read.
 
@@ -1745,6 +1750,62 @@ public:
             expect (reader != nullptr);
             expect (reader->metadataValues == metadataValues, "Somehow, the metadata is different!");
         }
+
+        {
+            beginTest ("Memory-mapping an RF64 file");
+
+            TemporaryFile tempFile (".wav");
+            const int numFrames = 200000;
+            writeRF64TestFile (tempFile.getFile(), numFrames, "loopInfo");
+
+            ScopedPointer<AudioFormatReader> reader (format.createReaderFor (tempFile.getFile().createInputStream(), true));
+            expect (reader != nullptr);
+            expectEquals (reader->lengthInSamples, (int64) numFrames);
+            expectEquals (reader->metadataValues [WavAudioFormat::tracktionLoopInfo], String ("loopInfo"));
+
+            ScopedPointer<MemoryMappedAudioFormatReader> mapped (format.createMemoryMappedReader (tempFile.getFile()));
+            expect (mapped != nullptr);
+            expect (mapped->mapEntireFile());
+            expect (mapped->getMappedSection() == Range<int64> (0, numFrames));
+            expect (readersMatch (*reader, *mapped, 0, numFrames));
+
+            beginTest ("Paged memory-mapped reading");
+
+            ScopedPointer<MemoryMappedAudioFormatReader> paged (format.createMemoryMappedReader (tempFile.getFile()));
+            paged->setMappingWindowSize (4096);
+
+            Random r = getRandom();
+
+            for (int i = 0; i < 100; ++i)
+            {
+                const int start = r.nextInt (numFrames - 1000);
+                expect (readersMatch (*reader, *paged, start, 1000));
+                expect (paged->getNumBytesUsed() < 4096 * 4 + 8192);
+            }
+
+            // getSample() is const, so it only reads from the window that a read() has mapped
+            expect (readersMatch (*reader, *paged, numFrames - 1000, 1000));
+            expect (paged->getMappedSection().contains ((int64) numFrames - 1));
+
+            float sample[2], expected[2];
+            paged->getSample (numFrames - 1, sample);
+            mapped->getSample (numFrames - 1, expected);
+            expect (sample[0] == expected[0] && sample[1] == expected[1]);
+
+            beginTest ("Random-access read benchmark");
+
+            const int numReads = 2000, blockSize = 512;
+            AudioSampleBuffer buffer (2, blockSize);
+            paged->setMappingWindowSize (65536);
+
+            const double streamTime = timeRandomReads (*reader, buffer, numFrames, numReads);
+            const double mappedTime = timeRandomReads (*mapped, buffer, numFrames, numReads);
+            const double pagedTime  = timeRandomReads (*paged,  buffer, numFrames, numReads);
+
+            logMessage ("Random reads of " + String (blockSize) + " frames: FileInputStream "
+                          + String (streamTime, 3) + " ms, mapped " + String (mappedTime, 3)
+                          + " ms, paged " + String (pagedTime, 3) + " ms");
+        }
     }
 
 private:
@@ -1754,6 +1815,79 @@ private:
         numTestAudioBufferSamples = 256
     };
 
+    // Writes a stereo 16-bit RF64 file by hand, because the writer only switches to
+    // RF64 once a file has grown beyond 4GB.
+    static void writeRF64TestFile (const File& file, int numFrames, const String& trailingChunkText)
+    {
+        using namespace WavFileHelpers;
+
+        const int64 dataSize = numFrames * 4;
+        MemoryBlock trailer (trailingChunkText.toRawUTF8(), trailingChunkText.getNumBytesAsUTF8() + 1);
+        trailer.ensureSize (trailer.getSize() + (trailer.getSize() & 1), true);
+
+        FileOutputStream out (file);
+        out.setPosition (0);
+        out.truncate();
+
+        out.writeInt (chunkName ("RF64"));
+        out.writeInt (-1);
+        out.writeInt (chunkName ("WAVE"));
+
+        out.writeInt (chunkName ("ds64"));
+        out.writeInt (28);
+        out.writeInt64 (4 + (8 + 28) + (8 + 16) + (8 + dataSize) + (8 + (int64) trailer.getSize()));
+        out.writeInt64 (dataSize);
+        out.writeInt64 (numFrames);
+        out.writeInt (0);
+
+        out.writeInt (chunkName ("fmt "));
+        out.writeInt (16);
+        out.writeShort (1);
+        out.writeShort (2);
+        out.writeInt (44100);
+        out.writeInt (44100 * 4);
+        out.writeShort (4);
+        out.writeShort (16);
+
+        out.writeInt (chunkName ("data"));
+        out.writeInt (-1);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            out.writeShort ((short) (i & 0x7fff));
+            out.writeShort ((short) -(i & 0x7fff));
+        }
+
+        out.writeInt (chunkName ("Trkn"));
+        out.writeInt ((int) trailer.getSize());
+        out << trailer;
+    }
+
+    static bool readersMatch (AudioFormatReader& r1, AudioFormatReader& r2, int start, int num)
+    {
+        AudioSampleBuffer b1 (2, num), b2 (2, num);
+        r1.read (&b1, 0, num, start, true, true);
+        r2.read (&b2, 0, num, start, true, true);
+
+        for (int ch = 0; ch < 2; ++ch)
+            if (memcmp (b1.getReadPointer (ch), b2.getReadPointer (ch), sizeof (float) * (size_t) num) != 0)
+                return false;
+
+        return true;
+    }
+
+    static double timeRandomReads (AudioFormatReader& reader, AudioSampleBuffer& buffer, int numFrames, int numReads)
+    {
+        Random r (1);
+        const int blockSize = buffer.getNumSamples();
+        const double startTime = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numReads; ++i)
+            reader.read (&buffer, 0, blockSize, r.nextInt (numFrames - blockSize), true, true);
+
+        return Time::getMillisecondCounterHiRes() - startTime;
+    }
+
     JUCE_DECLARE_NON_COPYABLE (WaveAudioFormatTests)
 };
 
@@ -367,7 +367,7 @@ int64 AudioFormatReader::searchForLevel (int64 startSample,
 MemoryMappedAudioFormatReader::MemoryMappedAudioFormatReader (const File& f, const AudioFormatReader& reader,
                                                               int64 start, int64 length, int frameSize)
     : AudioFormatReader (nullptr, reader.getFormatName()), file (f),
-      dataChunkStart (start), dataLength (length), bytesPerFrame (frameSize)
+      dataChunkStart (start), dataLength (length), bytesPerFrame (frameSize), windowSize (0)
 {
     sampleRate      = reader.sampleRate;
     bitsPerSample   = reader.bitsPerSample;
@@ -403,6 +403,25 @@ bool MemoryMappedAudioFormatReader::mapSectionOfFile (Range<int64> samplesToMap)
     return map != nullptr;
 }
 
+bool MemoryMappedAudioFormatReader::ensureSamplesAreMapped (Range<int64> samplesNeeded)
+{
+    if (isMapped (samplesNeeded))
+        return true;
+
+    if (windowSize <= 0 || samplesNeeded.getStart() < 0 || samplesNeeded.getEnd() > lengthInSamples)
+        return false;
+
+    // Leave a little space behind the requested position, so that small backwards
+    // jumps don't immediately force the window to be moved again.
+    const int64 windowLength = jmin (lengthInSamples, jmax (windowSize, samplesNeeded.getLength()));
+    const int64 windowStart  = jlimit ((int64) 0, lengthInSamples - windowLength,
+                                       samplesNeeded.getStart() - (windowLength - samplesNeeded.getLength()) / 8);
+
+    mapSectionOfFile (Range<int64> (windowStart, windowStart + windowLength));
+
+    return isMapped (samplesNeeded);
+}
+
 static int memoryReadDummyVariable; // used to force the compiler not to optimise-away the read operation
 
 void MemoryMappedAudioFormatReader::touchSample (int64 sample) const noexcept
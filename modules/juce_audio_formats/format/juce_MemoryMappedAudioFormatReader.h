@@ -37,7 +37,8 @@
 
     Note that before reading samples from a MemoryMappedAudioFormatReader, you must first
     call mapEntireFile() or mapSectionOfFile() to ensure that the region you want to
-    read has been mapped.
+    read has been mapped - or alternatively, call setMappingWindowSize() to let the reader
+    map sections of the file on demand.
 
     @see AudioFormat::createMemoryMappedReader, AudioFormatReader
 */
@@ -79,12 +80,45 @@ public:
     /** Returns the number of bytes currently being mapped */
     size_t getNumBytesUsed() const                          { return map != nullptr ? map->getSize() : 0; }
 
+    //==============================================================================
+    /** Enables a paged mode, in which only a sliding window of the file is kept mapped.
+
+        For very long files (e.g. multi-gigabyte RF64 recordings), mapping the whole file
+        can use up a lot of address space. If a window size is set, then a read which falls
+        outside the currently-mapped section will move the mapping so that it covers the
+        samples that are needed, instead of failing. Pass 0 to turn this mode off again.
+
+        Only the non-const reading methods (read() and readMaxLevels()) will move the window.
+        The const getSample() method only reads from the section that's currently mapped, so
+        that it's safe to call from several threads at once, as long as nothing else is
+        reading from the reader at the same time.
+
+        Moving the window means re-mapping part of the file, so avoid relying on this
+        from a realtime thread.
+    */
+    void setMappingWindowSize (int64 numSamplesInWindow) noexcept   { windowSize = jmax ((int64) 0, numSamplesInWindow); }
+
+    /** Returns the window size that was set with setMappingWindowSize(), or 0 if the
+        paged mode isn't enabled.
+    */
+    int64 getMappingWindowSize() const noexcept             { return windowSize; }
+
 protected:
     File file;
     Range<int64> mappedSection;
     ScopedPointer<MemoryMappedFile> map;
     int64 dataChunkStart, dataLength;
     int bytesPerFrame;
+    int64 windowSize;
+
+    /** Returns true if the given range of samples is mapped and can be read.
+        If the paged mode is enabled (see setMappingWindowSize()), this will move the
+        mapped window to cover the range if necessary.
+    */
+    bool ensureSamplesAreMapped (Range<int64> samplesNeeded);
+
+    /** Returns true if the given range of samples lies within the currently-mapped section. */
+    bool isMapped (Range<int64> samples) const noexcept     { return map != nullptr && mappedSection.contains (samples); }
 
     /** Converts a sample index to a byte position in the file. */
     inline int64 sampleToFilePos (int64 sample) const noexcept       { return dataChunkStart + sample * bytesPerFrame; }
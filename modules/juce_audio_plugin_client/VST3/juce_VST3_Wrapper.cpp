@@ -1828,12 +1828,40 @@ public:
                     else
                     {
                         const int index = getJuceIndexForVSTParamID (vstParamID);
+
                         if (isPositiveAndBelow (index, pluginInstance->getNumParameters()))
+                        {
+                            addParameterChangesToAutomationQueue (*paramQueue, index, numPoints);
                             pluginInstance->setParameter (index, static_cast<float> (value));
+                        }
                     }
                 }
             }
         }
+
+        // each parameter's points arrive in order, but the parameters themselves may not
+        pluginInstance->getParameterAutomation().sort();
+    }
+
+    void addParameterChangesToAutomationQueue (Vst::IParamValueQueue& paramQueue, const int index, const Steinberg::int32 numPoints)
+    {
+        // VST3 points describe a piecewise-linear curve, starting from wherever the parameter
+        // was at the end of the last block, so each point becomes a ramp from the previous one.
+        AudioProcessorAutomationQueue& automation = pluginInstance->getParameterAutomation();
+        Steinberg::int32 lastOffset = 0;
+
+        for (Steinberg::int32 i = 0; i < numPoints; ++i)
+        {
+            Steinberg::int32 offsetSamples;
+            double value;
+
+            if (paramQueue.getPoint (i, offsetSamples, value) == kResultTrue)
+            {
+                offsetSamples = jmax (lastOffset, offsetSamples);
+                automation.addEvent (index, (int) lastOffset, static_cast<float> (value), (int) (offsetSamples - lastOffset));
+                lastOffset = offsetSamples;
+            }
+        }
     }
 
     void addParameterChangeToMidiBuffer (const Steinberg::int32 offsetSamples, const Vst::ParamID id, const double value)
@@ -2018,6 +2046,8 @@ private:
                 }
             }
 
+            pluginInstance->getParameterAutomation().clear();
+
            #if JUCE_DEBUG && (! JucePlugin_ProducesMidiOutput)
             /*  This assertion is caused when you've added some events to the
                 midiMessages array in your processBlock() method, which usually means
@@ -2080,6 +2110,7 @@ private:
         AudioProcessor& p = getPluginInstance();
 
         p.setRateAndBufferSizeDetails (sampleRate, bufferSize);
+        p.getParameterAutomation().ensureStorageAllocated (jmax (256, 4 * p.getNumParameters()));
         p.prepareToPlay (sampleRate, bufferSize);
     }
 
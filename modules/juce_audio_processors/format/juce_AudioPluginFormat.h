@@ -150,7 +150,8 @@ protected:
     AudioPluginFormat() noexcept;
 
     /** Implementors must override this function. This is guaranteed to be called on
-        the message thread. You may call the callback on any thread.
+        the message thread, unless canCreateInstancesOnBackgroundThread() returns true
+        for the description. You may call the callback on any thread.
     */
     virtual void createPluginInstance (const PluginDescription&, double initialSampleRate,
                                        int initialBufferSize, void* userData,
@@ -158,6 +159,13 @@ protected:
 
     virtual bool requiresUnblockedMessageThreadDuringCreation (const PluginDescription&) const noexcept = 0;
 
+    /** Formats can override this to return true if createPluginInstance() may be called
+        for this plugin on a background thread, concurrently with other instances being
+        created. AudioPluginFormatManager::createPluginInstances() uses it to decide which
+        plugins it can instantiate in parallel.
+    */
+    virtual bool canCreateInstancesOnBackgroundThread (const PluginDescription&) const noexcept    { return false; }
+
 private:
     /** @internal */
     void createPluginInstanceOnMessageThread (const PluginDescription&, double rate, int size,
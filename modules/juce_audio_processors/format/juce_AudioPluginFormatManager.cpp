@@ -152,6 +152,144 @@ void AudioPluginFormatManager::createPluginInstanceAsync (const PluginDescriptio
 }
 #endif
 
+//==============================================================================
+struct AudioPluginFormatManager::BackgroundInstantiationJob  : public ThreadPoolJob
+{
+    BackgroundInstantiationJob (AudioPluginFormat& f, const PluginDescription& desc,
+                                double sampleRate, int blockSize, const MemoryBlock* stateToRestore)
+        : ThreadPoolJob ("Plugin instantiation"),
+          format (f), description (desc), rate (sampleRate), size (blockSize),
+          state (stateToRestore), instance (nullptr)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        instance = createInstanceOnThisThread (format, description, rate, size, errorMessage);
+
+        if (instance != nullptr && state != nullptr && state->getSize() > 0)
+            instance->setStateInformation (state->getData(), (int) state->getSize());
+
+        return jobHasFinished;
+    }
+
+    AudioPluginFormat& format;
+    const PluginDescription& description;
+    const double rate;
+    const int size;
+    const MemoryBlock* const state;
+    AudioPluginInstance* instance;
+    String errorMessage;
+
+    JUCE_DECLARE_NON_COPYABLE (BackgroundInstantiationJob)
+};
+
+AudioPluginInstance* AudioPluginFormatManager::createInstanceOnThisThread (AudioPluginFormat& format,
+                                                                          const PluginDescription& description,
+                                                                          double rate, int blockSize,
+                                                                          String& errorMessage)
+{
+    WaitableEvent waitForCreation;
+    AudioPluginInstance* instance = nullptr;
+    EventSignaler signaler (waitForCreation, instance, errorMessage);
+
+    format.createPluginInstance (description, rate, blockSize, &signaler, EventSignaler::staticCompletionCallback);
+
+    waitForCreation.wait();
+    return instance;
+}
+
+void AudioPluginFormatManager::createPluginInstances (const Array<PluginDescription>& descriptions,
+                                                      double rate, int blockSize,
+                                                      OwnedArray<AudioPluginInstance>& results,
+                                                      StringArray& errorMessages,
+                                                      const Array<MemoryBlock>* statesToRestore,
+                                                      int maxNumThreads) const
+{
+    // there must be one state block for each of the descriptions!
+    jassert (statesToRestore == nullptr || statesToRestore->size() == descriptions.size());
+
+    const int numPlugins = descriptions.size();
+
+    results.clear();
+    errorMessages.clear();
+
+    Array<AudioPluginInstance*> instances;
+    Array<AudioPluginFormat*> foregroundFormats;
+    OwnedArray<BackgroundInstantiationJob> jobs;
+    Array<int> jobIndexes;
+
+    for (int i = 0; i < numPlugins; ++i)
+    {
+        const PluginDescription& desc = descriptions.getReference (i);
+        const MemoryBlock* state = (statesToRestore != nullptr && isPositiveAndBelow (i, statesToRestore->size()))
+                                        ? &statesToRestore->getReference (i) : nullptr;
+
+        String error;
+        AudioPluginFormat* format = findFormatForDescription (desc, error);
+
+        instances.add (nullptr);
+        errorMessages.add (error);
+        foregroundFormats.add (nullptr);
+
+        if (format != nullptr)
+        {
+            if (format->canCreateInstancesOnBackgroundThread (desc))
+            {
+                jobs.add (new BackgroundInstantiationJob (*format, desc, rate, blockSize, state));
+                jobIndexes.add (i);
+            }
+            else
+            {
+                foregroundFormats.set (i, format);
+            }
+        }
+    }
+
+    ScopedPointer<ThreadPool> pool;
+
+    if (jobs.size() > 0)
+    {
+        pool = new ThreadPool (jmin (jobs.size(), maxNumThreads > 0 ? maxNumThreads
+                                                                     : SystemStats::getNumCpus()));
+
+        for (int i = 0; i < jobs.size(); ++i)
+            pool->addJob (jobs.getUnchecked (i), false);
+    }
+
+    // While the pool is busy, create the ones that have to be made in the usual way..
+    for (int i = 0; i < numPlugins; ++i)
+    {
+        if (AudioPluginFormat* format = foregroundFormats.getUnchecked (i))
+        {
+            AudioPluginInstance* instance = format->createInstanceFromDescription (descriptions.getReference (i), rate, blockSize,
+                                                                                   errorMessages.getReference (i));
+
+            if (instance != nullptr && statesToRestore != nullptr && isPositiveAndBelow (i, statesToRestore->size()))
+            {
+                const MemoryBlock& state = statesToRestore->getReference (i);
+
+                if (state.getSize() > 0)
+                    instance->setStateInformation (state.getData(), (int) state.getSize());
+            }
+
+            instances.set (i, instance);
+        }
+    }
+
+    for (int i = 0; i < jobs.size(); ++i)
+    {
+        BackgroundInstantiationJob* const job = jobs.getUnchecked (i);
+        pool->waitForJobToFinish (job, -1);
+
+        instances.set (jobIndexes.getUnchecked (i), job->instance);
+        errorMessages.set (jobIndexes.getUnchecked (i), job->errorMessage);
+    }
+
+    for (int i = 0; i < numPlugins; ++i)
+        results.add (instances.getUnchecked (i));
+}
+
 AudioPluginFormat* AudioPluginFormatManager::findFormatForDescription (const PluginDescription& description, String& errorMessage) const
 {
     errorMessage = String();
@@ -178,3 +316,153 @@ bool AudioPluginFormatManager::doesPluginStillExist (const PluginDescription& de
 
     return false;
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioPluginFormatManagerTests  : public UnitTest
+{
+public:
+    AudioPluginFormatManagerTests() : UnitTest ("AudioPluginFormatManager") {}
+
+    //==============================================================================
+    struct DummyInstance  : public AudioPluginInstance
+    {
+        DummyInstance (const PluginDescription& d)  : desc (d), creationThread (Thread::getCurrentThreadId()) {}
+
+        void fillInPluginDescription (PluginDescription& d) const override   { d = desc; }
+        const String getName() const override                                 { return desc.name; }
+        void prepareToPlay (double, int) override                             {}
+        void releaseResources() override                                      {}
+        void processBlock (AudioBuffer<float>&, MidiBuffer&) override         {}
+        double getTailLengthSeconds() const override                          { return 0.0; }
+        bool acceptsMidi() const override                                     { return false; }
+        bool producesMidi() const override                                    { return false; }
+        AudioProcessorEditor* createEditor() override                         { return nullptr; }
+        bool hasEditor() const override                                       { return false; }
+        int getNumPrograms() override                                         { return 1; }
+        int getCurrentProgram() override                                      { return 0; }
+        void setCurrentProgram (int) override                                 {}
+        const String getProgramName (int) override                            { return String(); }
+        void changeProgramName (int, const String&) override                  {}
+        void getStateInformation (MemoryBlock& dest) override                 { dest = restoredState; }
+        void setStateInformation (const void* data, int size) override
+        {
+            restoredState.replaceWith (data, (size_t) size);
+            restoreThread = Thread::getCurrentThreadId();
+        }
+
+        PluginDescription desc;
+        Thread::ThreadID creationThread, restoreThread;
+        MemoryBlock restoredState;
+    };
+
+    // Plugins whose identifier begins with "bg" may be created in the background. Each
+    // one takes a while to create, so that we can see them overlapping.
+    struct DummyFormat  : public AudioPluginFormat
+    {
+        DummyFormat() : numCreating (0), maxNumCreating (0) {}
+
+        String getName() const override                                          { return "Dummy"; }
+        void findAllTypesForFile (OwnedArray<PluginDescription>&, const String&) override {}
+        bool fileMightContainThisPluginType (const String& f) override           { return f.startsWith ("bg") || f.startsWith ("fg"); }
+        String getNameOfPluginFromIdentifier (const String& f) override          { return f; }
+        bool pluginNeedsRescanning (const PluginDescription&) override           { return false; }
+        bool doesPluginStillExist (const PluginDescription&) override            { return true; }
+        bool canScanForPlugins() const override                                  { return false; }
+        StringArray searchPathsForPlugins (const FileSearchPath&, bool, bool) override  { return StringArray(); }
+        FileSearchPath getDefaultLocationsToSearch() override                    { return FileSearchPath(); }
+
+        void createPluginInstance (const PluginDescription& desc, double, int, void* userData,
+                                   void (*callback) (void*, AudioPluginInstance*, const String&)) override
+        {
+            const int n = ++numCreating;
+
+            for (;;)
+            {
+                const int oldMax = maxNumCreating.get();
+
+                if (n <= oldMax || maxNumCreating.compareAndSetBool (n, oldMax))
+                    break;
+            }
+
+            Thread::sleep (40);
+            --numCreating;
+
+            callback (userData, new DummyInstance (desc), String());
+        }
+
+        bool requiresUnblockedMessageThreadDuringCreation (const PluginDescription&) const noexcept override  { return false; }
+
+        bool canCreateInstancesOnBackgroundThread (const PluginDescription& desc) const noexcept override
+        {
+            return desc.fileOrIdentifier.startsWith ("bg");
+        }
+
+        Atomic<int> numCreating, maxNumCreating;
+    };
+
+    static PluginDescription makeDescription (const String& identifier)
+    {
+        PluginDescription desc;
+        desc.name = identifier;
+        desc.fileOrIdentifier = identifier;
+        desc.pluginFormatName = "Dummy";
+        return desc;
+    }
+
+    void runTest() override
+    {
+        beginTest ("Parallel instantiation");
+
+        AudioPluginFormatManager manager;
+        DummyFormat* format = new DummyFormat();
+        manager.addFormat (format);
+
+        Array<PluginDescription> descriptions;
+        Array<MemoryBlock> states;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            descriptions.add (makeDescription ((i % 4 == 3 ? "fg" : "bg") + String (i)));
+            states.add (MemoryBlock (&i, sizeof (i)));
+        }
+
+        descriptions.add (makeDescription ("unknown"));
+        states.add (MemoryBlock());
+
+        OwnedArray<AudioPluginInstance> results;
+        StringArray errors;
+        const Thread::ThreadID callingThread = Thread::getCurrentThreadId();
+
+        manager.createPluginInstances (descriptions, 44100.0, 512, results, errors, &states, 4);
+
+        expectEquals (results.size(), descriptions.size());
+        expectEquals (errors.size(), descriptions.size());
+        expect (format->maxNumCreating.get() > 1);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            DummyInstance* instance = dynamic_cast<DummyInstance*> (results[i]);
+            expect (instance != nullptr);
+
+            if (instance != nullptr)
+            {
+                const bool isBackground = descriptions.getReference (i).fileOrIdentifier.startsWith ("bg");
+
+                expect (instance->desc.name == descriptions.getReference (i).name);
+                expect (instance->restoredState == states.getReference (i));
+                expect (instance->restoreThread == instance->creationThread);
+                expect ((instance->creationThread != callingThread) == isBackground);
+                expect (errors[i].isEmpty());
+            }
+        }
+
+        expect (results[8] == nullptr);
+        expect (errors[8].isNotEmpty());
+    }
+};
+
+static AudioPluginFormatManagerTests audioPluginFormatManagerTests;
+
+#endif
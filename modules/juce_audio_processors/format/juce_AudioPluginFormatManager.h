@@ -120,6 +120,32 @@ public:
                                     std::function<void (AudioPluginInstance*, const String&)> completionCallback);
    #endif
 
+    /** Creates a whole set of plugin instances in one go, e.g. when loading a project.
+
+        Plugins whose format allows it (see AudioPluginFormat::canCreateInstancesOnBackgroundThread)
+        are instantiated in parallel on a pool of up to maxNumThreads background threads
+        (or one per CPU if this is zero or less), while the remaining ones are created on the
+        message thread at the same time. This method blocks until all of them are ready.
+
+        On return, the results and errorMessages arrays contain one entry for each of the
+        descriptions, in the same order. An entry in results will be nullptr if that plugin
+        couldn't be created, and the matching error message explains why.
+
+        If statesToRestore is supplied, it must contain one block for each description, and
+        any non-empty block is passed to the new instance's setStateInformation() method on
+        the same thread that created it.
+
+        The same restrictions apply as for createPluginInstance(), so formats that need an
+        unblocked message thread must be loaded from a thread other than the message thread.
+    */
+    void createPluginInstances (const Array<PluginDescription>& descriptions,
+                                double initialSampleRate,
+                                int initialBufferSize,
+                                OwnedArray<AudioPluginInstance>& results,
+                                StringArray& errorMessages,
+                                const Array<MemoryBlock>* statesToRestore = nullptr,
+                                int maxNumThreads = 0) const;
+
     /** Checks that the file or component for this plugin actually still exists.
 
         (This won't try to load the plugin)
@@ -131,6 +157,10 @@ private:
     //@internal
     AudioPluginFormat* findFormatForDescription (const PluginDescription&, String& errorMessage) const;
 
+    struct BackgroundInstantiationJob;
+    static AudioPluginInstance* createInstanceOnThisThread (AudioPluginFormat&, const PluginDescription&,
+                                                            double rate, int blockSize, String& errorMessage);
+
     OwnedArray<AudioPluginFormat> formats;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginFormatManager)
@@ -1098,10 +1098,10 @@ private:
 };
 
 //==============================================================================
-struct DLLHandle
+struct DLLHandle  : public ReferenceCountedObject
 {
     DLLHandle (const String& modulePath)
-        : factory (nullptr)
+        : path (modulePath), factory (nullptr)
     {
         if (modulePath.trim().isNotEmpty())
             open (modulePath);
@@ -1153,6 +1153,8 @@ struct DLLHandle
     */
     IPluginFactory* JUCE_CALLTYPE getPluginFactory()
     {
+        const ScopedLock sl (factoryLock);
+
         if (factory == nullptr)
             if (GetFactoryProc proc = (GetFactoryProc) getFunction ("GetPluginFactory"))
                 factory = proc();
@@ -1179,8 +1181,69 @@ struct DLLHandle
        #endif
     }
 
+    //==============================================================================
+    typedef ReferenceCountedObjectPtr<DLLHandle> Ptr;
+
+    /** Returns a handle that's shared by everything using this module file, so that
+        the bundle's entry point and factory are only set up once, however many
+        instances or shell sub-plugins are created from it.
+    */
+    static Ptr findOrOpen (const String& modulePath)
+    {
+        releaseUnusedHandles();
+
+        const ScopedLock sl (getOpenHandlesLock());
+
+        ReferenceCountedArray<DLLHandle>& openHandles = getOpenHandles();
+
+        for (int i = openHandles.size(); --i >= 0;)
+        {
+            DLLHandle* const handle = openHandles.getObjectPointerUnchecked (i);
+
+            if (handle->path == modulePath)
+                return handle;
+        }
+
+        Ptr handle (new DLLHandle (modulePath));
+        openHandles.add (handle);
+        return handle;
+    }
+
+    /** Closes any handles that aren't being used by anything else. */
+    static void releaseUnusedHandles()
+    {
+        // (these get deleted when this array goes out of scope, after the lock has been released)
+        ReferenceCountedArray<DLLHandle> unusedHandles;
+
+        {
+            const ScopedLock sl (getOpenHandlesLock());
+
+            for (int i = getOpenHandles().size(); --i >= 0;)
+                if (getOpenHandles().getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+                    unusedHandles.add (getOpenHandles().removeAndReturn (i));
+        }
+    }
+
+    const String path;
+
 private:
     IPluginFactory* factory;
+    CriticalSection factoryLock;
+
+    /** This holds a reference to each handle, so that one can never be found here while
+        another thread is in the middle of deleting it.
+    */
+    static ReferenceCountedArray<DLLHandle>& getOpenHandles()
+    {
+        static ReferenceCountedArray<DLLHandle> openHandles;
+        return openHandles;
+    }
+
+    static CriticalSection& getOpenHandlesLock()
+    {
+        static CriticalSection openHandlesLock;
+        return openHandlesLock;
+    }
 
     void releaseFactory()
     {
@@ -1274,12 +1337,12 @@ class VST3ModuleHandle  : public ReferenceCountedObject
 public:
     explicit VST3ModuleHandle (const File& pluginFile)  : file (pluginFile)
     {
-        getActiveModules().add (this);
     }
 
     ~VST3ModuleHandle()
     {
-        getActiveModules().removeFirstMatchingValue (this);
+        dllHandle = nullptr;
+        DLLHandle::releaseUnusedHandles();
     }
 
     /**
@@ -1290,23 +1353,30 @@ public:
     static bool getAllDescriptionsForFile (OwnedArray<PluginDescription>& results,
                                            const String& fileOrIdentifier)
     {
-        DLLHandle tempModule (fileOrIdentifier);
-
-        ComSmartPtr<IPluginFactory> pluginFactory (tempModule.getPluginFactory());
+        bool succeeded = false;
 
-        if (pluginFactory != nullptr)
         {
-            ComSmartPtr<VST3HostContext> host (new VST3HostContext (nullptr));
-            DescriptionLister lister (host, pluginFactory);
-            const Result result (lister.findDescriptionsAndPerform (File (fileOrIdentifier)));
+            const DLLHandle::Ptr tempModule (DLLHandle::findOrOpen (fileOrIdentifier));
+
+            ComSmartPtr<IPluginFactory> pluginFactory (tempModule->getPluginFactory());
 
-            results.addCopiesOf (lister.list);
+            if (pluginFactory != nullptr)
+            {
+                ComSmartPtr<VST3HostContext> host (new VST3HostContext (nullptr));
+                DescriptionLister lister (host, pluginFactory);
+                const Result result (lister.findDescriptionsAndPerform (File (fileOrIdentifier)));
 
-            return result.wasOk();
+                results.addCopiesOf (lister.list);
+                succeeded = result.wasOk();
+            }
+            else
+            {
+                jassertfalse;
+            }
         }
 
-        jassertfalse;
-        return false;
+        DLLHandle::releaseUnusedHandles();
+        return succeeded;
     }
 
     //==============================================================================
@@ -1314,11 +1384,15 @@ public:
 
     static VST3ModuleHandle::Ptr findOrCreateModule (const File& file, const PluginDescription& description)
     {
-        Array<VST3ModuleHandle*>& activeModules = getActiveModules();
+        releaseUnusedModules();
+
+        const ScopedLock sl (getActiveModulesLock());
+
+        ReferenceCountedArray<VST3ModuleHandle>& activeModules = getActiveModules();
 
         for (int i = activeModules.size(); --i >= 0;)
         {
-            VST3ModuleHandle* const module = activeModules.getUnchecked (i);
+            VST3ModuleHandle* const module = activeModules.getObjectPointerUnchecked (i);
 
             // VST3s are basically shells, you must therefore check their name along with their file:
             if (module->file == file && module->name == description.name)
@@ -1328,11 +1402,27 @@ public:
         VST3ModuleHandle::Ptr m (new VST3ModuleHandle (file));
 
         if (! m->open (file, description))
-            m = nullptr;
+            return nullptr;
 
+        activeModules.add (m);
         return m;
     }
 
+    /** Unloads any active modules that aren't being used by anything else. */
+    static void releaseUnusedModules()
+    {
+        // (these get deleted when this array goes out of scope, after the lock has been released)
+        ReferenceCountedArray<VST3ModuleHandle> unusedModules;
+
+        {
+            const ScopedLock sl (getActiveModulesLock());
+
+            for (int i = getActiveModules().size(); --i >= 0;)
+                if (getActiveModules().getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+                    unusedModules.add (getActiveModules().removeAndReturn (i));
+        }
+    }
+
     //==============================================================================
     IPluginFactory* getPluginFactory()      { return dllHandle->getPluginFactory(); }
 
@@ -1340,19 +1430,28 @@ public:
     String name;
 
 private:
-    ScopedPointer<DLLHandle> dllHandle;
+    DLLHandle::Ptr dllHandle;
 
     //==============================================================================
-    static Array<VST3ModuleHandle*>& getActiveModules()
+    /** This holds a reference to each module, so that one can never be found here while
+        another thread is in the middle of deleting it.
+    */
+    static ReferenceCountedArray<VST3ModuleHandle>& getActiveModules()
     {
-        static Array<VST3ModuleHandle*> activeModules;
+        static ReferenceCountedArray<VST3ModuleHandle> activeModules;
         return activeModules;
     }
 
+    static CriticalSection& getActiveModulesLock()
+    {
+        static CriticalSection activeModulesLock;
+        return activeModulesLock;
+    }
+
     //==============================================================================
     bool open (const File& f, const PluginDescription& description)
     {
-        dllHandle = new DLLHandle (f.getFullPathName());
+        dllHandle = DLLHandle::findOrOpen (f.getFullPathName());
 
         ComSmartPtr<IPluginFactory> pluginFactory (dllHandle->getPluginFactory());
 
@@ -1638,6 +1737,8 @@ public:
         component = nullptr;
         host = nullptr;
         module = nullptr;
+
+        VST3ModuleHandle::releaseUnusedModules();
     }
 
     bool initialise()
@@ -1707,6 +1808,9 @@ public:
 
     void prepareToPlay (double newSampleRate, int estimatedSamplesPerBlock) override
     {
+        getParameterAutomation().ensureStorageAllocated (jmax (256, 4 * getNumParameters()));
+        automationValues.setSize (1, jmax (1, estimatedSamplesPerBlock), false, false, true);
+
         // Avoid redundantly calling things like setActive, which can be a heavy-duty call for some plugins:
         if (isActive
               && getSampleRate() == newSampleRate
@@ -1823,12 +1927,93 @@ public:
 
         associateTo (data, buffer);
         associateTo (data, midiMessages);
+        addScheduledParameterChanges (numSamples);
 
         processor->process (data);
 
         MidiEventList::toMidiBuffer (midiMessages, *midiOutputs);
 
         inputParameterChanges->clearAllQueues();
+        getParameterAutomation().clear();
+    }
+
+    void addScheduledParameterChanges (const int numSamples)
+    {
+        AudioProcessorAutomationQueue& automation = getParameterAutomation();
+
+        if (automation.isEmpty() || editController == nullptr)
+            return;
+
+        automation.sort();
+
+        // If the host sends a bigger block than it asked for in prepareToPlay, there's no room to
+        // render the curves, and resizing the buffer here could allocate, so each parameter just
+        // gets set to its final value at the start of the block.
+        const bool canRenderCurves = numSamples <= automationValues.getNumSamples();
+        float* const values = canRenderCurves ? automationValues.getWritePointer (0) : nullptr;
+
+        for (int i = 0; i < automation.getNumEvents();)
+        {
+            const int parameterIndex = automation.getEvent (i).parameterIndex;
+            int numEvents;
+            const AudioProcessorAutomationQueue::Event* const events = automation.getEventsForParameter (parameterIndex, numEvents);
+            i += numEvents;
+
+            // VST3 interpolates linearly between points, so render the curve that the events describe,
+            // and add a point wherever it changes direction. A jump needs a point just before it which
+            // holds the old value, or the plugin would ramp to the new value from the previous point.
+            const float endValue = automation.renderParameterValues (parameterIndex, getParameter (parameterIndex),
+                                                                     values, numSamples);
+            const Vst::ParamID paramID = getParameterInfoForIndex (parameterIndex).id;
+            Steinberg::int32 queueIndex;
+            Vst::IParamValueQueue& queue = *inputParameterChanges->addParameterData (paramID, queueIndex);
+            int lastOffset = -1, rampEnd = -1;
+
+            if (values == nullptr)
+            {
+                Steinberg::int32 pointIndex;
+                queue.addPoint (0, (double) endValue, pointIndex);
+                editController->setParamNormalized (paramID, (double) endValue);
+                continue;
+            }
+
+            for (int j = 0; j < numEvents && events[j].sampleOffset < numSamples; ++j)
+            {
+                const int start = events[j].sampleOffset;
+
+                // a ramp that gets interrupted ends at the hold point of the next change
+                if (rampEnd >= 0 && rampEnd < start - 1)
+                    addAutomationPoint (queue, values, rampEnd, lastOffset);
+
+                if (start > 0)
+                    addAutomationPoint (queue, values, start - 1, lastOffset);
+
+                if (events[j].rampLength == 0)
+                {
+                    addAutomationPoint (queue, values, start, lastOffset);
+                    rampEnd = -1;
+                }
+                else
+                {
+                    rampEnd = jmin (start + events[j].rampLength, numSamples) - 1;
+                }
+            }
+
+            if (rampEnd >= 0)
+                addAutomationPoint (queue, values, rampEnd, lastOffset);
+
+            editController->setParamNormalized (paramID, (double) endValue);
+        }
+    }
+
+    static void addAutomationPoint (Vst::IParamValueQueue& queue, const float* values, const int offset, int& lastOffset)
+    {
+        if (offset > lastOffset)
+        {
+            Steinberg::int32 index;
+            queue.addPoint ((Steinberg::int32) offset, (double) values[offset], index);
+            lastOffset = offset;
+        }
     }
 
     //==============================================================================
@@ -2226,6 +2411,7 @@ private:
     ComSmartPtr<ParamValueQueueList> inputParameterChanges, outputParameterChanges;
     ComSmartPtr<MidiEventList> midiInputs, midiOutputs;
     Vst::ProcessContext timingInfo; //< Only use this in processBlock()!
+    AudioBuffer<float> automationValues; //< Only use this in processBlock()!
     bool isComponentInitialised, isControllerInitialised, isActive;
 
     //==============================================================================
@@ -331,18 +331,49 @@ public:
 
     typedef ReferenceCountedObjectPtr<ModuleHandle> Ptr;
 
-    static Array<ModuleHandle*>& getActiveModules()
+    /** The modules that are currently loaded. This holds a reference to each of them, so
+        that one can never be found here while another thread is in the middle of deleting it.
+    */
+    static ReferenceCountedArray<ModuleHandle>& getActiveModules()
     {
-        static Array<ModuleHandle*> activeModules;
+        static ReferenceCountedArray<ModuleHandle> activeModules;
         return activeModules;
     }
 
+    /** Guards the list of active modules, which may be searched from several
+        threads when instances are being created in parallel.
+    */
+    static CriticalSection& getActiveModulesLock()
+    {
+        static CriticalSection activeModulesLock;
+        return activeModulesLock;
+    }
+
+    /** Unloads any active modules that aren't being used by anything else. */
+    static void releaseUnusedModules()
+    {
+        // (these get deleted when this array goes out of scope, after the lock has been released)
+        ReferenceCountedArray<ModuleHandle> unusedModules;
+
+        {
+            const ScopedLock sl (getActiveModulesLock());
+
+            for (int i = getActiveModules().size(); --i >= 0;)
+                if (getActiveModules().getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+                    unusedModules.add (getActiveModules().removeAndReturn (i));
+        }
+    }
+
     //==============================================================================
     static Ptr findOrCreateModule (const File& file)
     {
+        releaseUnusedModules();
+
+        const ScopedLock sl (getActiveModulesLock());
+
         for (int i = getActiveModules().size(); --i >= 0;)
         {
-            ModuleHandle* const module = getActiveModules().getUnchecked(i);
+            ModuleHandle* const module = getActiveModules().getObjectPointerUnchecked (i);
 
             if (module->file == file)
                 return module;
@@ -359,6 +390,7 @@ public:
         if (m->open())
         {
             _fpreset();
+            getActiveModules().add (m);
             return m;
         }
 
@@ -372,8 +404,6 @@ public:
            , resHandle (0), bundleRef (0), resFileId (0)
          #endif
     {
-        getActiveModules().add (this);
-
        #if JUCE_WINDOWS || JUCE_LINUX || JUCE_IOS
         fullParentDirectoryPathName = f.getParentDirectory().getFullPathName();
        #elif JUCE_MAC
@@ -385,7 +415,6 @@ public:
 
     ~ModuleHandle()
     {
-        getActiveModules().removeFirstMatchingValue (this);
         close();
     }
 
@@ -649,6 +678,8 @@ public:
 
         module = nullptr;
         effect = nullptr;
+
+        ModuleHandle::releaseUnusedModules();
     }
 
     void fillInPluginDescription (PluginDescription& desc) const override
@@ -2702,20 +2733,32 @@ void VSTPluginFormat::createPluginInstance (const PluginDescription& desc,
     {
         File file (desc.fileOrIdentifier);
 
-        const File previousWorkingDirectory (File::getCurrentWorkingDirectory());
-        file.getParentDirectory().setAsCurrentWorkingDirectory();
+        // When we're being called from a background thread, only the module's entry point
+        // needs to be serialised (the shell UID and working directory are process-wide), and
+        // the rest of the initialisation can run alongside other instances being created.
+        const bool initialiseWhileLocked = MessageManager::getInstance()->isThisTheMessageThread();
 
-        if (ModuleHandle::Ptr module = ModuleHandle::findOrCreateModule (file))
         {
-            shellUIDToCreate = desc.uid;
+            const ScopedLock sl (getInstantiationLock());
 
-            result = new VSTPluginInstance (module);
+            const File previousWorkingDirectory (File::getCurrentWorkingDirectory());
+            file.getParentDirectory().setAsCurrentWorkingDirectory();
 
-            if (! result->initialiseEffect (sampleRate, blockSize))
-                result = nullptr;
+            if (ModuleHandle::Ptr module = ModuleHandle::findOrCreateModule (file))
+            {
+                shellUIDToCreate = desc.uid;
+
+                result = new VSTPluginInstance (module);
+
+                if (initialiseWhileLocked && ! result->initialiseEffect (sampleRate, blockSize))
+                    result = nullptr;
+            }
+
+            previousWorkingDirectory.setAsCurrentWorkingDirectory();
         }
 
-        previousWorkingDirectory.setAsCurrentWorkingDirectory();
+        if (result != nullptr && ! initialiseWhileLocked && ! result->initialiseEffect (sampleRate, blockSize))
+            result = nullptr;
     }
 
     String errorMsg;
@@ -2731,6 +2774,23 @@ bool VSTPluginFormat::requiresUnblockedMessageThreadDuringCreation (const Plugin
     return false;
 }
 
+bool VSTPluginFormat::canCreateInstancesOnBackgroundThread (const PluginDescription&) const noexcept
+{
+   #if JUCE_LINUX
+    return true;
+   #else
+    // Windows plugins need the message thread to create their HWNDs, and on the Mac
+    // the resource file chain that UseResFile() selects is global.
+    return false;
+   #endif
+}
+
+CriticalSection& VSTPluginFormat::getInstantiationLock()
+{
+    static CriticalSection instantiationLock;
+    return instantiationLock;
+}
+
 bool VSTPluginFormat::fileMightContainThisPluginType (const String& fileOrIdentifier)
 {
     const File f (File::createFileWithoutCheckingPath (fileOrIdentifier));
@@ -110,9 +110,11 @@ private:
                                void (*callback) (void*, AudioPluginInstance*, const String&)) override;
 
     bool requiresUnblockedMessageThreadDuringCreation (const PluginDescription&) const noexcept override;
+    bool canCreateInstancesOnBackgroundThread (const PluginDescription&) const noexcept override;
 
 private:
     void recursiveFileSearch (StringArray&, const File&, bool recursive);
+    static CriticalSection& getInstantiationLock();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VSTPluginFormat)
 };
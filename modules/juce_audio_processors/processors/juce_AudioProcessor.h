@@ -802,6 +802,20 @@ public:
     /** Returns the current list of parameters. */
     const OwnedArray<AudioProcessorParameter>& getParameters() const noexcept;
 
+    /** Returns the sample-accurate parameter changes for the block being processed.
+
+        This is only meaningful inside processBlock(), where it contains any changes
+        that the host has scheduled within the current block. The parameters will also
+        have been set to their final values before processBlock() is called, so you only
+        need to look at this if you want to respond to changes at the exact sample.
+
+        @see AudioProcessorAutomationQueue
+    */
+    AudioProcessorAutomationQueue& getParameterAutomation() noexcept            { return parameterAutomation; }
+
+    /** Returns the sample-accurate parameter changes for the block being processed. */
+    const AudioProcessorAutomationQueue& getParameterAutomation() const noexcept { return parameterAutomation; }
+
     //==============================================================================
     /** Returns the number of preset programs the filter supports.
 
@@ -1003,6 +1017,7 @@ private:
     String cachedOutputSpeakerArrString;
 
     OwnedArray<AudioProcessorParameter> managedParameters;
+    AudioProcessorAutomationQueue parameterAutomation;
     AudioProcessorParameter* getParamChecked (int) const noexcept;
 
    #if JUCE_DEBUG && ! JUCE_DISABLE_AUDIOPROCESSOR_BEGIN_END_GESTURE_CHECKING
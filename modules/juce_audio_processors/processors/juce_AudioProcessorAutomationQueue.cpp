@@ -0,0 +1,446 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+AudioProcessorAutomationQueue::AudioProcessorAutomationQueue() noexcept
+    : numEvents (0), capacity (0), numDropped (0), isSorted (true)
+{
+}
+
+AudioProcessorAutomationQueue::~AudioProcessorAutomationQueue() {}
+
+void AudioProcessorAutomationQueue::ensureStorageAllocated (const int numEventsNeeded)
+{
+    if (numEventsNeeded > capacity)
+    {
+        // this mustn't happen while the queue is being filled or read!
+        jassert (numEvents == 0);
+
+        events.realloc ((size_t) numEventsNeeded);
+        sortSpace.realloc ((size_t) numEventsNeeded);
+        capacity = numEventsNeeded;
+    }
+}
+
+bool AudioProcessorAutomationQueue::addEvent (const int parameterIndex, const int sampleOffset,
+                                              const float value, const int rampLength) noexcept
+{
+    jassert (parameterIndex >= 0 && sampleOffset >= 0);
+
+    if (numEvents >= capacity)
+    {
+        // (this is on the audio thread, so the event is just counted rather than asserting)
+        ++numDropped;
+        return false;
+    }
+
+    Event& newEvent = events[numEvents];
+    newEvent.parameterIndex = parameterIndex;
+    newEvent.sampleOffset   = sampleOffset;
+    newEvent.rampLength     = jmax (0, rampLength);
+    newEvent.value          = value;
+
+    if (numEvents > 0 && isSorted)
+        isSorted = ! isBefore (newEvent, events[numEvents - 1]);
+
+    ++numEvents;
+    return true;
+}
+
+void AudioProcessorAutomationQueue::clear() noexcept
+{
+    numEvents = 0;
+    isSorted = true;
+}
+
+bool AudioProcessorAutomationQueue::isBefore (const Event& a, const Event& b) noexcept
+{
+    return a.parameterIndex < b.parameterIndex
+            || (a.parameterIndex == b.parameterIndex && a.sampleOffset < b.sampleOffset);
+}
+
+void AudioProcessorAutomationQueue::sort() noexcept
+{
+    if (isSorted)
+        return;
+
+    // A bottom-up merge sort, which keeps events with equal keys in the order they were
+    // added, and uses the spare block that ensureStorageAllocated() made, so never allocates
+    Event* src = events;
+    Event* dst = sortSpace;
+
+    for (int width = 1; width < numEvents; width *= 2)
+    {
+        for (int start = 0; start < numEvents; start += 2 * width)
+        {
+            const int mid = jmin (start + width, numEvents);
+            const int end = jmin (start + 2 * width, numEvents);
+            int i = start, j = mid, k = start;
+
+            while (i < mid && j < end)
+                dst[k++] = isBefore (src[j], src[i]) ? src[j++] : src[i++];
+
+            while (i < mid)  dst[k++] = src[i++];
+            while (j < end)  dst[k++] = src[j++];
+        }
+
+        std::swap (src, dst);
+    }
+
+    if (src != events)
+        memcpy (events, src, sizeof (Event) * (size_t) numEvents);
+
+    isSorted = true;
+}
+
+const AudioProcessorAutomationQueue::Event& AudioProcessorAutomationQueue::getEvent (const int index) const noexcept
+{
+    jassert (isPositiveAndBelow (index, numEvents));
+    return events[index];
+}
+
+int AudioProcessorAutomationQueue::findFirstEventFor (const int parameterIndex) const noexcept
+{
+    jassert (isSorted); // you need to call sort() after adding events out of order!
+
+    int start = 0, end = numEvents;
+
+    while (start < end)
+    {
+        const int mid = (start + end) / 2;
+
+        if (events[mid].parameterIndex < parameterIndex)
+            start = mid + 1;
+        else
+            end = mid;
+    }
+
+    return start;
+}
+
+const AudioProcessorAutomationQueue::Event* AudioProcessorAutomationQueue::getEventsForParameter (const int parameterIndex,
+                                                                                                 int& numFound) const noexcept
+{
+    const int first = findFirstEventFor (parameterIndex);
+    int last = first;
+
+    while (last < numEvents && events[last].parameterIndex == parameterIndex)
+        ++last;
+
+    numFound = last - first;
+    return numFound > 0 ? events + first : nullptr;
+}
+
+bool AudioProcessorAutomationQueue::hasEventsForParameter (const int parameterIndex) const noexcept
+{
+    const int first = findFirstEventFor (parameterIndex);
+    return first < numEvents && events[first].parameterIndex == parameterIndex;
+}
+
+float AudioProcessorAutomationQueue::renderParameterValues (const int parameterIndex, float value,
+                                                            float* const dest, const int numSamples) const noexcept
+{
+    int numFound;
+    const Event* e = getEventsForParameter (parameterIndex, numFound);
+    int pos = 0;
+
+    for (; --numFound >= 0; ++e)
+    {
+        const int start = jmin (e->sampleOffset, numSamples);
+
+        if (start > pos)
+        {
+            if (dest != nullptr)
+                FloatVectorOperations::fill (dest + pos, value, start - pos);
+
+            pos = start;
+        }
+
+        if (e->rampLength == 0)
+        {
+            if (e->sampleOffset < numSamples)
+                value = e->value;
+
+            continue;
+        }
+
+        // if a previous ramp overlaps this one, the new ramp takes over from wherever it got to
+        const int rampEnd = e->sampleOffset + e->rampLength;
+        const int end = jmin (rampEnd, numSamples);
+
+        if (end > pos)
+        {
+            const float step = (e->value - value) / (float) (rampEnd - pos);
+
+            if (dest != nullptr)
+            {
+                for (int i = pos; i < end; ++i)
+                    dest[i] = (value += step);
+            }
+            else
+            {
+                value += step * (float) (end - pos);
+            }
+
+            pos = end;
+
+            if (rampEnd <= numSamples)
+                value = e->value;
+        }
+    }
+
+    if (dest != nullptr && pos < numSamples)
+        FloatVectorOperations::fill (dest + pos, value, numSamples - pos);
+
+    return value;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorAutomationQueueTests  : public UnitTest
+{
+public:
+    AudioProcessorAutomationQueueTests() : UnitTest ("AudioProcessorAutomationQueue") {}
+
+    void runTest() override
+    {
+        beginTest ("Sorting and lookup");
+        {
+            AudioProcessorAutomationQueue q;
+            q.ensureStorageAllocated (16);
+
+            expect (q.addEvent (3, 10, 0.5f));
+            expect (q.addEvent (1, 20, 0.2f));
+            expect (q.addEvent (3, 5, 0.1f));
+            expect (q.addEvent (1, 0, 0.9f));
+            expect (q.addEvent (3, 5, 0.3f));
+            q.sort();
+
+            expectEquals (q.getNumEvents(), 5);
+            expectEquals (q.getEvent (0).parameterIndex, 1);
+            expectEquals (q.getEvent (0).sampleOffset, 0);
+            expectEquals (q.getEvent (4).sampleOffset, 10);
+
+            int num;
+            const AudioProcessorAutomationQueue::Event* e = q.getEventsForParameter (3, num);
+            expectEquals (num, 3);
+            expectEquals (e[0].value, 0.1f);
+            expectEquals (e[1].value, 0.3f);    // equal offsets stay in the order they were added
+            expect (q.getEventsForParameter (2, num) == nullptr && num == 0);
+            expect (q.hasEventsForParameter (1));
+            expect (! q.hasEventsForParameter (0));
+            expect (! q.hasEventsForParameter (4));
+
+            q.clear();
+            expect (q.isEmpty());
+        }
+
+        beginTest ("Events that don't fit are counted");
+        {
+            AudioProcessorAutomationQueue q;
+            q.ensureStorageAllocated (2);
+
+            expect (q.addEvent (0, 0, 0.1f));
+            expect (q.addEvent (0, 1, 0.2f));
+            expect (! q.addEvent (0, 2, 0.3f));
+            expect (! q.addEvent (1, 0, 0.4f));
+            expectEquals (q.getNumEvents(), 2);
+            expectEquals (q.getNumDroppedEvents(), 2);
+
+            q.clear();
+            expect (q.addEvent (0, 0, 0.5f));
+            expectEquals (q.getNumDroppedEvents(), 2);
+        }
+
+        beginTest ("Sorting many events");
+        {
+            const int numEvents = 1000;
+            AudioProcessorAutomationQueue q;
+            q.ensureStorageAllocated (numEvents);
+            Random r (getRandom());
+
+            for (int i = 0; i < numEvents; ++i)
+                q.addEvent (r.nextInt (20), r.nextInt (8), (float) i);
+
+            q.sort();
+
+            for (int i = 1; i < numEvents; ++i)
+            {
+                const AudioProcessorAutomationQueue::Event& a = q.getEvent (i - 1);
+                const AudioProcessorAutomationQueue::Event& b = q.getEvent (i);
+
+                expect (a.parameterIndex < b.parameterIndex
+                         || (a.parameterIndex == b.parameterIndex
+                              && (a.sampleOffset < b.sampleOffset
+                                   || (a.sampleOffset == b.sampleOffset && a.value < b.value))));
+            }
+        }
+
+        beginTest ("Rendering steps and ramps");
+        {
+            AudioProcessorAutomationQueue q;
+            q.ensureStorageAllocated (16);
+            float values[16];
+
+            expectEquals (q.renderParameterValues (0, 0.25f, values, 16), 0.25f);
+            expectEquals (values[15], 0.25f);
+
+            q.addEvent (0, 4, 1.0f);
+            q.addEvent (0, 8, 0.0f, 4);     // ramps down to 0 at sample 11
+            q.addEvent (0, 14, 0.5f, 4);    // only half of this ramp fits
+
+            const float end = q.renderParameterValues (0, 0.0f, values, 16);
+
+            expectEquals (values[3], 0.0f);
+            expectEquals (values[4], 1.0f);
+            expectEquals (values[7], 1.0f);
+            expectWithinAbsoluteError (values[8], 0.75f, 1.0e-6f);
+            expectWithinAbsoluteError (values[10], 0.25f, 1.0e-6f);
+            expectEquals (values[11], 0.0f);
+            expectEquals (values[13], 0.0f);
+            expectWithinAbsoluteError (values[14], 0.125f, 1.0e-6f);
+            expectWithinAbsoluteError (values[15], 0.25f, 1.0e-6f);
+            expectWithinAbsoluteError (end, 0.25f, 1.0e-6f);
+            expectWithinAbsoluteError (q.renderParameterValues (0, 0.0f, nullptr, 16), end, 1.0e-6f);
+        }
+
+        beginTest ("Block-splitting versus the queue benchmark");
+        {
+            const int blockSize = 512, numBlocks = 2000, numChannels = 2, eventSpacing = 8;
+            Random r (getRandom());
+
+            GainProcessor processor;
+            processor.prepareToPlay (44100.0, blockSize);
+            processor.getParameterAutomation().ensureStorageAllocated (blockSize / eventSpacing);
+
+            AudioSampleBuffer input (numChannels, blockSize), splitOutput (numChannels, blockSize), queueOutput (numChannels, blockSize);
+            MidiBuffer midi;
+            Array<float> changes;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < blockSize; ++i)
+                    input.setSample (ch, i, r.nextFloat() * 2.0f - 1.0f);
+
+            double splitMs = 0, queueMs = 0;
+            float maxDifference = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                changes.clearQuick();
+
+                for (int pos = 0; pos < blockSize; pos += eventSpacing)
+                    changes.add (r.nextFloat());
+
+                // Without the queue, a host has to call the processor once for each change..
+                splitOutput.makeCopyOf (input);
+                double start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < changes.size(); ++i)
+                {
+                    processor.getParameters().getUnchecked (0)->setValue (changes.getUnchecked (i));
+
+                    AudioSampleBuffer section (splitOutput.getArrayOfWritePointers(), numChannels,
+                                               i * eventSpacing, eventSpacing);
+                    processor.processBlock (section, midi);
+                }
+
+                splitMs += Time::getMillisecondCounterHiRes() - start;
+
+                // ..whereas with it, the whole block can be processed in one go
+                queueOutput.makeCopyOf (input);
+                start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < changes.size(); ++i)
+                    processor.getParameterAutomation().addEvent (0, i * eventSpacing, changes.getUnchecked (i));
+
+                processor.processBlock (queueOutput, midi);
+                processor.getParameterAutomation().clear();
+
+                queueMs += Time::getMillisecondCounterHiRes() - start;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        maxDifference = jmax (maxDifference, std::abs (splitOutput.getSample (ch, i) - queueOutput.getSample (ch, i)));
+            }
+
+            expectEquals (maxDifference, 0.0f);
+
+            logMessage (String (numBlocks) + " blocks with a change every " + String (eventSpacing) + " samples: block-splitting "
+                          + String (splitMs, 2) + " ms, automation queue " + String (queueMs, 2) + " ms");
+        }
+    }
+
+    // A processor which applies a gain, and follows the automation queue if there's anything in it
+    struct GainProcessor  : public AudioProcessor
+    {
+        GainProcessor() : currentGain (1.0f)
+        {
+            addParameter (new AudioParameterFloat ("gain", "Gain", 0.0f, 1.0f, 1.0f));
+        }
+
+        void prepareToPlay (double, int maxBlockSize) override  { gains.setSize (1, maxBlockSize); }
+        void releaseResources() override                        {}
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            const int numSamples = buffer.getNumSamples();
+
+            if (getParameterAutomation().hasEventsForParameter (0))
+            {
+                float* const g = gains.getWritePointer (0);
+                currentGain = getParameterAutomation().renderParameterValues (0, currentGain, g, numSamples);
+
+                for (int i = 0; i < buffer.getNumChannels(); ++i)
+                    FloatVectorOperations::multiply (buffer.getWritePointer (i), g, numSamples);
+            }
+            else
+            {
+                currentGain = getParameters().getUnchecked (0)->getValue();
+                buffer.applyGain (currentGain);
+            }
+        }
+
+        const String getName() const override                   { return "Gain"; }
+        double getTailLengthSeconds() const override            { return 0; }
+        bool acceptsMidi() const override                       { return false; }
+        bool producesMidi() const override                      { return false; }
+        AudioProcessorEditor* createEditor() override           { return nullptr; }
+        bool hasEditor() const override                         { return false; }
+        int getNumPrograms() override                           { return 1; }
+        int getCurrentProgram() override                        { return 0; }
+        void setCurrentProgram (int) override                   {}
+        const String getProgramName (int) override              { return String(); }
+        void changeProgramName (int, const String&) override    {}
+        void getStateInformation (MemoryBlock&) override        {}
+        void setStateInformation (const void*, int) override    {}
+
+        AudioSampleBuffer gains;
+        float currentGain;
+    };
+};
+
+static AudioProcessorAutomationQueueTests audioProcessorAutomationQueueTests;
+
+#endif
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+#ifndef JUCE_AUDIOPROCESSORAUTOMATIONQUEUE_H_INCLUDED
+#define JUCE_AUDIOPROCESSORAUTOMATIONQUEUE_H_INCLUDED
+
+
+//==============================================================================
+/**
+    Holds the sample-accurate parameter changes for the block that an AudioProcessor
+    is about to process.
+
+    Each AudioProcessor has one of these, which you can get with
+    AudioProcessor::getParameterAutomation(). The VST3 plugin wrapper fills it with
+    the changes that the host has scheduled for the current block before calling
+    processBlock(), and clears it again afterwards, so inside processBlock() a
+    processor can read exactly where each of its parameters changes, without the host
+    having to split the block into smaller pieces.
+
+    Going the other way, a host can fill the queue of a hosted VST3 plugin before
+    calling its processBlock(), and the changes are passed on to the plugin as
+    parameter points. Nothing else writes to or clears the queue, so if you fill the
+    queue of any other processor yourself, you're responsible for clearing it. In
+    particular, AudioProcessorGraph doesn't pass anything on to its nodes' queues.
+
+    The parameters will still be set to their final values in the usual way, so
+    processors which don't look at the queue carry on working as before. A processor
+    that wants sample-accurate values would keep track of the value it last used, and
+    call renderParameterValues() to get a value for each sample in the block, e.g.
+    @code
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+    {
+        float* gains = gainBuffer.getWritePointer (0);  // allocated in prepareToPlay
+        currentGain = getParameterAutomation().renderParameterValues (gainIndex, currentGain, gains, buffer.getNumSamples());
+
+        for (int i = 0; i < buffer.getNumChannels(); ++i)
+            FloatVectorOperations::multiply (buffer.getWritePointer (i), gains, buffer.getNumSamples());
+    }
+    @endcode
+
+    The queue is only ever touched by the audio thread, during the processing
+    callback, so there's no locking involved. Its storage is allocated up-front with
+    ensureStorageAllocated(), and neither adding nor sorting the events allocates.
+
+    Values are whatever units the writer and reader agree on - the wrappers use the
+    normalised 0 to 1 values that AudioProcessorParameter::setValue() takes.
+
+    @see AudioProcessor::getParameterAutomation
+*/
+class JUCE_API  AudioProcessorAutomationQueue
+{
+public:
+    //==============================================================================
+    /** Creates an empty queue with no storage. */
+    AudioProcessorAutomationQueue() noexcept;
+
+    /** Destructor. */
+    ~AudioProcessorAutomationQueue();
+
+    //==============================================================================
+    /** A change to a parameter at a position within the block. */
+    struct Event
+    {
+        int parameterIndex;     /**< The index of the parameter in AudioProcessor::getParameters(). */
+        int sampleOffset;       /**< The position in the block at which the change starts. */
+        int rampLength;         /**< The number of samples over which the parameter moves to its new
+                                     value, or 0 for an instant jump. */
+        float value;            /**< The value that the parameter reaches at the end of the ramp. */
+    };
+
+    //==============================================================================
+    /** Makes sure there's space for at least this many events.
+        This may allocate, so must be called before processing starts, e.g. in prepareToPlay().
+    */
+    void ensureStorageAllocated (int numEventsNeeded);
+
+    /** Returns the maximum number of events that can be added without running out of space. */
+    int getCapacity() const noexcept                            { return capacity; }
+
+    /** Removes all the events. */
+    void clear() noexcept;
+
+    /** Adds an event to the end of the queue.
+
+        Events can be added in any order, but if they're not already in order you must
+        call sort() once you've added them all, before anything reads the queue.
+        If the queue is full, the event is dropped and this returns false, so make sure
+        you've called ensureStorageAllocated().
+        @see getNumDroppedEvents
+    */
+    bool addEvent (int parameterIndex, int sampleOffset, float value, int rampLength = 0) noexcept;
+
+    /** Returns the number of events that addEvent() has had to drop because the queue was
+        full, since the queue was created.
+    */
+    int getNumDroppedEvents() const noexcept                    { return numDropped; }
+
+    /** Sorts the events by parameter index, then by offset.
+
+        This does nothing if the events were added in order. If two events for the same
+        parameter have the same offset, the one that was added last stays last, so it's
+        the one that takes effect.
+    */
+    void sort() noexcept;
+
+    //==============================================================================
+    /** Returns true if there are no events in the queue. */
+    bool isEmpty() const noexcept                               { return numEvents == 0; }
+
+    /** Returns the total number of events in the queue. */
+    int getNumEvents() const noexcept                           { return numEvents; }
+
+    /** Returns one of the events. The events are sorted by parameter index, then by offset. */
+    const Event& getEvent (int index) const noexcept;
+
+    /** Returns the events for one parameter, sorted by offset.
+        @param parameterIndex   the parameter to look for
+        @param numFound         on return, this is set to the number of events
+        @returns a pointer to the first event, or nullptr if there aren't any
+    */
+    const Event* getEventsForParameter (int parameterIndex, int& numFound) const noexcept;
+
+    /** Returns true if the queue contains any events for the given parameter. */
+    bool hasEventsForParameter (int parameterIndex) const noexcept;
+
+    /** Calculates the value of a parameter at each sample of the block.
+
+        @param parameterIndex   the parameter to render
+        @param startValue       the value that the parameter had at the end of the previous block
+        @param destSamples      the buffer to fill with one value per sample. This can be
+                                nullptr if you only need the value at the end of the block
+        @param numSamples       the number of samples in the block
+        @returns the value at the end of the block, which is the startValue to pass in next time.
+                 If a ramp extends beyond the end of the block, this is the value that the ramp
+                 had reached.
+    */
+    float renderParameterValues (int parameterIndex, float startValue,
+                                 float* destSamples, int numSamples) const noexcept;
+
+private:
+    //==============================================================================
+    HeapBlock<Event> events, sortSpace;
+    int numEvents, capacity, numDropped;
+    bool isSorted;
+
+    int findFirstEventFor (int parameterIndex) const noexcept;
+    static bool isBefore (const Event&, const Event&) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (AudioProcessorAutomationQueue)
+};
+
+
+#endif   // JUCE_AUDIOPROCESSORAUTOMATIONQUEUE_H_INCLUDED
@@ -93,18 +93,70 @@ struct AudioGraphRenderingOp  : public AudioGraphRenderingOpBase
     }
 };
 
+//==============================================================================
+/** When silence detection is enabled, this keeps a flag for each of the shared
+    channels to say whether it's known to contain only zeros. A silent channel's
+    samples aren't necessarily cleared, so any op that needs to actually read them
+    must clear the channel first.
+*/
+struct SilenceFlags
+{
+    SilenceFlags() noexcept : numChannels (0) {}
+
+    void setNumChannels (int newNumChannels)
+    {
+        numChannels = newNumChannels;
+        flags.calloc ((size_t) jmax (1, numChannels));
+    }
+
+    bool isSilent (int channel) const noexcept
+    {
+        jassert (isPositiveAndBelow (channel, numChannels));
+        return flags[channel];
+    }
+
+    void setSilent (int channel, bool isNowSilent) noexcept
+    {
+        jassert (isPositiveAndBelow (channel, numChannels));
+        flags[channel] = isNowSilent;
+    }
+
+    template <typename FloatType>
+    void clearIfSilent (AudioBuffer<FloatType>& sharedBufferChans, int channel, int numSamples) const noexcept
+    {
+        if (isSilent (channel))
+            FloatVectorOperations::clear (sharedBufferChans.getWritePointer (channel), numSamples);
+    }
+
+    template <typename FloatType>
+    static bool containsOnlyZeros (const FloatType* data, int numSamples) noexcept
+    {
+        const Range<FloatType> range (FloatVectorOperations::findMinAndMax (data, numSamples));
+        return range.getStart() == 0 && range.getEnd() == 0;
+    }
+
+    HeapBlock<bool> flags;
+    int numChannels;
+
+    JUCE_DECLARE_NON_COPYABLE (SilenceFlags)
+};
+
 //==============================================================================
 struct ClearChannelOp  : public AudioGraphRenderingOp<ClearChannelOp>
 {
-    ClearChannelOp (const int channel) noexcept  : channelNum (channel)  {}
+    ClearChannelOp (const int channel, SilenceFlags* s) noexcept  : channelNum (channel), silence (s)  {}
 
     template <typename FloatType>
     void perform (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray<MidiBuffer>&, const int numSamples)
     {
-        sharedBufferChans.clear (channelNum, 0, numSamples);
+        if (silence != nullptr)
+            silence->setSilent (channelNum, true);
+        else
+            sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
     const int channelNum;
+    SilenceFlags* const silence;
 
     JUCE_DECLARE_NON_COPYABLE (ClearChannelOp)
 };
@@ -112,17 +164,27 @@ struct ClearChannelOp  : public AudioGraphRenderingOp<ClearChannelOp>
 //==============================================================================
 struct CopyChannelOp  : public AudioGraphRenderingOp<CopyChannelOp>
 {
-    CopyChannelOp (const int srcChan, const int dstChan) noexcept
-        : srcChannelNum (srcChan), dstChannelNum (dstChan)
+    CopyChannelOp (const int srcChan, const int dstChan, SilenceFlags* s) noexcept
+        : srcChannelNum (srcChan), dstChannelNum (dstChan), silence (s)
     {}
 
     template <typename FloatType>
     void perform (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray<MidiBuffer>&, const int numSamples)
     {
+        if (silence != nullptr)
+        {
+            const bool sourceIsSilent = silence->isSilent (srcChannelNum);
+            silence->setSilent (dstChannelNum, sourceIsSilent);
+
+            if (sourceIsSilent)
+                return;
+        }
+
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
     const int srcChannelNum, dstChannelNum;
+    SilenceFlags* const silence;
 
     JUCE_DECLARE_NON_COPYABLE (CopyChannelOp)
 };
@@ -130,17 +192,31 @@ struct CopyChannelOp  : public AudioGraphRenderingOp<CopyChannelOp>
 //==============================================================================
 struct AddChannelOp  : public AudioGraphRenderingOp<AddChannelOp>
 {
-    AddChannelOp (const int srcChan, const int dstChan) noexcept
-        : srcChannelNum (srcChan), dstChannelNum (dstChan)
+    AddChannelOp (const int srcChan, const int dstChan, SilenceFlags* s) noexcept
+        : srcChannelNum (srcChan), dstChannelNum (dstChan), silence (s)
     {}
 
     template <typename FloatType>
     void perform (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray<MidiBuffer>&, const int numSamples)
     {
+        if (silence != nullptr)
+        {
+            if (silence->isSilent (srcChannelNum))
+                return;
+
+            if (silence->isSilent (dstChannelNum))
+            {
+                silence->setSilent (dstChannelNum, false);
+                sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+                return;
+            }
+        }
+
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
     const int srcChannelNum, dstChannelNum;
+    SilenceFlags* const silence;
 
     JUCE_DECLARE_NON_COPYABLE (AddChannelOp)
 };
@@ -198,23 +274,273 @@ struct AddMidiBufferOp  : public AudioGraphRenderingOp<AddMidiBufferOp>
     JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
 };
 
+//==============================================================================
+/** Keeps track of the latency of each node in a rendering sequence, and of the delay
+    that's needed at each junction where paths with different latencies meet.
+
+    The latencies are re-read at the start of every block, so when a processor calls
+    setLatencySamples() the delays are adjusted straight away, without the op sequence
+    having to be rebuilt. All of the audio delay lines come from a single pool which is
+    allocated up-front, with some headroom to allow latencies to grow.
+*/
+struct DelayCompensation  : public ReferenceCountedObject
+{
+    DelayCompensation() noexcept : totalLatency (0), needsRebuild (false) {}
+
+    typedef ReferenceCountedObjectPtr<DelayCompensation> Ptr;
+
+    enum { delayLineHeadroom = 4096 };
+
+    //==============================================================================
+    /** Adds a node, which must come after all of the sources that are listed for it.
+        Output nodes all get aligned to the latency of the slowest one.
+    */
+    int addNode (AudioProcessor& processor, const Array<int>& sourceNodeIndexes, bool isOutput)
+    {
+        nodes.add (new NodeInfo (processor, sourceNodeIndexes, isOutput));
+        return nodes.size() - 1;
+    }
+
+    /** Adds a point at which one source feeds a node, and may need delaying. */
+    int addJunction (int nodeIndex, int sourceNodeIndex)
+    {
+        const Junction j = { nodeIndex, sourceNodeIndex, 0, 0 };
+        junctions.add (j);
+        return junctions.size() - 1;
+    }
+
+    /** Reserves an audio delay line from the pool for a junction. */
+    int addDelayLine (int junctionIndex)
+    {
+        lineJunctions.add (junctionIndex);
+        return lineJunctions.size() - 1;
+    }
+
+    /** Registers the buffers that hold the midi events on their way through a junction,
+        so that finalise() can make them big enough for its delay.
+    */
+    void addMidiDelayLine (int junctionIndex, MidiBuffer& pendingEvents, MidiBuffer& spareEvents)
+    {
+        const MidiLine line = { junctionIndex, &pendingEvents, &spareEvents };
+        midiLines.add (line);
+    }
+
+    /** Works out the initial delays, and allocates the delay lines to fit them. */
+    void finalise (int blockSize)
+    {
+        calculate();
+
+        for (int i = 0; i < junctions.size(); ++i)
+        {
+            Junction& j = junctions.getReference (i);
+            j.capacity = j.delay + (int) delayLineHeadroom;
+        }
+
+        size_t totalSize = 1;
+
+        for (int i = 0; i < lineJunctions.size(); ++i)
+        {
+            lineOffsets.add ((int) totalSize);
+            totalSize += (size_t) junctions.getReference (lineJunctions.getUnchecked (i)).capacity;
+        }
+
+        pool.floatVersion. calloc (totalSize);
+        pool.doubleVersion.calloc (totalSize);
+
+        // Leaves room for a short message every few samples, which is far more than a midi
+        // cable could deliver, so that a busy stream doesn't make them reallocate.
+        for (int i = 0; i < midiLines.size(); ++i)
+        {
+            const MidiLine& line = midiLines.getReference (i);
+            const int numBytes = (junctions.getReference (line.junction).capacity + blockSize) * (int) midiBytesPerSample;
+
+            line.pendingEvents->ensureSize ((size_t) numBytes);
+            line.spareEvents->ensureSize ((size_t) numBytes);
+        }
+
+        midiLines.clear();
+    }
+
+    //==============================================================================
+    /** Called at the start of each block to pick up any latency changes.
+        Returns true if anything changed.
+    */
+    bool update() noexcept
+    {
+        bool changed = false;
+
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            NodeInfo& info = *nodes.getUnchecked (i);
+            const int latency = info.processor.getLatencySamples();
+
+            if (info.latency != latency)
+            {
+                info.latency = latency;
+                changed = true;
+            }
+        }
+
+        if (changed)
+            calculate();
+
+        return changed;
+    }
+
+    int getDelay (int junctionIndex) const noexcept             { return junctions.getReference (junctionIndex).delay; }
+    int getCapacity (int junctionIndex) const noexcept          { return junctions.getReference (junctionIndex).capacity; }
+    int getInputLatency (int nodeIndex) const noexcept          { return nodes.getUnchecked (nodeIndex)->inputLatency; }
+
+    template <typename FloatType>
+    FloatType* getDelayLine (int lineIndex) noexcept
+    {
+        return pool.get<FloatType>().getData() + lineOffsets.getUnchecked (lineIndex);
+    }
+
+    int totalLatency;
+    bool needsRebuild;
+
+private:
+    //==============================================================================
+    struct NodeInfo
+    {
+        NodeInfo (AudioProcessor& p, const Array<int>& sourceIndexes, bool output)
+            : processor (p), sources (sourceIndexes), latency (p.getLatencySamples()),
+              inputLatency (0), isOutput (output)
+        {}
+
+        AudioProcessor& processor;
+        const Array<int> sources;
+        int latency, inputLatency;
+        const bool isOutput;
+
+        int getOutputLatency() const noexcept       { return inputLatency + latency; }
+
+        JUCE_DECLARE_NON_COPYABLE (NodeInfo)
+    };
+
+    struct Junction
+    {
+        int node, source, delay, capacity;
+    };
+
+    struct MidiLine
+    {
+        int junction;
+        MidiBuffer* pendingEvents;
+        MidiBuffer* spareEvents;
+    };
+
+    enum { midiBytesPerSample = 3 };
+
+    OwnedArray<NodeInfo> nodes;
+    Array<Junction> junctions;
+    Array<MidiLine> midiLines;
+    Array<int> lineJunctions, lineOffsets;
+    FloatAndDoubleComposition<HeapBlock<FloatPlaceholder> > pool;
+
+    void calculate() noexcept
+    {
+        totalLatency = 0;
+
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            NodeInfo& info = *nodes.getUnchecked (i);
+            info.inputLatency = 0;
+
+            for (int j = 0; j < info.sources.size(); ++j)
+                info.inputLatency = jmax (info.inputLatency,
+                                          nodes.getUnchecked (info.sources.getUnchecked (j))->getOutputLatency());
+
+            if (info.isOutput)
+                totalLatency = jmax (totalLatency, info.inputLatency);
+        }
+
+        for (int i = 0; i < nodes.size(); ++i)
+            if (nodes.getUnchecked (i)->isOutput)
+                nodes.getUnchecked (i)->inputLatency = totalLatency;
+
+        for (int i = 0; i < junctions.size(); ++i)
+        {
+            Junction& j = junctions.getReference (i);
+            j.delay = jmax (0, nodes.getUnchecked (j.node)->inputLatency
+                                 - nodes.getUnchecked (j.source)->getOutputLatency());
+
+            if (j.capacity > 0 && j.delay >= j.capacity)
+            {
+                // This is too long for the pool, so it'll be clamped until the graph gets rebuilt
+                needsRebuild = true;
+                j.delay = j.capacity - 1;
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (DelayCompensation)
+};
+
 //==============================================================================
 struct DelayChannelOp  : public AudioGraphRenderingOp<DelayChannelOp>
 {
-    DelayChannelOp (const int chan, const int delaySize)
+    DelayChannelOp (const int chan, DelayCompensation* comp, const int junction, SilenceFlags* s)
         : channel (chan),
-          bufferSize (delaySize + 1),
-          readIndex (0), writeIndex (delaySize)
+          compensation (comp),
+          junctionIndex (junction),
+          lineIndex (comp->addDelayLine (junction)),
+          currentDelay (-1),
+          writeIndex (0),
+          silence (s), samplesUntilSilent (0)
     {
-        buffer.floatVersion. calloc ((size_t) bufferSize);
-        buffer.doubleVersion.calloc ((size_t) bufferSize);
     }
 
     template <typename FloatType>
     void perform (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray<MidiBuffer>&, const int numSamples)
     {
+        FloatType* const block = compensation->getDelayLine<FloatType> (lineIndex);
+        const int bufferSize = compensation->getCapacity (junctionIndex);
+        const int delay = compensation->getDelay (junctionIndex);
+
+        if (delay != currentDelay)
+        {
+            // The samples that are already in the line are kept, so a shorter delay just skips
+            // some of them. A longer one reaches further back than the samples that are still
+            // valid, so that extra stretch gets cleared.
+            const int oldDelay = jmax (0, currentDelay);
+
+            for (int i = oldDelay; i < delay; ++i)
+                block [(writeIndex - i - 1 + bufferSize) % bufferSize] = 0;
+
+            if (samplesUntilSilent > 0)
+                samplesUntilSilent += jmax (0, delay - oldDelay);
+
+            currentDelay = delay;
+        }
+
+        if (delay == 0)
+            return;
+
+        if (silence != nullptr)
+        {
+            if (silence->isSilent (channel))
+            {
+                // once the delay line is full of zeros, a silent input can go straight through
+                if (samplesUntilSilent <= 0)
+                    return;
+
+                samplesUntilSilent -= numSamples;
+                silence->clearIfSilent (sharedBufferChans, channel, numSamples);
+                silence->setSilent (channel, false);
+            }
+            else
+            {
+                samplesUntilSilent = delay;
+            }
+        }
+
         FloatType* data = sharedBufferChans.getWritePointer (channel, 0);
-        HeapBlock<FloatType>& block = buffer.get<FloatType>();
+        int readIndex = writeIndex - delay;
+
+        if (readIndex < 0)
+            readIndex += bufferSize;
 
         for (int i = numSamples; --i >= 0;)
         {
@@ -227,37 +553,146 @@ struct DelayChannelOp  : public AudioGraphRenderingOp<DelayChannelOp>
     }
 
 private:
-    FloatAndDoubleComposition<HeapBlock<FloatPlaceholder> > buffer;
-    const int channel, bufferSize;
-    int readIndex, writeIndex;
+    const int channel;
+    const DelayCompensation::Ptr compensation;
+    const int junctionIndex, lineIndex;
+    int currentDelay, writeIndex;
+    SilenceFlags* const silence;
+    int samplesUntilSilent;
 
     JUCE_DECLARE_NON_COPYABLE (DelayChannelOp)
 };
 
+//==============================================================================
+struct DelayMidiBufferOp  : public AudioGraphRenderingOp<DelayMidiBufferOp>
+{
+    DelayMidiBufferOp (const int buffer, DelayCompensation* comp, const int junction)
+        : bufferNum (buffer),
+          compensation (comp),
+          junctionIndex (junction),
+          currentDelay (0)
+    {
+        comp->addMidiDelayLine (junction, pendingEvents, remainingEvents);
+    }
+
+    template <typename FloatType>
+    void perform (AudioBuffer<FloatType>&, const OwnedArray<MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        MidiBuffer& buffer = *sharedMidiBuffers.getUnchecked (bufferNum);
+        const int delay = compensation->getDelay (junctionIndex);
+
+        if (delay != currentDelay)
+        {
+            // The pending events are moved by the change in the delay, so that they stay in
+            // step with the audio. Any that are now overdue get sent straight away, so that
+            // no note-offs are lost.
+            remainingEvents.clear();
+
+            for (MidiBuffer::Iterator i (pendingEvents);;)
+            {
+                const uint8* data;
+                int size, position;
+
+                if (! i.getNextEvent (data, size, position))
+                    break;
+
+                remainingEvents.addEvent (data, size, jmax (0, position + delay - currentDelay));
+            }
+
+            pendingEvents.swapWith (remainingEvents);
+            currentDelay = delay;
+        }
+
+        if (delay == 0 && pendingEvents.isEmpty())
+            return;
+
+        pendingEvents.addEvents (buffer, 0, numSamples, delay);
+
+        buffer.clear();
+        buffer.addEvents (pendingEvents, 0, numSamples, 0);
+
+        remainingEvents.clear();
+        remainingEvents.addEvents (pendingEvents, numSamples, -1, -numSamples);
+        pendingEvents.swapWith (remainingEvents);
+    }
+
+private:
+    const int bufferNum;
+    const DelayCompensation::Ptr compensation;
+    const int junctionIndex;
+    int currentDelay;
+    MidiBuffer pendingEvents, remainingEvents;
+
+    JUCE_DECLARE_NON_COPYABLE (DelayMidiBufferOp)
+};
+
 //==============================================================================
 struct ProcessBufferOp   : public AudioGraphRenderingOp<ProcessBufferOp>
 {
     ProcessBufferOp (const AudioProcessorGraph::Node::Ptr& n,
                      const Array<int>& audioChannelsUsed,
                      const int totalNumChans,
-                     const int midiBuffer)
+                     const int midiBuffer,
+                     SilenceFlags* s)
         : node (n),
           processor (n->getProcessor()),
           audioChannelsToUse (audioChannelsUsed),
           totalChans (jmax (1, totalNumChans)),
-          midiBufferToUse (midiBuffer)
+          midiBufferToUse (midiBuffer),
+          numIns (processor->getTotalNumInputChannels()),
+          numOuts (processor->getTotalNumOutputChannels()),
+          silence (s),
+          samplesBeforeSleeping (-1),
+          silentSamples (0),
+          lastOutputWasSilent (false)
     {
         audioChannels.floatVersion. calloc ((size_t) totalChans);
         audioChannels.doubleVersion.calloc ((size_t) totalChans);
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
+
+        if (silence != nullptr)
+        {
+            const AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
+                = dynamic_cast<const AudioProcessorGraph::AudioGraphIOProcessor*> (processor);
+
+            const double tailSeconds = processor->getTailLengthSeconds();
+
+            // Sources, anything that generates midi (which it may do with silent inputs, e.g.
+            // a sequencer or arpeggiator), and anything with an infinite (or silly) tail are
+            // never put to sleep
+            if ((numIns > 0 || processor->acceptsMidi())
+                 && ! processor->producesMidi()
+                 && (ioProc == nullptr || ! ioProc->isInput())
+                 && tailSeconds >= 0.0 && tailSeconds <= 3600.0)
+            {
+                samplesBeforeSleeping = (int64) (tailSeconds * processor->getSampleRate())
+                                          + processor->getLatencySamples();
+            }
+        }
     }
 
     template <typename FloatType>
     void perform (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray<MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
         HeapBlock<FloatType*>& channels = audioChannels.get<FloatType>();
+        MidiBuffer& midiMessages = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
+
+        if (silence != nullptr)
+        {
+            if (shouldSleep (midiMessages, numSamples))
+            {
+                for (int i = 0; i < numOuts; ++i)
+                    silence->setSilent (audioChannelsToUse.getUnchecked (i), true);
+
+                node->recordRenderedBlock (true);
+                return;
+            }
+
+            for (int i = totalChans; --i >= 0;)
+                silence->clearIfSilent (sharedBufferChans, audioChannelsToUse.getUnchecked (i), numSamples);
+        }
 
         for (int i = totalChans; --i >= 0;)
             channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
@@ -270,8 +705,48 @@ struct ProcessBufferOp   : public AudioGraphRenderingOp<ProcessBufferOp>
             if (processor->isSuspended())
                 buffer.clear();
             else
-                callProcess (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+                callProcess (buffer, midiMessages);
+        }
+
+        if (silence != nullptr)
+        {
+            lastOutputWasSilent = true;
+
+            for (int i = 0; i < numOuts; ++i)
+            {
+                const bool isSilent = SilenceFlags::containsOnlyZeros (channels[i], numSamples);
+                silence->setSilent (audioChannelsToUse.getUnchecked (i), isSilent);
+                lastOutputWasSilent = lastOutputWasSilent && isSilent;
+            }
+
+            node->recordRenderedBlock (false);
+        }
+    }
+
+    bool shouldSleep (const MidiBuffer& midiMessages, const int numSamples) noexcept
+    {
+        if (samplesBeforeSleeping < 0)
+            return false;
+
+        bool inputsAreSilent = ! (processor->acceptsMidi() && ! midiMessages.isEmpty());
+
+        for (int i = 0; i < numIns && inputsAreSilent; ++i)
+            inputsAreSilent = silence->isSilent (audioChannelsToUse.getUnchecked (i));
+
+        if (! inputsAreSilent)
+        {
+            silentSamples = 0;
+            return false;
         }
+
+        // A synth can keep playing a held note with no incoming midi, so those also
+        // have to go quiet before they're allowed to sleep
+        if (silentSamples >= samplesBeforeSleeping
+             && (lastOutputWasSilent || ! processor->acceptsMidi()))
+            return true;
+
+        silentSamples += numSamples;
+        return false;
     }
 
     void callProcess (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
@@ -306,6 +781,10 @@ private:
     AudioBuffer<float> tempBuffer;
     const int totalChans;
     const int midiBufferToUse;
+    const int numIns, numOuts;
+    SilenceFlags* const silence;
+    int64 samplesBeforeSleeping, silentSamples;
+    bool lastOutputWasSilent;
 
     JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
 };
@@ -318,10 +797,12 @@ struct RenderingOpSequenceCalculator
 {
     RenderingOpSequenceCalculator (AudioProcessorGraph& g,
                                    const Array<AudioProcessorGraph::Node*>& nodes,
-                                   Array<void*>& renderingOps)
+                                   Array<void*>& renderingOps,
+                                   SilenceFlags* silenceFlags)
         : graph (g),
           orderedNodes (nodes),
-          totalLatency (0)
+          silence (silenceFlags),
+          compensation (new DelayCompensation())
     {
         nodeIds.add ((uint32) zeroNodeID); // first buffer is read-only zeros
         channels.add (0);
@@ -334,57 +815,110 @@ struct RenderingOpSequenceCalculator
             markAnyUnusedBuffersAsFree (i);
         }
 
-        graph.setLatencySamples (totalLatency);
+        compensation->finalise (graph.getBlockSize());
+        graph.setLatencySamples (compensation->totalLatency);
     }
 
     int getNumBuffersNeeded() const noexcept         { return nodeIds.size(); }
     int getNumMidiBuffersNeeded() const noexcept     { return midiNodeIds.size(); }
 
+    DelayCompensation* getDelayCompensation() const noexcept    { return compensation; }
+
 private:
     //==============================================================================
     AudioProcessorGraph& graph;
     const Array<AudioProcessorGraph::Node*>& orderedNodes;
+    SilenceFlags* const silence;
     Array<int> channels;
     Array<uint32> nodeIds, midiNodeIds;
 
-    enum { freeNodeID = 0xffffffff, zeroNodeID = 0xfffffffe };
+    enum { freeNodeID = 0xffffffff, zeroNodeID = 0xfffffffe, anonymousNodeID = 0xfffffffd };
 
     static bool isNodeBusy (uint32 nodeID) noexcept     { return nodeID != freeNodeID && nodeID != zeroNodeID; }
 
-    Array<uint32> nodeDelayIDs;
-    Array<int> nodeDelays;
-    int totalLatency;
-
-    int getNodeDelay (const uint32 nodeID) const        { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    const DelayCompensation::Ptr compensation;
+    HashMap<int, int> compensationIndexes;
+    Array<uint32> junctionSourceIds;
+    Array<int> junctionIndexes;
 
-    void setNodeDelay (const uint32 nodeID, const int latency)
+    /** Adds a node to the latency compensation table. A junction is created for each of the
+        node's sources when there's more than one of them, or when the node is an output,
+        so that the delays can change later on without needing any new rendering ops.
+    */
+    void addNodeToDelayCompensation (AudioProcessorGraph::Node& node)
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
+        SortedSet<uint32> sourceIds;
 
-        if (index >= 0)
+        for (int i = graph.getNumConnections(); --i >= 0;)
         {
-            nodeDelays.set (index, latency);
+            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+
+            // (sources that haven't been added yet are either feedback loops or inactive)
+            if (c->destNodeId == node.nodeId && compensationIndexes.contains ((int) c->sourceNodeId))
+                sourceIds.add (c->sourceNodeId);
         }
-        else
+
+        Array<int> sourceIndexes;
+
+        for (int i = 0; i < sourceIds.size(); ++i)
+            sourceIndexes.add (compensationIndexes [(int) sourceIds.getUnchecked (i)]);
+
+        const AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
+            = dynamic_cast<const AudioProcessorGraph::AudioGraphIOProcessor*> (node.getProcessor());
+
+        const bool isOutput = ioProc != nullptr && ioProc->isOutput();
+        const int nodeIndex = compensation->addNode (*node.getProcessor(), sourceIndexes, isOutput);
+
+        compensationIndexes.set ((int) node.nodeId, nodeIndex);
+        junctionSourceIds.clearQuick();
+        junctionIndexes.clearQuick();
+
+        if (sourceIds.size() > 1 || isOutput)
         {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
+            for (int i = 0; i < sourceIds.size(); ++i)
+            {
+                junctionSourceIds.add (sourceIds.getUnchecked (i));
+                junctionIndexes.add (compensation->addJunction (nodeIndex, sourceIndexes.getUnchecked (i)));
+            }
         }
     }
 
-    int getInputLatencyForNode (const uint32 nodeID) const
+    /** Returns the junction for one of the current node's sources, or -1 if it never needs delaying. */
+    int getJunctionFor (const uint32 sourceNodeId) const noexcept
     {
-        int maxLatency = 0;
+        const int index = junctionSourceIds.indexOf (sourceNodeId);
+        return index >= 0 ? junctionIndexes.getUnchecked (index) : -1;
+    }
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
+    /** Returns a buffer that holds a delayed version of a source's output, copying it first if the
+        original is still needed by something else.
+    */
+    int addDelayOps (Array<void*>& renderingOps, int bufIndex, const uint32 srcNode, const int srcChan,
+                     const int ourRenderingIndex, const int inputChan, const bool isMidi)
+    {
+        const int junction = getJunctionFor (srcNode);
+
+        if (junction < 0 || bufIndex <= 0)
+            return bufIndex;
+
+        if (isBufferNeededLater (ourRenderingIndex, inputChan, srcNode, srcChan))
         {
-            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+            const int newFreeBuffer = getTemporaryBuffer (isMidi);
+
+            if (isMidi)
+                renderingOps.add (new CopyMidiBufferOp (bufIndex, newFreeBuffer));
+            else
+                renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer, silence));
 
-            if (c->destNodeId == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNodeId));
+            bufIndex = newFreeBuffer;
         }
 
-        return maxLatency;
+        if (isMidi)
+            renderingOps.add (new DelayMidiBufferOp (bufIndex, compensation, junction));
+        else
+            renderingOps.add (new DelayChannelOp (bufIndex, compensation, junction, silence));
+
+        return bufIndex;
     }
 
     //==============================================================================
@@ -400,7 +934,7 @@ private:
         Array<int> audioChannelsToUse;
         int midiBufferToUse = -1;
 
-        int maxLatency = getInputLatencyForNode (node.nodeId);
+        addNodeToDelayCompensation (node);
 
         for (int inputChan = 0; inputChan < numIns; ++inputChan)
         {
@@ -433,7 +967,7 @@ private:
                 else
                 {
                     bufIndex = getFreeBuffer (false);
-                    renderingOps.add (new ClearChannelOp (bufIndex));
+                    renderingOps.add (new ClearChannelOp (bufIndex, silence));
                 }
             }
             else if (sourceNodes.size() == 1)
@@ -451,24 +985,24 @@ private:
                     jassert (bufIndex >= 0);
                 }
 
-                if (inputChan < numOuts
-                     && isBufferNeededLater (ourRenderingIndex,
-                                             inputChan,
-                                             srcNode, srcChan))
+                if (bufIndex > 0 && getJunctionFor (srcNode) >= 0)
+                {
+                    bufIndex = addDelayOps (renderingOps, bufIndex, srcNode, srcChan,
+                                            ourRenderingIndex, inputChan, false);
+                }
+                else if (inputChan < numOuts
+                          && isBufferNeededLater (ourRenderingIndex,
+                                                  inputChan,
+                                                  srcNode, srcChan))
                 {
                     // can't mess up this channel because it's needed later by another node, so we
                     // need to use a copy of it..
                     const int newFreeBuffer = getFreeBuffer (false);
 
-                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer, silence));
 
                     bufIndex = newFreeBuffer;
                 }
-
-                const int nodeDelay = getNodeDelay (srcNode);
-
-                if (nodeDelay < maxLatency)
-                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
             }
             else
             {
@@ -490,12 +1024,9 @@ private:
                     {
                         // we've found one of our input chans that can be re-used..
                         reusableInputIndex = i;
-                        bufIndex = sourceBufIndex;
-
-                        const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (i));
-                        if (nodeDelay < maxLatency)
-                            renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay));
-
+                        bufIndex = addDelayOps (renderingOps, sourceBufIndex,
+                                                sourceNodes.getUnchecked(i), sourceOutputChans.getUnchecked(i),
+                                                ourRenderingIndex, inputChan, false);
                         break;
                     }
                 }
@@ -503,7 +1034,7 @@ private:
                 if (reusableInputIndex < 0)
                 {
                     // can't re-use any of our input chans, so get a new one and copy everything into it..
-                    bufIndex = getFreeBuffer (false);
+                    bufIndex = getTemporaryBuffer (false);
                     jassert (bufIndex != 0);
 
                     const int srcIndex = getBufferContaining (sourceNodes.getUnchecked (0),
@@ -511,18 +1042,18 @@ private:
                     if (srcIndex < 0)
                     {
                         // if not found, this is probably a feedback loop
-                        renderingOps.add (new ClearChannelOp (bufIndex));
+                        renderingOps.add (new ClearChannelOp (bufIndex, silence));
                     }
                     else
                     {
-                        renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
+                        renderingOps.add (new CopyChannelOp (srcIndex, bufIndex, silence));
+
+                        if (getJunctionFor (sourceNodes.getFirst()) >= 0)
+                            renderingOps.add (new DelayChannelOp (bufIndex, compensation,
+                                                                  getJunctionFor (sourceNodes.getFirst()), silence));
                     }
 
                     reusableInputIndex = 0;
-                    const int nodeDelay = getNodeDelay (sourceNodes.getFirst());
-
-                    if (nodeDelay < maxLatency)
-                        renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
                 }
 
                 for (int j = 0; j < sourceNodes.size(); ++j)
@@ -533,26 +1064,11 @@ private:
                                                             sourceOutputChans.getUnchecked(j));
                         if (srcIndex >= 0)
                         {
-                            const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (j));
-
-                            if (nodeDelay < maxLatency)
-                            {
-                                if (! isBufferNeededLater (ourRenderingIndex, inputChan,
-                                                           sourceNodes.getUnchecked(j),
-                                                           sourceOutputChans.getUnchecked(j)))
-                                {
-                                    renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay));
-                                }
-                                else // buffer is reused elsewhere, can't be delayed
-                                {
-                                    const int bufferToDelay = getFreeBuffer (false);
-                                    renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay));
-                                    renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay));
-                                    srcIndex = bufferToDelay;
-                                }
-                            }
-
-                            renderingOps.add (new AddChannelOp (srcIndex, bufIndex));
+                            srcIndex = addDelayOps (renderingOps, srcIndex,
+                                                    sourceNodes.getUnchecked(j), sourceOutputChans.getUnchecked(j),
+                                                    ourRenderingIndex, inputChan, false);
+
+                            renderingOps.add (new AddChannelOp (srcIndex, bufIndex, silence));
                         }
                     }
                 }
@@ -601,10 +1117,16 @@ private:
 
             if (midiBufferToUse >= 0)
             {
-                if (isBufferNeededLater (ourRenderingIndex,
-                                         AudioProcessorGraph::midiChannelIndex,
-                                         midiSourceNodes.getUnchecked(0),
-                                         AudioProcessorGraph::midiChannelIndex))
+                if (getJunctionFor (midiSourceNodes.getUnchecked(0)) >= 0)
+                {
+                    midiBufferToUse = addDelayOps (renderingOps, midiBufferToUse, midiSourceNodes.getUnchecked(0),
+                                                   AudioProcessorGraph::midiChannelIndex, ourRenderingIndex,
+                                                   AudioProcessorGraph::midiChannelIndex, true);
+                }
+                else if (isBufferNeededLater (ourRenderingIndex,
+                                              AudioProcessorGraph::midiChannelIndex,
+                                              midiSourceNodes.getUnchecked(0),
+                                              AudioProcessorGraph::midiChannelIndex))
                 {
                     // can't mess up this channel because it's needed later by another node, so we
                     // need to use a copy of it..
@@ -637,7 +1159,9 @@ private:
                 {
                     // we've found one of our input buffers that can be re-used..
                     reusableInputIndex = i;
-                    midiBufferToUse = sourceBufIndex;
+                    midiBufferToUse = addDelayOps (renderingOps, sourceBufIndex, midiSourceNodes.getUnchecked(i),
+                                                   AudioProcessorGraph::midiChannelIndex, ourRenderingIndex,
+                                                   AudioProcessorGraph::midiChannelIndex, true);
                     break;
                 }
             }
@@ -645,15 +1169,23 @@ private:
             if (reusableInputIndex < 0)
             {
                 // can't re-use any of our input buffers, so get a new one and copy everything into it..
-                midiBufferToUse = getFreeBuffer (true);
+                midiBufferToUse = getTemporaryBuffer (true);
                 jassert (midiBufferToUse >= 0);
 
                 const int srcIndex = getBufferContaining (midiSourceNodes.getUnchecked(0),
                                                           AudioProcessorGraph::midiChannelIndex);
                 if (srcIndex >= 0)
+                {
                     renderingOps.add (new CopyMidiBufferOp (srcIndex, midiBufferToUse));
+
+                    if (getJunctionFor (midiSourceNodes.getFirst()) >= 0)
+                        renderingOps.add (new DelayMidiBufferOp (midiBufferToUse, compensation,
+                                                                 getJunctionFor (midiSourceNodes.getFirst())));
+                }
                 else
+                {
                     renderingOps.add (new ClearMidiBufferOp (midiBufferToUse));
+                }
 
                 reusableInputIndex = 0;
             }
@@ -662,10 +1194,16 @@ private:
             {
                 if (j != reusableInputIndex)
                 {
-                    const int srcIndex = getBufferContaining (midiSourceNodes.getUnchecked(j),
-                                                              AudioProcessorGraph::midiChannelIndex);
+                    int srcIndex = getBufferContaining (midiSourceNodes.getUnchecked(j),
+                                                        AudioProcessorGraph::midiChannelIndex);
                     if (srcIndex >= 0)
+                    {
+                        srcIndex = addDelayOps (renderingOps, srcIndex, midiSourceNodes.getUnchecked(j),
+                                                AudioProcessorGraph::midiChannelIndex, ourRenderingIndex,
+                                                AudioProcessorGraph::midiChannelIndex, true);
+
                         renderingOps.add (new AddMidiBufferOp (srcIndex, midiBufferToUse));
+                    }
                 }
             }
         }
@@ -674,13 +1212,8 @@ private:
             markBufferAsContaining (midiBufferToUse, node.nodeId,
                                     AudioProcessorGraph::midiChannelIndex);
 
-        setNodeDelay (node.nodeId, maxLatency + processor.getLatencySamples());
-
-        if (numOuts == 0)
-            totalLatency = maxLatency;
-
         renderingOps.add (new ProcessBufferOp (&node, audioChannelsToUse,
-                                               totalChans, midiBufferToUse));
+                                               totalChans, midiBufferToUse, silence));
     }
 
     //==============================================================================
@@ -707,6 +1240,15 @@ private:
         }
     }
 
+    int getTemporaryBuffer (const bool forMidi)
+    {
+        // (marked as busy so nothing else grabs it while this node's ops are being built)
+        const int bufIndex = getFreeBuffer (forMidi);
+        markBufferAsContaining (bufIndex, (uint32) anonymousNodeID,
+                                forMidi ? AudioProcessorGraph::midiChannelIndex : 0);
+        return bufIndex;
+    }
+
     int getReadOnlyEmptyBuffer() const noexcept
     {
         return 0;
@@ -950,7 +1492,7 @@ AudioProcessorGraph::Connection::Connection (const uint32 sourceID, const int so
 
 //==============================================================================
 AudioProcessorGraph::Node::Node (const uint32 nodeID, AudioProcessor* const p) noexcept
-    : nodeId (nodeID), processor (p), isPrepared (false)
+    : nodeId (nodeID), processor (p), isPrepared (false), preparedLazily (false)
 {
     jassert (processor != nullptr);
 }
@@ -988,17 +1530,33 @@ void AudioProcessorGraph::Node::unprepare()
     }
 }
 
-void AudioProcessorGraph::Node::setParentGraph (AudioProcessorGraph* const graph) const
+void AudioProcessorGraph::Node::resetSleepStatistics() noexcept
 {
-    if (AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
-            = dynamic_cast<AudioProcessorGraph::AudioGraphIOProcessor*> (processor.get()))
-        ioProc->setParentGraph (graph);
+    numBlocksProcessed = 0;
+    numBlocksSkipped = 0;
+}
+
+void AudioProcessorGraph::Node::recordRenderedBlock (const bool wasSkipped) noexcept
+{
+    if (wasSkipped)
+        ++numBlocksSkipped;
+    else
+        ++numBlocksProcessed;
+
+    sleeping = wasSkipped ? 1 : 0;
+}
+
+void AudioProcessorGraph::Node::setParentGraph (AudioProcessorGraph* const graph) const
+{
+    if (AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
+            = dynamic_cast<AudioProcessorGraph::AudioGraphIOProcessor*> (processor.get()))
+        ioProc->setParentGraph (graph);
 }
 
 //==============================================================================
 struct AudioProcessorGraph::AudioProcessorGraphBufferHelpers
 {
-    AudioProcessorGraphBufferHelpers()
+    AudioProcessorGraphBufferHelpers (AudioProcessorGraph& g)  : latencyUpdater (g)
     {
         currentAudioInputBuffer.floatVersion  = nullptr;
         currentAudioInputBuffer.doubleVersion = nullptr;
@@ -1011,6 +1569,8 @@ struct AudioProcessorGraph::AudioProcessorGraphBufferHelpers
 
         renderingBuffers.floatVersion. clear();
         renderingBuffers.doubleVersion.clear();
+
+        silence.setNumChannels (newNumChannels);
     }
 
     void release()
@@ -1037,12 +1597,35 @@ struct AudioProcessorGraph::AudioProcessorGraphBufferHelpers
     FloatAndDoubleComposition<AudioBuffer<FloatPlaceholder> > renderingBuffers;
     FloatAndDoubleComposition<AudioBuffer<FloatPlaceholder>*> currentAudioInputBuffer;
     FloatAndDoubleComposition<AudioBuffer<FloatPlaceholder> > currentAudioOutputBuffer;
+    GraphRenderingOps::SilenceFlags silence;
+    GraphRenderingOps::DelayCompensation::Ptr delayCompensation;
+
+    //==============================================================================
+    // When a node's latency changes on the audio thread, this passes the graph's new
+    // total latency back to the message thread.
+    struct LatencyUpdater  : public AsyncUpdater
+    {
+        LatencyUpdater (AudioProcessorGraph& g) noexcept : graph (g) {}
+
+        void handleAsyncUpdate() override
+        {
+            graph.setLatencySamples (newLatency.get());
+        }
+
+        AudioProcessorGraph& graph;
+        Atomic<int> newLatency;
+
+        JUCE_DECLARE_NON_COPYABLE (LatencyUpdater)
+    };
+
+    LatencyUpdater latencyUpdater;
 };
 
 //==============================================================================
 AudioProcessorGraph::AudioProcessorGraph()
-    : lastNodeId (0), audioBuffers (new AudioProcessorGraphBufferHelpers),
-      currentMidiInputBuffer (nullptr), isPrepared (false)
+    : lastNodeId (0), audioBuffers (new AudioProcessorGraphBufferHelpers (*this)),
+      currentMidiInputBuffer (nullptr), isPrepared (false), newNodesPreparedLazily (false),
+      silenceDetectionEnabled (false)
 {
 }
 
@@ -1108,6 +1691,7 @@ AudioProcessorGraph::Node* AudioProcessorGraph::addNode (AudioProcessor* const n
     newProcessor->setPlayHead (getPlayHead());
 
     Node* const n = new Node (nodeId, newProcessor);
+    n->preparedLazily = newNodesPreparedLazily;
     nodes.add (n);
 
     if (isPrepared)
@@ -1146,6 +1730,31 @@ bool AudioProcessorGraph::removeNode (Node* node)
     return false;
 }
 
+void AudioProcessorGraph::setSilenceDetectionEnabled (const bool shouldBeEnabled)
+{
+    if (silenceDetectionEnabled != shouldBeEnabled)
+    {
+        silenceDetectionEnabled = shouldBeEnabled;
+
+        if (isPrepared)
+            triggerAsyncUpdate();
+    }
+}
+
+void AudioProcessorGraph::setNodePreparedLazily (const uint32 nodeId, const bool shouldBePreparedLazily)
+{
+    if (Node* const n = getNodeForId (nodeId))
+    {
+        if (n->preparedLazily != shouldBePreparedLazily)
+        {
+            n->preparedLazily = shouldBePreparedLazily;
+
+            if (isPrepared)
+                triggerAsyncUpdate();
+        }
+    }
+}
+
 //==============================================================================
 const AudioProcessorGraph::Connection* AudioProcessorGraph::getConnectionBetween (const uint32 sourceNodeId,
                                                                                   const int sourceChannelIndex,
@@ -1310,10 +1919,12 @@ static void deleteRenderOpArray (Array<void*>& ops)
 void AudioProcessorGraph::clearRenderingSequence()
 {
     Array<void*> oldOps;
+    GraphRenderingOps::DelayCompensation::Ptr oldDelayCompensation;
 
     {
         const ScopedLock sl (getCallbackLock());
         renderingOps.swapWith (oldOps);
+        std::swap (audioBuffers->delayCompensation, oldDelayCompensation);
     }
 
     deleteRenderOpArray (oldOps);
@@ -1339,9 +1950,47 @@ bool AudioProcessorGraph::isAnInputTo (const uint32 possibleInputId,
     return false;
 }
 
+// A node is active if it's an output, isn't lazy, or feeds (indirectly) into an active node.
+SortedSet<uint32> AudioProcessorGraph::findActiveNodeIds() const
+{
+    SortedSet<uint32> activeIds;
+    Array<uint32> nodesToVisit;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        const Node* const node = nodes.getUnchecked(i);
+        const AudioGraphIOProcessor* const ioProc = dynamic_cast<const AudioGraphIOProcessor*> (node->getProcessor());
+
+        if (! node->preparedLazily || (ioProc != nullptr && ioProc->isOutput()))
+            nodesToVisit.add (node->nodeId);
+    }
+
+    while (nodesToVisit.size() > 0)
+    {
+        const uint32 nodeId = nodesToVisit.removeAndReturn (nodesToVisit.size() - 1);
+
+        if (activeIds.contains (nodeId))
+            continue;
+
+        activeIds.add (nodeId);
+
+        for (int i = connections.size(); --i >= 0;)
+        {
+            const Connection* const c = connections.getUnchecked(i);
+
+            if (c->destNodeId == nodeId && ! activeIds.contains (c->sourceNodeId))
+                nodesToVisit.add (c->sourceNodeId);
+        }
+    }
+
+    return activeIds;
+}
+
 void AudioProcessorGraph::buildRenderingSequence()
 {
     Array<void*> newRenderingOps;
+    ReferenceCountedArray<Node> nodesToRelease;
+    GraphRenderingOps::DelayCompensation::Ptr newDelayCompensation;
     int numRenderingBuffersNeeded = 2;
     int numMidiBuffersNeeded = 1;
 
@@ -1352,11 +2001,20 @@ void AudioProcessorGraph::buildRenderingSequence()
 
         {
             const GraphRenderingOps::ConnectionLookupTable table (connections);
+            const SortedSet<uint32> activeNodeIds (findActiveNodeIds());
 
             for (int i = 0; i < nodes.size(); ++i)
             {
                 Node* const node = nodes.getUnchecked(i);
 
+                if (! activeNodeIds.contains (node->nodeId))
+                {
+                    if (node->isPrepared)
+                        nodesToRelease.add (node);
+
+                    continue;
+                }
+
                 node->prepare (getSampleRate(), getBlockSize(), this, getProcessingPrecision());
 
                 int j = 0;
@@ -1368,10 +2026,12 @@ void AudioProcessorGraph::buildRenderingSequence()
             }
         }
 
-        GraphRenderingOps::RenderingOpSequenceCalculator calculator (*this, orderedNodes, newRenderingOps);
+        GraphRenderingOps::RenderingOpSequenceCalculator calculator (*this, orderedNodes, newRenderingOps,
+                                                                     silenceDetectionEnabled ? &(audioBuffers->silence) : nullptr);
 
         numRenderingBuffersNeeded = calculator.getNumBuffersNeeded();
         numMidiBuffersNeeded = calculator.getNumMidiBuffersNeeded();
+        newDelayCompensation = calculator.getDelayCompensation();
     }
 
     {
@@ -1387,10 +2047,15 @@ void AudioProcessorGraph::buildRenderingSequence()
             midiBuffers.add (new MidiBuffer());
 
         renderingOps.swapWith (newRenderingOps);
+        std::swap (audioBuffers->delayCompensation, newDelayCompensation);
     }
 
     // delete the old ones..
     deleteRenderOpArray (newRenderingOps);
+
+    // ..and now that the audio thread can't be using them, release any lazy nodes that have gone idle
+    for (int i = 0; i < nodesToRelease.size(); ++i)
+        nodesToRelease.getUnchecked(i)->unprepare();
 }
 
 void AudioProcessorGraph::handleAsyncUpdate()
@@ -1474,6 +2139,19 @@ void AudioProcessorGraph::processAudio (AudioBuffer<FloatType>& buffer, MidiBuff
     currentMidiInputBuffer = &midiMessages;
     currentMidiOutputBuffer.clear();
 
+    if (GraphRenderingOps::DelayCompensation* const compensation = audioBuffers->delayCompensation)
+    {
+        // pick up any latency changes, and adjust the delays without rebuilding anything
+        if (compensation->update())
+        {
+            audioBuffers->latencyUpdater.newLatency = compensation->totalLatency;
+            audioBuffers->latencyUpdater.triggerAsyncUpdate();
+
+            if (compensation->needsRebuild)
+                triggerAsyncUpdate();
+        }
+    }
+
     for (int i = 0; i < renderingOps.size(); ++i)
     {
         GraphRenderingOps::AudioGraphRenderingOpBase* const op
@@ -1674,3 +2352,760 @@ void AudioProcessorGraph::AudioGraphIOProcessor::setParentGraph (AudioProcessorG
         updateHostDisplay();
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorGraphTests  : public UnitTest
+{
+public:
+    AudioProcessorGraphTests() : UnitTest ("AudioProcessorGraph") {}
+
+    struct CountingProcessor  : public AudioProcessor
+    {
+        CountingProcessor() : numPrepares (0), numReleases (0), numBlocks (0)
+        {
+            setPlayConfigDetails (2, 2, 44100.0, 256);
+        }
+
+        const String getName() const override                           { return "Counting"; }
+        void prepareToPlay (double, int) override                       { ++numPrepares; }
+        void releaseResources() override                                { ++numReleases; }
+        void processBlock (AudioBuffer<float>&, MidiBuffer&) override   { ++numBlocks; }
+        double getTailLengthSeconds() const override                    { return 0.0; }
+        bool acceptsMidi() const override                               { return false; }
+        bool producesMidi() const override                              { return false; }
+        AudioProcessorEditor* createEditor() override                   { return nullptr; }
+        bool hasEditor() const override                                 { return false; }
+        int getNumPrograms() override                                   { return 1; }
+        int getCurrentProgram() override                                { return 0; }
+        void setCurrentProgram (int) override                           {}
+        const String getProgramName (int) override                      { return String(); }
+        void changeProgramName (int, const String&) override            {}
+        void getStateInformation (MemoryBlock&) override                {}
+        void setStateInformation (const void*, int) override            {}
+
+        int numPrepares, numReleases, numBlocks;
+    };
+
+    // A processor that can act as a signal source, an effect that adds a constant
+    // offset to its input, or a simple synth which outputs a constant while a note is held.
+    struct TestProcessor  : public AudioProcessor
+    {
+        enum Mode { source, effect, synth, midiClock };
+
+        TestProcessor (Mode m, double tail = 0.0, int latency = 0)
+            : mode (m), tailSeconds (tail), sourceLevel (0.0f), numNotesOn (0), numBlocks (0)
+        {
+            setPlayConfigDetails (mode == effect || mode == midiClock ? 2 : 0, 2, 44100.0, 256);
+            setLatencySamples (latency);
+        }
+
+        const String getName() const override                           { return "Test"; }
+        void prepareToPlay (double, int) override                       {}
+        void releaseResources() override                                {}
+        double getTailLengthSeconds() const override                    { return tailSeconds; }
+        bool acceptsMidi() const override                               { return mode == synth; }
+        bool producesMidi() const override                              { return mode == midiClock; }
+        AudioProcessorEditor* createEditor() override                   { return nullptr; }
+        bool hasEditor() const override                                 { return false; }
+        int getNumPrograms() override                                   { return 1; }
+        int getCurrentProgram() override                                { return 0; }
+        void setCurrentProgram (int) override                           {}
+        const String getProgramName (int) override                      { return String(); }
+        void changeProgramName (int, const String&) override            {}
+        void getStateInformation (MemoryBlock&) override                {}
+        void setStateInformation (const void*, int) override            {}
+
+        void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+        {
+            ++numBlocks;
+
+            if (mode == midiClock)
+            {
+                // sends a clock tick every block, whatever its audio input is doing
+                midi.addEvent (MidiMessage::midiClock(), 0);
+            }
+            else if (mode == synth)
+            {
+                MidiBuffer::Iterator iter (midi);
+                MidiMessage m;
+                int pos;
+
+                while (iter.getNextEvent (m, pos))
+                    numNotesOn += m.isNoteOn() ? 1 : (m.isNoteOff() ? -1 : 0);
+
+                buffer.clear();
+
+                if (numNotesOn > 0)
+                    for (int i = 0; i < buffer.getNumChannels(); ++i)
+                        FloatVectorOperations::fill (buffer.getWritePointer (i), 0.25f, buffer.getNumSamples());
+            }
+            else if (mode == source)
+            {
+                for (int i = 0; i < buffer.getNumChannels(); ++i)
+                    FloatVectorOperations::fill (buffer.getWritePointer (i), sourceLevel * (float) (i + 1), buffer.getNumSamples());
+            }
+            else
+            {
+                // (a real effect with a tail would keep ringing - this one's output is just
+                // its input, plus a small offset so that we can see which nodes have run)
+                for (int i = 0; i < buffer.getNumChannels(); ++i)
+                {
+                    float* const data = buffer.getWritePointer (i);
+
+                    for (int j = 0; j < buffer.getNumSamples(); ++j)
+                        if (data[j] != 0)
+                            data[j] += 0.125f;
+                }
+            }
+        }
+
+        const Mode mode;
+        const double tailSeconds;
+        float sourceLevel;
+        int numNotesOn, numBlocks;
+    };
+
+    static float getPeakLevel (const AudioBuffer<float>& buffer)
+    {
+        float peak = 0;
+
+        for (int i = 0; i < buffer.getNumChannels(); ++i)
+            peak = jmax (peak, buffer.getMagnitude (i, 0, buffer.getNumSamples()));
+
+        return peak;
+    }
+
+    static AudioProcessorGraph::Node* addIONode (AudioProcessorGraph& graph, AudioProcessorGraph::AudioGraphIOProcessor::IODeviceType type)
+    {
+        return graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (type));
+    }
+
+    static void connectStereo (AudioProcessorGraph& graph, uint32 source, uint32 dest)
+    {
+        graph.addConnection (source, 0, dest, 0);
+        graph.addConnection (source, 1, dest, 1);
+    }
+
+    // An effect that really does delay its audio and midi by whatever latency it reports.
+    struct DelayingProcessor  : public AudioProcessor
+    {
+        DelayingProcessor (int latency)  : delayLine (2, 16384), writePos (0), currentLatency (latency)
+        {
+            setPlayConfigDetails (2, 2, 44100.0, 256);
+            setLatencySamples (latency);
+            delayLine.clear();
+        }
+
+        const String getName() const override                           { return "Delaying"; }
+        void prepareToPlay (double, int) override                       {}
+        void releaseResources() override                                {}
+        double getTailLengthSeconds() const override                    { return 0.0; }
+        bool acceptsMidi() const override                               { return true; }
+        bool producesMidi() const override                              { return true; }
+        AudioProcessorEditor* createEditor() override                   { return nullptr; }
+        bool hasEditor() const override                                 { return false; }
+        int getNumPrograms() override                                   { return 1; }
+        int getCurrentProgram() override                                { return 0; }
+        void setCurrentProgram (int) override                           {}
+        const String getProgramName (int) override                      { return String(); }
+        void changeProgramName (int, const String&) override            {}
+        void getStateInformation (MemoryBlock&) override                {}
+        void setStateInformation (const void*, int) override            {}
+
+        void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+        {
+            const int latency = getLatencySamples();
+            const int numSamples = buffer.getNumSamples();
+
+            if (latency != currentLatency)
+            {
+                delayLine.clear();
+                currentLatency = latency;
+            }
+
+            for (int chan = 0; chan < 2; ++chan)
+            {
+                float* const data = buffer.getWritePointer (chan);
+                float* const line = delayLine.getWritePointer (chan);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const int pos = (writePos + i) % delayLine.getNumSamples();
+                    line[pos] = data[i];
+                    data[i] = line[(pos + delayLine.getNumSamples() - latency) % delayLine.getNumSamples()];
+                }
+            }
+
+            writePos = (writePos + numSamples) % delayLine.getNumSamples();
+
+            pendingMidi.addEvents (midi, 0, numSamples, latency);
+            midi.clear();
+            midi.addEvents (pendingMidi, 0, numSamples, 0);
+
+            MidiBuffer remaining;
+            remaining.addEvents (pendingMidi, numSamples, -1, -numSamples);
+            pendingMidi.swapWith (remaining);
+        }
+
+        AudioBuffer<float> delayLine;
+        MidiBuffer pendingMidi;
+        int writePos, currentLatency;
+    };
+
+    // Feeds an impulse (and a note-on) into the graph, and returns the positions at which
+    // they come out, or -1 if they don't.
+    static void findImpulse (AudioProcessorGraph& graph, int blockSize, int impulsePos,
+                             int& audioPos, float& audioLevel, int& midiPos)
+    {
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+
+        audioPos = midiPos = -1;
+        audioLevel = 0;
+
+        for (int block = 0; block < 200; ++block)
+        {
+            buffer.clear();
+            midi.clear();
+
+            if (block == 0)
+            {
+                buffer.setSample (0, impulsePos, 1.0f);
+                buffer.setSample (1, impulsePos, 1.0f);
+                midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), impulsePos);
+            }
+
+            graph.processBlock (buffer, midi);
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                if (buffer.getSample (0, i) != 0)
+                {
+                    if (audioPos < 0)
+                    {
+                        audioPos = block * blockSize + i;
+                        audioLevel = buffer.getSample (0, i);
+                    }
+                    else
+                    {
+                        audioPos = -2; // (the impulse has been smeared)
+                    }
+                }
+            }
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage m;
+            int pos;
+
+            while (iter.getNextEvent (m, pos))
+                midiPos = (midiPos == -1 ? block * blockSize + pos : -2);
+        }
+    }
+
+    void testLatencyCompensation()
+    {
+        beginTest ("Latency compensation across parallel paths");
+
+        const int blockSize = 64;
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        const uint32 inputId  = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode)->nodeId;
+        const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        const uint32 midiInId  = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode)->nodeId;
+        const uint32 midiOutId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode)->nodeId;
+
+        // three parallel busses: a lookahead limiter, a dry path, and a chain of two shorter delays
+        const uint32 limiter = graph.addNode (new DelayingProcessor (100))->nodeId;
+        const uint32 eq1     = graph.addNode (new DelayingProcessor (30))->nodeId;
+        const uint32 eq2     = graph.addNode (new DelayingProcessor (40))->nodeId;
+
+        connectStereo (graph, inputId, limiter);
+        connectStereo (graph, inputId, eq1);
+        connectStereo (graph, eq1, eq2);
+        connectStereo (graph, limiter, outputId);
+        connectStereo (graph, eq2, outputId);
+        connectStereo (graph, inputId, outputId);
+
+        // ..and midi going straight through, which should stay in step with the audio
+        graph.addConnection (midiInId, AudioProcessorGraph::midiChannelIndex,
+                             midiOutId, AudioProcessorGraph::midiChannelIndex);
+
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), 100);
+
+        int audioPos, midiPos;
+        float audioLevel;
+        findImpulse (graph, blockSize, 10, audioPos, audioLevel, midiPos);
+
+        expectEquals (audioPos, 110);
+        expectEquals (audioLevel, 3.0f);
+        expectEquals (midiPos, 110);
+
+        beginTest ("Latency compensation of merging midi paths");
+
+        // the midi now takes two routes to the output, one of which is delayed
+        const uint32 arp = graph.addNode (new DelayingProcessor (70))->nodeId;
+
+        graph.addConnection (midiInId, AudioProcessorGraph::midiChannelIndex, arp, AudioProcessorGraph::midiChannelIndex);
+        graph.addConnection (arp, AudioProcessorGraph::midiChannelIndex, midiOutId, AudioProcessorGraph::midiChannelIndex);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        int numNotes = 0;
+
+        for (int block = 0; block < 10; ++block)
+        {
+            buffer.clear();
+            midi.clear();
+
+            if (block == 0)
+                midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), 5);
+
+            graph.processBlock (buffer, midi);
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage m;
+            int pos;
+
+            while (iter.getNextEvent (m, pos))
+            {
+                expectEquals (block * blockSize + pos, 105);
+                ++numNotes;
+            }
+        }
+
+        expectEquals (numNotes, 2);
+    }
+
+    void testLatencyChanges()
+    {
+        beginTest ("Latency changes are applied without rebuilding");
+
+        const int blockSize = 64;
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        const uint32 inputId  = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode)->nodeId;
+        const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        const uint32 midiInId  = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode)->nodeId;
+        const uint32 midiOutId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode)->nodeId;
+
+        DelayingProcessor* const limiter = new DelayingProcessor (0);
+        const uint32 limiterId = graph.addNode (limiter)->nodeId;
+
+        connectStereo (graph, inputId, limiterId);
+        connectStereo (graph, limiterId, outputId);
+        connectStereo (graph, inputId, outputId);
+        graph.addConnection (midiInId, AudioProcessorGraph::midiChannelIndex,
+                             midiOutId, AudioProcessorGraph::midiChannelIndex);
+
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), 0);
+
+        int audioPos, midiPos;
+        float audioLevel;
+        findImpulse (graph, blockSize, 20, audioPos, audioLevel, midiPos);
+        expectEquals (audioPos, 20);
+        expectEquals (audioLevel, 2.0f);
+        expectEquals (midiPos, 20);
+
+        // (nothing here gives the graph a chance to rebuild itself, so the new
+        // delays must be picked up by the existing rendering sequence)
+        limiter->setLatencySamples (300);
+        findImpulse (graph, blockSize, 20, audioPos, audioLevel, midiPos);
+        expectEquals (audioPos, 320);
+        expectEquals (audioLevel, 2.0f);
+        expectEquals (midiPos, 320);
+
+        limiter->setLatencySamples (50);
+        findImpulse (graph, blockSize, 20, audioPos, audioLevel, midiPos);
+        expectEquals (audioPos, 70);
+        expectEquals (audioLevel, 2.0f);
+        expectEquals (midiPos, 70);
+
+        // a delay that's too big for the existing delay lines gets sorted out by a rebuild
+        limiter->setLatencySamples (10000);
+        graph.prepareToPlay (44100.0, blockSize);
+        expectEquals (graph.getLatencySamples(), 10000);
+
+        findImpulse (graph, blockSize, 20, audioPos, audioLevel, midiPos);
+        expectEquals (audioPos, 10020);
+        expectEquals (audioLevel, 2.0f);
+        expectEquals (midiPos, 10020);
+
+        beginTest ("Shortening a delay keeps the signal that's already in it");
+
+        // the effect passes its input straight through, so only the dry path gets delayed
+        AudioProcessorGraph steadyGraph;
+        steadyGraph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+
+        const uint32 steadyInputId  = addIONode (steadyGraph, AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode)->nodeId;
+        const uint32 steadyOutputId = addIONode (steadyGraph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+
+        TestProcessor* const effect = new TestProcessor (TestProcessor::effect, 0.0, 300);
+        const uint32 effectId = steadyGraph.addNode (effect)->nodeId;
+
+        connectStereo (steadyGraph, steadyInputId, effectId);
+        connectStereo (steadyGraph, effectId, steadyOutputId);
+        connectStereo (steadyGraph, steadyInputId, steadyOutputId);
+        steadyGraph.prepareToPlay (44100.0, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+
+        for (int block = 0; block < 20; ++block)
+        {
+            if (block == 10)
+                effect->setLatencySamples (200);
+
+            for (int i = 0; i < 2; ++i)
+                FloatVectorOperations::fill (buffer.getWritePointer (i), 1.0f, blockSize);
+
+            steadyGraph.processBlock (buffer, midi);
+
+            if (block >= 5)
+            {
+                expectEquals (buffer.findMinMax (0, 0, blockSize).getStart(), 2.125f);
+                expectEquals (buffer.findMinMax (0, 0, blockSize).getEnd(),   2.125f);
+            }
+        }
+    }
+
+    void runTest() override
+    {
+        testLazyPreparation();
+        testLatencyCompensation();
+        testLatencyChanges();
+        testSilentNodesSleep();
+        testSleepingSynths();
+        testMidiGeneratorsNeverSleep();
+        testSilenceDetectionOutputMatches();
+        testSilenceDetectionBenchmark();
+    }
+
+    void testLazyPreparation()
+    {
+        beginTest ("Lazily prepared nodes");
+
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, 256);
+
+        const uint32 outputId = graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeId;
+
+        graph.setNewNodesPreparedLazily (true);
+        AudioProcessorGraph::Node* const a = graph.addNode (new CountingProcessor());
+        AudioProcessorGraph::Node* const b = graph.addNode (new CountingProcessor());
+        graph.setNewNodesPreparedLazily (false);
+
+        CountingProcessor& procA = *static_cast<CountingProcessor*> (a->getProcessor());
+        CountingProcessor& procB = *static_cast<CountingProcessor*> (b->getProcessor());
+
+        expect (a->isPreparedLazily() && b->isPreparedLazily());
+
+        AudioBuffer<float> buffer (2, 256);
+        MidiBuffer midi;
+
+        // The graph rebuilds its sequence asynchronously after each change, so
+        // these tests just re-prepare it to make that happen straight away.
+        graph.prepareToPlay (44100.0, 256);
+        graph.processBlock (buffer, midi);
+
+        expect (! a->isActive() && ! b->isActive());
+        expect (procA.numPrepares == 0 && procA.numBlocks == 0);
+        expect (procB.numPrepares == 0 && procB.numBlocks == 0);
+
+        expect (graph.addConnection (a->nodeId, 0, outputId, 0));
+        graph.prepareToPlay (44100.0, 256);
+        graph.processBlock (buffer, midi);
+
+        expect (a->isActive() && ! b->isActive());
+        expect (procA.numPrepares == 1 && procA.numBlocks == 1);
+        expect (procB.numPrepares == 0 && procB.numBlocks == 0);
+
+        expect (graph.addConnection (b->nodeId, 1, a->nodeId, 1));
+        graph.prepareToPlay (44100.0, 256);
+        graph.processBlock (buffer, midi);
+
+        expect (a->isActive() && b->isActive());
+        expect (procA.numPrepares == 1 && procA.numBlocks == 2);
+        expect (procB.numPrepares == 1 && procB.numBlocks == 1);
+
+        expect (graph.removeConnection (a->nodeId, 0, outputId, 0));
+        graph.prepareToPlay (44100.0, 256);
+        graph.processBlock (buffer, midi);
+
+        expect (! a->isActive() && ! b->isActive());
+        expect (procA.numReleases == 1 && procA.numBlocks == 2);
+        expect (procB.numReleases == 1 && procB.numBlocks == 1);
+
+        // a non-lazy node keeps everything that feeds it active, even without an output
+        graph.setNodePreparedLazily (a->nodeId, false);
+        graph.prepareToPlay (44100.0, 256);
+        graph.processBlock (buffer, midi);
+
+        expect (a->isActive() && b->isActive());
+        expect (procA.numPrepares == 2 && procA.numBlocks == 3);
+        expect (procB.numPrepares == 2 && procB.numBlocks == 2);
+
+        graph.releaseResources();
+        expect (procA.numReleases == 2 && procB.numReleases == 2);
+    }
+
+    void testSilentNodesSleep()
+    {
+        beginTest ("Silent nodes sleep once their tail has elapsed");
+
+        const int blockSize = 256;
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        graph.setSilenceDetectionEnabled (true);
+
+        TestProcessor* const src = new TestProcessor (TestProcessor::source);
+        TestProcessor* const fx  = new TestProcessor (TestProcessor::effect, 3 * blockSize / 44100.0);
+
+        const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        const uint32 srcId = graph.addNode (src)->nodeId;
+        AudioProcessorGraph::Node* const fxNode = graph.addNode (fx);
+
+        connectStereo (graph, srcId, fxNode->nodeId);
+        connectStereo (graph, fxNode->nodeId, outputId);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+
+        src->sourceLevel = 0.5f;
+        graph.processBlock (buffer, midi);
+        expectEquals (buffer.getSample (1, 10), 1.125f);
+        expect (! fxNode->isSleeping());
+
+        // three silent blocks of tail, then it should go to sleep
+        src->sourceLevel = 0;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            graph.processBlock (buffer, midi);
+            expectEquals (getPeakLevel (buffer), 0.0f);
+        }
+
+        expectEquals (fx->numBlocks, 4);
+        expect (fxNode->getNumBlocksProcessed() == 4);
+        expect (fxNode->getNumBlocksSkipped() == 3);
+        expect (fxNode->isSleeping());
+
+        // ..and wake up as soon as there's a signal
+        src->sourceLevel = 0.25f;
+        graph.processBlock (buffer, midi);
+        expectEquals (buffer.getSample (0, 0), 0.375f);
+        expectEquals (fx->numBlocks, 5);
+        expect (! fxNode->isSleeping());
+
+        // the source never sleeps, because it has no inputs
+        expect (graph.getNodeForId (srcId)->getNumBlocksSkipped() == 0);
+    }
+
+    void testSleepingSynths()
+    {
+        beginTest ("Synths keep running while a note is held");
+
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, 256);
+        graph.setSilenceDetectionEnabled (true);
+
+        TestProcessor* const synth = new TestProcessor (TestProcessor::synth);
+
+        const uint32 midiInId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode)->nodeId;
+        const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        AudioProcessorGraph::Node* const synthNode = graph.addNode (synth);
+
+        graph.addConnection (midiInId, AudioProcessorGraph::midiChannelIndex, synthNode->nodeId, AudioProcessorGraph::midiChannelIndex);
+        connectStereo (graph, synthNode->nodeId, outputId);
+        graph.prepareToPlay (44100.0, 256);
+
+        AudioBuffer<float> buffer (2, 256);
+        MidiBuffer midi;
+
+        graph.processBlock (buffer, midi);
+        graph.processBlock (buffer, midi);
+        expect (synthNode->isSleeping());
+
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), 0);
+        graph.processBlock (buffer, midi);
+        expectEquals (getPeakLevel (buffer), 0.25f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            midi.clear();
+            graph.processBlock (buffer, midi);
+            expectEquals (getPeakLevel (buffer), 0.25f);
+            expect (! synthNode->isSleeping());
+        }
+
+        midi.clear();
+        midi.addEvent (MidiMessage::noteOff (1, 60), 0);
+        graph.processBlock (buffer, midi);
+        expectEquals (getPeakLevel (buffer), 0.0f);
+
+        midi.clear();
+        graph.processBlock (buffer, midi);
+        expect (synthNode->isSleeping());
+    }
+
+    void testMidiGeneratorsNeverSleep()
+    {
+        beginTest ("Nodes that generate midi never sleep");
+
+        const int blockSize = 256;
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        graph.setSilenceDetectionEnabled (true);
+
+        TestProcessor* const src   = new TestProcessor (TestProcessor::source);
+        TestProcessor* const clock = new TestProcessor (TestProcessor::midiClock);
+
+        const uint32 outputId  = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        const uint32 midiOutId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode)->nodeId;
+        const uint32 srcId = graph.addNode (src)->nodeId;
+        AudioProcessorGraph::Node* const clockNode = graph.addNode (clock);
+
+        connectStereo (graph, srcId, clockNode->nodeId);
+        connectStereo (graph, clockNode->nodeId, outputId);
+        graph.addConnection (clockNode->nodeId, AudioProcessorGraph::midiChannelIndex,
+                             midiOutId, AudioProcessorGraph::midiChannelIndex);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+
+        // its audio inputs are silent throughout, but the clock ticks must keep coming
+        for (int i = 0; i < 8; ++i)
+        {
+            midi.clear();
+            graph.processBlock (buffer, midi);
+
+            expectEquals (midi.getNumEvents(), 1);
+            expect (! clockNode->isSleeping());
+        }
+
+        expectEquals (clock->numBlocks, 8);
+        expect (clockNode->getNumBlocksSkipped() == 0);
+    }
+
+    // Builds a graph with parallel paths, summing and latency compensation, and
+    // runs the same sequence of on/off signals through it with and without silence
+    // detection, which should make no difference to the output.
+    void renderTestPattern (bool useSilenceDetection, AudioBuffer<float>& result)
+    {
+        const int blockSize = 64, numBlocks = 40;
+
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        graph.setSilenceDetectionEnabled (useSilenceDetection);
+
+        TestProcessor* const srcA = new TestProcessor (TestProcessor::source);
+        TestProcessor* const srcB = new TestProcessor (TestProcessor::source);
+
+        const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+        const uint32 a  = graph.addNode (srcA)->nodeId;
+        const uint32 b  = graph.addNode (srcB)->nodeId;
+        const uint32 fx1 = graph.addNode (new TestProcessor (TestProcessor::effect, 0.0, 100))->nodeId;
+        const uint32 fx2 = graph.addNode (new TestProcessor (TestProcessor::effect, 200.0 / 44100.0))->nodeId;
+        const uint32 fx3 = graph.addNode (new TestProcessor (TestProcessor::effect))->nodeId;
+
+        connectStereo (graph, a, fx1);
+        connectStereo (graph, b, fx2);
+        connectStereo (graph, a, fx3);
+        connectStereo (graph, b, fx3);
+        connectStereo (graph, fx1, outputId);
+        connectStereo (graph, fx2, outputId);
+        connectStereo (graph, fx3, outputId);
+        graph.addConnection (a, 1, outputId, 0);
+
+        graph.prepareToPlay (44100.0, blockSize);
+
+        result.setSize (2, blockSize * numBlocks);
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        Random r (1234);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            srcA->sourceLevel = r.nextInt (3) == 0 ? r.nextFloat() : 0.0f;
+            srcB->sourceLevel = r.nextInt (4) == 0 ? r.nextFloat() : 0.0f;
+
+            graph.processBlock (buffer, midi);
+
+            for (int chan = 0; chan < 2; ++chan)
+                result.copyFrom (chan, i * blockSize, buffer, chan, 0, blockSize);
+        }
+    }
+
+    void testSilenceDetectionOutputMatches()
+    {
+        beginTest ("Silence detection doesn't change the output");
+
+        AudioBuffer<float> normal, detected;
+        renderTestPattern (false, normal);
+        renderTestPattern (true, detected);
+
+        expect (getPeakLevel (normal) > 0);
+
+        for (int chan = 0; chan < 2; ++chan)
+            for (int i = 0; i < normal.getNumSamples(); ++i)
+                if (normal.getSample (chan, i) != detected.getSample (chan, i))
+                    return expect (false, "Mismatch at sample " + String (i));
+    }
+
+    void testSilenceDetectionBenchmark()
+    {
+        beginTest ("Silence detection benchmark");
+
+        // a mixer-style graph: lots of idle tracks, each with a chain of effects
+        const int numTracks = 64, numEffectsPerTrack = 4, blockSize = 256, numBlocks = 400;
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            AudioProcessorGraph graph;
+            graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+            graph.setSilenceDetectionEnabled (pass == 1);
+
+            const uint32 outputId = addIONode (graph, AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)->nodeId;
+
+            for (int track = 0; track < numTracks; ++track)
+            {
+                uint32 previous = graph.addNode (new TestProcessor (TestProcessor::source))->nodeId;
+
+                for (int i = 0; i < numEffectsPerTrack; ++i)
+                {
+                    const uint32 fx = graph.addNode (new TestProcessor (TestProcessor::effect))->nodeId;
+                    connectStereo (graph, previous, fx);
+                    previous = fx;
+                }
+
+                connectStereo (graph, previous, outputId);
+            }
+
+            graph.prepareToPlay (44100.0, blockSize);
+
+            AudioBuffer<float> buffer (2, blockSize);
+            MidiBuffer midi;
+
+            const double start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numBlocks; ++i)
+                graph.processBlock (buffer, midi);
+
+            logMessage (String (pass == 1 ? "With" : "Without") + " silence detection: "
+                          + String (Time::getMillisecondCounterHiRes() - start, 1) + " ms for "
+                          + String (numBlocks) + " blocks of " + String (numTracks * (numEffectsPerTrack + 1)) + " idle nodes");
+        }
+    }
+};
+
+static AudioProcessorGraphTests audioProcessorGraphTests;
+
+#endif
@@ -38,6 +38,16 @@
 
     To play back a graph through an audio device, you might want to use an
     AudioProcessorPlayer object.
+
+    The graph doesn't fill or clear its nodes' AudioProcessor::getParameterAutomation()
+    queues, so its nodes only see parameter changes at block boundaries.
+
+    The graph compensates for the latency of its nodes: wherever parallel paths with
+    different latencies meet (audio or midi), the faster ones are delayed so that
+    everything lines up, and all the graph's outputs are aligned to the slowest path.
+    If a node changes its latency with AudioProcessor::setLatencySamples(), the delays
+    are adjusted at the start of the next block without the graph being rebuilt, and
+    the graph's own getLatencySamples() is updated asynchronously on the message thread.
 */
 class JUCE_API  AudioProcessorGraph   : public AudioProcessor,
                                         private AsyncUpdater
@@ -77,6 +87,41 @@ public:
         */
         NamedValueSet properties;
 
+        /** Returns true if the graph has prepared this node's processor and is
+            including it when rendering.
+            This is always the case for a prepared graph unless the node is being
+            prepared lazily and isn't currently connected to anything that's used.
+            @see AudioProcessorGraph::setNodePreparedLazily
+        */
+        bool isActive() const noexcept                          { return isPrepared; }
+
+        /** Returns true if this node is only prepared when it becomes active.
+            @see AudioProcessorGraph::setNodePreparedLazily
+        */
+        bool isPreparedLazily() const noexcept                  { return preparedLazily; }
+
+        //==============================================================================
+        /** When the graph's silence detection is enabled, this returns the number of
+            blocks for which the node's processor was actually called.
+            @see AudioProcessorGraph::setSilenceDetectionEnabled
+        */
+        int64 getNumBlocksProcessed() const noexcept            { return numBlocksProcessed.get(); }
+
+        /** When the graph's silence detection is enabled, this returns the number of
+            blocks that were skipped because the node was asleep.
+            @see AudioProcessorGraph::setSilenceDetectionEnabled
+        */
+        int64 getNumBlocksSkipped() const noexcept              { return numBlocksSkipped.get(); }
+
+        /** Returns true if the last block was skipped because the node was asleep. */
+        bool isSleeping() const noexcept                        { return sleeping.get() != 0; }
+
+        /** Resets the counters returned by getNumBlocksProcessed() and getNumBlocksSkipped(). */
+        void resetSleepStatistics() noexcept;
+
+        /** @internal */
+        void recordRenderedBlock (bool wasSkipped) noexcept;
+
         //==============================================================================
         /** A convenient typedef for referring to a pointer to a node object. */
         typedef ReferenceCountedObjectPtr<Node> Ptr;
@@ -86,7 +131,9 @@ public:
         friend class AudioProcessorGraph;
 
         const ScopedPointer<AudioProcessor> processor;
-        bool isPrepared;
+        bool isPrepared, preparedLazily;
+        Atomic<int64> numBlocksProcessed, numBlocksSkipped;
+        Atomic<int> sleeping;
 
         Node (uint32 nodeId, AudioProcessor*) noexcept;
 
@@ -189,6 +236,49 @@ public:
      */
     bool removeNode (Node* node);
 
+    /** Puts a node into (or takes it out of) lazy preparation mode.
+
+        The processor of a lazy node doesn't get its prepareToPlay() method called, and
+        isn't processed, until the node becomes active - i.e. until it's connected, directly
+        or via other nodes, to one of the graph's output nodes or to a node that isn't lazy.
+        When it's disconnected again, its releaseResources() method is called.
+
+        This lets you load a large number of plugins into a graph without paying for
+        all of their buffers and other resources until they're actually being used.
+
+        @see setNewNodesPreparedLazily, Node::isActive
+    */
+    void setNodePreparedLazily (uint32 nodeId, bool shouldBePreparedLazily);
+
+    /** Sets whether nodes created by subsequent calls to addNode() start off being
+        prepared lazily. By default this is false.
+        @see setNodePreparedLazily
+    */
+    void setNewNodesPreparedLazily (bool shouldBePreparedLazily) noexcept   { newNodesPreparedLazily = shouldBePreparedLazily; }
+
+    //==============================================================================
+    /** Enables or disables the graph's silence detection.
+
+        When this is on, the graph keeps track of which of its internal channels contain
+        nothing but digital silence. Silent channels are passed between nodes without being
+        cleared or copied, and a node whose inputs are all silent (and which has no incoming
+        midi) is put to sleep and skipped once its reported tail length and latency have
+        elapsed. It wakes up again as soon as any of its inputs contains a non-zero sample.
+
+        Nodes that have no inputs at all, and nodes whose processors produce midi, are never
+        put to sleep, because they're assumed to be generating their own signal. Processors
+        that report an incorrect tail length may get cut off early, which is why this is
+        disabled by default.
+
+        Use Node::getNumBlocksSkipped() to find out how much work this is saving.
+    */
+    void setSilenceDetectionEnabled (bool shouldBeEnabled);
+
+    /** Returns true if silence detection is turned on.
+        @see setSilenceDetectionEnabled
+    */
+    bool isSilenceDetectionEnabled() const noexcept                     { return silenceDetectionEnabled; }
+
     //==============================================================================
     /** Returns the number of connections in the graph. */
     int getNumConnections() const                                       { return connections.size(); }
@@ -392,12 +482,13 @@ private:
     MidiBuffer* currentMidiInputBuffer;
     MidiBuffer currentMidiOutputBuffer;
 
-    bool isPrepared;
+    bool isPrepared, newNodesPreparedLazily, silenceDetectionEnabled;
 
     void handleAsyncUpdate() override;
     void clearRenderingSequence();
     void buildRenderingSequence();
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
+    SortedSet<uint32> findActiveNodeIds() const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorGraph)
 };
@@ -22,9 +22,216 @@
   ==============================================================================
 */
 
+namespace KnownPluginListCacheHelpers
+{
+    enum
+    {
+        cacheMagicNumber = 0x4350504b,
+        cacheVersion = 1,
+        snapshotChunk = 1,
+        changesChunk = 2
+    };
+
+    enum CacheChange
+    {
+        typeAdded = 1,
+        typeRemoved,
+        blacklistAdded,
+        blacklistRemoved,
+        blacklistCleared,
+        needsRewriting
+    };
+
+    static void writeDescription (OutputStream& out, const PluginDescription& d)
+    {
+        out.writeString (d.name);
+        out.writeString (d.descriptiveName);
+        out.writeString (d.pluginFormatName);
+        out.writeString (d.category);
+        out.writeString (d.manufacturerName);
+        out.writeString (d.version);
+        out.writeString (d.fileOrIdentifier);
+        out.writeInt64 (d.lastFileModTime.toMilliseconds());
+        out.writeInt64 (d.lastInfoUpdateTime.toMilliseconds());
+        out.writeInt (d.uid);
+        out.writeInt (d.numInputChannels);
+        out.writeInt (d.numOutputChannels);
+        out.writeByte ((char) ((d.isInstrument ? 1 : 0) | (d.hasSharedContainer ? 2 : 0)));
+    }
+
+    static void readDescription (InputStream& in, PluginDescription& d)
+    {
+        d.name                = in.readString();
+        d.descriptiveName     = in.readString();
+        d.pluginFormatName    = in.readString();
+        d.category            = in.readString();
+        d.manufacturerName    = in.readString();
+        d.version             = in.readString();
+        d.fileOrIdentifier    = in.readString();
+        d.lastFileModTime     = Time (in.readInt64());
+        d.lastInfoUpdateTime  = Time (in.readInt64());
+        d.uid                 = in.readInt();
+        d.numInputChannels    = in.readInt();
+        d.numOutputChannels   = in.readInt();
+
+        const int flags = in.readByte();
+        d.isInstrument        = (flags & 1) != 0;
+        d.hasSharedContainer  = (flags & 2) != 0;
+    }
+
+    static void writeChunk (OutputStream& out, int type, const MemoryOutputStream& data)
+    {
+        out.writeInt (type);
+        out.writeInt ((int) data.getDataSize());
+        out.write (data.getData(), data.getDataSize());
+    }
+
+    static bool readChunk (MemoryInputStream& in, int& type, const void*& data, int& size)
+    {
+        if (in.getNumBytesRemaining() < 8)
+            return false;
+
+        type = in.readInt();
+        size = in.readInt();
+
+        // a chunk that runs off the end of the file was only partly written
+        if (size < 0 || size > in.getNumBytesRemaining())
+            return false;
+
+        data = addBytesToPointer (in.getData(), (int) in.getPosition());
+        in.skipNextBytes (size);
+        return true;
+    }
+}
+
+//==============================================================================
+// Hash tables for looking up the types by file, identifier string and UID. This is
+// built when it's first needed, kept up to date as types are added, and thrown away
+// when any types are removed or re-ordered.
+struct KnownPluginList::TypeIndex
+{
+    TypeIndex (const OwnedArray<PluginDescription>& types)
+    {
+        for (int i = types.size(); --i >= 0;)
+            addTypeAtStart (types.getUnchecked (i));
+    }
+
+    void addTypeAtStart (PluginDescription* type)
+    {
+        if (const Array<PluginDescription*>* group = getTypesForFile (type->fileOrIdentifier))
+        {
+            const_cast<Array<PluginDescription*>*> (group)->insert (0, type);
+        }
+        else
+        {
+            filesToGroups.set (type->fileOrIdentifier, fileGroups.size());
+            fileGroups.add (Array<PluginDescription*>());
+            fileGroups.getReference (fileGroups.size() - 1).add (type);
+        }
+
+        identifiers.set (getIdentifierKey (*type), type);
+        uids.set (type->uid, type);
+    }
+
+    const Array<PluginDescription*>* getTypesForFile (const String& fileOrIdentifier) const
+    {
+        if (filesToGroups.contains (fileOrIdentifier))
+            return &fileGroups.getReference (filesToGroups [fileOrIdentifier]);
+
+        return nullptr;
+    }
+
+    PluginDescription* getTypeForIdentifierString (const String& identifierString) const
+    {
+        // the identifier string ends with the file's hash and the UID, so
+        // those two parts are all we need to look it up
+        const String withoutUID (identifierString.upToLastOccurrenceOf ("-", false, false));
+        const String key (withoutUID.fromLastOccurrenceOf ("-", true, false)
+                            + identifierString.fromLastOccurrenceOf ("-", true, false));
+
+        PluginDescription* const type = identifiers [key.toLowerCase()];
+        return type != nullptr && type->matchesIdentifierString (identifierString) ? type : nullptr;
+    }
+
+    PluginDescription* getTypeForUID (int uid) const
+    {
+        return uids [uid];
+    }
+
+    static String getIdentifierKey (const PluginDescription& type)
+    {
+        return "-" + String::toHexString (type.fileOrIdentifier.hashCode())
+             + "-" + String::toHexString (type.uid);
+    }
+
+private:
+    HashMap<String, int> filesToGroups;
+    Array<Array<PluginDescription*> > fileGroups;
+    HashMap<String, PluginDescription*> identifiers;
+    HashMap<int, PluginDescription*> uids;
+
+    JUCE_DECLARE_NON_COPYABLE (TypeIndex)
+};
+
+// The changes that have been made since the list was last saved to or loaded from
+// a binary cache, which updateBinaryCache() will append to the file.
+struct KnownPluginList::CacheJournal
+{
+    CacheJournal (const File& f, int64 size)
+        : file (f), snapshotSize (size), needsFullWrite (false)
+    {
+    }
+
+    const File file;
+    const int64 snapshotSize;
+    MemoryOutputStream changes;
+    bool needsFullWrite;
+
+    JUCE_DECLARE_NON_COPYABLE (CacheJournal)
+};
+
+//==============================================================================
 KnownPluginList::KnownPluginList()  {}
 KnownPluginList::~KnownPluginList() {}
 
+KnownPluginList::TypeIndex& KnownPluginList::getTypeIndex() const
+{
+    // the caller must be holding the typesArrayLock
+    if (typeIndex == nullptr)
+        typeIndex = new TypeIndex (types);
+
+    return *typeIndex;
+}
+
+void KnownPluginList::typesChanged()
+{
+    typeIndex = nullptr;
+}
+
+void KnownPluginList::addToCacheJournal (const int change, const PluginDescription* type, const String& text)
+{
+    using namespace KnownPluginListCacheHelpers;
+
+    ScopedLock lock (typesArrayLock);
+
+    if (cacheJournal == nullptr || cacheJournal->needsFullWrite)
+        return;
+
+    if (change == needsRewriting)
+    {
+        cacheJournal->needsFullWrite = true;
+        cacheJournal->changes.reset();
+        return;
+    }
+
+    cacheJournal->changes.writeByte ((char) change);
+
+    if (type != nullptr)
+        writeDescription (cacheJournal->changes, *type);
+    else
+        cacheJournal->changes.writeString (text);
+}
+
 void KnownPluginList::clear()
 {
     ScopedLock lock (typesArrayLock);
@@ -32,6 +239,8 @@ void KnownPluginList::clear()
     if (types.size() > 0)
     {
         types.clear();
+        typesChanged();
+        addToCacheJournal (KnownPluginListCacheHelpers::needsRewriting, nullptr, String());
         sendChangeMessage();
     }
 }
@@ -40,9 +249,8 @@ PluginDescription* KnownPluginList::getTypeForFile (const String& fileOrIdentifi
 {
     ScopedLock lock (typesArrayLock);
 
-    for (int i = 0; i < types.size(); ++i)
-        if (types.getUnchecked(i)->fileOrIdentifier == fileOrIdentifier)
-            return types.getUnchecked(i);
+    if (const Array<PluginDescription*>* group = getTypeIndex().getTypesForFile (fileOrIdentifier))
+        return group->getFirst();
 
     return nullptr;
 }
@@ -50,12 +258,13 @@ PluginDescription* KnownPluginList::getTypeForFile (const String& fileOrIdentifi
 PluginDescription* KnownPluginList::getTypeForIdentifierString (const String& identifierString) const
 {
     ScopedLock lock (typesArrayLock);
+    return getTypeIndex().getTypeForIdentifierString (identifierString);
+}
 
-    for (int i = 0; i < types.size(); ++i)
-        if (types.getUnchecked(i)->matchesIdentifierString (identifierString))
-            return types.getUnchecked(i);
-
-    return nullptr;
+PluginDescription* KnownPluginList::getTypeForUID (const int uid) const
+{
+    ScopedLock lock (typesArrayLock);
+    return getTypeIndex().getTypeForUID (uid);
 }
 
 bool KnownPluginList::addType (const PluginDescription& type)
@@ -63,20 +272,29 @@ bool KnownPluginList::addType (const PluginDescription& type)
     {
         ScopedLock lock (typesArrayLock);
 
-        for (int i = types.size(); --i >= 0;)
+        addToCacheJournal (KnownPluginListCacheHelpers::typeAdded, &type, String());
+
+        if (const Array<PluginDescription*>* group = getTypeIndex().getTypesForFile (type.fileOrIdentifier))
         {
-            if (types.getUnchecked(i)->isDuplicateOf (type))
+            for (int i = 0; i < group->size(); ++i)
             {
-                // strange - found a duplicate plugin with different info..
-                jassert (types.getUnchecked(i)->name == type.name);
-                jassert (types.getUnchecked(i)->isInstrument == type.isInstrument);
+                PluginDescription* const existing = group->getUnchecked (i);
+
+                if (existing->isDuplicateOf (type))
+                {
+                    // strange - found a duplicate plugin with different info..
+                    jassert (existing->name == type.name);
+                    jassert (existing->isInstrument == type.isInstrument);
 
-                *types.getUnchecked(i) = type;
-                return false;
+                    *existing = type;
+                    return false;
+                }
             }
         }
 
-        types.insert (0, new PluginDescription (type));
+        PluginDescription* const newType = new PluginDescription (type);
+        types.insert (0, newType);
+        getTypeIndex().addTypeAtStart (newType);
     }
 
     sendChangeMessage();
@@ -88,7 +306,11 @@ void KnownPluginList::removeType (const int index)
     {
         ScopedLock lock (typesArrayLock);
 
+        if (const PluginDescription* const type = types [index])
+            addToCacheJournal (KnownPluginListCacheHelpers::typeRemoved, nullptr, type->createIdentifierString());
+
         types.remove (index);
+        typesChanged();
     }
 
     sendChangeMessage();
@@ -97,19 +319,16 @@ void KnownPluginList::removeType (const int index)
 bool KnownPluginList::isListingUpToDate (const String& fileOrIdentifier,
                                          AudioPluginFormat& formatToUse) const
 {
-    if (getTypeForFile (fileOrIdentifier) == nullptr)
-        return false;
-
     ScopedLock lock (typesArrayLock);
 
-    for (int i = types.size(); --i >= 0;)
-    {
-        const PluginDescription* const d = types.getUnchecked(i);
+    const Array<PluginDescription*>* const group = getTypeIndex().getTypesForFile (fileOrIdentifier);
 
-        if (d->fileOrIdentifier == fileOrIdentifier
-             && formatToUse.pluginNeedsRescanning (*d))
+    if (group == nullptr || group->size() == 0)
+        return false;
+
+    for (int i = group->size(); --i >= 0;)
+        if (formatToUse.pluginNeedsRescanning (*group->getUnchecked(i)))
             return false;
-    }
 
     return true;
 }
@@ -133,16 +352,19 @@ bool KnownPluginList::scanAndAddFile (const String& fileOrIdentifier,
 
         ScopedLock lock (typesArrayLock);
 
-        for (int i = types.size(); --i >= 0;)
+        if (const Array<PluginDescription*>* const typesForFile = getTypeIndex().getTypesForFile (fileOrIdentifier))
         {
-            const PluginDescription* const d = types.getUnchecked(i);
-
-            if (d->fileOrIdentifier == fileOrIdentifier && d->pluginFormatName == format.getName())
+            for (int i = typesForFile->size(); --i >= 0;)
             {
-                if (format.pluginNeedsRescanning (*d))
-                    needsRescanning = true;
-                else
-                    typesFound.add (new PluginDescription (*d));
+                const PluginDescription* const d = typesForFile->getUnchecked(i);
+
+                if (d->pluginFormatName == format.getName())
+                {
+                    if (format.pluginNeedsRescanning (*d))
+                        needsRescanning = true;
+                    else
+                        typesFound.add (new PluginDescription (*d));
+                }
             }
         }
 
@@ -242,6 +464,7 @@ void KnownPluginList::addToBlacklist (const String& pluginID)
     if (! blacklist.contains (pluginID))
     {
         blacklist.add (pluginID);
+        addToCacheJournal (KnownPluginListCacheHelpers::blacklistAdded, nullptr, pluginID);
         sendChangeMessage();
     }
 }
@@ -253,6 +476,7 @@ void KnownPluginList::removeFromBlacklist (const String& pluginID)
     if (index >= 0)
     {
         blacklist.remove (index);
+        addToCacheJournal (KnownPluginListCacheHelpers::blacklistRemoved, nullptr, pluginID);
         sendChangeMessage();
     }
 }
@@ -262,6 +486,7 @@ void KnownPluginList::clearBlacklistedFiles()
     if (blacklist.size() > 0)
     {
         blacklist.clear();
+        addToCacheJournal (KnownPluginListCacheHelpers::blacklistCleared, nullptr, String());
         sendChangeMessage();
     }
 }
@@ -328,6 +553,12 @@ void KnownPluginList::sort (const SortMethod method, bool forwards)
             types.sort (sorter, true);
 
             newOrder.addArray (types);
+
+            if (oldOrder != newOrder)
+            {
+                typesChanged();
+                addToCacheJournal (KnownPluginListCacheHelpers::needsRewriting, nullptr, String());
+            }
         }
 
         if (oldOrder != newOrder)
@@ -372,6 +603,174 @@ void KnownPluginList::recreateFromXml (const XmlElement& xml)
     }
 }
 
+//==============================================================================
+bool KnownPluginList::saveToBinaryCache (const File& cacheFile)
+{
+    using namespace KnownPluginListCacheHelpers;
+
+    ScopedLock lock (typesArrayLock);
+
+    MemoryOutputStream snapshot;
+    snapshot.writeInt (types.size());
+
+    for (int i = 0; i < types.size(); ++i)
+        writeDescription (snapshot, *types.getUnchecked(i));
+
+    snapshot.writeInt (blacklist.size());
+
+    for (int i = 0; i < blacklist.size(); ++i)
+        snapshot.writeString (blacklist[i]);
+
+    MemoryOutputStream out (snapshot.getDataSize() + 16);
+    out.writeInt (cacheMagicNumber);
+    out.writeInt (cacheVersion);
+    writeChunk (out, snapshotChunk, snapshot);
+
+    if (! cacheFile.replaceWithData (out.getData(), out.getDataSize()))
+        return false;
+
+    cacheJournal = new CacheJournal (cacheFile, (int64) out.getDataSize());
+    return true;
+}
+
+bool KnownPluginList::loadFromBinaryCache (const File& cacheFile)
+{
+    using namespace KnownPluginListCacheHelpers;
+
+    const MemoryMappedFile mappedFile (cacheFile, MemoryMappedFile::readOnly);
+
+    if (mappedFile.getData() == nullptr)
+        return false;
+
+    MemoryInputStream in (mappedFile.getData(), mappedFile.getSize(), false);
+
+    if (in.getNumBytesRemaining() < 8
+         || in.readInt() != cacheMagicNumber
+         || in.readInt() != cacheVersion)
+        return false;
+
+    int chunkType, chunkSize;
+    const void* chunkData;
+
+    if (! readChunk (in, chunkType, chunkData, chunkSize) || chunkType != snapshotChunk)
+        return false;
+
+    const int64 snapshotSize = in.getPosition();
+
+    OwnedArray<PluginDescription> newTypes;
+    StringArray newBlacklist;
+
+    {
+        MemoryInputStream snapshot (chunkData, (size_t) chunkSize, false);
+        const int numTypes = snapshot.readInt();
+
+        if (numTypes < 0)
+            return false;
+
+        newTypes.ensureStorageAllocated (numTypes);
+
+        for (int i = 0; i < numTypes && ! snapshot.isExhausted(); ++i)
+            readDescription (snapshot, *newTypes.add (new PluginDescription()));
+
+        for (int i = snapshot.readInt(); --i >= 0 && ! snapshot.isExhausted();)
+            newBlacklist.add (snapshot.readString());
+    }
+
+    {
+        ScopedLock lock (typesArrayLock);
+
+        cacheJournal = nullptr;
+        types.swapWith (newTypes);
+        blacklist.swapWith (newBlacklist);
+        typesChanged();
+    }
+
+    // now replay any changes that were appended after the snapshot was written
+    int64 endOfLastChunk = in.getPosition();
+
+    while (readChunk (in, chunkType, chunkData, chunkSize))
+    {
+        endOfLastChunk = in.getPosition();
+
+        if (chunkType != changesChunk)
+            continue;
+
+        MemoryInputStream changes (chunkData, (size_t) chunkSize, false);
+
+        while (! changes.isExhausted())
+        {
+            const int change = changes.readByte();
+
+            if (change == typeAdded)
+            {
+                PluginDescription type;
+                readDescription (changes, type);
+                addType (type);
+            }
+            else if (change == typeRemoved)
+            {
+                ScopedLock lock (typesArrayLock);
+
+                if (PluginDescription* const type = getTypeForIdentifierString (changes.readString()))
+                    removeType (types.indexOf (type));
+            }
+            else if (change == blacklistAdded)      addToBlacklist (changes.readString());
+            else if (change == blacklistRemoved)    removeFromBlacklist (changes.readString());
+            else if (change == blacklistCleared)    clearBlacklistedFiles();
+            else break;
+        }
+    }
+
+    {
+        ScopedLock lock (typesArrayLock);
+        cacheJournal = new CacheJournal (cacheFile, snapshotSize);
+
+        // Any bytes after the last complete chunk are the start of one that was never
+        // finished, and its size would swallow a chunk that got appended after it.
+        cacheJournal->needsFullWrite = endOfLastChunk < (int64) mappedFile.getSize();
+    }
+
+    sendChangeMessage();
+    return true;
+}
+
+bool KnownPluginList::updateBinaryCache (const File& cacheFile)
+{
+    using namespace KnownPluginListCacheHelpers;
+
+    {
+        ScopedLock lock (typesArrayLock);
+
+        // once the appended changes get bigger than the snapshot itself,
+        // it's quicker to load a fresh snapshot
+        if (cacheJournal != nullptr
+             && cacheJournal->file == cacheFile
+             && ! cacheJournal->needsFullWrite
+             && cacheFile.existsAsFile()
+             && cacheFile.getSize() < cacheJournal->snapshotSize * 2 + 65536)
+        {
+            if (cacheJournal->changes.getDataSize() == 0)
+                return true;
+
+            FileOutputStream out (cacheFile);
+
+            if (out.openedOk())
+            {
+                writeChunk (out, changesChunk, cacheJournal->changes);
+                out.flush();
+
+                if (out.getStatus().wasOk())
+                {
+                    cacheJournal->changes.reset();
+                    return true;
+                }
+            }
+        }
+    }
+
+    return saveToBinaryCache (cacheFile);
+}
+
 //==============================================================================
 struct PluginTreeUtils
 {
@@ -598,3 +997,237 @@ bool KnownPluginList::CustomScanner::shouldExit() const noexcept
 
     return false;
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class KnownPluginListTests  : public UnitTest
+{
+public:
+    KnownPluginListTests() : UnitTest ("KnownPluginList") {}
+
+    void runTest() override
+    {
+        const File cacheFile (File::getSpecialLocation (File::tempDirectory)
+                                .getNonexistentChildFile ("KnownPluginListTest", ".cache", false));
+
+        beginTest ("Hashed lookups");
+        {
+            KnownPluginList list;
+            fillList (list, 200);
+
+            for (int i = 0; i < list.getNumTypes(); ++i)
+            {
+                const PluginDescription* const type = list.getType (i);
+
+                expect (list.getTypeForIdentifierString (type->createIdentifierString()) == type);
+                expect (list.getTypeForUID (type->uid) == type);
+                expect (list.getTypeForFile (type->fileOrIdentifier)->fileOrIdentifier == type->fileOrIdentifier);
+            }
+
+            expect (list.getTypeForFile ("nonexistent") == nullptr);
+            expect (list.getTypeForUID (-1) == nullptr);
+            expect (list.getTypeForIdentifierString ("VST-Plugin 1-0-0") == nullptr);
+
+            const PluginDescription removed (*list.getType (10));
+            list.removeType (10);
+            expect (list.getTypeForIdentifierString (removed.createIdentifierString()) == nullptr);
+            expect (list.getTypeForUID (removed.uid) == nullptr);
+
+            list.sort (KnownPluginList::sortAlphabetically, true);
+            expect (list.getTypeForFile (list.getType (0)->fileOrIdentifier) == list.getType (0));
+
+            PluginDescription changed (*list.getType (5));
+            changed.version = "2.0";
+            expect (! list.addType (changed));
+            expectEquals (list.getTypeForUID (changed.uid)->version, String ("2.0"));
+        }
+
+        beginTest ("Binary cache round trip");
+        {
+            KnownPluginList list, loaded;
+            fillList (list, 100);
+            list.addToBlacklist ("/plugins/crashed.so");
+
+            expect (list.saveToBinaryCache (cacheFile));
+            expect (loaded.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (loaded), toString (list));
+        }
+
+        beginTest ("Incremental cache updates");
+        {
+            KnownPluginList list;
+            fillList (list, 100);
+            expect (list.saveToBinaryCache (cacheFile));
+            const int64 snapshotSize = cacheFile.getSize();
+
+            list.addType (createType (1000, 0));
+            list.removeType (20);
+            list.addToBlacklist ("/plugins/a.so");
+            list.addToBlacklist ("/plugins/b.so");
+            list.removeFromBlacklist ("/plugins/a.so");
+
+            expect (list.updateBinaryCache (cacheFile));
+            expect (cacheFile.getSize() > snapshotSize && cacheFile.getSize() < snapshotSize + 1000);
+
+            KnownPluginList loaded;
+            expect (loaded.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (loaded), toString (list));
+
+            // changes can keep being appended to a list that was loaded from the cache
+            loaded.removeType (0);
+            expect (loaded.updateBinaryCache (cacheFile));
+
+            KnownPluginList reloaded;
+            expect (reloaded.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (reloaded), toString (loaded));
+
+            // sorting means the whole thing gets rewritten
+            reloaded.sort (KnownPluginList::sortByManufacturer, false);
+            expect (reloaded.updateBinaryCache (cacheFile));
+
+            KnownPluginList sorted;
+            expect (sorted.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (sorted), toString (reloaded));
+        }
+
+        beginTest ("Damaged cache files");
+        {
+            KnownPluginList list;
+            fillList (list, 10);
+            expect (list.saveToBinaryCache (cacheFile));
+
+            {
+                // a change chunk that was cut off part-way through
+                FileOutputStream out (cacheFile);
+                out.writeInt (2);
+                out.writeInt (1000);
+                out.writeString ("abc");
+            }
+
+            KnownPluginList loaded;
+            expect (loaded.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (loaded), toString (list));
+
+            // changes made after loading it mustn't get lost behind the damaged chunk
+            loaded.addType (createType (1000, 0));
+            loaded.addToBlacklist ("/plugins/a.so");
+            expect (loaded.updateBinaryCache (cacheFile));
+
+            KnownPluginList reloaded;
+            expect (reloaded.loadFromBinaryCache (cacheFile));
+            expectEquals (toString (reloaded), toString (loaded));
+            expectEquals (reloaded.getNumTypes(), 11);
+
+            cacheFile.replaceWithText ("not a cache");
+            expect (! loaded.loadFromBinaryCache (cacheFile));
+            expectEquals (loaded.getNumTypes(), 11);
+        }
+
+        beginTest ("Startup benchmark with 5000 plugins");
+        {
+            const int numTypes = 5000;
+            KnownPluginList list;
+            fillList (list, numTypes);
+
+            ScopedPointer<XmlElement> xml (list.createXml());
+            const String xmlText (xml->createDocument (String()));
+            xml = nullptr;
+
+            expect (list.saveToBinaryCache (cacheFile));
+
+            double start = Time::getMillisecondCounterHiRes();
+
+            {
+                KnownPluginList fromXml;
+                ScopedPointer<XmlElement> parsed (XmlDocument::parse (xmlText));
+                fromXml.recreateFromXml (*parsed);
+                expectEquals (fromXml.getNumTypes(), numTypes);
+            }
+
+            const double xmlTime = Time::getMillisecondCounterHiRes() - start;
+            start = Time::getMillisecondCounterHiRes();
+
+            KnownPluginList fromCache;
+            expect (fromCache.loadFromBinaryCache (cacheFile));
+            expectEquals (fromCache.getNumTypes(), numTypes);
+
+            const double cacheTime = Time::getMillisecondCounterHiRes() - start;
+
+            StringArray identifiers;
+
+            for (int i = 0; i < numTypes; ++i)
+                identifiers.add (fromCache.getType (i)->createIdentifierString());
+
+            start = Time::getMillisecondCounterHiRes();
+            int numFound = 0;
+
+            for (int i = 0; i < numTypes; ++i)
+                if (fromCache.getTypeForIdentifierString (identifiers[i]) != nullptr)
+                    ++numFound;
+
+            const double indexedTime = Time::getMillisecondCounterHiRes() - start;
+            start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numTypes; ++i)
+                for (int j = 0; j < fromCache.getNumTypes(); ++j)
+                    if (fromCache.getType (j)->matchesIdentifierString (identifiers[i]))
+                        break;
+
+            const double linearTime = Time::getMillisecondCounterHiRes() - start;
+
+            expectEquals (numFound, numTypes);
+
+            logMessage ("Loading " + String (numTypes) + " types: XML " + String (xmlTime, 1)
+                          + " ms (" + String (xmlText.getNumBytesAsUTF8() / 1024) + " KB), binary cache "
+                          + String (cacheTime, 1) + " ms (" + String (cacheFile.getSize() / 1024) + " KB)");
+            logMessage ("Looking up every type by identifier: hashed " + String (indexedTime, 2)
+                          + " ms, linear search " + String (linearTime, 1) + " ms");
+        }
+
+        cacheFile.deleteFile();
+    }
+
+private:
+    static PluginDescription createType (int index, int subType)
+    {
+        PluginDescription d;
+        d.name = "Plugin " + String (index) + (subType > 0 ? " " + String (subType) : String());
+        d.descriptiveName = d.name;
+        d.pluginFormatName = "VST";
+        d.category = index % 3 == 0 ? "Synth" : "Effect";
+        d.manufacturerName = "Manufacturer " + String (index % 17);
+        d.version = "1.0." + String (index);
+        d.fileOrIdentifier = "/plugins/Plugin " + String (index) + ".so";
+        d.lastFileModTime = Time (1000000 + index);
+        d.lastInfoUpdateTime = Time (2000000 + index);
+        d.uid = index * 7919 + subType + 1;
+        d.isInstrument = index % 3 == 0;
+        d.numInputChannels = 2;
+        d.numOutputChannels = 2;
+        d.hasSharedContainer = subType > 0;
+        return d;
+    }
+
+    static void fillList (KnownPluginList& list, int numTypes)
+    {
+        // every tenth file is a shell containing two types
+        for (int i = 0; list.getNumTypes() < numTypes; ++i)
+        {
+            list.addType (createType (i, i % 10 == 0 ? 1 : 0));
+
+            if (i % 10 == 0 && list.getNumTypes() < numTypes)
+                list.addType (createType (i, 2));
+        }
+    }
+
+    static String toString (const KnownPluginList& list)
+    {
+        ScopedPointer<XmlElement> xml (list.createXml());
+        return xml->createDocument (String());
+    }
+};
+
+static KnownPluginListTests knownPluginListTests;
+
+#endif
@@ -33,6 +33,11 @@
     This can be easily edited, saved and loaded, and used to create instances of
     the plugin types in it.
 
+    Lookups by file, identifier string or UID use hash tables that are built when
+    first needed, so they stay fast with thousands of types in the list. For a quick
+    startup, the list can be kept in a binary cache file rather than as XML - see
+    saveToBinaryCache().
+
     @see PluginListComponent
 */
 class JUCE_API  KnownPluginList   : public ChangeBroadcaster
@@ -74,6 +79,11 @@ public:
     */
     PluginDescription* getTypeForIdentifierString (const String& identifierString) const;
 
+    /** Looks for a type in the list with the given unique ID.
+        If more than one type has this ID, the first one in the list is returned.
+    */
+    PluginDescription* getTypeForUID (int uid) const;
+
     /** Adds a type manually from its description. */
     bool addType (const PluginDescription& type);
 
@@ -168,6 +178,41 @@ public:
     /** Recreates the state of this list from its stored XML format. */
     void recreateFromXml (const XmlElement& xml);
 
+    //==============================================================================
+    /** Writes the types and blacklist to a binary cache file.
+
+        The binary format is much quicker to load than XML. Once a list has been saved
+        to (or loaded from) a cache file, it keeps a record of the changes that are made
+        to it, so that updateBinaryCache() can append them to the file rather than
+        rewriting the whole thing.
+
+        Returns true if the file was written successfully.
+    */
+    bool saveToBinaryCache (const File& cacheFile);
+
+    /** Replaces the contents of this list with those of a binary cache file.
+
+        The file is memory-mapped while it's read, and any changes that have been
+        appended to it by updateBinaryCache() are applied in order. If the end of the
+        file is incomplete (e.g. because the app crashed while it was being written),
+        everything up to that point is still loaded, and the next call to
+        updateBinaryCache() will rewrite the whole file.
+
+        Returns false, leaving the list untouched, if the file isn't a valid cache.
+    */
+    bool loadFromBinaryCache (const File& cacheFile);
+
+    /** Brings a binary cache file up to date with this list.
+
+        If the list was last saved to or loaded from this file, just the changes
+        made since then are appended to it. Otherwise - or after the list has been
+        cleared or sorted, or if the file has grown too large - the whole file is
+        rewritten with saveToBinaryCache().
+
+        Returns true if the file was written successfully.
+    */
+    bool updateBinaryCache (const File& cacheFile);
+
     //==============================================================================
     /** A structure that recursively holds a tree of plugins.
         @see KnownPluginList::createTree()
@@ -218,6 +263,17 @@ private:
     ScopedPointer<CustomScanner> scanner;
     CriticalSection scanLock, typesArrayLock;
 
+    struct TypeIndex;
+    struct CacheJournal;
+    friend struct ContainerDeletePolicy<TypeIndex>;
+    friend struct ContainerDeletePolicy<CacheJournal>;
+    mutable ScopedPointer<TypeIndex> typeIndex;
+    ScopedPointer<CacheJournal> cacheJournal;
+
+    TypeIndex& getTypeIndex() const;
+    void typesChanged();
+    void addToCacheJournal (int change, const PluginDescription*, const String&);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KnownPluginList)
 };
 
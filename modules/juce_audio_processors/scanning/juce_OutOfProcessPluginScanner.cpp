@@ -0,0 +1,865 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+namespace PluginScannerHelpers
+{
+    static void addToHash (uint64& hash, const void* data, size_t numBytes) noexcept
+    {
+        const uint8* d = static_cast<const uint8*> (data);
+
+        for (size_t i = 0; i < numBytes; ++i)
+            hash = (hash ^ d[i]) * (uint64) 0x100000001b3LL;
+    }
+
+    static void addFileToHash (uint64& hash, const File& file)
+    {
+        enum { bytesToSample = 65536 };
+
+        const int64 size = file.getSize();
+        addToHash (hash, &size, sizeof (size));
+
+        FileInputStream in (file);
+
+        if (in.openedOk())
+        {
+            HeapBlock<char> buffer (bytesToSample);
+
+            addToHash (hash, buffer, (size_t) in.read (buffer, bytesToSample));
+
+            if (size > bytesToSample && in.setPosition (jmax ((int64) bytesToSample, size - bytesToSample)))
+                addToHash (hash, buffer, (size_t) in.read (buffer, bytesToSample));
+        }
+    }
+
+    static MemoryBlock xmlToMemoryBlock (const XmlElement& xml)
+    {
+        const String s (xml.createDocument (String(), true, false));
+        return MemoryBlock (s.toRawUTF8(), s.getNumBytesAsUTF8());
+    }
+
+    static File getFileFromIdentifier (const String& fileOrIdentifier)
+    {
+        return File::isAbsolutePath (fileOrIdentifier) ? File (fileOrIdentifier) : File();
+    }
+
+    static String getJobKey (const String& formatName, const String& fileOrIdentifier)
+    {
+        return formatName + "\n" + fileOrIdentifier;
+    }
+}
+
+//==============================================================================
+struct OutOfProcessPluginScanner::WorkerProcess  : public ChildProcessMaster
+{
+    WorkerProcess (OutOfProcessPluginScanner& o)
+        : owner (o), busy (false), isReady (false), hasResult (false), jobStartTime (0)
+    {
+    }
+
+    bool launch()
+    {
+        // On some platforms a process can be started even if its executable isn't valid, so
+        // we wait for the worker to say that it's ready before giving it anything to scan.
+        const int launchTimeoutMs = jmin (owner.timeoutMs, 10000);
+
+        return owner.executable.existsAsFile()
+                 && launchSlaveProcess (owner.executable, owner.commandLineID, launchTimeoutMs)
+                 && readyEvent.wait (launchTimeoutMs);
+    }
+
+    bool startJob (const Job& job)
+    {
+        XmlElement request ("SCAN");
+        request.setAttribute ("format", job.formatName);
+        request.setAttribute ("file", job.fileOrIdentifier);
+        request.setAttribute ("timeout", owner.timeoutMs);
+
+        {
+            const ScopedLock sl (resultLock);
+            hasResult = false;
+        }
+
+        currentJob = job;
+        busy = true;
+        jobStartTime = Time::getMillisecondCounter();
+
+        return sendMessageToSlave (PluginScannerHelpers::xmlToMemoryBlock (request));
+    }
+
+    bool takeResult (MemoryBlock& dest)
+    {
+        const ScopedLock sl (resultLock);
+
+        if (! hasResult)
+            return false;
+
+        dest.swapWith (result);
+        hasResult = false;
+        return true;
+    }
+
+    bool hasTimedOut() const noexcept
+    {
+        // the worker should kill itself when it reaches the timeout, so allow it
+        // a little longer than that before giving up on it
+        return Time::getMillisecondCounter() - jobStartTime > (uint32) owner.timeoutMs + 2000;
+    }
+
+    void handleMessageFromSlave (const MemoryBlock& mb) override
+    {
+        if (! isReady)
+        {
+            isReady = true;
+            readyEvent.signal();
+            return;
+        }
+
+        {
+            const ScopedLock sl (resultLock);
+            result = mb;
+            hasResult = true;
+        }
+
+        owner.notify();
+    }
+
+    void handleConnectionLost() override
+    {
+        connectionLost = 1;
+        owner.notify();
+    }
+
+    OutOfProcessPluginScanner& owner;
+    Job currentJob;
+    bool busy;
+    Atomic<int> connectionLost;
+
+private:
+    WaitableEvent readyEvent;
+    bool isReady;
+    CriticalSection resultLock;
+    MemoryBlock result;
+    bool hasResult;
+    uint32 jobStartTime;
+
+    JUCE_DECLARE_NON_COPYABLE (WorkerProcess)
+};
+
+//==============================================================================
+OutOfProcessPluginScanner::OutOfProcessPluginScanner (KnownPluginList& listToAddResultsTo,
+                                                      const File& workerExecutable,
+                                                      const String& commandLineUniqueID,
+                                                      const int numWorkersToUse,
+                                                      const int perPluginTimeoutMs)
+    : Thread ("Plugin scanner"),
+      list (listToAddResultsTo),
+      executable (workerExecutable),
+      commandLineID (commandLineUniqueID),
+      numWorkers (jmax (1, numWorkersToUse)),
+      timeoutMs (jmax (1, perPluginTimeoutMs)),
+      numJobsStarted (0),
+      numJobsFinished (0),
+      finishedEvent (true)
+{
+}
+
+OutOfProcessPluginScanner::~OutOfProcessPluginScanner()
+{
+    stopScanning();
+    saveScanState();
+}
+
+//==============================================================================
+void OutOfProcessPluginScanner::setScanStateFile (const File& file)
+{
+    const ScopedLock sl (lock);
+
+    scanStateFile = file;
+    scanState.clear();
+
+    ScopedPointer<XmlElement> xml (XmlDocument::parse (file));
+
+    if (xml != nullptr && xml->hasTagName ("PLUGINSCANSTATE"))
+    {
+        forEachXmlChildElementWithTagName (*xml, e, "FILE")
+        {
+            ScanRecord record;
+            record.formatName = e->getStringAttribute ("format");
+            record.fileTime   = e->getStringAttribute ("time").getHexValue64();
+            record.hash       = e->getStringAttribute ("hash").getHexValue64();
+
+            scanState.set (e->getStringAttribute ("id"), record);
+        }
+    }
+}
+
+void OutOfProcessPluginScanner::saveScanState()
+{
+    const ScopedLock sl (lock);
+
+    if (scanStateFile == File())
+        return;
+
+    XmlElement xml ("PLUGINSCANSTATE");
+
+    for (HashMap<String, ScanRecord>::Iterator i (scanState); i.next();)
+    {
+        const ScanRecord record (i.getValue());
+
+        XmlElement* const e = xml.createNewChildElement ("FILE");
+        e->setAttribute ("id", i.getKey());
+        e->setAttribute ("format", record.formatName);
+        e->setAttribute ("time", String::toHexString (record.fileTime));
+        e->setAttribute ("hash", String::toHexString (record.hash));
+    }
+
+    xml.writeToFile (scanStateFile, String());
+}
+
+void OutOfProcessPluginScanner::recordScan (const Job& job)
+{
+    const File file (PluginScannerHelpers::getFileFromIdentifier (job.fileOrIdentifier));
+
+    if (file.exists())
+    {
+        ScanRecord record;
+        record.formatName = job.formatName;
+        record.fileTime   = file.getLastModificationTime().toMilliseconds();
+        record.hash       = calculateFileHash (file);
+
+        const ScopedLock sl (lock);
+        scanState.set (job.fileOrIdentifier, record);
+    }
+}
+
+bool OutOfProcessPluginScanner::isUnchanged (AudioPluginFormat& format, const String& fileOrIdentifier)
+{
+    const File file (PluginScannerHelpers::getFileFromIdentifier (fileOrIdentifier));
+
+    if (file.exists())
+    {
+        ScanRecord record;
+        bool hasRecord;
+
+        {
+            const ScopedLock sl (lock);
+            hasRecord = scanState.contains (fileOrIdentifier);
+
+            if (hasRecord)
+                record = scanState [fileOrIdentifier];
+        }
+
+        if (hasRecord && record.formatName == format.getName())
+        {
+            const int64 fileTime = file.getLastModificationTime().toMilliseconds();
+
+            if (fileTime == record.fileTime)
+                return true;
+
+            // hashing reads the file, so it's done without holding the lock
+            if (calculateFileHash (file) != record.hash)
+                return false;
+
+            // the file has been touched, but its contents are the same
+            record.fileTime = fileTime;
+
+            const ScopedLock sl (lock);
+            scanState.set (fileOrIdentifier, record);
+            return true;
+        }
+    }
+
+    return list.isListingUpToDate (fileOrIdentifier, format);
+}
+
+int64 OutOfProcessPluginScanner::calculateFileHash (const File& fileOrBundle)
+{
+    uint64 hash = (uint64) 0xcbf29ce484222325LL;
+
+    if (fileOrBundle.isDirectory())
+    {
+        Array<File> files;
+        fileOrBundle.findChildFiles (files, File::findFiles, true);
+        files.sort();
+
+        for (int i = 0; i < files.size(); ++i)
+        {
+            const String path (files.getReference(i).getRelativePathFrom (fileOrBundle));
+            PluginScannerHelpers::addToHash (hash, path.toRawUTF8(), path.getNumBytesAsUTF8());
+            PluginScannerHelpers::addFileToHash (hash, files.getReference(i));
+        }
+    }
+    else
+    {
+        PluginScannerHelpers::addFileToHash (hash, fileOrBundle);
+    }
+
+    return (int64) hash;
+}
+
+//==============================================================================
+int OutOfProcessPluginScanner::addFilesToScan (AudioPluginFormat& format,
+                                               const FileSearchPath& directoriesToSearch,
+                                               const bool searchRecursively,
+                                               const bool onlyChangedFiles)
+{
+    FileSearchPath directories (directoriesToSearch);
+    directories.removeRedundantPaths();
+
+    const StringArray files (format.searchPathsForPlugins (directories, searchRecursively));
+    int numAdded = 0;
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        const String& file = files[i];
+
+        if (list.getBlacklistedFiles().contains (file)
+             || (onlyChangedFiles && isUnchanged (format, file)))
+            continue;
+
+        addFileToScan (format.getName(), file);
+        ++numAdded;
+    }
+
+    return numAdded;
+}
+
+void OutOfProcessPluginScanner::addFileToScan (const String& formatName, const String& fileOrIdentifier)
+{
+    Job job;
+    job.formatName = formatName;
+    job.fileOrIdentifier = fileOrIdentifier;
+
+    const ScopedLock sl (lock);
+
+    if (! queuedJobs.contains (PluginScannerHelpers::getJobKey (formatName, fileOrIdentifier)))
+        queueJob (job, false);
+}
+
+void OutOfProcessPluginScanner::queueJob (const Job& job, const bool atFront)
+{
+    // the caller must hold the lock
+    queuedJobs.set (PluginScannerHelpers::getJobKey (job.formatName, job.fileOrIdentifier), true);
+    jobs.insert (atFront ? 0 : -1, job);
+}
+
+bool OutOfProcessPluginScanner::takeNextJob (Job& job)
+{
+    const ScopedLock sl (lock);
+
+    if (jobs.size() == 0)
+        return false;
+
+    job = jobs.getReference (0);
+    jobs.remove (0);
+    queuedJobs.remove (PluginScannerHelpers::getJobKey (job.formatName, job.fileOrIdentifier));
+    ++numJobsStarted;
+    return true;
+}
+
+//==============================================================================
+void OutOfProcessPluginScanner::startScanning()
+{
+    if (isThreadRunning())
+        return;
+
+    {
+        const ScopedLock sl (lock);
+        numJobsStarted = numJobsFinished = 0;
+        failedFiles.clear();
+        launchError.clear();
+    }
+
+    finishedEvent.reset();
+    startThread();
+}
+
+void OutOfProcessPluginScanner::stopScanning()
+{
+    stopThread (10000);
+}
+
+bool OutOfProcessPluginScanner::isScanning() const
+{
+    return isThreadRunning();
+}
+
+bool OutOfProcessPluginScanner::waitForCompletion (const int timeout)
+{
+    return ! isThreadRunning() || finishedEvent.wait (timeout);
+}
+
+float OutOfProcessPluginScanner::getProgress() const
+{
+    const ScopedLock sl (lock);
+    const int total = numJobsStarted + jobs.size();
+
+    return total > 0 ? numJobsFinished / (float) total : 1.0f;
+}
+
+int OutOfProcessPluginScanner::getNumFilesRemaining() const
+{
+    const ScopedLock sl (lock);
+    return jobs.size() + numJobsStarted - numJobsFinished;
+}
+
+StringArray OutOfProcessPluginScanner::getFailedFiles() const
+{
+    const ScopedLock sl (lock);
+    return failedFiles;
+}
+
+String OutOfProcessPluginScanner::getLaunchError() const
+{
+    const ScopedLock sl (lock);
+    return launchError;
+}
+
+//==============================================================================
+void OutOfProcessPluginScanner::run()
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        ScopedPointer<WorkerProcess> worker (new WorkerProcess (*this));
+
+        if (worker->launch())
+            workers.add (worker.release());
+    }
+
+    while (! threadShouldExit() && workers.size() > 0)
+    {
+        bool anyBusy = false;
+
+        for (int i = workers.size(); --i >= 0;)
+            if (serviceWorker (i))
+                anyBusy = true;
+
+        if (! anyBusy)
+            break;
+
+        wait (100);
+    }
+
+    // if the executable couldn't be launched (or relaunched), the files just stay queued
+    if (workers.size() == 0 && ! threadShouldExit())
+    {
+        const ScopedLock sl (lock);
+        launchError = (executable.existsAsFile() ? "Couldn't launch the plugin scanner worker: "
+                                                 : "The plugin scanner worker doesn't exist: ")
+                        + executable.getFullPathName();
+    }
+
+    // put back any files that were still being scanned, so that they'll be tried again
+    for (int i = workers.size(); --i >= 0;)
+    {
+        if (workers.getUnchecked(i)->busy)
+        {
+            const ScopedLock sl (lock);
+            queueJob (workers.getUnchecked(i)->currentJob, true);
+            --numJobsStarted;
+        }
+    }
+
+    workers.clear();
+    saveScanState();
+    finishedEvent.signal();
+}
+
+bool OutOfProcessPluginScanner::serviceWorker (const int index)
+{
+    WorkerProcess* worker = workers.getUnchecked (index);
+
+    if (worker->busy)
+    {
+        MemoryBlock result;
+
+        if (worker->takeResult (result))
+        {
+            worker->busy = false;
+            handleResult (worker->currentJob, result);
+        }
+        else if (worker->connectionLost.get() != 0 || worker->hasTimedOut())
+        {
+            worker->busy = false;
+            handleFailure (worker->currentJob, worker->connectionLost.get() != 0 ? "crashed" : "timed out");
+            worker->connectionLost = 1;
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    if (worker->connectionLost.get() != 0)
+    {
+        workers.set (index, worker = new WorkerProcess (*this));
+
+        if (! worker->launch())
+        {
+            workers.remove (index);
+            return false;
+        }
+    }
+
+    Job job;
+
+    if (! takeNextJob (job))
+        return false;
+
+    if (! worker->startJob (job))
+    {
+        // couldn't talk to the worker, so put the job back and get a new worker next time
+        worker->busy = false;
+        worker->connectionLost = 1;
+
+        const ScopedLock sl (lock);
+        queueJob (job, true);
+        --numJobsStarted;
+    }
+
+    return true;
+}
+
+void OutOfProcessPluginScanner::handleResult (const Job& job, const MemoryBlock& result)
+{
+    ScopedPointer<XmlElement> xml (XmlDocument::parse (result.toString()));
+
+    if (xml != nullptr && xml->hasTagName ("RESULT"))
+    {
+        forEachXmlChildElement (*xml, e)
+        {
+            PluginDescription desc;
+
+            if (desc.loadFromXml (*e))
+                list.addType (desc);
+        }
+    }
+
+    recordScan (job);
+
+    const ScopedLock sl (lock);
+    ++numJobsFinished;
+}
+
+void OutOfProcessPluginScanner::handleFailure (const Job& job, const String& reason)
+{
+    DBG ("Plugin scan " << reason << ": " << job.fileOrIdentifier);
+    ignoreUnused (reason);
+
+    list.addToBlacklist (job.fileOrIdentifier);
+
+    const ScopedLock sl (lock);
+    ++numJobsFinished;
+    failedFiles.add (job.fileOrIdentifier);
+}
+
+//==============================================================================
+struct OutOfProcessPluginScanner::Worker::ScanMessage  : public CallbackMessage
+{
+    ScanMessage (Worker& w, const String& r)  : worker (&w), request (r) {}
+
+    void messageCallback() override
+    {
+        if (Worker* const w = worker)
+            w->performScan (request);
+    }
+
+    WeakReference<Worker> worker;
+    const String request;
+};
+
+// Terminates the worker process if a plugin takes too long to scan, since a plugin
+// that hangs the message thread can't be interrupted in any other way.
+struct OutOfProcessPluginScanner::Worker::Watchdog  : public Thread
+{
+    Watchdog (int timeout)  : Thread ("Plugin scan watchdog"), timeoutMs (timeout)
+    {
+        startThread();
+    }
+
+    ~Watchdog()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (1000);
+    }
+
+    void run() override
+    {
+        if (! wait (timeoutMs))
+            Process::terminate();
+    }
+
+    const int timeoutMs;
+};
+
+OutOfProcessPluginScanner::Worker::Worker (AudioPluginFormatManager& fm)  : formatManager (fm) {}
+OutOfProcessPluginScanner::Worker::~Worker()
+{
+    masterReference.clear();
+}
+
+void OutOfProcessPluginScanner::Worker::handleMessageFromMaster (const MemoryBlock& mb)
+{
+    // plugins expect to be loaded on the message thread
+    (new ScanMessage (*this, mb.toString()))->post();
+}
+
+void OutOfProcessPluginScanner::Worker::handleConnectionMade()
+{
+    sendMessageToMaster (PluginScannerHelpers::xmlToMemoryBlock (XmlElement ("READY")));
+}
+
+void OutOfProcessPluginScanner::Worker::handleConnectionLost()
+{
+    JUCEApplicationBase::quit();
+}
+
+void OutOfProcessPluginScanner::Worker::performScan (const String& request)
+{
+    ScopedPointer<XmlElement> xml (XmlDocument::parse (request));
+
+    if (xml == nullptr || ! xml->hasTagName ("SCAN"))
+        return;
+
+    const String formatName (xml->getStringAttribute ("format"));
+    const String fileOrIdentifier (xml->getStringAttribute ("file"));
+    const int timeoutMs = xml->getIntAttribute ("timeout");
+
+    XmlElement reply ("RESULT");
+    reply.setAttribute ("file", fileOrIdentifier);
+
+    for (int i = 0; i < formatManager.getNumFormats(); ++i)
+    {
+        AudioPluginFormat* const format = formatManager.getFormat (i);
+
+        if (format->getName() == formatName)
+        {
+            OwnedArray<PluginDescription> found;
+
+            {
+                ScopedPointer<Watchdog> watchdog (timeoutMs > 0 ? new Watchdog (timeoutMs) : nullptr);
+                format->findAllTypesForFile (found, fileOrIdentifier);
+            }
+
+            for (int j = 0; j < found.size(); ++j)
+                reply.addChildElement (found.getUnchecked(j)->createXml());
+
+            break;
+        }
+    }
+
+    sendMessageToMaster (PluginScannerHelpers::xmlToMemoryBlock (reply));
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class OutOfProcessPluginScannerTests  : public UnitTest
+{
+public:
+    OutOfProcessPluginScannerTests() : UnitTest ("OutOfProcessPluginScanner") {}
+
+    void runTest() override
+    {
+        const File dir (File::getSpecialLocation (File::tempDirectory)
+                          .getNonexistentChildFile ("PluginScannerTest", String(), false));
+        dir.createDirectory();
+
+        beginTest ("File hashes");
+        {
+            const File f (dir.getChildFile ("a.testplugin"));
+            f.replaceWithText ("some plugin code");
+            const int64 hash = OutOfProcessPluginScanner::calculateFileHash (f);
+
+            f.setLastModificationTime (Time::getCurrentTime() - RelativeTime::hours (1));
+            expect (OutOfProcessPluginScanner::calculateFileHash (f) == hash);
+
+            f.replaceWithText ("some new plugin code");
+            expect (OutOfProcessPluginScanner::calculateFileHash (f) != hash);
+
+            const File bundle (dir.getChildFile ("bundle"));
+            bundle.getChildFile ("Contents/binary").create();
+            bundle.getChildFile ("Contents/binary").replaceWithText ("abc");
+            const int64 bundleHash = OutOfProcessPluginScanner::calculateFileHash (bundle);
+
+            bundle.getChildFile ("Contents/binary").replaceWithText ("abd");
+            expect (OutOfProcessPluginScanner::calculateFileHash (bundle) != bundleHash);
+
+            bundle.deleteRecursively();
+        }
+
+        beginTest ("Only changed files are rescanned");
+        {
+            const Time oldTime (Time::getCurrentTime() - RelativeTime::days (1));
+            const File unchanged (dir.getChildFile ("a.testplugin"));
+            const File touched   (dir.getChildFile ("b.testplugin"));
+            const File modified  (dir.getChildFile ("c.testplugin"));
+            const File added     (dir.getChildFile ("d.testplugin"));
+
+            unchanged.replaceWithText ("a");
+            touched.replaceWithText ("b");
+            modified.replaceWithText ("c");
+            added.replaceWithText ("d");
+
+            // write some state as if a previous scan had seen the first three files
+            const File stateFile (dir.getChildFile ("state.xml"));
+            XmlElement state ("PLUGINSCANSTATE");
+            addRecord (state, unchanged, unchanged.getLastModificationTime(), unchanged);
+            addRecord (state, touched,   oldTime, touched);
+            addRecord (state, modified,  oldTime, added);
+            state.writeToFile (stateFile, String());
+
+            KnownPluginList list;
+            TestFormat format;
+
+            {
+                OutOfProcessPluginScanner scanner (list, File(), "test");
+                scanner.setScanStateFile (stateFile);
+
+                expectEquals (scanner.addFilesToScan (format, FileSearchPath (dir.getFullPathName()), false, true), 2);
+                expectEquals (scanner.getNumFilesRemaining(), 2);
+            }
+
+            {
+                OutOfProcessPluginScanner scanner (list, File(), "test");
+                expectEquals (scanner.addFilesToScan (format, FileSearchPath (dir.getFullPathName()), false, false), 4);
+            }
+
+            list.addToBlacklist (added.getFullPathName());
+
+            {
+                OutOfProcessPluginScanner scanner (list, File(), "test");
+                scanner.setScanStateFile (stateFile);
+                expectEquals (scanner.addFilesToScan (format, FileSearchPath (dir.getFullPathName()), false, true), 1);
+            }
+        }
+
+        beginTest ("Missing worker executable");
+        {
+            KnownPluginList list;
+            OutOfProcessPluginScanner scanner (list, dir.getChildFile ("nonexistent"), "test", 2, 1000);
+            scanner.addFileToScan ("Test", "x");
+            scanner.addFileToScan ("Test", "y");
+            scanner.addFileToScan ("Test", "y");
+
+            scanner.startScanning();
+            expect (scanner.waitForCompletion (10000));
+
+            expectEquals (scanner.getNumFilesRemaining(), 2);
+            expect (scanner.getLaunchError().isNotEmpty());
+            expect (scanner.getFailedFiles().isEmpty());
+            expect (list.getBlacklistedFiles().isEmpty());
+        }
+
+        beginTest ("Scanning with real workers");
+        {
+            // This launches the running executable as the worker, so it only works if its main()
+            // handles the "juceUnitTestPluginScanner" worker command-line, as the UnitTestRunner does
+            const File workerDir (dir.getChildFile ("workers"));
+            const File stateFile (dir.getChildFile ("workerState.xml"));
+            KnownPluginList list;
+            TestFormat format;
+            const int numFiles = 6;
+            workerDir.createDirectory();
+
+            for (int i = 0; i < numFiles; ++i)
+                workerDir.getChildFile ("plugin" + String (i) + ".testplugin").replaceWithText (String (i));
+
+            OutOfProcessPluginScanner scanner (list, File::getSpecialLocation (File::currentExecutableFile),
+                                               "juceUnitTestPluginScanner", 2, 10000);
+            scanner.setScanStateFile (stateFile);
+            expectEquals (scanner.addFilesToScan (format, FileSearchPath (workerDir.getFullPathName()), false, false), numFiles);
+
+            scanner.startScanning();
+            expect (scanner.waitForCompletion (60000));
+
+            if (scanner.getLaunchError().isNotEmpty())
+            {
+                logMessage ("This executable can't be launched as a scanner worker, so the scan was skipped");
+            }
+            else
+            {
+                expectEquals (scanner.getNumFilesRemaining(), 0);
+                expectEquals (scanner.getProgress(), 1.0f);
+                expect (scanner.getFailedFiles().isEmpty());
+                expect (list.getBlacklistedFiles().isEmpty());
+
+                // every file was recorded, even though the workers didn't find any plugins in them
+                OutOfProcessPluginScanner rescanner (list, File(), "test");
+                rescanner.setScanStateFile (stateFile);
+                expectEquals (rescanner.addFilesToScan (format, FileSearchPath (workerDir.getFullPathName()), false, true), 0);
+            }
+        }
+
+        dir.deleteRecursively();
+    }
+
+private:
+    static void addRecord (XmlElement& state, const File& file, Time time, const File& contents)
+    {
+        XmlElement* const e = state.createNewChildElement ("FILE");
+        e->setAttribute ("id", file.getFullPathName());
+        e->setAttribute ("format", "Test");
+        e->setAttribute ("time", String::toHexString (time.toMilliseconds()));
+        e->setAttribute ("hash", String::toHexString (OutOfProcessPluginScanner::calculateFileHash (contents)));
+    }
+
+    struct TestFormat  : public AudioPluginFormat
+    {
+        String getName() const override                                         { return "Test"; }
+        void findAllTypesForFile (OwnedArray<PluginDescription>&, const String&) override {}
+        bool fileMightContainThisPluginType (const String& f) override          { return f.endsWith (".testplugin"); }
+        String getNameOfPluginFromIdentifier (const String& f) override         { return f; }
+        bool pluginNeedsRescanning (const PluginDescription&) override          { return false; }
+        bool doesPluginStillExist (const PluginDescription&) override           { return true; }
+        bool canScanForPlugins() const override                                 { return true; }
+        FileSearchPath getDefaultLocationsToSearch() override                   { return FileSearchPath(); }
+
+        StringArray searchPathsForPlugins (const FileSearchPath& path, bool, bool) override
+        {
+            StringArray results;
+            Array<File> files;
+            path[0].findChildFiles (files, File::findFiles, false, "*.testplugin");
+
+            for (int i = 0; i < files.size(); ++i)
+                results.add (files.getReference(i).getFullPathName());
+
+            return results;
+        }
+
+        void createPluginInstance (const PluginDescription&, double, int, void* userData,
+                                   void (*callback) (void*, AudioPluginInstance*, const String&)) override
+        {
+            callback (userData, nullptr, "Not supported");
+        }
+
+        bool requiresUnblockedMessageThreadDuringCreation (const PluginDescription&) const noexcept override  { return false; }
+    };
+};
+
+static OutOfProcessPluginScannerTests outOfProcessPluginScannerTests;
+
+#endif
@@ -0,0 +1,244 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+#ifndef JUCE_OUTOFPROCESSPLUGINSCANNER_H_INCLUDED
+#define JUCE_OUTOFPROCESSPLUGINSCANNER_H_INCLUDED
+
+
+//==============================================================================
+/**
+    Scans plugins in a pool of child processes, adding the results to a KnownPluginList.
+
+    Unlike PluginDirectoryScanner, which loads each plugin inside the host, this launches
+    a number of worker processes and hands each of them one file at a time. A plugin that
+    crashes or hangs only takes down its worker, which is then relaunched, and the
+    offending file is added to the list's blacklist. Since the workers run in parallel,
+    a large plugin folder can be scanned several times faster than with a single scanner.
+
+    The workers are started by launching an executable (usually your own app) with a
+    special command-line. Your app must check for this at startup and, if it's found,
+    create an OutOfProcessPluginScanner::Worker instead of running normally, e.g.
+
+    @code
+    void initialise (const String& commandLine) override
+    {
+        formatManager.addDefaultFormats();
+        scannerWorker = new OutOfProcessPluginScanner::Worker (formatManager);
+
+        if (scannerWorker->initialiseFromCommandLine (commandLine, "myHostScanner"))
+            return; // we're a worker, so don't open any windows
+
+        scannerWorker = nullptr;
+        ...normal startup...
+    }
+    @endcode
+
+    Results are streamed into the KnownPluginList as each file finishes, so a
+    ChangeListener on the list will see the plugins appear while the scan is running.
+
+    If you give it a scan-state file, the scanner will remember the modification time and
+    a content hash of every file it has scanned, so that a later scan with onlyChangedFiles
+    set can skip files that haven't changed - including files that didn't contain any
+    plugins, and files that were touched or copied without their contents changing.
+
+    @see PluginDirectoryScanner, KnownPluginList, ChildProcessMaster
+*/
+class JUCE_API  OutOfProcessPluginScanner  : private Thread
+{
+public:
+    //==============================================================================
+    /** Creates a scanner.
+
+        @param listToAddResultsTo       the list that found types will be added to, and whose
+                                        blacklist is used for files that crash or time out
+        @param workerExecutable         the executable to launch for each worker
+        @param commandLineUniqueID      the ID that the executable will be launched with -
+                                        see ChildProcessMaster::launchSlaveProcess()
+        @param numWorkers               the number of worker processes to run at once
+        @param perPluginTimeoutMs       how long a worker may spend on a single file before
+                                        it's considered to have hung
+    */
+    OutOfProcessPluginScanner (KnownPluginList& listToAddResultsTo,
+                               const File& workerExecutable,
+                               const String& commandLineUniqueID,
+                               int numWorkers = SystemStats::getNumCpus(),
+                               int perPluginTimeoutMs = 30000);
+
+    /** Destructor.
+        If a scan is running, it will be cancelled and the workers killed.
+    */
+    ~OutOfProcessPluginScanner();
+
+    //==============================================================================
+    /** Sets a file in which to keep the modification times and hashes of scanned files.
+        Any existing state in the file is loaded straight away, and it'll be rewritten
+        whenever a scan finishes.
+    */
+    void setScanStateFile (const File& file);
+
+    /** Searches some directories for the given format's plugins, and queues them for scanning.
+
+        If onlyChangedFiles is true, files will be skipped if they've been scanned before
+        and haven't changed since, according to either the scan-state file or the
+        KnownPluginList. Files that are in the list's blacklist are always skipped.
+
+        Returns the number of files that were queued.
+    */
+    int addFilesToScan (AudioPluginFormat& format,
+                        const FileSearchPath& directoriesToSearch,
+                        bool searchRecursively,
+                        bool onlyChangedFiles);
+
+    /** Queues a single file or identifier to be scanned with the named format. */
+    void addFileToScan (const String& formatName, const String& fileOrIdentifier);
+
+    /** Launches the workers and begins scanning the queued files in the background. */
+    void startScanning();
+
+    /** Stops the scan, killing any workers. Files that haven't been scanned stay queued. */
+    void stopScanning();
+
+    /** Returns true if the scan is still running. */
+    bool isScanning() const;
+
+    /** Waits for the scan to finish.
+        Returns false if the timeout expired before it did.
+    */
+    bool waitForCompletion (int timeoutMs = -1);
+
+    //==============================================================================
+    /** Returns the estimated progress of the current scan, between 0 and 1. */
+    float getProgress() const;
+
+    /** Returns the number of queued files that haven't been scanned yet. */
+    int getNumFilesRemaining() const;
+
+    /** Returns the files that crashed or hung their worker during the current scan.
+        These are also added to the KnownPluginList's blacklist. Files that were scanned
+        successfully but didn't contain any plugins aren't included.
+    */
+    StringArray getFailedFiles() const;
+
+    /** If the last scan stopped because its workers couldn't be launched, this returns a
+        description of the problem, otherwise it returns an empty string.
+        Any files that weren't scanned are left queued.
+    */
+    String getLaunchError() const;
+
+    //==============================================================================
+    /** Calculates a hash of a plugin file's contents, which is used to spot files whose
+        modification time has changed without their contents having changed.
+
+        For a bundle, this hashes the names and sizes of all the files inside it, and to
+        keep it quick, only the beginning and end of each file's data is included.
+    */
+    static int64 calculateFileHash (const File& fileOrBundle);
+
+    //==============================================================================
+    /**
+        The part of the scanner that runs inside each worker process.
+
+        See the OutOfProcessPluginScanner class description for how to create one of these.
+        Each file is scanned on the message thread, using the format with the matching
+        name in the AudioPluginFormatManager that you give it. If a scan takes longer than
+        the host's timeout, the worker process terminates itself.
+    */
+    class JUCE_API  Worker  : public ChildProcessSlave
+    {
+    public:
+        /** Creates a worker that will scan with the formats in this manager. */
+        Worker (AudioPluginFormatManager& formatManager);
+
+        /** Destructor. */
+        ~Worker();
+
+        /** @internal */
+        void handleMessageFromMaster (const MemoryBlock&) override;
+        /** @internal */
+        void handleConnectionMade() override;
+        /** @internal */
+        void handleConnectionLost() override;
+
+    private:
+        AudioPluginFormatManager& formatManager;
+
+        struct ScanMessage;
+        struct Watchdog;
+        void performScan (const String& request);
+
+        WeakReference<Worker>::Master masterReference;
+        friend class WeakReference<Worker>;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+    };
+
+private:
+    //==============================================================================
+    struct Job
+    {
+        String formatName, fileOrIdentifier;
+    };
+
+    struct ScanRecord
+    {
+        String formatName;
+        int64 fileTime, hash;
+    };
+
+    struct WorkerProcess;
+    friend struct WorkerProcess;
+    friend struct ContainerDeletePolicy<WorkerProcess>;
+
+    KnownPluginList& list;
+    const File executable;
+    const String commandLineID;
+    const int numWorkers, timeoutMs;
+
+    OwnedArray<WorkerProcess> workers;
+    Array<Job> jobs;
+    HashMap<String, bool> queuedJobs;
+    StringArray failedFiles;
+    String launchError;
+    HashMap<String, ScanRecord> scanState;
+    File scanStateFile;
+    int numJobsStarted, numJobsFinished;
+    CriticalSection lock;
+    WaitableEvent finishedEvent;
+
+    void run() override;
+    void queueJob (const Job&, bool atFront);
+    bool takeNextJob (Job&);
+    bool serviceWorker (int index);
+    void handleResult (const Job&, const MemoryBlock&);
+    void handleFailure (const Job&, const String& reason);
+    void recordScan (const Job&);
+    bool isUnchanged (AudioPluginFormat&, const String& fileOrIdentifier);
+    void saveScanState();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OutOfProcessPluginScanner)
+};
+
+
+#endif   // JUCE_OUTOFPROCESSPLUGINSCANNER_H_INCLUDED
@@ -38,10 +38,11 @@ struct AudioProcessorValueTreeState::Parameter   : public AudioProcessorParamete
           valueToTextFunction (valueToText),
           textToValueFunction (textToValue),
           range (r), value (defaultVal), defaultValue (defaultVal),
+          nextDirtyParameter (nullptr),
           listenersNeedCalling (true)
     {
         state.addListener (this);
-        needsUpdate.set (1);
+        markAsNeedingUpdate();
     }
 
     ~Parameter()
@@ -85,10 +86,16 @@ struct AudioProcessorValueTreeState::Parameter   : public AudioProcessorParamete
             listeners.call (&AudioProcessorValueTreeState::Listener::parameterChanged, paramID, value);
             listenersNeedCalling = false;
 
-            needsUpdate.set (1);
+            markAsNeedingUpdate();
         }
     }
 
+    void markAsNeedingUpdate() noexcept
+    {
+        if (needsUpdate.compareAndSetBool (1, 0))
+            owner.addToDirtyList (*this);
+    }
+
     void setNewState (const ValueTree& v)
     {
         state = v;
@@ -126,27 +133,6 @@ struct AudioProcessorValueTreeState::Parameter   : public AudioProcessorParamete
     void valueTreeChildOrderChanged (ValueTree&, int, int) override {}
     void valueTreeParentChanged (ValueTree&) override {}
 
-    static Parameter* getParameterForID (AudioProcessor& processor, StringRef paramID) noexcept
-    {
-        const int numParams = processor.getParameters().size();
-
-        for (int i = 0; i < numParams; ++i)
-        {
-            AudioProcessorParameter* const ap = processor.getParameters().getUnchecked(i);
-
-            // When using this class, you must allow it to manage all the parameters in your AudioProcessor, and
-            // not add any parameter objects of other types!
-            jassert (dynamic_cast<Parameter*> (ap) != nullptr);
-
-            Parameter* const p = static_cast<Parameter*> (ap);
-
-            if (paramID == p->paramID)
-                return p;
-        }
-
-        return nullptr;
-    }
-
     AudioProcessorValueTreeState& owner;
     ValueTree state;
     String label;
@@ -156,6 +142,7 @@ struct AudioProcessorValueTreeState::Parameter   : public AudioProcessorParamete
     NormalisableRange<float> range;
     float value, defaultValue;
     Atomic<int> needsUpdate;
+    Parameter* nextDirtyParameter;
     bool listenersNeedCalling;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Parameter)
@@ -168,6 +155,7 @@ AudioProcessorValueTreeState::AudioProcessorValueTreeState (AudioProcessor& p, U
       valueType ("PARAM"),
       valuePropertyID ("value"),
       idPropertyID ("id"),
+      numIndexedParameters (0),
       updatingConnections (false)
 {
     startTimerHz (10);
@@ -188,24 +176,122 @@ AudioProcessorParameter* AudioProcessorValueTreeState::createAndAddParameter (St
     Parameter* p = new Parameter (*this, paramID, paramName, labelText, r,
                                   defaultVal, valueToTextFunction, textToValueFunction);
     processor.addParameter (p);
+    addToParameterIndex (p);
     return p;
 }
 
+//==============================================================================
+static uint32 hashParameterID (StringRef paramID) noexcept
+{
+    uint32 hash = 0;
+
+    for (String::CharPointerType t (paramID.text); ! t.isEmpty();)
+        hash = hash * 31 + (uint32) t.getAndAdvance();
+
+    return hash;
+}
+
+AudioProcessorValueTreeState::Parameter* AudioProcessorValueTreeState::getParameterForID (StringRef paramID) const noexcept
+{
+    const int mask = parameterIndex.size() - 1;
+
+    if (mask > 0)
+    {
+        for (int i = (int) (hashParameterID (paramID) & (uint32) mask);; i = (i + 1) & mask)
+        {
+            Parameter* const p = parameterIndex.getUnchecked (i);
+
+            if (p == nullptr)
+                break;
+
+            if (p->paramID == paramID)
+                return p;
+        }
+    }
+
+    return nullptr;
+}
+
+void AudioProcessorValueTreeState::addToParameterIndex (Parameter* newParam)
+{
+    // Each parameter must have a unique ID!
+    jassert (getParameterForID (newParam->paramID) == nullptr);
+
+    // The index is an open-addressed hash table which is kept less than half full,
+    // so that lookups rarely need to compare more than one or two IDs.
+    if ((numIndexedParameters + 1) * 2 > parameterIndex.size())
+    {
+        Array<Parameter*> oldIndex;
+        oldIndex.swapWith (parameterIndex);
+
+        parameterIndex.insertMultiple (0, nullptr, jmax (16, oldIndex.size() * 2));
+        numIndexedParameters = 0;
+
+        for (int i = 0; i < oldIndex.size(); ++i)
+            if (Parameter* p = oldIndex.getUnchecked (i))
+                addToParameterIndex (p);
+    }
+
+    const int mask = parameterIndex.size() - 1;
+    int i = (int) (hashParameterID (newParam->paramID) & (uint32) mask);
+
+    while (parameterIndex.getUnchecked (i) != nullptr)
+        i = (i + 1) & mask;
+
+    parameterIndex.set (i, newParam);
+    ++numIndexedParameters;
+}
+
+void AudioProcessorValueTreeState::addToDirtyList (Parameter& p) noexcept
+{
+    // This is a lock-free stack: a parameter can only be on it once, because it's only
+    // pushed when its needsUpdate flag goes from 0 to 1, and the flag isn't cleared until
+    // the message thread has taken it off again.
+    for (;;)
+    {
+        Parameter* const head = dirtyParameters.get();
+        p.nextDirtyParameter = head;
+
+        if (dirtyParameters.compareAndSetBool (&p, head))
+            break;
+    }
+}
+
+bool AudioProcessorValueTreeState::flushParameterValuesToValueTree()
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+
+    Parameter* p = dirtyParameters.exchange (nullptr);
+    const bool anythingUpdated = (p != nullptr);
+
+    while (p != nullptr)
+    {
+        // Once the flag is cleared, another thread may push this parameter again,
+        // overwriting its link, so the link has to be read first.
+        Parameter* const next = p->nextDirtyParameter;
+        p->needsUpdate.set (0);
+        p->copyValueToValueTree();
+        p = next;
+    }
+
+    return anythingUpdated;
+}
+
 void AudioProcessorValueTreeState::addParameterListener (StringRef paramID, Listener* listener)
 {
-    if (Parameter* p = Parameter::getParameterForID (processor, paramID))
+    if (Parameter* p = getParameterForID (paramID))
         p->listeners.add (listener);
 }
 
 void AudioProcessorValueTreeState::removeParameterListener (StringRef paramID, Listener* listener)
 {
-    if (Parameter* p = Parameter::getParameterForID (processor, paramID))
+    if (Parameter* p = getParameterForID (paramID))
         p->listeners.remove (listener);
 }
 
 Value AudioProcessorValueTreeState::getParameterAsValue (StringRef paramID) const
 {
-    if (Parameter* p = Parameter::getParameterForID (processor, paramID))
+    if (Parameter* p = getParameterForID (paramID))
         return p->state.getPropertyAsValue (valuePropertyID, undoManager);
 
     return Value();
@@ -213,7 +299,7 @@ Value AudioProcessorValueTreeState::getParameterAsValue (StringRef paramID) cons
 
 NormalisableRange<float> AudioProcessorValueTreeState::getParameterRange (StringRef paramID) const noexcept
 {
-    if (Parameter* p = Parameter::getParameterForID (processor, paramID))
+    if (Parameter* p = getParameterForID (paramID))
         return p->range;
 
     return NormalisableRange<float>();
@@ -221,12 +307,12 @@ NormalisableRange<float> AudioProcessorValueTreeState::getParameterRange (String
 
 AudioProcessorParameter* AudioProcessorValueTreeState::getParameter (StringRef paramID) const noexcept
 {
-    return Parameter::getParameterForID (processor, paramID);
+    return getParameterForID (paramID);
 }
 
 float* AudioProcessorValueTreeState::getRawParameterValue (StringRef paramID) const noexcept
 {
-    if (Parameter* p = Parameter::getParameterForID (processor, paramID))
+    if (Parameter* p = getParameterForID (paramID))
         return &(p->value);
 
     return nullptr;
@@ -294,22 +380,7 @@ void AudioProcessorValueTreeState::valueTreeParentChanged (ValueTree&) {}
 
 void AudioProcessorValueTreeState::timerCallback()
 {
-    const int numParams = processor.getParameters().size();
-    bool anythingUpdated = false;
-
-    for (int i = 0; i < numParams; ++i)
-    {
-        AudioProcessorParameter* const ap = processor.getParameters().getUnchecked(i);
-        jassert (dynamic_cast<Parameter*> (ap) != nullptr);
-
-        Parameter* p = static_cast<Parameter*> (ap);
-
-        if (p->needsUpdate.compareAndSetBool (0, 1))
-        {
-            p->copyValueToValueTree();
-            anythingUpdated = true;
-        }
-    }
+    const bool anythingUpdated = flushParameterValuesToValueTree();
 
     startTimer (anythingUpdated ? 1000 / 50
                                 : jlimit (50, 500, getTimerInterval() + 20));
@@ -524,4 +595,209 @@ AudioProcessorValueTreeState::ButtonAttachment::ButtonAttachment (AudioProcessor
 
 AudioProcessorValueTreeState::ButtonAttachment::~ButtonAttachment() {}
 
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorValueTreeStateTests  : public UnitTest
+{
+public:
+    AudioProcessorValueTreeStateTests() : UnitTest ("AudioProcessorValueTreeState") {}
+
+    struct TestProcessor  : public AudioProcessor
+    {
+        const String getName() const override                           { return "Test"; }
+        void prepareToPlay (double, int) override                       {}
+        void releaseResources() override                                {}
+        void processBlock (AudioSampleBuffer&, MidiBuffer&) override    {}
+        double getTailLengthSeconds() const override                    { return 0; }
+        bool acceptsMidi() const override                               { return false; }
+        bool producesMidi() const override                              { return false; }
+        AudioProcessorEditor* createEditor() override                   { return nullptr; }
+        bool hasEditor() const override                                 { return false; }
+        int getNumPrograms() override                                   { return 1; }
+        int getCurrentProgram() override                                { return 0; }
+        void setCurrentProgram (int) override                           {}
+        const String getProgramName (int) override                      { return String(); }
+        void changeProgramName (int, const String&) override            {}
+        void getStateInformation (MemoryBlock&) override                {}
+        void setStateInformation (const void*, int) override            {}
+    };
+
+    static String getID (int index)     { return "param_" + String (index); }
+
+    // The lookup that this class used to do, for comparison.
+    static AudioProcessorParameter* linearSearch (AudioProcessor& p, StringRef paramID)
+    {
+        const OwnedArray<AudioProcessorParameter>& params = p.getParameters();
+
+        for (int i = 0; i < params.size(); ++i)
+            if (AudioProcessorParameterWithID* ap = dynamic_cast<AudioProcessorParameterWithID*> (params.getUnchecked (i)))
+                if (ap->paramID == paramID)
+                    return ap;
+
+        return nullptr;
+    }
+
+    void expectTreeMatchesParameters (AudioProcessorValueTreeState& s, int numParams)
+    {
+        int numMismatches = 0;
+
+        for (int i = 0; i < numParams; ++i)
+            if ((float) s.state.getChildWithProperty ("id", getID (i)).getProperty ("value") != *s.getRawParameterValue (getID (i)))
+                ++numMismatches;
+
+        expectEquals (numMismatches, 0);
+    }
+
+    void runTest() override
+    {
+        const int numParams = 5000;
+
+        TestProcessor processor;
+        AudioProcessorValueTreeState s (processor, nullptr);
+
+        for (int i = 0; i < numParams; ++i)
+            s.createAndAddParameter (getID (i), "Param " + String (i), String(),
+                                     NormalisableRange<float> (0.0f, 1.0f), 0.0f, nullptr, nullptr);
+
+        s.state = ValueTree ("TEST");
+        s.flushParameterValuesToValueTree();
+
+        Random r (getRandom());
+
+        beginTest ("Parameter lookup");
+        {
+            const OwnedArray<AudioProcessorParameter>& params = processor.getParameters();
+            StringArray ids;
+
+            for (int i = 0; i < numParams; ++i)
+                ids.add (getID (i));
+
+            int numWrong = 0;
+
+            for (int i = 0; i < numParams; ++i)
+                if (s.getParameter (ids[i]) != params[i] || s.getRawParameterValue (ids[i]) == nullptr)
+                    ++numWrong;
+
+            expectEquals (numWrong, 0);
+            expect (s.getParameter ("nonexistent") == nullptr);
+            expect (s.getParameter (String()) == nullptr);
+
+            const int numLookups = 2000;
+            int64 checksum = 0;
+
+            double start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numLookups; ++i)
+                checksum += (pointer_sized_int) s.getParameter (ids[r.nextInt (numParams)]);
+
+            const double hashedMs = Time::getMillisecondCounterHiRes() - start;
+            start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numLookups; ++i)
+                checksum -= (pointer_sized_int) linearSearch (processor, ids[r.nextInt (numParams)]);
+
+            const double linearMs = Time::getMillisecondCounterHiRes() - start;
+
+            logMessage (String (numLookups) + " lookups among " + String (numParams) + " parameters: hashed "
+                          + String (hashedMs, 2) + " ms, linear scan " + String (linearMs, 2) + " ms");
+            ignoreUnused (checksum);
+        }
+
+        beginTest ("Only changed parameters are copied to the tree");
+        {
+            struct ChangeCounter  : public ValueTree::Listener
+            {
+                ChangeCounter() : numChanges (0) {}
+
+                void valueTreePropertyChanged (ValueTree&, const Identifier&) override  { ++numChanges; }
+                void valueTreeChildAdded (ValueTree&, ValueTree&) override {}
+                void valueTreeChildRemoved (ValueTree&, ValueTree&, int) override {}
+                void valueTreeChildOrderChanged (ValueTree&, int, int) override {}
+                void valueTreeParentChanged (ValueTree&) override {}
+
+                int numChanges;
+            };
+
+            ChangeCounter counter;
+            s.state.addListener (&counter);
+            int numChanged = 0;
+
+            for (int i = 0; i < numParams; i += 7)
+            {
+                processor.getParameters()[i]->setValueNotifyingHost (0.5f);
+                ++numChanged;
+            }
+
+            expect (s.flushParameterValuesToValueTree());
+            expect (! s.flushParameterValuesToValueTree());
+            expectTreeMatchesParameters (s, numParams);
+            expectEquals (counter.numChanges, numChanged);
+            s.state.removeListener (&counter);
+        }
+
+        beginTest ("Automation benchmark");
+        {
+            // 5% of the parameters change in every block, and the tree is updated every 4 blocks
+            const int numBlocks = 400, changesPerBlock = numParams / 20;
+            double automationMs = 0, flushMs = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                double start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < changesPerBlock; ++i)
+                    processor.getParameters()[r.nextInt (numParams)]->setValue (r.nextFloat());
+
+                automationMs += Time::getMillisecondCounterHiRes() - start;
+
+                if (block % 4 == 3)
+                {
+                    start = Time::getMillisecondCounterHiRes();
+                    s.flushParameterValuesToValueTree();
+                    flushMs += Time::getMillisecondCounterHiRes() - start;
+                }
+            }
+
+            logMessage (String (numBlocks) + " blocks of " + String (changesPerBlock) + " changes: setValue "
+                          + String (automationMs, 2) + " ms, tree updates " + String (flushMs, 2) + " ms");
+
+            expectTreeMatchesParameters (s, numParams);
+        }
+
+        beginTest ("Automation from another thread");
+        {
+            struct AutomationThread  : public Thread
+            {
+                AutomationThread (AudioProcessor& p, int64 seed)
+                    : Thread ("automation"), processor (p), random (seed) {}
+
+                void run() override
+                {
+                    const OwnedArray<AudioProcessorParameter>& params = processor.getParameters();
+
+                    for (int i = 0; i < 200000 && ! threadShouldExit(); ++i)
+                        params.getUnchecked (random.nextInt (params.size()))->setValue (random.nextFloat());
+                }
+
+                AudioProcessor& processor;
+                Random random;
+            };
+
+            AutomationThread thread (processor, r.nextInt64());
+            thread.startThread();
+
+            while (thread.isThreadRunning())
+                s.flushParameterValuesToValueTree();
+
+            s.flushParameterValuesToValueTree();
+            expectTreeMatchesParameters (s, numParams);
+        }
+    }
+};
+
+static AudioProcessorValueTreeStateTests audioProcessorValueTreeStateTests;
+
+#endif
+
 #endif
@@ -117,6 +117,16 @@ public:
     /** Returns the range that was set when the given parameter was created. */
     NormalisableRange<float> getParameterRange (StringRef parameterID) const noexcept;
 
+    /** Copies the values of any parameters that have changed into the ValueTree.
+
+        This happens automatically on a timer, but you can call it yourself if you need
+        the tree to be up-to-date immediately, e.g. before saving the state. Only the
+        parameters that have actually changed since the last call are visited, so it's
+        cheap to call even when there are thousands of parameters.
+        It must be called on the message thread. Returns true if anything was updated.
+    */
+    bool flushParameterValuesToValueTree();
+
     /** A reference to the processor with which this state is associated. */
     AudioProcessor& processor;
 
@@ -207,6 +217,10 @@ private:
     struct Parameter;
     friend struct Parameter;
 
+    Parameter* getParameterForID (StringRef) const noexcept;
+    void addToParameterIndex (Parameter*);
+    void addToDirtyList (Parameter&) noexcept;
+
     ValueTree getOrCreateChildValueTree (const String&);
     void timerCallback() override;
 
@@ -219,6 +233,9 @@ private:
     void updateParameterConnectionsToChildTrees();
 
     Identifier valueType, valuePropertyID, idPropertyID;
+    Array<Parameter*> parameterIndex;
+    int numIndexedParameters;
+    Atomic<Parameter*> dirtyParameters;
     bool updatingConnections;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorValueTreeState)
@@ -77,19 +77,21 @@ class AudioThumbnail::LevelDataSource   : public TimeSliceClient
 public:
     LevelDataSource (AudioThumbnail& thumb, AudioFormatReader* newReader, int64 hash)
         : lengthInSamples (0), numSamplesFinished (0), sampleRate (0), numChannels (0),
-          hashCode (hash), owner (thumb), reader (newReader), lastReaderUseTime (0)
+          hashCode (hash), owner (thumb), thread (thumb.cache.getLeastBusyThread()),
+          reader (newReader), lastReaderUseTime (0)
     {
     }
 
     LevelDataSource (AudioThumbnail& thumb, InputSource* src)
         : lengthInSamples (0), numSamplesFinished (0), sampleRate (0), numChannels (0),
-          hashCode (src->hashCode()), owner (thumb), source (src), lastReaderUseTime (0)
+          hashCode (src->hashCode()), owner (thumb), thread (thumb.cache.getLeastBusyThread()),
+          source (src), lastReaderUseTime (0)
     {
     }
 
     ~LevelDataSource()
     {
-        owner.cache.getTimeSliceThread().removeTimeSliceClient (this);
+        thread.removeTimeSliceClient (this);
     }
 
     enum { timeBeforeDeletingReader = 3000 };
@@ -111,7 +113,7 @@ public:
             if (lengthInSamples <= 0 || isFullyLoaded())
                 reader = nullptr;
             else
-                owner.cache.getTimeSliceThread().addTimeSliceClient (this);
+                thread.addTimeSliceClient (this);
         }
     }
 
@@ -126,7 +128,7 @@ public:
             if (reader != nullptr)
             {
                 lastReaderUseTime = Time::getMillisecondCounter();
-                owner.cache.getTimeSliceThread().addTimeSliceClient (this);
+                thread.addTimeSliceClient (this);
             }
         }
 
@@ -201,6 +203,7 @@ public:
 
 private:
     AudioThumbnail& owner;
+    TimeSliceThread& thread;
     ScopedPointer<InputSource> source;
     ScopedPointer<AudioFormatReader> reader;
     CriticalSection readerLock;
@@ -292,12 +295,24 @@ public:
 
             while (startSample <= endSample)
             {
-                const MinMaxValue& v = data.getReference (startSample);
+                // Use the coarsest summary level whose block starts here and fits inside the range
+                int level = 0, blockSize = 1;
+
+                while (level < summaries.size()
+                        && startSample % (blockSize * summaryBlockSize) == 0
+                        && startSample + blockSize * summaryBlockSize - 1 <= endSample)
+                {
+                    ++level;
+                    blockSize *= summaryBlockSize;
+                }
+
+                const MinMaxValue& v = level == 0 ? data.getReference (startSample)
+                                                  : summaries.getReference (level - 1).getReference (startSample / blockSize);
 
                 if (v.getMinValue() < mn)  mn = v.getMinValue();
                 if (v.getMaxValue() > mx)  mx = v.getMaxValue();
 
-                ++startSample;
+                startSample += blockSize;
             }
 
             if (mn <= mx)
@@ -321,6 +336,15 @@ public:
 
         for (int i = 0; i < numValues; ++i)
             dest[i] = values[i];
+
+        updateSummaries (startIndex, numValues);
+    }
+
+    /** Must be called after the data has been modified directly via getData(). */
+    void refreshSummaries()
+    {
+        resetPeak();
+        updateSummaries (0, data.size());
     }
 
     void resetPeak() noexcept
@@ -332,9 +356,11 @@ public:
     {
         if (peakLevel < 0)
         {
-            for (int i = 0; i < data.size(); ++i)
+            const Array<MinMaxValue>& top = summaries.size() > 0 ? summaries.getReference (summaries.size() - 1) : data;
+
+            for (int i = 0; i < top.size(); ++i)
             {
-                const int peak = data[i].getPeak();
+                const int peak = top[i].getPeak();
                 if (peak > peakLevel)
                     peakLevel = peak;
             }
@@ -344,14 +370,75 @@ public:
     }
 
 private:
+    // Each summary level holds the combined min/max of blocks of summaryBlockSize
+    // values from the level below, so that long ranges can be scanned quickly.
+    enum { summaryBlockSize = 16 };
+
     Array<MinMaxValue> data;
+    Array<Array<MinMaxValue> > summaries;
     int peakLevel;
 
     void ensureSize (const int thumbSamples)
     {
-        const int extraNeeded = thumbSamples - data.size();
+        const int oldSize = data.size();
+        const int extraNeeded = thumbSamples - oldSize;
+
         if (extraNeeded > 0)
+        {
             data.insertMultiple (-1, MinMaxValue(), extraNeeded);
+
+            const int oldNumLevels = summaries.size();
+            int levelSize = data.size();
+
+            for (int level = 0; levelSize > summaryBlockSize; ++level)
+            {
+                levelSize = (levelSize + summaryBlockSize - 1) / summaryBlockSize;
+
+                if (level >= summaries.size())
+                    summaries.add (Array<MinMaxValue>());
+
+                Array<MinMaxValue>& summary = summaries.getReference (level);
+                summary.insertMultiple (-1, MinMaxValue(), levelSize - summary.size());
+            }
+
+            if (summaries.size() != oldNumLevels)
+                updateSummaries (0, data.size());
+            else
+                updateSummaries (oldSize, extraNeeded);
+        }
+    }
+
+    void updateSummaries (int start, int num)
+    {
+        const Array<MinMaxValue>* source = &data;
+
+        for (int level = 0; level < summaries.size() && num > 0; ++level)
+        {
+            Array<MinMaxValue>& dest = summaries.getReference (level);
+            const int first = start / summaryBlockSize;
+            const int last  = (start + num - 1) / summaryBlockSize;
+
+            for (int i = first; i <= last; ++i)
+            {
+                const MinMaxValue* v = source->begin() + i * summaryBlockSize;
+                const MinMaxValue* const end = source->begin() + jmin ((i + 1) * summaryBlockSize, source->size());
+
+                char mx = -128;
+                char mn = 127;
+
+                for (; v < end; ++v)
+                {
+                    if (v->getMinValue() < mn)  mn = v->getMinValue();
+                    if (v->getMaxValue() > mx)  mx = v->getMaxValue();
+                }
+
+                dest.getReference (i).set (mn, mx);
+            }
+
+            start = first;
+            num = last - first + 1;
+            source = &dest;
+        }
     }
 };
 
@@ -613,6 +700,9 @@ bool AudioThumbnail::loadFrom (InputStream& rawInput)
         for (int chan = 0; chan < numChannels; ++chan)
             channels.getUnchecked(chan)->getData(i)->read (input);
 
+    for (int chan = 0; chan < numChannels; ++chan)
+        channels.getUnchecked(chan)->refreshSummaries();
+
     return true;
 }
 
@@ -820,3 +910,126 @@ void AudioThumbnail::drawChannels (Graphics& g, const Rectangle<int>& area, doub
                      startTimeSeconds, endTimeSeconds, i, verticalZoomFactor);
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioThumbnailTests  : public UnitTest
+{
+public:
+    AudioThumbnailTests() : UnitTest ("AudioThumbnail") {}
+
+    enum { samplesPerThumbSample = 64, blocksPerSection = 10, numSamples = 2000000 };
+
+    // A slow sine wave, with a spike in the middle of every tenth thumbnail block
+    static AudioSampleBuffer createTestSignal (Random& r)
+    {
+        AudioSampleBuffer buffer (2, numSamples);
+
+        for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+        {
+            float* const data = buffer.getWritePointer (chan);
+
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = 0.5f * std::sin ((chan + 1) * i * 2.0 * double_Pi / 100000.0);
+
+            for (int block = blocksPerSection / 2; block * samplesPerThumbSample < numSamples; block += blocksPerSection)
+                if (r.nextInt (4) == 0)
+                    data [block * samplesPerThumbSample + samplesPerThumbSample / 2] = r.nextFloat() * 1.8f - 0.9f;
+        }
+
+        return buffer;
+    }
+
+    static Range<float> findRange (const AudioSampleBuffer& buffer, int chan, int start, int end)
+    {
+        return FloatVectorOperations::findMinAndMax (buffer.getReadPointer (chan, start), end - start);
+    }
+
+    static Range<float> getThumbnailRange (const AudioThumbnail& thumb, int chan, int start, int end)
+    {
+        float minValue, maxValue;
+        thumb.getApproximateMinMax (start / 44100.0, end / 44100.0, chan, minValue, maxValue);
+        return Range<float> (minValue, maxValue);
+    }
+
+    // Ranges that start and end on block boundaries away from the spikes, so that the
+    // thumbnail's min and max should match those of the exact samples
+    static Range<int> getRandomRange (Random& r)
+    {
+        const int numSections = numSamples / (samplesPerThumbSample * blocksPerSection);
+        const int firstSection = r.nextInt (numSections - 1);
+        const int lastSection = firstSection + 1 + r.nextInt (jmin (numSections - firstSection - 1, r.nextBool() ? 5 : 3000));
+
+        const int sectionSize = samplesPerThumbSample * blocksPerSection;
+        return Range<int> (firstSection * sectionSize, lastSection * sectionSize);
+    }
+
+    void runTest() override
+    {
+        Random r (getRandom());
+        const AudioSampleBuffer signal (createTestSignal (r));
+
+        AudioFormatManager formatManager;
+        AudioThumbnailCache cache (4);
+        AudioThumbnail thumb (samplesPerThumbSample, formatManager, cache);
+
+        thumb.reset (signal.getNumChannels(), 44100.0, numSamples);
+
+        for (int pos = 0; pos < numSamples; pos += 10000)
+            thumb.addBlock (pos, signal, pos, jmin (10000, numSamples - pos));
+
+        beginTest ("Summary levels give the same min and max as the samples");
+
+        for (int i = 0; i < 200; ++i)
+        {
+            const Range<int> range (getRandomRange (r));
+            const int chan = r.nextInt (2);
+            const Range<float> expected (findRange (signal, chan, range.getStart(), range.getEnd()));
+            const Range<float> actual (getThumbnailRange (thumb, chan, range.getStart(), range.getEnd()));
+
+            // (the thumbnail stores its values in 8 bits)
+            expectWithinAbsoluteError (actual.getStart(), expected.getStart(), 0.03f);
+            expectWithinAbsoluteError (actual.getEnd(),   expected.getEnd(),   0.03f);
+        }
+
+        beginTest ("Thumbnails survive a round-trip through the cache directory");
+        {
+            const File directory (File::getSpecialLocation (File::tempDirectory)
+                                    .getNonexistentChildFile ("thumbnail_cache", String(), false));
+            cache.setCacheDirectory (directory);
+
+            const int64 hash = 0x1234567890abcdefLL;
+            expect (thumb.isFullyLoaded());
+            cache.storeThumb (thumb, hash);
+            expect (directory.getNumberOfChildFiles (File::findFiles) == 1);
+
+            cache.clear();
+
+            AudioThumbnail reloaded (samplesPerThumbSample, formatManager, cache);
+            expect (cache.loadThumb (reloaded, hash));
+            expect (reloaded.isFullyLoaded());
+            expectEquals (reloaded.getTotalLength(), thumb.getTotalLength());
+
+            for (int i = 0; i < 200; ++i)
+            {
+                const Range<int> range (getRandomRange (r));
+                const int chan = r.nextInt (2);
+
+                expect (getThumbnailRange (reloaded, chan, range.getStart(), range.getEnd())
+                          == getThumbnailRange (thumb, chan, range.getStart(), range.getEnd()));
+            }
+
+            // the reloaded data is kept in memory too
+            expect (directory.deleteRecursively());
+
+            AudioThumbnail fromMemory (samplesPerThumbSample, formatManager, cache);
+            expect (cache.loadThumb (fromMemory, hash));
+            expect (getThumbnailRange (fromMemory, 0, 0, numSamples) == getThumbnailRange (thumb, 0, 0, numSamples));
+        }
+    }
+};
+
+static AudioThumbnailTests audioThumbnailTests;
+
+#endif
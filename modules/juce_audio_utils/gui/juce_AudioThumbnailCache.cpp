@@ -55,18 +55,34 @@ private:
 };
 
 //==============================================================================
-AudioThumbnailCache::AudioThumbnailCache (const int maxNumThumbs)
-    : thread ("thumb cache"),
-      maxNumThumbsToStore (maxNumThumbs)
+AudioThumbnailCache::AudioThumbnailCache (const int maxNumThumbs, const int numThreadsToUse)
+    : maxNumThumbsToStore (maxNumThumbs)
 {
     jassert (maxNumThumbsToStore > 0);
-    thread.startThread (2);
+    jassert (numThreadsToUse > 0);
+
+    for (int i = 0; i < jmax (1, numThreadsToUse); ++i)
+    {
+        TimeSliceThread* t = threads.add (new TimeSliceThread ("thumb cache"));
+        t->startThread (2);
+    }
 }
 
 AudioThumbnailCache::~AudioThumbnailCache()
 {
 }
 
+TimeSliceThread& AudioThumbnailCache::getLeastBusyThread() noexcept
+{
+    TimeSliceThread* best = threads.getUnchecked (0);
+
+    for (int i = 1; i < threads.size(); ++i)
+        if (threads.getUnchecked (i)->getNumClients() < best->getNumClients())
+            best = threads.getUnchecked (i);
+
+    return *best;
+}
+
 AudioThumbnailCache::ThumbnailCacheEntry* AudioThumbnailCache::findThumbFor (const int64 hash) const
 {
     for (int i = thumbs.size(); --i >= 0;)
@@ -97,42 +113,139 @@ int AudioThumbnailCache::findOldestThumb() const
 
 bool AudioThumbnailCache::loadThumb (AudioThumbnailBase& thumb, const int64 hashCode)
 {
-    const ScopedLock sl (lock);
+    File fileToLoad;
 
-    if (ThumbnailCacheEntry* te = findThumbFor (hashCode))
     {
-        te->lastUsed = Time::getMillisecondCounter();
+        const ScopedLock sl (lock);
 
-        MemoryInputStream in (te->data, false);
-        thumb.loadFrom (in);
-        return true;
+        if (ThumbnailCacheEntry* te = findThumbFor (hashCode))
+        {
+            te->lastUsed = Time::getMillisecondCounter();
+
+            MemoryInputStream in (te->data, false);
+            thumb.loadFrom (in);
+            return true;
+        }
+
+        if (cacheDirectory != File())
+            fileToLoad = getFileForThumb (hashCode);
     }
 
+    // (the file is read outside the lock, so that lookups on other threads aren't held up)
+    if (fileToLoad != File() && loadThumbFromFile (thumb, hashCode, fileToLoad))
+        return true;
+
+    const ScopedLock sl (lock);
     return loadNewThumb (thumb, hashCode);
 }
 
+void AudioThumbnailCache::addThumb (ThumbnailCacheEntry* te)
+{
+    if (thumbs.size() < maxNumThumbsToStore)
+        thumbs.add (te);
+    else
+        thumbs.set (findOldestThumb(), te);
+}
+
 void AudioThumbnailCache::storeThumb (const AudioThumbnailBase& thumb,
                                       const int64 hashCode)
 {
-    const ScopedLock sl (lock);
-    ThumbnailCacheEntry* te = findThumbFor (hashCode);
+    MemoryBlock dataToSave;
+    File fileToSave;
+
+    {
+        const ScopedLock sl (lock);
+        ThumbnailCacheEntry* te = findThumbFor (hashCode);
+
+        if (te == nullptr)
+        {
+            te = new ThumbnailCacheEntry (hashCode);
+            addThumb (te);
+        }
+
+        {
+            MemoryOutputStream out (te->data, false);
+            thumb.saveTo (out);
+        }
+
+        if (cacheDirectory != File() && thumb.isFullyLoaded())
+        {
+            dataToSave = te->data;
+            fileToSave = getFileForThumb (hashCode);
+        }
 
-    if (te == nullptr)
+        saveNewlyFinishedThumbnail (thumb, hashCode);
+    }
+
+    // (the file is written outside the lock, so that other threads aren't held up)
+    if (fileToSave != File())
     {
-        te = new ThumbnailCacheEntry (hashCode);
+        TemporaryFile temp (fileToSave);
+
+        {
+            ScopedPointer<FileOutputStream> out (temp.getFile().createOutputStream());
 
-        if (thumbs.size() < maxNumThumbsToStore)
-            thumbs.add (te);
-        else
-            thumbs.set (findOldestThumb(), te);
+            if (out == nullptr)
+                return;
+
+            GZIPCompressorOutputStream gzip (out, 9, false);
+            gzip << dataToSave;
+        }
+
+        temp.overwriteTargetFileWithTemporary();
     }
+}
+
+//==============================================================================
+void AudioThumbnailCache::setCacheDirectory (const File& directory)
+{
+    const ScopedLock sl (lock);
+    cacheDirectory = directory;
+
+    if (cacheDirectory != File())
+        cacheDirectory.createDirectory();
+}
+
+File AudioThumbnailCache::getCacheDirectory() const
+{
+    const ScopedLock sl (lock);
+    return cacheDirectory;
+}
+
+File AudioThumbnailCache::getFileForThumb (const int64 hash) const
+{
+    return cacheDirectory.getChildFile (String::toHexString (hash) + ".thumb");
+}
+
+bool AudioThumbnailCache::loadThumbFromFile (AudioThumbnailBase& thumb, const int64 hashCode, const File& file)
+{
+    ScopedPointer<ThumbnailCacheEntry> te (new ThumbnailCacheEntry (hashCode));
 
     {
+        ScopedPointer<FileInputStream> in (file.createInputStream());
+
+        if (in == nullptr)
+            return false;
+
+        GZIPDecompressorInputStream gzip (*in);
         MemoryOutputStream out (te->data, false);
-        thumb.saveTo (out);
+        out << gzip;
     }
 
-    saveNewlyFinishedThumbnail (thumb, hashCode);
+    MemoryInputStream in (te->data, false);
+
+    if (! thumb.loadFrom (in))
+        return false;
+
+    // keep the reloaded data in memory too, so the file won't need to be read again
+    const ScopedLock sl (lock);
+
+    if (ThumbnailCacheEntry* existing = findThumbFor (hashCode))
+        existing->data = te->data;
+    else
+        addThumb (te.release());
+
+    return true;
 }
 
 void AudioThumbnailCache::clear()
@@ -30,9 +30,10 @@
 /**
     An instance of this class is used to manage multiple AudioThumbnail objects.
 
-    The cache runs a single background thread that is shared by all the thumbnails
-    that need it, and it maintains a set of low-res previews in memory, to avoid
-    having to re-scan audio files too often.
+    The cache runs one or more background threads that are shared by all the thumbnails
+    that need them, and it maintains a set of low-res previews in memory, to avoid
+    having to re-scan audio files too often. It can also be given a directory in which
+    to keep finished previews on disk, so that they survive between sessions.
 
     @see AudioThumbnail
 */
@@ -44,8 +45,12 @@ public:
 
         The maxNumThumbsToStore parameter lets you specify how many previews should
         be kept in memory at once.
+
+        The numThreadsToUse parameter sets how many background threads will be used to
+        scan audio files. When lots of thumbnails are loaded at once, they'll be spread
+        across these threads so that several files can be scanned in parallel.
     */
-    explicit AudioThumbnailCache (int maxNumThumbsToStore);
+    explicit AudioThumbnailCache (int maxNumThumbsToStore, int numThreadsToUse = 1);
 
     /** Destructor. */
     virtual ~AudioThumbnailCache();
@@ -84,8 +89,33 @@ public:
     */
     void writeToStream (OutputStream& stream);
 
+    //==============================================================================
+    /** Tells the cache to keep a copy of each finished thumbnail in the given directory.
+
+        When a thumbnail isn't found in memory, the cache will look for a file in this
+        directory before the audio file has to be re-scanned. The files are named after
+        the thumbnail's hash code, so if you're using a FileInputSource you'll probably
+        want to create it with useFileTimeInHashGeneration = true, so that a file which
+        has been modified won't pick up a stale preview.
+
+        Pass File() to stop using a directory.
+    */
+    void setCacheDirectory (const File& directory);
+
+    /** Returns the directory that was set with setCacheDirectory(). */
+    File getCacheDirectory() const;
+
+    //==============================================================================
     /** Returns the thread that client thumbnails can use. */
-    TimeSliceThread& getTimeSliceThread() noexcept      { return thread; }
+    TimeSliceThread& getTimeSliceThread() noexcept      { return *threads.getUnchecked (0); }
+
+    /** Returns the number of background threads that this cache is running. */
+    int getNumThreads() const noexcept                  { return threads.size(); }
+
+    /** Returns whichever of the cache's threads currently has the fewest clients.
+        AudioThumbnail uses this to spread the work of scanning files across all the threads.
+    */
+    TimeSliceThread& getLeastBusyThread() noexcept;
 
 protected:
     /** This can be overridden to provide a custom callback for saving thumbnails
@@ -100,16 +130,20 @@ protected:
 
 private:
     //==============================================================================
-    TimeSliceThread thread;
+    OwnedArray<TimeSliceThread> threads;
 
     class ThumbnailCacheEntry;
     friend struct ContainerDeletePolicy<ThumbnailCacheEntry>;
     OwnedArray<ThumbnailCacheEntry> thumbs;
     CriticalSection lock;
     int maxNumThumbsToStore;
+    File cacheDirectory;
 
     ThumbnailCacheEntry* findThumbFor (int64 hash) const;
     int findOldestThumb() const;
+    File getFileForThumb (int64 hash) const;
+    bool loadThumbFromFile (AudioThumbnailBase&, int64 hash, const File&);
+    void addThumb (ThumbnailCacheEntry*);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioThumbnailCache)
 };
@@ -98,10 +98,15 @@ public:
 
         if (pipeOut == -1)
         {
-            pipeOut = openPipe (createdPipe ? pipeOutName : pipeInName, O_WRONLY, timeoutEnd);
+            // A blocking open would wait forever if nobody ever opens the other end, so
+            // open it non-blocking (which fails until there's a reader) and then switch
+            // it back to blocking mode for the writes.
+            pipeOut = openPipe (createdPipe ? pipeOutName : pipeInName, O_WRONLY | O_NONBLOCK, timeoutEnd);
 
             if (pipeOut == -1)
                 return -1;
+
+            fcntl (pipeOut, F_SETFL, fcntl (pipeOut, F_GETFL) & ~O_NONBLOCK);
         }
 
         int bytesWritten = 0;
@@ -45,6 +45,13 @@ struct ChildProcessPingThread  : public Thread,
         pingReceived();
     }
 
+    ~ChildProcessPingThread()
+    {
+        // the owner may be deleted on a background thread after a ping has failed, in
+        // which case there's nobody left to tell about it
+        cancelPendingUpdate();
+    }
+
     static bool isPingMessage (const MemoryBlock& m) noexcept
     {
         return memcmp (m.getData(), pingMessage, specialMessageSize) == 0;
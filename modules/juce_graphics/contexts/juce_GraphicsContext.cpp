@@ -44,6 +44,15 @@ namespace
 LowLevelGraphicsContext::LowLevelGraphicsContext() {}
 LowLevelGraphicsContext::~LowLevelGraphicsContext() {}
 
+void LowLevelGraphicsContext::strokePath (const Path& path, const PathStrokeType& strokeType, const AffineTransform& transform)
+{
+    Path stroke;
+    strokeType.createStrokedPath (stroke, path, transform, getPhysicalPixelScaleFactor());
+
+    if (! stroke.isEmpty())
+        fillPath (stroke, AffineTransform());
+}
+
 //==============================================================================
 Graphics::Graphics (const Image& imageToDrawOnto)
     : context (*imageToDrawOnto.createLowLevelContext()),
@@ -229,6 +238,8 @@ Font Graphics::getCurrentFont() const
 }
 
 //==============================================================================
+typedef RenderingHelpers::GlyphArrangementCache GlyphLayoutCache;
+
 void Graphics::drawSingleLineText (const String& text, const int startX, const int baselineY,
                                    Justification justification) const
 {
@@ -248,22 +259,34 @@ void Graphics::drawSingleLineText (const String& text, const int startX, const i
             if (startX > context.getClipBounds().getRight())
                 return;
 
-        GlyphArrangement arr;
-        arr.addLineOfText (context.getFont(), text, (float) startX, (float) baselineY);
+        const GlyphLayoutCache::Key key (GlyphLayoutCache::singleLineText, context.getFont(), text,
+                                         Rectangle<float> ((float) startX, (float) baselineY, 0.0f, 0.0f), flags, 0, 0.0f);
 
-        if (flags != Justification::left)
+        GlyphLayoutCache::EntryPtr layout (GlyphLayoutCache::getInstance()->find (key));
+
+        if (layout == nullptr)
         {
-            float w = arr.getBoundingBox (0, -1, true).getWidth();
+            layout = new GlyphLayoutCache::Entry (key);
+            GlyphArrangement& arr = layout->glyphs;
+            arr.addLineOfText (context.getFont(), text, (float) startX, (float) baselineY);
+
+            if (flags != Justification::left)
+            {
+                float w = arr.getBoundingBox (0, -1, true).getWidth();
+
+                if ((flags & (Justification::horizontallyCentred | Justification::horizontallyJustified)) != 0)
+                    w /= 2.0f;
 
-            if ((flags & (Justification::horizontallyCentred | Justification::horizontallyJustified)) != 0)
-                w /= 2.0f;
+                layout->xOffset = -w;
+            }
 
-            arr.draw (*this, AffineTransform::translation (-w, 0));
+            GlyphLayoutCache::getInstance()->add (layout);
         }
+
+        if (flags != Justification::left)
+            layout->glyphs.draw (*this, AffineTransform::translation (layout->xOffset, 0));
         else
-        {
-            arr.draw (*this);
-        }
+            layout->glyphs.draw (*this);
     }
 }
 
@@ -273,11 +296,22 @@ void Graphics::drawMultiLineText (const String& text, const int startX,
     if (text.isNotEmpty()
          && startX < context.getClipBounds().getRight())
     {
-        GlyphArrangement arr;
-        arr.addJustifiedText (context.getFont(), text,
-                              (float) startX, (float) baselineY, (float) maximumLineWidth,
-                              Justification::left);
-        arr.draw (*this);
+        const GlyphLayoutCache::Key key (GlyphLayoutCache::multiLineText, context.getFont(), text,
+                                         Rectangle<float> ((float) startX, (float) baselineY, (float) maximumLineWidth, 0.0f),
+                                         0, 0, 0.0f);
+
+        GlyphLayoutCache::EntryPtr layout (GlyphLayoutCache::getInstance()->find (key));
+
+        if (layout == nullptr)
+        {
+            layout = new GlyphLayoutCache::Entry (key);
+            layout->glyphs.addJustifiedText (context.getFont(), text,
+                                             (float) startX, (float) baselineY, (float) maximumLineWidth,
+                                             Justification::left);
+            GlyphLayoutCache::getInstance()->add (layout);
+        }
+
+        layout->glyphs.draw (*this);
     }
 }
 
@@ -286,14 +320,27 @@ void Graphics::drawText (const String& text, Rectangle<float> area,
 {
     if (text.isNotEmpty() && context.clipRegionIntersects (area.getSmallestIntegerContainer()))
     {
-        GlyphArrangement arr;
-        arr.addCurtailedLineOfText (context.getFont(), text, 0.0f, 0.0f,
-                                    area.getWidth(), useEllipsesIfTooBig);
-
-        arr.justifyGlyphs (0, arr.getNumGlyphs(),
-                           area.getX(), area.getY(), area.getWidth(), area.getHeight(),
-                           justificationType);
-        arr.draw (*this);
+        const GlyphLayoutCache::Key key (GlyphLayoutCache::curtailedText, context.getFont(), text, area,
+                                         justificationType.getFlags(), useEllipsesIfTooBig ? 1 : 0, 0.0f);
+
+        GlyphLayoutCache::EntryPtr layout (GlyphLayoutCache::getInstance()->find (key));
+
+        if (layout == nullptr)
+        {
+            layout = new GlyphLayoutCache::Entry (key);
+            GlyphArrangement& arr = layout->glyphs;
+
+            arr.addCurtailedLineOfText (context.getFont(), text, 0.0f, 0.0f,
+                                        area.getWidth(), useEllipsesIfTooBig);
+
+            arr.justifyGlyphs (0, arr.getNumGlyphs(),
+                               area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                               justificationType);
+
+            GlyphLayoutCache::getInstance()->add (layout);
+        }
+
+        layout->glyphs.draw (*this);
     }
 }
 
@@ -316,15 +363,25 @@ void Graphics::drawFittedText (const String& text, Rectangle<int> area,
 {
     if (text.isNotEmpty() && (! area.isEmpty()) && context.clipRegionIntersects (area))
     {
-        GlyphArrangement arr;
-        arr.addFittedText (context.getFont(), text,
-                           (float) area.getX(), (float) area.getY(),
-                           (float) area.getWidth(), (float) area.getHeight(),
-                           justification,
-                           maximumNumberOfLines,
-                           minimumHorizontalScale);
-
-        arr.draw (*this);
+        const GlyphLayoutCache::Key key (GlyphLayoutCache::fittedText, context.getFont(), text, area.toFloat(),
+                                         justification.getFlags(), maximumNumberOfLines, minimumHorizontalScale);
+
+        GlyphLayoutCache::EntryPtr layout (GlyphLayoutCache::getInstance()->find (key));
+
+        if (layout == nullptr)
+        {
+            layout = new GlyphLayoutCache::Entry (key);
+            layout->glyphs.addFittedText (context.getFont(), text,
+                                          (float) area.getX(), (float) area.getY(),
+                                          (float) area.getWidth(), (float) area.getHeight(),
+                                          justification,
+                                          maximumNumberOfLines,
+                                          minimumHorizontalScale);
+
+            GlyphLayoutCache::getInstance()->add (layout);
+        }
+
+        layout->glyphs.draw (*this);
     }
 }
 
@@ -410,9 +467,8 @@ void Graphics::strokePath (const Path& path,
                            const PathStrokeType& strokeType,
                            const AffineTransform& transform) const
 {
-    Path stroke;
-    strokeType.createStrokedPath (stroke, path, transform, context.getPhysicalPixelScaleFactor());
-    fillPath (stroke);
+    if (! (context.isClipEmpty() || path.isEmpty()))
+        context.strokePath (path, strokeType, transform);
 }
 
 //==============================================================================
@@ -88,6 +88,12 @@ public:
     virtual void fillRect (const Rectangle<float>&) = 0;
     virtual void fillRectList (const RectangleList<float>&) = 0;
     virtual void fillPath (const Path&, const AffineTransform&) = 0;
+
+    /** Strokes a path. The default implementation creates the stroke's outline and fills it,
+        but a context can override this to avoid doing that every time.
+    */
+    virtual void strokePath (const Path&, const PathStrokeType&, const AffineTransform&);
+
     virtual void drawImage (const Image&, const AffineTransform&) = 0;
     virtual void drawLine (const Line<float>&) = 0;
 
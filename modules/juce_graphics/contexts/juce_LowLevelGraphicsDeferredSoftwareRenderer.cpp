@@ -0,0 +1,947 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+class DeferredRendererThreadPool  : public ThreadPool,
+                                    private DeletedAtShutdown
+{
+public:
+    DeferredRendererThreadPool() {}
+
+    ~DeferredRendererThreadPool()
+    {
+        clearSingletonInstance();
+    }
+
+    juce_DeclareSingleton (DeferredRendererThreadPool, false)
+
+    /** Returns the pool that the image-processing helpers should share their work out to,
+        or nullptr if they should do it all on the calling thread.
+
+        When the caller is already running a pool job (e.g. drawing a tile for a deferred
+        renderer), it mustn't wait for other jobs, because they could be stuck in the queue
+        behind it and all the other threads' jobs, which are waiting in the same way.
+    */
+    static ThreadPool* getInstanceForHelperJobs()
+    {
+        return ThreadPoolJob::getCurrentThreadPoolJob() == nullptr ? getInstance() : nullptr;
+    }
+};
+
+juce_ImplementSingleton (DeferredRendererThreadPool)
+
+//==============================================================================
+class LowLevelGraphicsDeferredSoftwareRenderer::CommandList
+{
+public:
+    CommandList() : numDrawingCommands (0) {}
+
+    enum CommandType
+    {
+        setOriginCommand,
+        addTransformCommand,
+        clipToRectangleCommand,
+        clipToRectangleListCommand,
+        excludeClipRectangleCommand,
+        clipToPathCommand,
+        clipToImageAlphaCommand,
+        saveStateCommand,
+        restoreStateCommand,
+        beginTransparencyLayerCommand,
+        endTransparencyLayerCommand,
+        setFillCommand,
+        setOpacityCommand,
+        setInterpolationQualityCommand,
+        fillRectCommand,
+        fillFloatRectCommand,
+        fillRectListCommand,
+        fillPathCommand,
+        drawImageCommand,
+        drawGlyphCommand
+    };
+
+    struct Command
+    {
+        Command (CommandType t) noexcept  : type (t), index (0), value (0), flag (false) {}
+
+        CommandType type;
+        Rectangle<int> area;          // rectangles, origins and transparency layer bounds
+        Rectangle<float> floatArea;
+        AffineTransform transform;
+        Range<int> rows;              // the device rows that a drawing command can affect (empty for state changes)
+        Point<int> layerOrigin;       // where the layer being ended sits within the target image
+        int index;                    // the command's entry in one of the object lists below
+        float value;
+        bool flag;
+    };
+
+    Command& add (CommandType type)
+    {
+        commands.add (Command (type));
+        return commands.getReference (commands.size() - 1);
+    }
+
+    Command& addDrawing (CommandType type, Range<int> rows)
+    {
+        jassert (! rows.isEmpty());
+        ++numDrawingCommands;
+
+        Command& c = add (type);
+        c.rows = rows;
+        return c;
+    }
+
+    /** Throws away everything that has been drawn, keeping the state changes needed to
+        put a fresh tile into the same state as the recorder.
+    */
+    void removeDrawingCommands()
+    {
+        Array<Command> stateChanges;
+
+        for (const Command* c = commands.begin(), * const e = commands.end(); c != e; ++c)
+        {
+            if (c->rows.isEmpty())
+            {
+                stateChanges.add (*c);
+                continue;
+            }
+
+            switch (c->type)
+            {
+                case fillRectListCommand:   floatRectangleLists.set (c->index, nullptr); break;
+                case fillPathCommand:       paths.set (c->index, nullptr); break;
+                case drawImageCommand:      images.set (c->index, Image()); break;
+                case drawGlyphCommand:      glyphs.set (c->index, nullptr); break;
+                default:                    break;
+            }
+        }
+
+        commands.swapWith (stateChanges);
+        numDrawingCommands = 0;
+    }
+
+    Array<Command> commands;
+    OwnedArray<Path> paths;
+    OwnedArray<RectangleList<int> > rectangleLists;
+    OwnedArray<RectangleList<float> > floatRectangleLists;
+    OwnedArray<RenderingHelpers::SoftwareRendererSavedState::PreparedGlyph> glyphs;
+    Array<FillType> fills;
+    Array<Image> images;
+    int numDrawingCommands;
+
+    JUCE_DECLARE_NON_COPYABLE (CommandList)
+};
+
+//==============================================================================
+class LowLevelGraphicsDeferredSoftwareRenderer::TileRenderer
+{
+public:
+    TileRenderer (const Image& image, Point<int> origin, const RectangleList<int>& tileClip, Range<int> rows)
+        : stack (new RenderingHelpers::SoftwareRendererSavedState (image, tileClip, origin)),
+          tileRows (rows)
+    {
+    }
+
+    void render (const CommandList& list)
+    {
+        for (const CommandList::Command* c = list.commands.begin(), * const e = list.commands.end(); c != e; ++c)
+            if (c->rows.isEmpty() || c->rows.intersects (tileRows))
+                perform (list, *c);
+    }
+
+private:
+    typedef RenderingHelpers::SoftwareRendererSavedState SavedState;
+
+    RenderingHelpers::SavedStateStack<SavedState> stack;
+    const Range<int> tileRows;
+
+    void perform (const CommandList& list, const CommandList::Command& c)
+    {
+        switch (c.type)
+        {
+            case CommandList::setOriginCommand:                 stack->transform.setOrigin (c.area.getPosition()); break;
+            case CommandList::addTransformCommand:              stack->transform.addTransform (c.transform); break;
+            case CommandList::clipToRectangleCommand:           stack->clipToRectangle (c.area); break;
+            case CommandList::clipToRectangleListCommand:       stack->clipToRectangleList (*list.rectangleLists.getUnchecked (c.index)); break;
+            case CommandList::excludeClipRectangleCommand:      stack->excludeClipRectangle (c.area); break;
+            case CommandList::clipToPathCommand:                stack->clipToPath (*list.paths.getUnchecked (c.index), c.transform); break;
+            case CommandList::clipToImageAlphaCommand:          stack->clipToImageAlpha (list.images.getReference (c.index), c.transform); break;
+            case CommandList::saveStateCommand:                 stack.save(); break;
+            case CommandList::restoreStateCommand:              stack.restore(); break;
+            case CommandList::beginTransparencyLayerCommand:    beginTransparencyLayer (c.area, c.value); break;
+            case CommandList::endTransparencyLayerCommand:      endTransparencyLayer (c.area, c.layerOrigin); break;
+            case CommandList::setFillCommand:                   stack->setFillType (list.fills.getReference (c.index)); break;
+            case CommandList::setOpacityCommand:                stack->fillType.setOpacity (c.value); break;
+            case CommandList::setInterpolationQualityCommand:   stack->interpolationQuality = (Graphics::ResamplingQuality) c.index; break;
+            case CommandList::fillRectCommand:                  stack->fillRect (c.area, c.flag); break;
+            case CommandList::fillFloatRectCommand:             stack->fillRect (c.floatArea); break;
+            case CommandList::fillRectListCommand:              stack->fillRectList (*list.floatRectangleLists.getUnchecked (c.index)); break;
+            case CommandList::fillPathCommand:                  stack->fillPath (*list.paths.getUnchecked (c.index), c.transform); break;
+            case CommandList::drawImageCommand:                 stack->drawImage (list.images.getReference (c.index), c.transform); break;
+            case CommandList::drawGlyphCommand:                 stack->drawPreparedGlyph (*list.glyphs.getUnchecked (c.index)); break;
+            default:                                            jassertfalse; break;
+        }
+    }
+
+    // The layer has the same size and position as it would have had in an immediate-mode
+    // renderer (even though only this tile's rows of it will be drawn), so that everything
+    // drawn into it is positioned exactly the same.
+    void beginTransparencyLayer (const Rectangle<int>& layerBounds, float opacity)
+    {
+        stack.save();
+
+        if (stack->clip != nullptr && ! layerBounds.isEmpty())
+        {
+            stack->image = Image (Image::ARGB, layerBounds.getWidth(), layerBounds.getHeight(), true);
+            stack->transparencyLayerAlpha = opacity;
+            stack->transform.moveOriginInDeviceSpace (-layerBounds.getPosition());
+            stack->cloneClipIfMultiplyReferenced();
+            stack->clip->translate (-layerBounds.getPosition());
+        }
+    }
+
+    void endTransparencyLayer (const Rectangle<int>& layerBounds, Point<int> layerOrigin)
+    {
+        const Image layerImage (stack->image);
+        const float layerAlpha = stack->transparencyLayerAlpha;
+        stack.restore();
+
+        if (layerImage != stack->image)
+        {
+            const ScopedPointer<LowLevelGraphicsContext> g (stack->image.createLowLevelContext());
+            g->clipToRectangle (Rectangle<int> (layerBounds.getX(), tileRows.getStart() - layerOrigin.y,
+                                                layerBounds.getWidth(), tileRows.getLength()));
+            g->setOpacity (layerAlpha);
+            g->drawImage (layerImage, AffineTransform::translation (layerBounds.getPosition()));
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (TileRenderer)
+};
+
+//==============================================================================
+class LowLevelGraphicsDeferredSoftwareRenderer::TileJob  : public ThreadPoolJob
+{
+public:
+    TileJob (const LowLevelGraphicsDeferredSoftwareRenderer& r, const RectangleList<int>& clip, Range<int> rows)
+        : ThreadPoolJob ("Deferred renderer tile"), owner (r), tileClip (clip), tileRows (rows)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        owner.renderTile (tileClip, tileRows);
+        return jobHasFinished;
+    }
+
+private:
+    const LowLevelGraphicsDeferredSoftwareRenderer& owner;
+    const RectangleList<int> tileClip;
+    const Range<int> tileRows;
+
+    JUCE_DECLARE_NON_COPYABLE (TileJob)
+};
+
+//==============================================================================
+namespace DeferredRendererHelpers
+{
+    // Only images whose pixels live in memory can be read by several tile threads at once.
+    static Image getImageForSharing (const Image& image)
+    {
+        if (image.isValid())
+        {
+            const int typeID = ScopedPointer<ImageType> (image.getPixelData()->createType())->getTypeID();
+
+            if (typeID != SoftwareImageType().getTypeID() && typeID != NativeImageType().getTypeID())
+                return SoftwareImageType().convert (image);
+        }
+
+        return image;
+    }
+
+    static FillType getFillForSharing (const FillType& fill)
+    {
+        if (! fill.isTiledImage())
+            return fill;
+
+        FillType f (fill);
+        f.image = getImageForSharing (fill.image);
+        return f;
+    }
+}
+
+//==============================================================================
+LowLevelGraphicsDeferredSoftwareRenderer::LowLevelGraphicsDeferredSoftwareRenderer (const Image& im, ThreadPool* pool)
+    : image (im), initialClip (im.getBounds()), threadPool (pool)
+{
+    initialise();
+}
+
+LowLevelGraphicsDeferredSoftwareRenderer::LowLevelGraphicsDeferredSoftwareRenderer (const Image& im, Point<int> origin,
+                                                                                    const RectangleList<int>& clip,
+                                                                                    ThreadPool* pool)
+    : image (im), initialClip (clip), initialOrigin (origin), threadPool (pool)
+{
+    initialise();
+}
+
+LowLevelGraphicsDeferredSoftwareRenderer::~LowLevelGraphicsDeferredSoftwareRenderer()
+{
+    flush();
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::initialise()
+{
+    // You need to give the renderer a valid image to draw onto!
+    jassert (image.isValid());
+
+    const int numCpus = SystemStats::getNumCpus();
+    maxTiles = numCpus > 1 ? numCpus * 2 : 1;
+    state.initialise (new RenderingHelpers::SoftwareRendererSavedState (image, initialClip, initialOrigin));
+    commands = new CommandList();
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setMaximumNumberOfTiles (int newMaxTiles) noexcept
+{
+    jassert (newMaxTiles > 0);
+    maxTiles = jmax (1, newMaxTiles);
+}
+
+//==============================================================================
+Point<int> LowLevelGraphicsDeferredSoftwareRenderer::getCurrentLayerOrigin() const noexcept
+{
+    return layerOrigins.size() > 0 ? layerOrigins.getLast() : Point<int>();
+}
+
+Range<int> LowLevelGraphicsDeferredSoftwareRenderer::getRowsCoveredBy (const Rectangle<int>& deviceArea) const noexcept
+{
+    const Rectangle<int> area (deviceArea.getIntersection (state->clip->getClipBounds()));
+
+    if (area.isEmpty())
+        return Range<int>();
+
+    const int y = area.getY() + getCurrentLayerOrigin().y;
+    return Range<int> (y, y + area.getHeight());
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::renderTile (const RectangleList<int>& tileClip, Range<int> tileRows) const
+{
+    TileRenderer tile (image, initialOrigin, tileClip, tileRows);
+    tile.render (*commands);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::flush()
+{
+    // You can't flush the commands while a transparency layer is still being drawn..
+    jassert (layerOrigins.size() == 0);
+
+    if (commands->numDrawingCommands == 0 || layerOrigins.size() > 0)
+        return;
+
+    const Rectangle<int> area (initialClip.getBounds());
+    const int minTileHeight = 32;
+    const int numTiles = jlimit (1, maxTiles, area.getHeight() / minTileHeight);
+
+    if (numTiles == 1)
+    {
+        renderTile (initialClip, Range<int> (area.getY(), area.getBottom()));
+    }
+    else
+    {
+        ThreadPool& pool = threadPool != nullptr ? *threadPool : *DeferredRendererThreadPool::getInstance();
+        OwnedArray<TileJob> jobs;
+        RectangleList<int> firstTileClip;
+        Range<int> firstTileRows;
+
+        for (int i = 0; i < numTiles; ++i)
+        {
+            const int top    = area.getY() + (area.getHeight() * i) / numTiles;
+            const int bottom = area.getY() + (area.getHeight() * (i + 1)) / numTiles;
+
+            RectangleList<int> tileClip (initialClip);
+            tileClip.clipTo (Rectangle<int> (area.getX(), top, area.getWidth(), bottom - top));
+
+            if (tileClip.isEmpty())
+                continue;
+
+            if (firstTileClip.isEmpty())
+            {
+                firstTileClip.swapWith (tileClip);
+                firstTileRows = Range<int> (top, bottom);
+            }
+            else
+            {
+                TileJob* job = jobs.add (new TileJob (*this, tileClip, Range<int> (top, bottom)));
+                pool.addJob (job, false);
+            }
+        }
+
+        // The calling thread renders one of the tiles itself while the pool does the rest..
+        renderTile (firstTileClip, firstTileRows);
+
+        for (int i = 0; i < jobs.size(); ++i)
+            pool.waitForJobToFinish (jobs.getUnchecked (i), -1);
+    }
+
+    commands->removeDrawingCommands();
+}
+
+//==============================================================================
+bool LowLevelGraphicsDeferredSoftwareRenderer::isVectorDevice() const                  { return false; }
+float LowLevelGraphicsDeferredSoftwareRenderer::getPhysicalPixelScaleFactor()          { return state->transform.getPhysicalPixelScaleFactor(); }
+Rectangle<int> LowLevelGraphicsDeferredSoftwareRenderer::getClipBounds() const         { return state->getClipBounds(); }
+bool LowLevelGraphicsDeferredSoftwareRenderer::isClipEmpty() const                     { return state->clip == nullptr; }
+bool LowLevelGraphicsDeferredSoftwareRenderer::clipRegionIntersects (const Rectangle<int>& r)  { return state->clipRegionIntersects (r); }
+const Font& LowLevelGraphicsDeferredSoftwareRenderer::getFont()                        { return state->font; }
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setOrigin (Point<int> o)
+{
+    state->transform.setOrigin (o);
+    commands->add (CommandList::setOriginCommand).area.setPosition (o);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::addTransform (const AffineTransform& t)
+{
+    state->transform.addTransform (t);
+    commands->add (CommandList::addTransformCommand).transform = t;
+}
+
+bool LowLevelGraphicsDeferredSoftwareRenderer::clipToRectangle (const Rectangle<int>& r)
+{
+    commands->add (CommandList::clipToRectangleCommand).area = r;
+    return state->clipToRectangle (r);
+}
+
+bool LowLevelGraphicsDeferredSoftwareRenderer::clipToRectangleList (const RectangleList<int>& r)
+{
+    commands->add (CommandList::clipToRectangleListCommand).index = commands->rectangleLists.size();
+    commands->rectangleLists.add (new RectangleList<int> (r));
+    return state->clipToRectangleList (r);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::excludeClipRectangle (const Rectangle<int>& r)
+{
+    commands->add (CommandList::excludeClipRectangleCommand).area = r;
+    state->excludeClipRectangle (r);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::clipToPath (const Path& path, const AffineTransform& t)
+{
+    CommandList::Command& c = commands->add (CommandList::clipToPathCommand);
+    c.transform = t;
+    c.index = commands->paths.size();
+    commands->paths.add (new Path (path));
+    state->clipToPath (path, t);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::clipToImageAlpha (const Image& im, const AffineTransform& t)
+{
+    CommandList::Command& c = commands->add (CommandList::clipToImageAlphaCommand);
+    c.transform = t;
+    c.index = commands->images.size();
+    commands->images.add (DeferredRendererHelpers::getImageForSharing (im));
+    state->clipToImageAlpha (im, t);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::saveState()
+{
+    commands->add (CommandList::saveStateCommand);
+    state.save();
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::restoreState()
+{
+    commands->add (CommandList::restoreStateCommand);
+    state.restore();
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::beginTransparencyLayer (float opacity)
+{
+    CommandList::Command& c = commands->add (CommandList::beginTransparencyLayerCommand);
+    c.value = opacity;
+
+    // This mirrors SoftwareRendererSavedState::beginTransparencyLayer(), without creating the image
+    state.save();
+    Point<int> layerOrigin (getCurrentLayerOrigin());
+
+    if (state->clip != nullptr)
+    {
+        const Rectangle<int> layerBounds (state->clip->getClipBounds());
+        c.area = layerBounds;
+
+        state->transform.moveOriginInDeviceSpace (-layerBounds.getPosition());
+        state->cloneClipIfMultiplyReferenced();
+        state->clip->translate (-layerBounds.getPosition());
+        layerOrigin += layerBounds.getPosition();
+    }
+
+    layerOrigins.add (layerOrigin);
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::endTransparencyLayer()
+{
+    jassert (layerOrigins.size() > 0); // trying to end a layer that was never started!
+    layerOrigins.removeLast();
+    state.restore();
+
+    CommandList::Command& c = commands->add (CommandList::endTransparencyLayerCommand);
+    c.layerOrigin = getCurrentLayerOrigin();
+
+    if (state->clip != nullptr)
+        c.area = state->clip->getClipBounds();
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setFill (const FillType& fill)
+{
+    commands->add (CommandList::setFillCommand).index = commands->fills.size();
+    commands->fills.add (DeferredRendererHelpers::getFillForSharing (fill));
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setOpacity (float newOpacity)
+{
+    commands->add (CommandList::setOpacityCommand).value = newOpacity;
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setInterpolationQuality (Graphics::ResamplingQuality quality)
+{
+    commands->add (CommandList::setInterpolationQualityCommand).index = (int) quality;
+    state->interpolationQuality = quality;
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::setFont (const Font& newFont)
+{
+    state->font = newFont;
+}
+
+//==============================================================================
+void LowLevelGraphicsDeferredSoftwareRenderer::fillRect (const Rectangle<int>& r, bool replaceExistingContents)
+{
+    if (state->clip != nullptr)
+    {
+        CommandList::Command& c = commands->addDrawing (CommandList::fillRectCommand,
+                                                        getRowsCoveredBy (state->clip->getClipBounds()));
+        c.area = r;
+        c.flag = replaceExistingContents;
+    }
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::fillRect (const Rectangle<float>& r)
+{
+    if (state->clip != nullptr)
+        commands->addDrawing (CommandList::fillFloatRectCommand,
+                              getRowsCoveredBy (state->clip->getClipBounds())).floatArea = r;
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::fillRectList (const RectangleList<float>& list)
+{
+    if (state->clip != nullptr)
+    {
+        commands->addDrawing (CommandList::fillRectListCommand,
+                              getRowsCoveredBy (state->clip->getClipBounds())).index = commands->floatRectangleLists.size();
+        commands->floatRectangleLists.add (new RectangleList<float> (list));
+    }
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::fillPath (const Path& path, const AffineTransform& t)
+{
+    if (state->clip != nullptr)
+    {
+        const Range<int> rows (getRowsCoveredBy (path.getBoundsTransformed (state->transform.getTransformWith (t))
+                                                     .getSmallestIntegerContainer()));
+
+        if (! rows.isEmpty())
+        {
+            CommandList::Command& c = commands->addDrawing (CommandList::fillPathCommand, rows);
+            c.transform = t;
+            c.index = commands->paths.size();
+            commands->paths.add (new Path (path));
+        }
+    }
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::drawLine (const Line<float>& line)
+{
+    // (this is drawn in the same way as SavedStateBase::drawLine)
+    Path p;
+    p.addLineSegment (line, 1.0f);
+    fillPath (p, AffineTransform());
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::drawImage (const Image& im, const AffineTransform& t)
+{
+    jassert (im != image); // the tiles can't read from the image that they're drawing onto
+
+    if (state->clip != nullptr)
+    {
+        CommandList::Command& c = commands->addDrawing (CommandList::drawImageCommand,
+                                                        getRowsCoveredBy (state->clip->getClipBounds()));
+        c.transform = t;
+        c.index = commands->images.size();
+        commands->images.add (DeferredRendererHelpers::getImageForSharing (im));
+    }
+}
+
+void LowLevelGraphicsDeferredSoftwareRenderer::drawGlyph (int glyphNumber, const AffineTransform& t)
+{
+    if (state->clip != nullptr)
+    {
+        ScopedPointer<RenderingHelpers::SoftwareRendererSavedState::PreparedGlyph> glyph
+            (new RenderingHelpers::SoftwareRendererSavedState::PreparedGlyph());
+
+        state->prepareGlyph (*glyph, glyphNumber, t);
+
+        Rectangle<int> glyphBounds;
+
+        if (glyph->cachedGlyph != nullptr)
+        {
+            if (const EdgeTable* et = glyph->cachedGlyph->edgeTable)
+                glyphBounds = et->getMaximumBounds().translated ((int) std::floor (glyph->position.x),
+                                                                 roundToInt (glyph->position.y)).expanded (1, 0);
+        }
+        else if (glyph->edgeTable != nullptr)
+        {
+            glyphBounds = glyph->edgeTable->getMaximumBounds();
+        }
+
+        const Range<int> rows (getRowsCoveredBy (glyphBounds));
+
+        if (! rows.isEmpty())
+        {
+            commands->addDrawing (CommandList::drawGlyphCommand, rows).index = commands->glyphs.size();
+            commands->glyphs.add (glyph.release());
+        }
+    }
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class DeferredSoftwareRendererTests  : public UnitTest
+{
+public:
+    DeferredSoftwareRendererTests() : UnitTest ("LowLevelGraphicsDeferredSoftwareRenderer") {}
+
+    // Glyphs built from paths, so that text can be tested without any fonts being installed
+    static Font createTestFont()
+    {
+        CustomTypeface* typeface = new CustomTypeface();
+        typeface->setCharacteristics ("Deferred Renderer Test", 0.8f, false, false, ' ');
+
+        for (juce_wchar c = 33; c < 127; ++c)
+        {
+            const float k = (c % 7) / 14.0f;
+
+            Path p;
+            p.addRoundedRectangle (0.05f, -0.75f + k * 0.5f, 0.45f + k * 0.2f, 0.75f - k * 0.5f, 0.1f);
+            p.addEllipse (0.15f, -0.55f + k * 0.3f, 0.2f + k * 0.1f, 0.25f);
+            p.addTriangle (0.1f, 0.2f, 0.3f + k, 0.0f, 0.5f, 0.2f);
+            p.setUsingNonZeroWinding (false);
+            typeface->addGlyph (c, p, 0.55f + k * 0.2f);
+        }
+
+        return Font (Typeface::Ptr (typeface)).withHeight (15.0f);
+    }
+
+    static Image createSprite()
+    {
+        Image sprite (Image::ARGB, 64, 48, true);
+        Graphics g (sprite);
+        g.setGradientFill (ColourGradient (Colours::orange, 0, 0, Colours::darkblue.withAlpha (0.3f), 64, 48, false));
+        g.fillEllipse (2.0f, 2.0f, 60.0f, 44.0f);
+        g.setColour (Colours::white);
+        g.drawLine (0, 47.0f, 63.0f, 0, 3.0f);
+        return sprite;
+    }
+
+    // A few pages of the sort of drawing that a typical UI does, standing in for the Demo's pages
+    static void drawPage (Graphics& g, int page, int w, int h, const Font& font, const Image& sprite)
+    {
+        Random r (page + 1);
+
+        if (page == 0)
+        {
+            g.setGradientFill (ColourGradient (Colour (0xff303840), 0, 0, Colour (0xff101418), 0, (float) h, false));
+            g.fillAll();
+
+            for (int y = 4; y + 30 < h; y += 36)
+            {
+                for (int x = 7; x + 100 < w; x += 113)
+                {
+                    // Each widget is drawn the way a component would paint itself
+                    Graphics::ScopedSaveState ss (g);
+                    const Rectangle<int> bounds (x, y, 100, 30);
+                    g.reduceClipRegion (bounds);
+                    g.setOrigin (bounds.getPosition());
+
+                    const Colour base (Colour::fromHSV (r.nextFloat(), 0.5f, 0.7f, 1.0f));
+                    g.setGradientFill (ColourGradient (base.brighter(), 0, 0, base.darker(), 0, 30.0f, false));
+                    g.fillRoundedRectangle (1.5f, 1.5f, 97.0f, 27.0f, 5.0f);
+                    g.setColour (Colours::black.withAlpha (0.6f));
+                    g.drawRoundedRectangle (1.5f, 1.5f, 97.0f, 27.0f, 5.0f, 1.0f);
+
+                    g.setColour (Colours::white);
+                    g.setFont (font);
+                    g.drawText ("Button " + String (x + y), 4, 4, 92, 22, Justification::centred, true);
+
+                    if (((x + y) & 1) == 0)
+                    {
+                        g.setColour (Colours::yellow.withAlpha (0.8f));
+                        g.fillEllipse (70.0f + r.nextFloat() * 10.0f, 8.0f, 14.0f, 14.0f);
+                    }
+                }
+            }
+        }
+        else if (page == 1)
+        {
+            g.fillAll (Colours::white);
+
+            for (int i = 0; i < 60; ++i)
+            {
+                Path star;
+                star.addStar (Point<float> (r.nextFloat() * w, r.nextFloat() * h), 5 + i % 4, 10.0f + r.nextFloat() * 30.0f,
+                              40.0f + r.nextFloat() * 80.0f, r.nextFloat() * 3.0f);
+
+                const Rectangle<float> starBounds (star.getBounds());
+                g.setGradientFill (ColourGradient (Colour (r.nextInt()).withAlpha (0.7f), starBounds.getCentreX(), starBounds.getCentreY(),
+                                                   Colour (r.nextInt()).withAlpha (0.2f), starBounds.getX(), starBounds.getY(), true));
+                g.fillPath (star);
+
+                Path outline;
+                PathStrokeType (2.0f + (i % 3)).createStrokedPath (outline, star, AffineTransform::rotation (0.1f * i, w * 0.5f, h * 0.5f));
+                g.setColour (Colours::black.withAlpha (0.5f));
+                g.fillPath (outline);
+            }
+
+            {
+                Graphics::ScopedSaveState ss (g);
+                Path clip;
+                clip.addEllipse (w * 0.1f, h * 0.2f, w * 0.7f, h * 0.6f);
+                g.reduceClipRegion (clip, AffineTransform::rotation (0.2f, w * 0.5f, h * 0.5f));
+                g.beginTransparencyLayer (0.6f);
+                g.setColour (Colours::darkgreen);
+                g.fillCheckerBoard (Rectangle<int> (0, 0, w, h), 23, 17, Colours::green, Colours::darkgreen.withAlpha (0.5f));
+
+                g.beginTransparencyLayer (0.5f);
+                g.setColour (Colours::purple);
+                g.fillRect (Rectangle<float> (w * 0.3f, h * 0.05f, w * 0.35f, h * 0.9f));
+                g.endTransparencyLayer();
+
+                g.endTransparencyLayer();
+            }
+
+            g.setFont (font);
+
+            for (int i = 0; i < 12; ++i)
+            {
+                Graphics::ScopedSaveState ss (g);
+                g.addTransform (AffineTransform::rotation (i * 0.5f).translated (w * 0.5f, h * 0.5f));
+                g.setColour (Colours::navy);
+                g.drawSingleLineText ("Rotated text " + String (i), 20, 0);
+            }
+
+            g.addTransform (AffineTransform::scale (1.7f, 1.3f));
+            g.setColour (Colours::maroon);
+            g.drawSingleLineText ("Scaled text drawn through the glyph cache", 10, 20);
+        }
+        else
+        {
+            g.fillAll (Colours::lightgrey);
+            g.setTiledImageFill (sprite, 3, 5, 0.7f);
+            g.fillRect (Rectangle<int> (0, 0, w / 3, h));
+            g.excludeClipRegion (Rectangle<int> (w / 2, h / 4, w / 6, h / 2));
+
+            for (int i = 0; i < 40; ++i)
+            {
+                g.setImageResamplingQuality (i % 3 == 0 ? Graphics::lowResamplingQuality
+                                                        : (i % 3 == 1 ? Graphics::mediumResamplingQuality
+                                                                      : Graphics::highResamplingQuality));
+                g.setOpacity (0.3f + (i % 7) / 10.0f);
+                g.drawImageTransformed (sprite, AffineTransform::rotation (r.nextFloat() * 6.0f)
+                                                                .scaled (0.5f + r.nextFloat() * 3.0f)
+                                                                .translated (r.nextFloat() * w, r.nextFloat() * h));
+                g.drawImageAt (sprite, r.nextInt (w), r.nextInt (h));
+            }
+
+            {
+                Graphics::ScopedSaveState ss (g);
+                g.reduceClipRegion (sprite, AffineTransform::scale (4.0f).translated (w * 0.6f, h * 0.1f));
+                g.setColour (Colours::red);
+                g.fillAll();
+            }
+
+            RectangleList<float> bars;
+
+            for (int i = 0; i < 30; ++i)
+                bars.addWithoutMerging (Rectangle<float> (5.0f + i * 9.3f, h - 10.0f - i * 3.7f, 6.5f, i * 3.7f));
+
+            g.setColour (Colours::darkorange);
+            g.fillRectList (bars);
+
+            for (int i = 0; i < 50; ++i)
+            {
+                g.setColour (Colour (r.nextInt()));
+                g.drawLine (r.nextFloat() * w, r.nextFloat() * h, r.nextFloat() * w, r.nextFloat() * h, 0.5f + r.nextFloat() * 3.0f);
+            }
+        }
+    }
+
+    static Image createTarget (Image::PixelFormat format, int w, int h)
+    {
+        Image im (format, w, h, true);
+        Image::BitmapData data (im, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                data.setPixelColour (x, y, Colour ((uint8) (x * 3), (uint8) (y * 5), (uint8) (x ^ y), (uint8) (128 + (x & 127))));
+
+        return im;
+    }
+
+    static void render (LowLevelGraphicsContext& context, int page, int w, int h, const Font& font, const Image& sprite)
+    {
+        Graphics g (context);
+        drawPage (g, page, w, h, font, sprite);
+    }
+
+    void expectIdenticalOutput (Image::PixelFormat format, int w, int h, Point<int> origin,
+                                const RectangleList<int>& clip, int numTiles)
+    {
+        const Font font (createTestFont());
+        const Image sprite (createSprite());
+
+        for (int page = 0; page < 3; ++page)
+        {
+            Image immediate (createTarget (format, w, h));
+            Image deferred (createTarget (format, w, h));
+
+            {
+                LowLevelGraphicsSoftwareRenderer context (immediate, origin, clip);
+                render (context, page, w, h, font, sprite);
+            }
+
+            {
+                LowLevelGraphicsDeferredSoftwareRenderer context (deferred, origin, clip);
+                context.setMaximumNumberOfTiles (numTiles);
+                render (context, page, w, h, font, sprite);
+            }
+
+            expect (RenderingHelpers::imagesAreIdentical (immediate, deferred), "page " + String (page) + " differs");
+        }
+    }
+
+    void runTest() override
+    {
+        beginTest ("Output matches the immediate renderer");
+        {
+            RectangleList<int> all (Rectangle<int> (0, 0, 400, 300));
+
+            expectIdenticalOutput (Image::ARGB, 400, 300, Point<int>(), all, 1);
+            expectIdenticalOutput (Image::ARGB, 400, 300, Point<int>(), all, 7);
+            expectIdenticalOutput (Image::RGB,  400, 300, Point<int>(), all, 5);
+        }
+
+        beginTest ("Output matches the immediate renderer with an irregular clip region");
+        {
+            // The tiles see different parts of this region, so their clip bounds are all different
+            RectangleList<int> clip;
+            clip.add (Rectangle<int> (10, 5, 120, 60));
+            clip.add (Rectangle<int> (200, 40, 190, 90));
+            clip.add (Rectangle<int> (40, 150, 300, 30));
+            clip.add (Rectangle<int> (0, 220, 250, 75));
+            clip.add (Rectangle<int> (330, 200, 60, 95));
+
+            expectIdenticalOutput (Image::ARGB, 400, 300, Point<int> (13, -7), clip, 9);
+            expectIdenticalOutput (Image::RGB,  400, 300, Point<int> (-20, 30), clip, 4);
+        }
+
+        beginTest ("Flushing part-way through");
+        {
+            const Font font (createTestFont());
+            const Image sprite (createSprite());
+            Image immediate (createTarget (Image::ARGB, 300, 200));
+            Image deferred (createTarget (Image::ARGB, 300, 200));
+
+            {
+                LowLevelGraphicsSoftwareRenderer context (immediate);
+                Graphics g (context);
+                g.addTransform (AffineTransform::rotation (0.3f));
+                drawPage (g, 1, 300, 200, font, sprite);
+                drawPage (g, 2, 300, 200, font, sprite);
+            }
+
+            {
+                LowLevelGraphicsDeferredSoftwareRenderer context (deferred);
+                context.setMaximumNumberOfTiles (6);
+                Graphics g (context);
+                g.addTransform (AffineTransform::rotation (0.3f));
+                drawPage (g, 1, 300, 200, font, sprite);
+                context.flush();
+                drawPage (g, 2, 300, 200, font, sprite);
+            }
+
+            expect (RenderingHelpers::imagesAreIdentical (immediate, deferred));
+        }
+
+        beginTest ("Offscreen page rendering benchmark");
+        {
+            const Font font (createTestFont());
+            const Image sprite (createSprite());
+            const int w = 1920, h = 1080, numFrames = 3;
+
+            for (int page = 0; page < 3; ++page)
+            {
+                Image immediate (Image::RGB, w, h, true);
+                Image deferred (Image::RGB, w, h, true);
+
+                double start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    LowLevelGraphicsSoftwareRenderer context (immediate);
+                    render (context, page, w, h, font, sprite);
+                }
+
+                const double immediateTime = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+                start = Time::getMillisecondCounterHiRes();
+
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    LowLevelGraphicsDeferredSoftwareRenderer context (deferred);
+                    render (context, page, w, h, font, sprite);
+                }
+
+                const double deferredTime = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+
+                logMessage ("Page " + String (page) + " at " + String (w) + "x" + String (h)
+                              + ": immediate " + String (immediateTime, 1) + " ms, deferred "
+                              + String (deferredTime, 1) + " ms (" + String (SystemStats::getNumCpus()) + " CPUs)");
+
+                expect (RenderingHelpers::imagesAreIdentical (immediate, deferred));
+            }
+        }
+    }
+};
+
+static DeferredSoftwareRendererTests deferredSoftwareRendererTests;
+
+#endif
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+#ifndef JUCE_LOWLEVELGRAPHICSDEFERREDSOFTWARERENDERER_H_INCLUDED
+#define JUCE_LOWLEVELGRAPHICSDEFERREDSOFTWARERENDERER_H_INCLUDED
+
+
+//==============================================================================
+/**
+    A software renderer that records its drawing operations into a command list, and
+    then rasterises them as a set of horizontal tiles in parallel on a thread pool.
+
+    The commands are rendered when flush() is called or when the renderer is deleted.
+    Each tile replays the whole list through its own LowLevelGraphicsSoftwareRenderer
+    state, with the initial clip region reduced to the tile, and skips any drawing
+    operations that can't touch its rows. The output is pixel-for-pixel identical to
+    what a LowLevelGraphicsSoftwareRenderer would draw.
+
+    Fonts and glyphs are resolved while the commands are being recorded, so the tile
+    threads never touch a typeface. Images that are drawn are only referenced, so they
+    mustn't be modified until the commands have been flushed, and you can't draw the
+    target image onto itself.
+
+    As with the other renderers, user code isn't supposed to use this class directly -
+    do all your rendering via the Graphics class instead.
+
+    @see LowLevelGraphicsSoftwareRenderer
+*/
+class JUCE_API  LowLevelGraphicsDeferredSoftwareRenderer    : public LowLevelGraphicsContext
+{
+public:
+    //==============================================================================
+    /** Creates a context to render into an image.
+
+        If no thread pool is supplied, a shared pool with a thread for each CPU is used.
+    */
+    LowLevelGraphicsDeferredSoftwareRenderer (const Image& imageToRenderOnto,
+                                              ThreadPool* poolToUse = nullptr);
+
+    /** Creates a context to render into a clipped subsection of an image. */
+    LowLevelGraphicsDeferredSoftwareRenderer (const Image& imageToRenderOnto, Point<int> origin,
+                                              const RectangleList<int>& initialClip,
+                                              ThreadPool* poolToUse = nullptr);
+
+    /** Destructor.
+        This flushes any commands that haven't been rendered yet.
+    */
+    ~LowLevelGraphicsDeferredSoftwareRenderer();
+
+    //==============================================================================
+    /** Renders all the commands that have been recorded so far onto the image.
+
+        This blocks until all the tiles have finished. It can't be called while a
+        transparency layer is open.
+    */
+    void flush();
+
+    /** Sets the maximum number of tiles that the image will be split into.
+        By default this is twice the number of CPUs, or just one tile on a single-core
+        machine. Tiles are never made less than 32 pixels high, so small areas may be
+        rendered with fewer tiles than this.
+    */
+    void setMaximumNumberOfTiles (int maxNumTiles) noexcept;
+
+    //==============================================================================
+    bool isVectorDevice() const override;
+    void setOrigin (Point<int>) override;
+    void addTransform (const AffineTransform&) override;
+    float getPhysicalPixelScaleFactor() override;
+    bool clipToRectangle (const Rectangle<int>&) override;
+    bool clipToRectangleList (const RectangleList<int>&) override;
+    void excludeClipRectangle (const Rectangle<int>&) override;
+    void clipToPath (const Path&, const AffineTransform&) override;
+    void clipToImageAlpha (const Image&, const AffineTransform&) override;
+    bool clipRegionIntersects (const Rectangle<int>&) override;
+    Rectangle<int> getClipBounds() const override;
+    bool isClipEmpty() const override;
+    void saveState() override;
+    void restoreState() override;
+    void beginTransparencyLayer (float opacity) override;
+    void endTransparencyLayer() override;
+    void setFill (const FillType&) override;
+    void setOpacity (float) override;
+    void setInterpolationQuality (Graphics::ResamplingQuality) override;
+    void fillRect (const Rectangle<int>&, bool replaceExistingContents) override;
+    void fillRect (const Rectangle<float>&) override;
+    void fillRectList (const RectangleList<float>&) override;
+    void fillPath (const Path&, const AffineTransform&) override;
+    void drawImage (const Image&, const AffineTransform&) override;
+    void drawLine (const Line<float>&) override;
+    void setFont (const Font&) override;
+    const Font& getFont() override;
+    void drawGlyph (int glyphNumber, const AffineTransform&) override;
+
+private:
+    //==============================================================================
+    class CommandList;
+    class TileRenderer;
+    class TileJob;
+    friend class TileJob;
+
+    Image image;
+    RectangleList<int> initialClip;
+    Point<int> initialOrigin;
+    ThreadPool* threadPool;
+    int maxTiles;
+
+    // Tracks the clip, transform and font exactly as the tiles will see them, so that the
+    // state queries can be answered without rendering anything.
+    RenderingHelpers::SavedStateStack<RenderingHelpers::SoftwareRendererSavedState> state;
+    Array<Point<int> > layerOrigins;
+    ScopedPointer<CommandList> commands;
+
+    void initialise();
+    Point<int> getCurrentLayerOrigin() const noexcept;
+    Range<int> getRowsCoveredBy (const Rectangle<int>& deviceArea) const noexcept;
+    void renderTile (const RectangleList<int>& tileClip, Range<int> tileRows) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowLevelGraphicsDeferredSoftwareRenderer)
+};
+
+
+#endif   // JUCE_LOWLEVELGRAPHICSDEFERREDSOFTWARERENDERER_H_INCLUDED
@@ -22,46 +22,690 @@
   ==============================================================================
 */
 
-static inline void blurDataTriplets (uint8* d, int num, const int delta) noexcept
+namespace BlurHelpers
 {
-    uint32 last = d[0];
-    d[0] = (uint8) ((d[0] + d[delta] + 1) / 3);
-    d += delta;
+    /*  The blur approximates a gaussian with three stacked box filters, each of which costs
+        the same whatever its width, as it's done with a running sum.
 
-    num -= 2;
+        The filters work on 16 lines at once: the lines are interleaved into a buffer so that
+        each byte of a 16-byte block belongs to a different line, which lets the SIMD versions
+        process a whole block with one register, and makes the horizontal and vertical passes
+        identical apart from the way the lines are copied in and out.
+    */
+    enum { numBoxes = 3, numLanes = 16, maxBoxWidth = 255 };
 
-    do
+    struct BoxWidths
     {
-        const uint32 newLast = d[0];
-        d[0] = (uint8) ((last + d[0] + d[delta] + 1) / 3);
-        d += delta;
-        last = newLast;
+        int widths[numBoxes];
+    };
+
+    /** Returns the box widths whose combined variance is closest to the given one. */
+    static BoxWidths getBoxWidths (double variance) noexcept
+    {
+        BoxWidths b;
+        const double idealWidth = std::sqrt (12.0 * jmax (0.0, variance) / numBoxes + 1.0);
+
+        int lower = (int) idealWidth;
+
+        if ((lower & 1) == 0)
+            --lower;
+
+        const double numLower = (12.0 * variance - numBoxes * lower * lower - 4.0 * numBoxes * lower - 3.0 * numBoxes)
+                                  / (-4.0 * lower - 4.0);
+
+        for (int i = 0; i < numBoxes; ++i)
+            b.widths[i] = jmin ((int) maxBoxWidth, i < roundToInt (numLower) ? lower : lower + 2);
+
+        return b;
+    }
+
+    /** The variance that the old triplet-averaging blur had, which set the size of a DropShadow's radius. */
+    static double getVarianceForShadowRadius (int radius) noexcept
+    {
+        // each pass of the triplet filter added 2/3 to the variance, and it used 2 * radius passes
+        return 4.0 * radius / 3.0;
+    }
+
+    // Dividing by the box width is done as a multiply and a 16-bit shift, rounded to nearest.
+    // For boxes up to 255 wide the intermediate values all fit into 16 bits.
+    static inline uint32 getMultiplier (int boxWidth) noexcept     { return (uint32) (65536 / boxWidth); }
+
+    struct Scalar
+    {
+        static void boxFilter (const uint8* src, uint8* dest, const int length, const int boxWidth) noexcept
+        {
+            const int half = boxWidth / 2;
+            const uint32 multiplier = getMultiplier (boxWidth);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                uint32 sum = 0;
+
+                for (int i = 0; i < half && i < length; ++i)
+                    sum += src [i * numLanes + lane];
+
+                for (int i = 0; i < length; ++i)
+                {
+                    if (i + half < length)
+                        sum += src [(i + half) * numLanes + lane];
+
+                    dest [i * numLanes + lane] = (uint8) (((sum + (uint32) half) * multiplier) >> 16);
+
+                    if (i >= half)
+                        sum -= src [(i - half) * numLanes + lane];
+                }
+            }
+        }
+    };
+
+   #if JUCE_USE_SSE_INTRINSICS
+    struct SSE2
+    {
+        static forcedinline __m128i load (const uint8* p) noexcept   { return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p)); }
+
+        static void boxFilter (const uint8* src, uint8* dest, const int length, const int boxWidth) noexcept
+        {
+            const int half = boxWidth / 2;
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16 ((short) half);
+            const __m128i multiplier = _mm_set1_epi16 ((short) getMultiplier (boxWidth));
+            __m128i sumLo = zero, sumHi = zero;
+
+            for (int i = 0; i < half && i < length; ++i)
+            {
+                const __m128i v = load (src + i * numLanes);
+                sumLo = _mm_add_epi16 (sumLo, _mm_unpacklo_epi8 (v, zero));
+                sumHi = _mm_add_epi16 (sumHi, _mm_unpackhi_epi8 (v, zero));
+            }
+
+            for (int i = 0; i < length; ++i)
+            {
+                if (i + half < length)
+                {
+                    const __m128i v = load (src + (i + half) * numLanes);
+                    sumLo = _mm_add_epi16 (sumLo, _mm_unpacklo_epi8 (v, zero));
+                    sumHi = _mm_add_epi16 (sumHi, _mm_unpackhi_epi8 (v, zero));
+                }
+
+                const __m128i lo = _mm_mulhi_epu16 (_mm_add_epi16 (sumLo, rounding), multiplier);
+                const __m128i hi = _mm_mulhi_epu16 (_mm_add_epi16 (sumHi, rounding), multiplier);
+                _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i * numLanes), _mm_packus_epi16 (lo, hi));
+
+                if (i >= half)
+                {
+                    const __m128i v = load (src + (i - half) * numLanes);
+                    sumLo = _mm_sub_epi16 (sumLo, _mm_unpacklo_epi8 (v, zero));
+                    sumHi = _mm_sub_epi16 (sumHi, _mm_unpackhi_epi8 (v, zero));
+                }
+            }
+        }
+    };
+   #endif
+
+   #if JUCE_USE_ARM_NEON
+    struct NEON
+    {
+        static forcedinline uint8x8_t divide (const uint16x8_t sum, const uint16x4_t multiplier) noexcept
+        {
+            return vmovn_u16 (vcombine_u16 (vshrn_n_u32 (vmull_u16 (vget_low_u16 (sum),  multiplier), 16),
+                                            vshrn_n_u32 (vmull_u16 (vget_high_u16 (sum), multiplier), 16)));
+        }
+
+        static void boxFilter (const uint8* src, uint8* dest, const int length, const int boxWidth) noexcept
+        {
+            const int half = boxWidth / 2;
+            const uint16x8_t rounding = vdupq_n_u16 ((uint16) half);
+            const uint16x4_t multiplier = vdup_n_u16 ((uint16) getMultiplier (boxWidth));
+            uint16x8_t sumLo = vdupq_n_u16 (0), sumHi = vdupq_n_u16 (0);
+
+            for (int i = 0; i < half && i < length; ++i)
+            {
+                const uint8x16_t v = vld1q_u8 (src + i * numLanes);
+                sumLo = vaddw_u8 (sumLo, vget_low_u8 (v));
+                sumHi = vaddw_u8 (sumHi, vget_high_u8 (v));
+            }
+
+            for (int i = 0; i < length; ++i)
+            {
+                if (i + half < length)
+                {
+                    const uint8x16_t v = vld1q_u8 (src + (i + half) * numLanes);
+                    sumLo = vaddw_u8 (sumLo, vget_low_u8 (v));
+                    sumHi = vaddw_u8 (sumHi, vget_high_u8 (v));
+                }
+
+                vst1q_u8 (dest + i * numLanes, vcombine_u8 (divide (vaddq_u16 (sumLo, rounding), multiplier),
+                                                            divide (vaddq_u16 (sumHi, rounding), multiplier)));
+
+                if (i >= half)
+                {
+                    const uint8x16_t v = vld1q_u8 (src + (i - half) * numLanes);
+                    sumLo = vsubw_u8 (sumLo, vget_low_u8 (v));
+                    sumHi = vsubw_u8 (sumHi, vget_high_u8 (v));
+                }
+            }
+        }
+    };
+   #endif
+
+    //==============================================================================
+    struct Implementation
+    {
+        template <class Kernels>
+        static Implementation create (const char* name) noexcept
+        {
+            Implementation i;
+            i.name = name;
+            i.boxFilter = Kernels::boxFilter;
+            return i;
+        }
+
+        // Returns the implementations that this CPU can run, fastest first.
+        static Array<Implementation> getAvailable()
+        {
+            Array<Implementation> available;
+
+           #if JUCE_USE_SSE_INTRINSICS
+            if (SystemStats::hasSSE2())
+                available.add (create<SSE2> ("SSE2"));
+           #endif
+
+           #if JUCE_USE_ARM_NEON
+            available.add (create<NEON> ("NEON"));
+           #endif
+
+            available.add (create<Scalar> ("scalar"));
+            return available;
+        }
+
+        static Implementation& getActive()
+        {
+            static Implementation active (getAvailable().getFirst());
+            return active;
+        }
+
+        bool operator== (const Implementation& other) const noexcept   { return boxFilter == other.boxFilter; }
+
+        const char* name;
+        void (*boxFilter) (const uint8*, uint8*, int, int);
+    };
+
+    //==============================================================================
+    /** Blurs a group of up to 16 rows or columns of a single-channel bitmap. */
+    struct LineGroupBlurrer
+    {
+        LineGroupBlurrer (const Image::BitmapData& d, const BoxWidths& b, bool isHorizontal)
+            : data (d), boxes (b), horizontal (isHorizontal),
+              length (isHorizontal ? d.width : d.height),
+              numLines (isHorizontal ? d.height : d.width),
+              buffer1 ((size_t) (length * numLanes)),
+              buffer2 ((size_t) (length * numLanes))
+        {
+        }
+
+        int getNumGroups() const noexcept   { return (numLines + numLanes - 1) / numLanes; }
+
+        void blurGroups (Range<int> groups) noexcept
+        {
+            const Implementation& impl = Implementation::getActive();
+
+            for (int group = groups.getStart(); group < groups.getEnd(); ++group)
+            {
+                const int firstLine = group * numLanes;
+                const int linesInGroup = jmin ((int) numLanes, numLines - firstLine);
+
+                readLines (firstLine, linesInGroup);
+
+                uint8* src = buffer1;
+                uint8* dst = buffer2;
+
+                for (int i = 0; i < numBoxes; ++i)
+                {
+                    if (boxes.widths[i] > 1)
+                    {
+                        impl.boxFilter (src, dst, length, boxes.widths[i]);
+                        std::swap (src, dst);
+                    }
+                }
+
+                writeLines (src, firstLine, linesInGroup);
+            }
+        }
+
+    private:
+        const Image::BitmapData& data;
+        const BoxWidths boxes;
+        const bool horizontal;
+        const int length, numLines;
+        HeapBlock<uint8> buffer1, buffer2;
+
+        void readLines (int firstLine, int linesInGroup) noexcept
+        {
+            if (linesInGroup < numLanes)
+                zeromem (buffer1, (size_t) (length * numLanes));
+
+            if (horizontal)
+            {
+                for (int lane = 0; lane < linesInGroup; ++lane)
+                {
+                    const uint8* src = data.getLinePointer (firstLine + lane);
+                    uint8* dst = buffer1 + lane;
+
+                    for (int i = 0; i < length; ++i)
+                        dst [i * numLanes] = src[i];
+                }
+            }
+            else
+            {
+                for (int i = 0; i < length; ++i)
+                    memcpy (buffer1 + i * numLanes, data.getLinePointer (i) + firstLine, (size_t) linesInGroup);
+            }
+        }
+
+        void writeLines (const uint8* result, int firstLine, int linesInGroup) const noexcept
+        {
+            if (horizontal)
+            {
+                for (int lane = 0; lane < linesInGroup; ++lane)
+                {
+                    const uint8* src = result + lane;
+                    uint8* dst = data.getLinePointer (firstLine + lane);
+
+                    for (int i = 0; i < length; ++i)
+                        dst[i] = src [i * numLanes];
+                }
+            }
+            else
+            {
+                for (int i = 0; i < length; ++i)
+                    memcpy (data.getLinePointer (i) + firstLine, result + i * numLanes, (size_t) linesInGroup);
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (LineGroupBlurrer)
+    };
+
+    class BlurJob  : public ThreadPoolJob
+    {
+    public:
+        BlurJob (const Image::BitmapData& d, const BoxWidths& b, bool horizontal, Range<int> g)
+            : ThreadPoolJob ("Shadow blur"), blurrer (d, b, horizontal), groups (g)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            blurrer.blurGroups (groups);
+            return jobHasFinished;
+        }
+
+    private:
+        LineGroupBlurrer blurrer;
+        const Range<int> groups;
+
+        JUCE_DECLARE_NON_COPYABLE (BlurJob)
+    };
+
+    // Images smaller than this aren't worth the overhead of handing out to other threads
+    enum { minPixelsForThreading = 128 * 128 };
+
+    static void blurLines (const Image::BitmapData& data, const BoxWidths& boxes, bool horizontal, ThreadPool* pool)
+    {
+        LineGroupBlurrer blurrer (data, boxes, horizontal);
+        const int numGroups = blurrer.getNumGroups();
+        const int numChunks = (pool != nullptr && data.width * data.height >= minPixelsForThreading)
+                                 ? jmin (numGroups, SystemStats::getNumCpus()) : 1;
+
+        OwnedArray<BlurJob> jobs;
+
+        for (int i = 1; i < numChunks; ++i)
+        {
+            BlurJob* job = jobs.add (new BlurJob (data, boxes, horizontal,
+                                                  Range<int> ((numGroups * i) / numChunks, (numGroups * (i + 1)) / numChunks)));
+            pool->addJob (job, false);
+        }
+
+        // The calling thread does the first chunk itself while the pool does the rest..
+        blurrer.blurGroups (Range<int> (0, numGroups / numChunks));
+
+        for (int i = 0; i < jobs.size(); ++i)
+            pool->waitForJobToFinish (jobs.getUnchecked (i), -1);
+    }
+
+    /** Blurs a single-channel bitmap in place, leaving whatever lies outside it as transparent. */
+    static void blur (const Image::BitmapData& data, const BoxWidths& boxes, ThreadPool* pool)
+    {
+        jassert (data.pixelStride == 1);
+
+        if (data.width > 0 && data.height > 0)
+        {
+            blurLines (data, boxes, true, pool);
+            blurLines (data, boxes, false, pool);
+        }
     }
-    while (--num > 0);
 
-    d[0] = (uint8) ((last + d[0] + 1) / 3);
+    static void blur (Image& image, double variance)
+    {
+        const Image::BitmapData bm (image, Image::BitmapData::readWrite);
+        blur (bm, getBoxWidths (variance), DeferredRendererThreadPool::getInstanceForHelperJobs());
+    }
 }
 
-static void blurSingleChannelImage (uint8* const data, const int width, const int height,
-                                    const int lineStride, const int repetitions) noexcept
+static void blurSingleChannelImage (Image& image, int radius)
 {
-    jassert (width > 2 && height > 2);
+    BlurHelpers::blur (image, BlurHelpers::getVarianceForShadowRadius (radius));
+}
 
-    for (int y = 0; y < height; ++y)
-        for (int i = repetitions; --i >= 0;)
-            blurDataTriplets (data + lineStride * y, width, 1);
+static void drawShadowSection (Graphics& g, ColourGradient& cg, Rectangle<float> area,
+                               bool isCorner, float centreX, float centreY, float edgeX, float edgeY)
+{
+    cg.point1 = area.getRelativePoint (centreX, centreY);
+    cg.point2 = area.getRelativePoint (edgeX, edgeY);
+    cg.isRadial = isCorner;
 
-    for (int x = 0; x < width; ++x)
-        for (int i = repetitions; --i >= 0;)
-            blurDataTriplets (data + x, height, lineStride);
+    g.setGradientFill (cg);
+    g.fillRect (area);
 }
 
-static void blurSingleChannelImage (Image& image, int radius)
+static void drawRectangleShadowWithGradients (Graphics& g, const DropShadow& shadow, const Rectangle<int>& targetArea)
 {
-    const Image::BitmapData bm (image, Image::BitmapData::readWrite);
-    blurSingleChannelImage (bm.data, bm.width, bm.height, bm.lineStride, 2 * radius);
+    ColourGradient cg (shadow.colour, 0, 0, shadow.colour.withAlpha (0.0f), 0, 0, false);
+
+    for (float i = 0.05f; i < 1.0f; i += 0.1f)
+        cg.addColour (1.0 - i, shadow.colour.withMultipliedAlpha (i * i));
+
+    const float radiusInset = (shadow.radius + 1) / 2.0f;
+    const float expandedRadius = shadow.radius + radiusInset;
+
+    const Rectangle<float> area (targetArea.toFloat().reduced (radiusInset) + shadow.offset.toFloat());
+
+    Rectangle<float> r (area.expanded (expandedRadius));
+    Rectangle<float> top (r.removeFromTop (expandedRadius));
+    Rectangle<float> bottom (r.removeFromBottom (expandedRadius));
+
+    drawShadowSection (g, cg, top.removeFromLeft  (expandedRadius), true, 1.0f, 1.0f, 0, 1.0f);
+    drawShadowSection (g, cg, top.removeFromRight (expandedRadius), true, 0, 1.0f, 1.0f, 1.0f);
+    drawShadowSection (g, cg, top, false, 0, 1.0f, 0, 0);
+
+    drawShadowSection (g, cg, bottom.removeFromLeft  (expandedRadius), true, 1.0f, 0, 0, 0);
+    drawShadowSection (g, cg, bottom.removeFromRight (expandedRadius), true, 0, 0, 1.0f, 0);
+    drawShadowSection (g, cg, bottom, false, 0, 0, 0, 1.0f);
+
+    drawShadowSection (g, cg, r.removeFromLeft  (expandedRadius), false, 1.0f, 0, 0, 0);
+    drawShadowSection (g, cg, r.removeFromRight (expandedRadius), false, 0, 0, 1.0f, 0);
+
+    g.setColour (shadow.colour);
+    g.fillRect (area);
 }
 
+//==============================================================================
+/*  Keeps hold of recently drawn shadows, so that re-drawing the same shape doesn't mean
+    blurring it all over again.
+
+    Path shadows are kept as blurred single-channel masks, and rectangular ones (which don't
+    need to be blurred, but take a lot of gradient-filling) as a small ARGB image that's cut
+    up into corners and edges, so that a shadow of any size can be drawn by tiling them.
+*/
+class ShadowImageCache  : private DeletedAtShutdown
+{
+public:
+    ShadowImageCache()
+        : maxBytes (4 * 1024 * 1024), bytesUsed (0), accessCounter (0),
+          hits (0), misses (0), nextRecentIndex (0), enabled (1)
+    {
+        zeromem (recentlySeen, sizeof (recentlySeen));
+    }
+
+    ~ShadowImageCache()
+    {
+        clearSingletonInstance();
+    }
+
+    juce_DeclareSingleton (ShadowImageCache, false)
+
+    //==============================================================================
+    struct Entry  : public ReferenceCountedObject
+    {
+        Entry (const Path& p, int r, Colour c, bool rect)
+            : path (p), radius (r), colour (c), isRectangle (rect), lastAccessCount (0),
+              pathDataSize (RenderingHelpers::CacheHelpers::getPathDataSize (p))
+        {
+        }
+
+        bool matches (const Path* p, int r, Colour c) const noexcept
+        {
+            return radius == r && isRectangle == (p == nullptr)
+                    && (isRectangle ? colour == c : *p == path);
+        }
+
+        size_t getSize() const noexcept
+        {
+            return sizeof (*this) + pathDataSize + (size_t) (image.getWidth() * image.getHeight() * (isRectangle ? 4 : 1));
+        }
+
+        const Path path;
+        const int radius;
+        const Colour colour;
+        const bool isRectangle;
+
+        Image image;
+        Point<int> origin;          // (where a path's shadow image goes, relative to the path)
+        Image corners[4], edges[4]; // (the pieces of a rectangular shadow image)
+        int64 lastAccessCount;
+        const size_t pathDataSize;
+
+        JUCE_DECLARE_NON_COPYABLE (Entry)
+    };
+
+    typedef ReferenceCountedObjectPtr<Entry> EntryPtr;
+
+    /** Returns the blurred mask for a path's shadow, if it has been drawn recently. */
+    EntryPtr findPathShadow (const Path& path, int radius)
+    {
+        return find (&path, radius, Colour());
+    }
+
+    /** Returns the pieces of a rectangular shadow with this radius and colour. */
+    EntryPtr findRectangleShadow (int radius, Colour colour)
+    {
+        return find (nullptr, radius, colour);
+    }
+
+    /** The size of the corners of a rectangular shadow. Beyond this distance from
+        its outer edge, the shadow is just a solid colour.
+    */
+    static int getRectangleCornerSize (int radius) noexcept
+    {
+        return (int) std::ceil (radius + (radius + 1) / 2.0f);
+    }
+
+    enum { rectangleEdgeLength = 128 };
+
+    //==============================================================================
+    void setMaximumSize (size_t numBytes)
+    {
+        const ScopedLock sl (lock);
+        maxBytes = numBytes;
+        RenderingHelpers::CacheHelpers::removeLeastRecentlyUsed (entries, bytesUsed, maxBytes);
+    }
+
+    size_t getMaximumSize() const noexcept          { return maxBytes; }
+
+    void setEnabled (bool shouldBeEnabled) noexcept { enabled = shouldBeEnabled ? 1 : 0; }
+    bool isEnabled() const noexcept                 { return enabled.get() != 0; }
+
+    void clear()
+    {
+        const ScopedLock sl (lock);
+        entries.clear();
+        bytesUsed = 0;
+        zeromem (recentlySeen, sizeof (recentlySeen));
+    }
+
+    struct Statistics
+    {
+        int64 hits, misses;
+        int numEntries;
+        size_t numBytes;
+
+        double getHitRate() const noexcept      { return hits + misses > 0 ? hits / (double) (hits + misses) : 0.0; }
+    };
+
+    Statistics getStatistics() const
+    {
+        const ScopedLock sl (lock);
+        Statistics s = { hits, misses, entries.size(), bytesUsed };
+        return s;
+    }
+
+    void resetStatistics()
+    {
+        const ScopedLock sl (lock);
+        hits = misses = 0;
+    }
+
+private:
+    HashMap<int64, EntryPtr> entries;
+    size_t maxBytes, bytesUsed;
+    int64 accessCounter, hits, misses;
+    enum { numRecentlySeen = 64 };
+    int64 recentlySeen [numRecentlySeen];
+    int nextRecentIndex;
+    Atomic<int> enabled;
+    CriticalSection lock;
+
+    EntryPtr find (const Path* path, int radius, Colour colour)
+    {
+        if (enabled.get() == 0)
+            return nullptr;
+
+        const int64 key = createKey (path, radius, colour);
+
+        {
+            const ScopedLock sl (lock);
+
+            if (Entry* e = entries [key])
+            {
+                if (e->matches (path, radius, colour))
+                {
+                    ++hits;
+                    e->lastAccessCount = ++accessCounter;
+                    return e;
+                }
+
+                ++misses;
+                return nullptr;
+            }
+
+            ++misses;
+
+            // a path needs to turn up twice before it's worth keeping
+            if (path != nullptr && ! std::count (recentlySeen, recentlySeen + numRecentlySeen, key))
+            {
+                recentlySeen [nextRecentIndex] = key;
+                nextRecentIndex = (nextRecentIndex + 1) % numRecentlySeen;
+                return nullptr;
+            }
+        }
+
+        EntryPtr e (new Entry (path != nullptr ? *path : Path(), radius, colour, path == nullptr));
+
+        if (path != nullptr)
+            renderPathShadow (*e);
+        else
+            renderRectangleShadow (*e);
+
+        // (a shape that's too big to be worth keeping isn't rendered, so is cheap to reject again)
+        if (! e->image.isValid())
+            return nullptr;
+
+        const ScopedLock sl (lock);
+
+        if (Entry* existing = entries [key])
+            bytesUsed -= existing->getSize();
+
+        entries.set (key, e);
+        bytesUsed += e->getSize();
+        e->lastAccessCount = ++accessCounter;
+
+        // Going a quarter below the limit means that the entries only need sorting
+        // once in a while, rather than every time something new is added.
+        if (bytesUsed > maxBytes)
+            RenderingHelpers::CacheHelpers::removeLeastRecentlyUsed (entries, bytesUsed, maxBytes - maxBytes / 4);
+
+        return e;
+    }
+
+    void renderPathShadow (Entry& e) const
+    {
+        const Rectangle<int> area (e.path.getBounds().getSmallestIntegerContainer().expanded (e.radius + 1));
+
+        // big shapes are usually clipped down to a small part of themselves, so they're
+        // better off being drawn each time
+        if ((size_t) area.getWidth() * (size_t) area.getHeight() > maxBytes / 8)
+            return;
+
+        Image mask (Image::SingleChannel, area.getWidth(), area.getHeight(), true);
+
+        {
+            Graphics g (mask);
+            g.setColour (Colours::white);
+            g.fillPath (e.path, AffineTransform::translation ((float) -area.getX(), (float) -area.getY()));
+        }
+
+        blurSingleChannelImage (mask, e.radius);
+
+        e.image = mask;
+        e.origin = area.getPosition();
+    }
+
+    void renderRectangleShadow (Entry& e) const
+    {
+        const int corner = getRectangleCornerSize (e.radius);
+        const int size = corner * 2 + rectangleEdgeLength;
+
+        Image image (Image::ARGB, size, size, true);
+
+        {
+            Graphics g (image);
+            drawRectangleShadowWithGradients (g, DropShadow (e.colour, e.radius, Point<int>()), image.getBounds().reduced (e.radius));
+        }
+
+        const int far = size - corner;
+
+        e.corners[0] = image.getClippedImage (Rectangle<int> (0,   0,   corner, corner));
+        e.corners[1] = image.getClippedImage (Rectangle<int> (far, 0,   corner, corner));
+        e.corners[2] = image.getClippedImage (Rectangle<int> (0,   far, corner, corner));
+        e.corners[3] = image.getClippedImage (Rectangle<int> (far, far, corner, corner));
+
+        e.edges[0] = image.getClippedImage (Rectangle<int> (corner, 0,   rectangleEdgeLength, corner));
+        e.edges[1] = image.getClippedImage (Rectangle<int> (corner, far, rectangleEdgeLength, corner));
+        e.edges[2] = image.getClippedImage (Rectangle<int> (0,   corner, corner, rectangleEdgeLength));
+        e.edges[3] = image.getClippedImage (Rectangle<int> (far, corner, corner, rectangleEdgeLength));
+
+        e.image = image;
+    }
+
+    static int64 createKey (const Path* path, int radius, Colour colour) noexcept
+    {
+        using namespace RenderingHelpers::CacheHelpers;
+
+        uint64 hash = initialHash;
+        addToHash (hash, (uint32) radius);
+
+        if (path != nullptr)
+            addToHash (hash, *path);
+        else
+            addToHash (hash, colour.getARGB());
+
+        return (int64) hash;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ShadowImageCache)
+};
+
+juce_ImplementSingleton (ShadowImageCache)
+
 //==============================================================================
 DropShadow::DropShadow() noexcept
     : colour (0x90000000), radius (4)
@@ -94,6 +738,13 @@ void DropShadow::drawForPath (Graphics& g, const Path& path) const
 {
     jassert (radius > 0);
 
+    if (ShadowImageCache::EntryPtr cached = ShadowImageCache::getInstance()->findPathShadow (path, radius))
+    {
+        g.setColour (colour);
+        g.drawImageAt (cached->image, cached->origin.x + offset.x, cached->origin.y + offset.y, true);
+        return;
+    }
+
     const Rectangle<int> area ((path.getBounds().getSmallestIntegerContainer() + offset)
                                    .expanded (radius + 1)
                                    .getIntersection (g.getClipBounds().expanded (radius + 1)));
@@ -116,46 +767,54 @@ void DropShadow::drawForPath (Graphics& g, const Path& path) const
     }
 }
 
-static void drawShadowSection (Graphics& g, ColourGradient& cg, Rectangle<float> area,
-                               bool isCorner, float centreX, float centreY, float edgeX, float edgeY)
+static void drawRectangleShadowEdge (Graphics& g, const Image& piece, const Rectangle<int>& area, bool isHorizontal)
 {
-    cg.point1 = area.getRelativePoint (centreX, centreY);
-    cg.point2 = area.getRelativePoint (edgeX, edgeY);
-    cg.isRadial = isCorner;
+    if (! g.clipRegionIntersects (area))
+        return;
 
-    g.setGradientFill (cg);
-    g.fillRect (area);
+    Graphics::ScopedSaveState state (g);
+    g.reduceClipRegion (area);
+
+    if (isHorizontal)
+        for (int x = area.getX(); x < area.getRight(); x += piece.getWidth())
+            g.drawImageAt (piece, x, area.getY());
+    else
+        for (int y = area.getY(); y < area.getBottom(); y += piece.getHeight())
+            g.drawImageAt (piece, area.getX(), y);
 }
 
 void DropShadow::drawForRectangle (Graphics& g, const Rectangle<int>& targetArea) const
 {
-    ColourGradient cg (colour, 0, 0, colour.withAlpha (0.0f), 0, 0, false);
-
-    for (float i = 0.05f; i < 1.0f; i += 0.1f)
-        cg.addColour (1.0 - i, colour.withMultipliedAlpha (i * i));
+    const Rectangle<int> outer ((targetArea + offset).expanded (radius));
+    const int corner = ShadowImageCache::getRectangleCornerSize (radius);
 
-    const float radiusInset = (radius + 1) / 2.0f;
-    const float expandedRadius = radius + radiusInset;
-
-    const Rectangle<float> area (targetArea.toFloat().reduced (radiusInset) + offset.toFloat());
-
-    Rectangle<float> r (area.expanded (expandedRadius));
-    Rectangle<float> top (r.removeFromTop (expandedRadius));
-    Rectangle<float> bottom (r.removeFromBottom (expandedRadius));
+    // The cached pieces are drawn at whole-pixel positions, so they'd only be smeared
+    // by a scaled context, and can't be used for a rectangle smaller than its corners.
+    if (g.getInternalContext().getPhysicalPixelScaleFactor() == 1.0f
+         && outer.getWidth() >= corner * 2 && outer.getHeight() >= corner * 2)
+    {
+        if (ShadowImageCache::EntryPtr cached = ShadowImageCache::getInstance()->findRectangleShadow (radius, colour))
+        {
+            const int x = outer.getX(), y = outer.getY();
+            const int far = outer.getRight() - corner, bottom = outer.getBottom() - corner;
 
-    drawShadowSection (g, cg, top.removeFromLeft  (expandedRadius), true, 1.0f, 1.0f, 0, 1.0f);
-    drawShadowSection (g, cg, top.removeFromRight (expandedRadius), true, 0, 1.0f, 1.0f, 1.0f);
-    drawShadowSection (g, cg, top, false, 0, 1.0f, 0, 0);
+            g.drawImageAt (cached->corners[0], x, y);
+            g.drawImageAt (cached->corners[1], far, y);
+            g.drawImageAt (cached->corners[2], x, bottom);
+            g.drawImageAt (cached->corners[3], far, bottom);
 
-    drawShadowSection (g, cg, bottom.removeFromLeft  (expandedRadius), true, 1.0f, 0, 0, 0);
-    drawShadowSection (g, cg, bottom.removeFromRight (expandedRadius), true, 0, 0, 1.0f, 0);
-    drawShadowSection (g, cg, bottom, false, 0, 0, 0, 1.0f);
+            drawRectangleShadowEdge (g, cached->edges[0], Rectangle<int> (x + corner, y, far - x - corner, corner), true);
+            drawRectangleShadowEdge (g, cached->edges[1], Rectangle<int> (x + corner, bottom, far - x - corner, corner), true);
+            drawRectangleShadowEdge (g, cached->edges[2], Rectangle<int> (x, y + corner, corner, bottom - y - corner), false);
+            drawRectangleShadowEdge (g, cached->edges[3], Rectangle<int> (far, y + corner, corner, bottom - y - corner), false);
 
-    drawShadowSection (g, cg, r.removeFromLeft  (expandedRadius), false, 1.0f, 0, 0, 0);
-    drawShadowSection (g, cg, r.removeFromRight (expandedRadius), false, 0, 0, 1.0f, 0);
+            g.setColour (colour);
+            g.fillRect (outer.reduced (corner));
+            return;
+        }
+    }
 
-    g.setColour (colour);
-    g.fillRect (area);
+    drawRectangleShadowWithGradients (g, *this, targetArea);
 }
 
 //==============================================================================
@@ -180,3 +839,435 @@ void DropShadowEffect::applyEffect (Image& image, Graphics& g, float scaleFactor
     g.setOpacity (alpha);
     g.drawImageAt (image, 0, 0);
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class DropShadowTests  : public UnitTest
+{
+public:
+    DropShadowTests() : UnitTest ("DropShadow") {}
+
+    typedef BlurHelpers::Implementation Implementation;
+    typedef BlurHelpers::BoxWidths BoxWidths;
+
+    struct ScopedImplementation
+    {
+        ScopedImplementation (const Implementation& i)  : original (Implementation::getActive())  { Implementation::getActive() = i; }
+        ~ScopedImplementation()  { Implementation::getActive() = original; }
+
+        const Implementation original;
+    };
+
+    typedef RenderingHelpers::CacheHelpers::ScopedCacheState<ShadowImageCache> ScopedCacheState;
+
+    // The box filters done the slow and obvious way, with the same rounding
+    static void referenceBoxFilter (uint8* data, int length, int stride, int boxWidth)
+    {
+        HeapBlock<uint8> src ((size_t) length);
+
+        for (int i = 0; i < length; ++i)
+            src[i] = data [i * stride];
+
+        const int half = boxWidth / 2;
+
+        for (int i = 0; i < length; ++i)
+        {
+            uint32 sum = 0;
+
+            for (int j = i - half; j <= i + half; ++j)
+                if (isPositiveAndBelow (j, length))
+                    sum += src[j];
+
+            data [i * stride] = (uint8) (((sum + (uint32) half) * BlurHelpers::getMultiplier (boxWidth)) >> 16);
+        }
+    }
+
+    static Image referenceBlur (const Image& source, const BoxWidths& boxes)
+    {
+        Image result (source.createCopy());
+        const Image::BitmapData data (result, Image::BitmapData::readWrite);
+
+        for (int y = 0; y < data.height; ++y)
+            for (int i = 0; i < BlurHelpers::numBoxes; ++i)
+                if (boxes.widths[i] > 1)
+                    referenceBoxFilter (data.getLinePointer (y), data.width, 1, boxes.widths[i]);
+
+        for (int x = 0; x < data.width; ++x)
+            for (int i = 0; i < BlurHelpers::numBoxes; ++i)
+                if (boxes.widths[i] > 1)
+                    referenceBoxFilter (data.data + x, data.height, data.lineStride, boxes.widths[i]);
+
+        return result;
+    }
+
+    // The blur that shadows used to have, for comparing speeds
+    static void blurDataTriplets (uint8* d, int num, const int delta) noexcept
+    {
+        uint32 last = d[0];
+        d[0] = (uint8) ((d[0] + d[delta] + 1) / 3);
+        d += delta;
+
+        num -= 2;
+
+        do
+        {
+            const uint32 newLast = d[0];
+            d[0] = (uint8) ((last + d[0] + d[delta] + 1) / 3);
+            d += delta;
+            last = newLast;
+        }
+        while (--num > 0);
+
+        d[0] = (uint8) ((last + d[0] + 1) / 3);
+    }
+
+    static void tripletBlur (const Image::BitmapData& data, int radius)
+    {
+        for (int y = 0; y < data.height; ++y)
+            for (int i = 2 * radius; --i >= 0;)
+                blurDataTriplets (data.getLinePointer (y), data.width, 1);
+
+        for (int x = 0; x < data.width; ++x)
+            for (int i = 2 * radius; --i >= 0;)
+                blurDataTriplets (data.data + x, data.height, data.lineStride);
+    }
+
+    static Image createMask (Random& r, int w, int h)
+    {
+        Image mask (Image::SingleChannel, w, h, true);
+        Graphics g (mask);
+
+        for (int i = 0; i < 12; ++i)
+        {
+            g.setColour (Colours::white.withAlpha (r.nextFloat()));
+            g.fillEllipse (r.nextFloat() * w, r.nextFloat() * h, r.nextFloat() * w * 0.5f, r.nextFloat() * h * 0.5f);
+        }
+
+        return mask;
+    }
+
+    static Image blurred (const Image& source, const BoxWidths& boxes, ThreadPool* pool)
+    {
+        Image result (source.createCopy());
+        const Image::BitmapData data (result, Image::BitmapData::readWrite);
+        BlurHelpers::blur (data, boxes, pool);
+        return result;
+    }
+
+    static int64 getTotal (const Image& image)
+    {
+        const Image::BitmapData data (image, Image::BitmapData::readOnly);
+        int64 total = 0;
+
+        for (int y = 0; y < data.height; ++y)
+            for (int x = 0; x < data.width; ++x)
+                total += data.getLinePointer (y)[x];
+
+        return total;
+    }
+
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        int maxDiff = 0;
+
+        for (int y = 0; y < da.height; ++y)
+            for (int i = 0; i < da.width * da.pixelStride; ++i)
+                maxDiff = jmax (maxDiff, std::abs (da.getLinePointer (y)[i] - db.getLinePointer (y)[i]));
+
+        return maxDiff;
+    }
+
+    // Blurs a copy of an image the way a shadow does, from one of a pool's threads
+    struct BlurringJob  : public ThreadPoolJob
+    {
+        BlurringJob (const Image& source)  : ThreadPoolJob ("Test blur"), image (source.createCopy()) {}
+
+        JobStatus runJob() override
+        {
+            blurSingleChannelImage (image, 10);
+            return jobHasFinished;
+        }
+
+        Image image;
+    };
+
+    static Path createShape()
+    {
+        Path p;
+        p.addRoundedRectangle (20.3f, 15.0f, 90.0f, 60.0f, 8.0f);
+        p.addStar (Point<float> (150.0f, 70.0f), 5, 15.0f, 40.0f, 0.3f);
+        return p;
+    }
+
+    static Image drawPathShadow (const DropShadow& shadow, const Path& path, Point<int> origin)
+    {
+        Image image (Image::ARGB, 240, 160, true);
+        Graphics g (image);
+        g.fillAll (Colours::white);
+        g.setOrigin (origin);
+        shadow.drawForPath (g, path);
+        return image;
+    }
+
+    static Image drawRectangleShadow (const DropShadow& shadow, const Rectangle<int>& area, bool useCache)
+    {
+        const ScopedCacheState state (useCache);
+        Image image (Image::ARGB, area.getRight() + 60, area.getBottom() + 60, true);
+        Graphics g (image);
+        g.fillAll (Colours::lightblue);
+        shadow.drawForRectangle (g, area);
+        return image;
+    }
+
+    void runTest() override
+    {
+        Random r (0x5eed);
+        const Array<Implementation> implementations (Implementation::getAvailable());
+
+        beginTest ("Box widths match the variance");
+        {
+            for (int radius = 1; radius < 100; ++radius)
+            {
+                const double variance = BlurHelpers::getVarianceForShadowRadius (radius);
+                const BoxWidths boxes (BlurHelpers::getBoxWidths (variance));
+                double actual = 0;
+
+                for (int i = 0; i < BlurHelpers::numBoxes; ++i)
+                {
+                    expect ((boxes.widths[i] & 1) != 0);
+                    actual += (boxes.widths[i] * boxes.widths[i] - 1) / 12.0;
+                }
+
+                // (the widths have to be odd, so swapping one box for the next size up changes
+                // the variance by (width + 1) / 3, and they should be within half of that)
+                expect (std::abs (actual - variance) <= (boxes.widths[BlurHelpers::numBoxes - 1] + 1) / 6.0);
+            }
+        }
+
+        beginTest ("Box filters match the scalar code");
+        {
+            const int length = 300;
+            HeapBlock<uint8> src ((size_t) (length * BlurHelpers::numLanes)), expected ((size_t) (length * BlurHelpers::numLanes)),
+                             actual ((size_t) (length * BlurHelpers::numLanes));
+
+            for (int i = 0; i < length * BlurHelpers::numLanes; ++i)
+                src[i] = (uint8) (r.nextInt (3) == 0 ? 255 : r.nextInt (256));
+
+            for (int i = 0; i < implementations.size(); ++i)
+            {
+                logMessage (String ("Testing ") + implementations.getReference (i).name);
+
+                for (int boxWidth = 3; boxWidth <= BlurHelpers::maxBoxWidth; boxWidth += 2 + 2 * r.nextInt (8))
+                {
+                    for (int len = 1; len <= length; len += 1 + r.nextInt (60))
+                    {
+                        BlurHelpers::Scalar::boxFilter (src, expected, len, boxWidth);
+                        implementations.getReference (i).boxFilter (src, actual, len, boxWidth);
+                        expect (memcmp (expected, actual, (size_t) (len * BlurHelpers::numLanes)) == 0);
+                    }
+                }
+            }
+        }
+
+        beginTest ("Blurring matches the reference blur");
+        {
+            const int sizes[][2] = { { 1, 1 }, { 3, 200 }, { 17, 33 }, { 250, 190 }, { 401, 299 } };
+
+            for (int size = 0; size < numElementsInArray (sizes); ++size)
+            {
+                const Image mask (createMask (r, sizes[size][0], sizes[size][1]));
+
+                for (int radius = 1; radius <= 40; radius *= 3)
+                {
+                    const BoxWidths boxes (BlurHelpers::getBoxWidths (BlurHelpers::getVarianceForShadowRadius (radius)));
+                    const Image expected (referenceBlur (mask, boxes));
+
+                    for (int i = 0; i < implementations.size(); ++i)
+                    {
+                        ScopedImplementation scope (implementations.getReference (i));
+                        expect (getMaxDifference (expected, blurred (mask, boxes, nullptr)) == 0);
+                        expect (getMaxDifference (expected, blurred (mask, boxes, DeferredRendererThreadPool::getInstance())) == 0);
+                    }
+                }
+            }
+        }
+
+        beginTest ("Blurring on the renderer's own threads");
+        {
+            const Image mask (createMask (r, 400, 300));
+            Image expected (mask.createCopy());
+            blurSingleChannelImage (expected, 10);
+
+            // (with every thread in the pool busy blurring, none of them can wait for help from the others)
+            ThreadPool& pool = *DeferredRendererThreadPool::getInstance();
+            OwnedArray<BlurringJob> jobs;
+
+            for (int i = 0; i < SystemStats::getNumCpus() * 2; ++i)
+                pool.addJob (jobs.add (new BlurringJob (mask)), false);
+
+            for (int i = 0; i < jobs.size(); ++i)
+            {
+                expect (pool.waitForJobToFinish (jobs.getUnchecked (i), 20000));
+                expectEquals (getMaxDifference (expected, jobs.getUnchecked (i)->image), 0);
+            }
+        }
+
+        beginTest ("Blurring is symmetrical and keeps its energy");
+        {
+            Image mask (Image::SingleChannel, 121, 121, true);
+
+            {
+                Graphics g (mask);
+                g.setColour (Colours::white);
+                g.fillRect (40, 40, 41, 41);
+                g.fillRect (20, 55, 81, 11);
+                g.fillRect (55, 20, 11, 81);
+            }
+
+            Image result (mask.createCopy());
+            blurSingleChannelImage (result, 12);
+
+            const Image::BitmapData data (result, Image::BitmapData::readOnly);
+            bool symmetrical = true;
+
+            for (int y = 0; y < data.height; ++y)
+                for (int x = 0; x < data.width; ++x)
+                    symmetrical = symmetrical && data.getPixelColour (x, y) == data.getPixelColour (120 - x, y)
+                                              && data.getPixelColour (x, y) == data.getPixelColour (x, 120 - y);
+
+            expect (symmetrical);
+            expect (std::abs (getTotal (result) - getTotal (mask)) < getTotal (mask) / 100);
+        }
+
+        beginTest ("Cached path shadows are drawn identically");
+        {
+            const DropShadow shadow (Colours::black.withAlpha (0.6f), 6, Point<int> (3, 4));
+            const Path shape (createShape());
+
+            Image expected;
+
+            {
+                const ScopedCacheState state (false);
+                expected = drawPathShadow (shadow, shape, Point<int> (5, 7));
+            }
+
+            const ScopedCacheState state (true);
+
+            for (int i = 0; i < 4; ++i)
+                expect (getMaxDifference (expected, drawPathShadow (shadow, shape, Point<int> (5, 7))) == 0);
+
+            const ShadowImageCache::Statistics stats (state.cache.getStatistics());
+            expectEquals ((int) stats.hits, 2);
+            expectEquals (stats.numEntries, 1);
+
+            // the same shape somewhere else is the same image drawn in a different place
+            drawPathShadow (shadow, shape, Point<int> (-20, 30));
+            expectEquals ((int) state.cache.getStatistics().hits, 3);
+
+            drawPathShadow (DropShadow (shadow.colour, 7, shadow.offset), shape, Point<int>());
+            drawPathShadow (DropShadow (shadow.colour, 7, shadow.offset), shape, Point<int>());
+            expectEquals (state.cache.getStatistics().numEntries, 2);
+        }
+
+        beginTest ("Cached rectangle shadows match the gradients");
+        {
+            for (int radius = 1; radius < 30; radius += 4)
+            {
+                const DropShadow shadow (Colours::black.withAlpha (0.5f), radius, Point<int> (r.nextInt (5), r.nextInt (5)));
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    const Rectangle<int> area (radius + 10, radius + 10, 40 + r.nextInt (400), 40 + r.nextInt (300));
+
+                    expect (getMaxDifference (drawRectangleShadow (shadow, area, false),
+                                              drawRectangleShadow (shadow, area, true)) <= 2);
+                }
+            }
+        }
+
+        beginTest ("Blur benchmark");
+        {
+            const int sizes[] = { 256, 512, 1024 };
+            const int radii[] = { 2, 8, 32 };
+
+            for (int size = 0; size < numElementsInArray (sizes); ++size)
+            {
+                const int w = sizes[size], h = (sizes[size] * 3) / 4;
+                const Image mask (createMask (r, w, h));
+
+                for (int radius = 0; radius < numElementsInArray (radii); ++radius)
+                {
+                    Image image (mask.createCopy());
+                    const Image::BitmapData data (image, Image::BitmapData::readWrite);
+
+                    double start = Time::getMillisecondCounterHiRes();
+                    tripletBlur (data, radii[radius]);
+                    const double tripletTime = Time::getMillisecondCounterHiRes() - start;
+
+                    const BoxWidths boxes (BlurHelpers::getBoxWidths (BlurHelpers::getVarianceForShadowRadius (radii[radius])));
+                    String results;
+
+                    for (int i = 0; i < implementations.size(); ++i)
+                    {
+                        ScopedImplementation scope (implementations.getReference (i));
+
+                        start = Time::getMillisecondCounterHiRes();
+                        BlurHelpers::blur (data, boxes, nullptr);
+                        const double singleThreadTime = Time::getMillisecondCounterHiRes() - start;
+
+                        start = Time::getMillisecondCounterHiRes();
+                        BlurHelpers::blur (data, boxes, DeferredRendererThreadPool::getInstance());
+                        const double threadedTime = Time::getMillisecondCounterHiRes() - start;
+
+                        results << "  " << implementations.getReference (i).name << " " << String (singleThreadTime, 2)
+                                << " ms (" << String (threadedTime, 2) << " ms threaded)";
+                    }
+
+                    logMessage (String (w) + "x" + String (h) + ", radius " + String (radii[radius])
+                                  + ": old blur " + String (tripletTime, 2) + " ms," + results);
+                }
+            }
+        }
+
+        beginTest ("Resizing window shadow benchmark");
+        {
+            const DropShadow shadow (Colours::black.withAlpha (0.5f), 16, Point<int>());
+            const int numFrames = 40;
+            double times[2];
+
+            for (int useCache = 0; useCache < 2; ++useCache)
+            {
+                const ScopedCacheState state (useCache != 0);
+                Image image (Image::ARGB, 1400, 1000, true);
+                const double start = Time::getMillisecondCounterHiRes();
+
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    // DropShadower draws the shadow into four windows around the edges of the component
+                    const Rectangle<int> area (40, 40, 800 + frame * 10, 600 + frame * 5);
+                    const Rectangle<int> outer (area.expanded (shadow.radius));
+                    const Rectangle<int> windows[] = { outer.withWidth (shadow.radius), outer.withLeft (area.getRight()),
+                                                       outer.withHeight (shadow.radius), outer.withTop (area.getBottom()) };
+
+                    for (int i = 0; i < numElementsInArray (windows); ++i)
+                    {
+                        Graphics g (image);
+                        g.reduceClipRegion (windows[i]);
+                        shadow.drawForRectangle (g, area);
+                    }
+                }
+
+                times[useCache] = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+            }
+
+            logMessage ("Gradients " + String (times[0], 3) + " ms/frame, cached " + String (times[1], 3) + " ms/frame");
+        }
+    }
+};
+
+static DropShadowTests dropShadowTests;
+
+#endif
@@ -41,11 +41,15 @@ struct JUCE_API  DropShadow
     /** Renders a drop-shadow based on the alpha-channel of the given image. */
     void drawForImage (Graphics& g, const Image& srcImage) const;
 
-    /** Renders a drop-shadow based on the shape of a path. */
+    /** Renders a drop-shadow based on the shape of a path.
+        The blurred shadows of recently drawn paths are cached, so re-drawing the same
+        path is quick.
+    */
     void drawForPath (Graphics& g, const Path& path) const;
 
     /** Renders a drop-shadow for a rectangle.
-        Note that for speed, this approximates the shadow using gradients.
+        Note that for speed, this approximates the shadow using gradients, which are
+        drawn once for each radius and colour, and then re-used for rectangles of any size.
     */
     void drawForRectangle (Graphics& g, const Rectangle<int>& area) const;
 
@@ -72,9 +76,10 @@ struct JUCE_API  DropShadow
     shadow based on what gets drawn inside it. The shadow will also
     be applied to the component's children.
 
-    For speed, this doesn't use a proper gaussian blur, but cheats by
-    using a simple bilinear filter. If you need a really high-quality
-    shadow, check out ImageConvolutionKernel::createGaussianBlur()
+    For speed, this doesn't use a proper gaussian blur, but approximates one
+    with a few box filters, which take the same time whatever the radius. If
+    you need a really high-quality shadow, check out
+    ImageConvolutionKernel::createGaussianBlur()
 
     @see Component::setComponentEffect
 */
@@ -39,19 +39,60 @@ void GlowEffect::setGlowProperties (const float newRadius,
     colour = newColour;
 }
 
+// The glow used to be drawn with a truncated gaussian convolution kernel, so this
+// finds the variance of that kernel to give the stacked-box blur the same spread.
+static double getGlowVariance (float radius, int kernelSize) noexcept
+{
+    const double radiusFactor = -1.0 / (radius * radius * 2);
+    const int centre = kernelSize >> 1;
+    double total = 0, sum = 0, sumOfSquares = 0;
+
+    for (int i = 0; i < kernelSize; ++i)
+    {
+        const double distance = i - centre;
+        const double weight = std::exp (radiusFactor * distance * distance);
+
+        total += weight;
+        sum += weight * distance;
+        sumOfSquares += weight * distance * distance;
+    }
+
+    if (total <= 0)
+        return 0;
+
+    const double mean = sum / total;
+    return sumOfSquares / total - mean * mean;
+}
+
 void GlowEffect::applyEffect (Image& image, Graphics& g, float scaleFactor, float alpha)
 {
-    Image temp (image.getFormat(), image.getWidth(), image.getHeight(), true);
+    if (radius > 0)
+    {
+        // only the alpha channel of the blurred image is used, so there's no need to blur the colours
+        Image glow (image.convertedToFormat (Image::SingleChannel));
+        glow.duplicateIfShared();
+
+        BlurHelpers::blur (glow, getGlowVariance (radius, roundToInt (radius * scaleFactor * 2.0f)));
+
+        // (the kernel's values were all scaled up by the radius, which brightens the glow)
+        uint8 levels [256];
+
+        for (int i = 0; i < 256; ++i)
+            levels[i] = (uint8) jmin (0xff, roundToInt (i * radius));
 
-    ImageConvolutionKernel blurKernel (roundToInt (radius * scaleFactor * 2.0f));
+        const Image::BitmapData data (glow, Image::BitmapData::readWrite);
 
-    blurKernel.createGaussianBlur (radius);
-    blurKernel.rescaleAllValues (radius);
+        for (int y = 0; y < data.height; ++y)
+        {
+            uint8* line = data.getLinePointer (y);
 
-    blurKernel.applyToImage (temp, image, image.getBounds());
+            for (int x = 0; x < data.width; ++x)
+                line[x] = levels [line[x]];
+        }
 
-    g.setColour (colour.withMultipliedAlpha (alpha));
-    g.drawImageAt (temp, 0, 0, true);
+        g.setColour (colour.withMultipliedAlpha (alpha));
+        g.drawImageAt (glow, 0, 0, true);
+    }
 
     g.setOpacity (alpha);
     g.drawImageAt (image, 0, 0, false);
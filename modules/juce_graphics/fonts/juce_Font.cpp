@@ -166,6 +166,7 @@ void Typeface::clearTypefaceCache()
     TypefaceCache::getInstance()->clear();
 
     RenderingHelpers::SoftwareRendererSavedState::clearGlyphCache();
+    RenderingHelpers::GlyphArrangementCache::getInstance()->clear();
 
     if (clearOpenGLGlyphCache != nullptr)
         clearOpenGLGlyphCache();
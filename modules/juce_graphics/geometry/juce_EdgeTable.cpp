@@ -338,8 +338,8 @@ void EdgeTable::sanitiseLevels (const bool useNonZeroWinding) noexcept
             std::sort (items, itemsEnd);
 
             const LineItem* src = items;
-            int correctedNum = num;
-            int level = 0;
+            LineItem* const firstItem = items;
+            int level = 0, lastCorrected = 0;
 
             while (src < itemsEnd)
             {
@@ -351,7 +351,6 @@ void EdgeTable::sanitiseLevels (const bool useNonZeroWinding) noexcept
                 {
                     level += src->level;
                     ++src;
-                    --correctedNum;
                 }
 
                 int corrected = std::abs (level);
@@ -370,13 +369,21 @@ void EdgeTable::sanitiseLevels (const bool useNonZeroWinding) noexcept
                     }
                 }
 
-                items->x = x;
-                items->level = corrected;
-                ++items;
+                // Points that don't change the level are dropped, so that a line with a given
+                // coverage always has the same points, however it was built up.
+                if (corrected != lastCorrected)
+                {
+                    items->x = x;
+                    items->level = corrected;
+                    lastCorrected = corrected;
+                    ++items;
+                }
             }
 
-            lineStart[0] = correctedNum;
-            (items - 1)->level = 0; // force the last level to 0, just in case something went wrong in creating the table
+            lineStart[0] = (int) (items - firstItem);
+
+            if (items > firstItem)
+                (items - 1)->level = 0; // force the last level to 0, just in case something went wrong in creating the table
         }
 
         lineStart += lineStrideElements;
@@ -411,6 +418,11 @@ void EdgeTable::optimiseTable()
     remapTableForNumEdges (maxLineElements);
 }
 
+size_t EdgeTable::getAllocatedSize() const noexcept
+{
+    return getEdgeTableAllocationSize (lineStrideElements, bounds.getHeight()) * sizeof (int);
+}
+
 void EdgeTable::addEdgePoint (const int x, const int y, const int winding)
 {
     jassert (y >= 0 && y < bounds.getHeight());
@@ -481,15 +493,27 @@ void EdgeTable::multiplyLevels (float amount)
 
     for (int y = 0; y < bounds.getHeight(); ++y)
     {
-        int numPoints = lineStart[0];
-        LineItem* item = reinterpret_cast<LineItem*> (lineStart + 1);
-        lineStart += lineStrideElements;
+        const int numPoints = lineStart[0];
+        LineItem* const items = reinterpret_cast<LineItem*> (lineStart + 1);
+        int numKept = 0, lastLevel = 0;
 
-        while (--numPoints > 0)
+        for (int i = 0; i < numPoints; ++i)
         {
-            item->level = jmin (255, (item->level * multiplier) >> 8);
-            ++item;
+            const int level = i < numPoints - 1 ? jmin (255, (items[i].level * multiplier) >> 8)
+                                                : items[i].level;
+
+            // (levels that have become equal are merged, as in sanitiseLevels())
+            if (level != lastLevel)
+            {
+                items[numKept].x = items[i].x;
+                items[numKept].level = level;
+                lastLevel = level;
+                ++numKept;
+            }
         }
+
+        lineStart[0] = numKept;
+        lineStart += lineStrideElements;
     }
 }
 
@@ -89,6 +89,9 @@ public:
     */
     void optimiseTable();
 
+    /** Returns the number of bytes that the table has allocated for its data. */
+    size_t getAllocatedSize() const noexcept;
+
 
     //==============================================================================
     /** Iterates the lines in the table, for rendering.
@@ -159,17 +159,78 @@ namespace JPEGHelpers
    #if ! JUCE_USING_COREIMAGE_LOADER
     static void dummyCallback1 (j_decompress_ptr) {}
 
+    // Feeds the decompressor from an InputStream a block at a time, so that the
+    // file doesn't have to be read into memory before decoding can start.
+    const int jpegReadBufferSize = 4096;
+
+    struct JuceJpegSource  : public jpeg_source_mgr
+    {
+        InputStream* input;
+        JOCTET* buffer;
+        bool reachedEnd;
+    };
+
+    static boolean jpegFill (j_decompress_ptr decompStruct)
+    {
+        JuceJpegSource* const src = static_cast<JuceJpegSource*> (decompStruct->src);
+
+        int numRead = src->input->read (src->buffer, jpegReadBufferSize);
+
+        if (numRead <= 0)
+        {
+            // a truncated file gets a fake end-of-image marker, so that whatever has
+            // been decoded so far is kept, as libjpeg's own stdio source does
+            src->buffer[0] = (JOCTET) 0xff;
+            src->buffer[1] = (JOCTET) JPEG_EOI;
+            src->reachedEnd = true;
+            numRead = 2;
+        }
+
+        src->next_input_byte = src->buffer;
+        src->bytes_in_buffer = (size_t) numRead;
+        return TRUE;
+    }
+
     static void jpegSkip (j_decompress_ptr decompStruct, long num)
     {
-        decompStruct->src->next_input_byte += num;
+        JuceJpegSource* const src = static_cast<JuceJpegSource*> (decompStruct->src);
 
-        num = jmin (num, (long) decompStruct->src->bytes_in_buffer);
-        decompStruct->src->bytes_in_buffer -= (size_t) num;
+        if (num <= 0)
+            return;
+
+        if ((size_t) num > src->bytes_in_buffer)
+        {
+            src->input->skipNextBytes (num - (long) src->bytes_in_buffer);
+            src->bytes_in_buffer = 0;
+            return;
+        }
+
+        src->next_input_byte += num;
+        src->bytes_in_buffer -= (size_t) num;
     }
 
-    static boolean jpegFill (j_decompress_ptr)
+    static void setupStreamSource (jpeg_decompress_struct& decompStruct, JuceJpegSource& src,
+                                   InputStream& input, JOCTET* buffer)
     {
-        return 0;
+        src.input             = &input;
+        src.buffer            = buffer;
+        src.reachedEnd        = false;
+        src.init_source       = dummyCallback1;
+        src.fill_input_buffer = jpegFill;
+        src.skip_input_data   = jpegSkip;
+        src.resync_to_restart = jpeg_resync_to_restart;
+        src.term_source       = dummyCallback1;
+        src.next_input_byte   = nullptr;
+        src.bytes_in_buffer   = 0;
+
+        decompStruct.src = &src;
+    }
+
+    // Leaves the stream positioned just after the image data, as the old decoder did.
+    static void rewindUnusedInput (InputStream& input, const JuceJpegSource& src)
+    {
+        if (! src.reachedEnd && src.bytes_in_buffer > 0)
+            input.setPosition (input.getPosition() - (int64) src.bytes_in_buffer);
     }
    #endif
 
@@ -238,112 +299,179 @@ bool JPEGImageFormat::canUnderstand (InputStream& in)
 
 Image JPEGImageFormat::decodeImage (InputStream& in)
 {
-#if JUCE_USING_COREIMAGE_LOADER
+   #if JUCE_USING_COREIMAGE_LOADER
     return juce_loadWithCoreImage (in);
-#else
+   #else
+    return decodeImageIncrementally (in, Image(), 1, nullptr);
+   #endif
+}
+
+bool JPEGImageFormat::readImageHeader (InputStream& in, int& width, int& height, bool& hasAlphaChannel)
+{
+   #if JUCE_USING_COREIMAGE_LOADER
+    return ImageFileFormat::readImageHeader (in, width, height, hasAlphaChannel);
+   #else
     using namespace jpeglibNamespace;
     using namespace JPEGHelpers;
 
-    MemoryOutputStream mb;
-    mb << in;
+    struct jpeg_decompress_struct jpegDecompStruct;
 
-    Image image;
+    struct jpeg_error_mgr jerr;
+    setupSilentErrorHandler (jerr);
+    jpegDecompStruct.err = &jerr;
 
-    if (mb.getDataSize() > 16)
-    {
-        struct jpeg_decompress_struct jpegDecompStruct;
+    jpeg_create_decompress (&jpegDecompStruct);
 
-        struct jpeg_error_mgr jerr;
-        setupSilentErrorHandler (jerr);
-        jpegDecompStruct.err = &jerr;
+    bool hasFailed = false;
+    jpegDecompStruct.client_data = &hasFailed;
 
-        jpeg_create_decompress (&jpegDecompStruct);
+    JuceJpegSource source;
+    HeapBlock<JOCTET> readBuffer (jpegReadBufferSize);
+    setupStreamSource (jpegDecompStruct, source, in, readBuffer);
 
-        jpegDecompStruct.src = (jpeg_source_mgr*)(jpegDecompStruct.mem->alloc_small)
-            ((j_common_ptr)(&jpegDecompStruct), JPOOL_PERMANENT, sizeof (jpeg_source_mgr));
+    const bool ok = jpeg_read_header (&jpegDecompStruct, TRUE) == JPEG_HEADER_OK && ! hasFailed;
 
-        bool hasFailed = false;
-        jpegDecompStruct.client_data = &hasFailed;
+    width  = ok ? (int) jpegDecompStruct.image_width  : 0;
+    height = ok ? (int) jpegDecompStruct.image_height : 0;
+    hasAlphaChannel = false;
 
-        jpegDecompStruct.src->init_source       = dummyCallback1;
-        jpegDecompStruct.src->fill_input_buffer = jpegFill;
-        jpegDecompStruct.src->skip_input_data   = jpegSkip;
-        jpegDecompStruct.src->resync_to_restart = jpeg_resync_to_restart;
-        jpegDecompStruct.src->term_source       = dummyCallback1;
+    jpeg_destroy_decompress (&jpegDecompStruct);
+    return ok && width > 0 && height > 0;
+   #endif
+}
 
-        jpegDecompStruct.src->next_input_byte   = static_cast<const unsigned char*> (mb.getData());
-        jpegDecompStruct.src->bytes_in_buffer   = mb.getDataSize();
+Image JPEGImageFormat::decodeImageIncrementally (InputStream& in, const Image& destImage,
+                                                 int scaleDenominator, DecodeListener* listener)
+{
+   #if JUCE_USING_COREIMAGE_LOADER
+    return ImageFileFormat::decodeImageIncrementally (in, destImage, scaleDenominator, listener);
+   #else
+    using namespace jpeglibNamespace;
+    using namespace JPEGHelpers;
 
-        jpeg_read_header (&jpegDecompStruct, TRUE);
+    jassert (scaleDenominator == 1 || scaleDenominator == 2 || scaleDenominator == 4 || scaleDenominator == 8);
 
-        if (! hasFailed)
-        {
-            jpeg_calc_output_dimensions (&jpegDecompStruct);
+    Image image;
 
-            if (! hasFailed)
-            {
-                const int width  = (int) jpegDecompStruct.output_width;
-                const int height = (int) jpegDecompStruct.output_height;
+    struct jpeg_decompress_struct jpegDecompStruct;
+
+    struct jpeg_error_mgr jerr;
+    setupSilentErrorHandler (jerr);
+    jpegDecompStruct.err = &jerr;
+
+    jpeg_create_decompress (&jpegDecompStruct);
+
+    bool hasFailed = false;
+    jpegDecompStruct.client_data = &hasFailed;
+
+    JuceJpegSource source;
+    HeapBlock<JOCTET> readBuffer (jpegReadBufferSize);
+    setupStreamSource (jpegDecompStruct, source, in, readBuffer);
 
-                jpegDecompStruct.out_color_space = JCS_RGB;
+    if (jpeg_read_header (&jpegDecompStruct, TRUE) == JPEG_HEADER_OK && ! hasFailed)
+    {
+        // libjpeg can shrink the image by 1/2, 1/4 or 1/8 inside its inverse DCT,
+        // which skips most of the decoding work rather than throwing it away later
+        jpegDecompStruct.scale_num = 1;
+        jpegDecompStruct.scale_denom = (unsigned int) jlimit (1, 8, scaleDenominator);
+        jpegDecompStruct.out_color_space = JCS_RGB;
+
+        jpeg_calc_output_dimensions (&jpegDecompStruct);
+
+        if (! hasFailed)
+        {
+            const int width  = (int) jpegDecompStruct.output_width;
+            const int height = (int) jpegDecompStruct.output_height;
 
-                JSAMPARRAY buffer
-                    = (*jpegDecompStruct.mem->alloc_sarray) ((j_common_ptr) &jpegDecompStruct,
-                                                             JPOOL_IMAGE,
-                                                             (JDIMENSION) width * 3, 1);
+            JSAMPARRAY buffer
+                = (*jpegDecompStruct.mem->alloc_sarray) ((j_common_ptr) &jpegDecompStruct,
+                                                         JPOOL_IMAGE,
+                                                         (JDIMENSION) width * 3, 1);
 
-                if (jpeg_start_decompress (&jpegDecompStruct) && ! hasFailed)
+            if (jpeg_start_decompress (&jpegDecompStruct) && ! hasFailed)
+            {
+                if (destImage.getWidth() == width && destImage.getHeight() == height
+                     && (destImage.isARGB() || destImage.isRGB()))
+                {
+                    image = destImage;
+                }
+                else
                 {
                     image = Image (Image::RGB, width, height, false);
                     image.getProperties()->set ("originalImageHadAlpha", false);
-                    const bool hasAlphaChan = image.hasAlphaChannel(); // (the native image creator may not give back what we expect)
+                }
 
-                    const Image::BitmapData destData (image, Image::BitmapData::writeOnly);
+                const bool hasAlphaChan = image.hasAlphaChannel(); // (the native image creator may not give back what we expect)
+                const int rowsPerBatch = 16;
+                bool wasStopped = false;
 
-                    for (int y = 0; y < height; ++y)
+                for (int startY = 0; startY < height && ! hasFailed; startY += rowsPerBatch)
+                {
+                    if (listener != nullptr && listener->shouldStopDecoding())
                     {
-                        jpeg_read_scanlines (&jpegDecompStruct, buffer, 1);
+                        wasStopped = true;
+                        break;
+                    }
 
-                        if (hasFailed)
-                            break;
+                    const int numRows = jmin (rowsPerBatch, height - startY);
 
-                        const uint8* src = *buffer;
-                        uint8* dest = destData.getLinePointer (y);
+                    {
+                        const Image::BitmapData destData (image, 0, startY, width, numRows, Image::BitmapData::writeOnly);
 
-                        if (hasAlphaChan)
+                        for (int y = 0; y < numRows; ++y)
                         {
-                            for (int i = width; --i >= 0;)
+                            jpeg_read_scanlines (&jpegDecompStruct, buffer, 1);
+
+                            if (hasFailed)
+                                break;
+
+                            const uint8* src = *buffer;
+                            uint8* dest = destData.getLinePointer (y);
+
+                            if (hasAlphaChan)
                             {
-                                ((PixelARGB*) dest)->setARGB (0xff, src[0], src[1], src[2]);
-                                ((PixelARGB*) dest)->premultiply();
-                                dest += destData.pixelStride;
-                                src += 3;
+                                for (int i = width; --i >= 0;)
+                                {
+                                    ((PixelARGB*) dest)->setARGB (0xff, src[0], src[1], src[2]);
+                                    dest += destData.pixelStride;
+                                    src += 3;
+                                }
                             }
-                        }
-                        else
-                        {
-                            for (int i = width; --i >= 0;)
+                            else
                             {
-                                ((PixelRGB*) dest)->setARGB (0xff, src[0], src[1], src[2]);
-                                dest += destData.pixelStride;
-                                src += 3;
+                                for (int i = width; --i >= 0;)
+                                {
+                                    ((PixelRGB*) dest)->setARGB (0xff, src[0], src[1], src[2]);
+                                    dest += destData.pixelStride;
+                                    src += 3;
+                                }
                             }
                         }
                     }
 
-                    if (! hasFailed)
-                        jpeg_finish_decompress (&jpegDecompStruct);
+                    if (listener != nullptr && ! hasFailed)
+                        listener->imageRowsDecoded (image, Range<int> (startY, startY + numRows));
+                }
 
-                    in.setPosition (((char*) jpegDecompStruct.src->next_input_byte) - (char*) mb.getData());
+                if (wasStopped)
+                {
+                    jpeg_abort_decompress (&jpegDecompStruct);
+                    image = Image();
+                }
+                else if (! hasFailed)
+                {
+                    jpeg_finish_decompress (&jpegDecompStruct);
                 }
+
+                rewindUnusedInput (in, source);
             }
         }
-
-        jpeg_destroy_decompress (&jpegDecompStruct);
     }
 
+    jpeg_destroy_decompress (&jpegDecompStruct);
+
     return image;
-#endif
+   #endif
 }
 
 bool JPEGImageFormat::writeImageToStream (const Image& image, OutputStream& out)
@@ -363,16 +363,53 @@ namespace PNGHelpers
         return false;
     }
 
+    static void setUpRGBAOutput (png_structp pngReadStruct, png_infop pngInfoStruct)
+    {
+        if (png_get_valid (pngReadStruct, pngInfoStruct, PNG_INFO_tRNS))
+            png_set_expand (pngReadStruct);
+
+        png_set_add_alpha (pngReadStruct, 0xff, PNG_FILLER_AFTER);
+    }
+
     static bool readImageData (png_structp pngReadStruct, png_infop pngInfoStruct, jmp_buf& errorJumpBuf, png_bytepp rows) noexcept
     {
         if (setjmp (errorJumpBuf) == 0)
         {
-            if (png_get_valid (pngReadStruct, pngInfoStruct, PNG_INFO_tRNS))
-                png_set_expand (pngReadStruct);
+            setUpRGBAOutput (pngReadStruct, pngInfoStruct);
+            png_read_image (pngReadStruct, rows);
+            png_read_end (pngReadStruct, pngInfoStruct);
+            return true;
+        }
 
-            png_set_add_alpha (pngReadStruct, 0xff, PNG_FILLER_AFTER);
+        return false;
+    }
 
-            png_read_image (pngReadStruct, rows);
+    static bool startReadingRows (png_structp pngReadStruct, png_infop pngInfoStruct, jmp_buf& errorJumpBuf) noexcept
+    {
+        if (setjmp (errorJumpBuf) == 0)
+        {
+            setUpRGBAOutput (pngReadStruct, pngInfoStruct);
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool readRow (png_structp pngReadStruct, jmp_buf& errorJumpBuf, png_bytep row) noexcept
+    {
+        if (setjmp (errorJumpBuf) == 0)
+        {
+            png_read_row (pngReadStruct, row, nullptr);
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool finishReading (png_structp pngReadStruct, png_infop pngInfoStruct, jmp_buf& errorJumpBuf) noexcept
+    {
+        if (setjmp (errorJumpBuf) == 0)
+        {
             png_read_end (pngReadStruct, pngInfoStruct);
             return true;
         }
@@ -384,46 +421,190 @@ namespace PNGHelpers
     #pragma warning (pop)
    #endif
 
-    static Image createImageFromData (bool hasAlphaChan, int width, int height, png_bytepp rows)
+    //==============================================================================
+    /** Takes the decoded RGBA rows one at a time and writes them into the image,
+        averaging blocks of pixels together if the image is being shrunk.
+    */
+    class ImageRowWriter
     {
-        // now convert the data to a juce image format..
-        Image image (hasAlphaChan ? Image::ARGB : Image::RGB, width, height, hasAlphaChan);
+    public:
+        ImageRowWriter (const Image& destImage, int sourceWidth_, int sourceHeight_,
+                        int scale_, ImageFileFormat::DecodeListener* listener_)
+            : image (destImage), listener (listener_),
+              sourceWidth (sourceWidth_), sourceHeight (sourceHeight_), scale (scale_),
+              hasAlphaChan (destImage.hasAlphaChannel()), // (the native image creator may not give back what we expect)
+              sourceY (0), rowsInBlock (0), destY (0), batchStart (0), batchEnd (0)
+        {
+            if (scale > 1)
+                sums.calloc ((size_t) image.getWidth() * 4);
+        }
+
+        /** Returns false if the listener wants the decoding to stop. */
+        bool addRow (const uint8* src)
+        {
+            ++sourceY;
+
+            if (scale == 1)
+            {
+                uint8* dest = getNextDestLine();
+
+                if (dest == nullptr)
+                    return false;
+
+                writePixels (src, dest);
+                return finishedDestLine();
+            }
 
-        image.getProperties()->set ("originalImageHadAlpha", image.hasAlphaChannel());
-        hasAlphaChan = image.hasAlphaChannel(); // (the native image creator may not give back what we expect)
+            accumulate (src);
+
+            if (++rowsInBlock == scale || sourceY == sourceHeight)
+            {
+                uint8* dest = getNextDestLine();
+
+                if (dest == nullptr)
+                    return false;
+
+                writeBlockAverages (dest);
+                rowsInBlock = 0;
+                return finishedDestLine();
+            }
+
+            return true;
+        }
 
-        const Image::BitmapData destData (image, Image::BitmapData::writeOnly);
+    private:
+        Image image;
+        ImageFileFormat::DecodeListener* listener;
+        const int sourceWidth, sourceHeight, scale;
+        const bool hasAlphaChan;
+        int sourceY, rowsInBlock, destY, batchStart, batchEnd;
+        HeapBlock<uint32> sums;
+        ScopedPointer<Image::BitmapData> batchData;
+
+        enum { rowsPerBatch = 16 };
+
+        uint8* getNextDestLine()
+        {
+            if (batchData == nullptr)
+            {
+                if (listener != nullptr && listener->shouldStopDecoding())
+                    return nullptr;
+
+                batchStart = destY;
+                batchEnd = jmin (destY + (int) rowsPerBatch, image.getHeight());
+                batchData = new Image::BitmapData (image, 0, batchStart, image.getWidth(),
+                                                   batchEnd - batchStart, Image::BitmapData::writeOnly);
+            }
+
+            return batchData->getLinePointer (destY - batchStart);
+        }
+
+        bool finishedDestLine()
+        {
+            if (++destY == batchEnd)
+            {
+                batchData = nullptr;
+
+                if (listener != nullptr)
+                    listener->imageRowsDecoded (image, Range<int> (batchStart, batchEnd));
+            }
+
+            return true;
+        }
 
-        for (int y = 0; y < (int) height; ++y)
+        void writePixels (const uint8* src, uint8* dest) const noexcept
         {
-            const uint8* src = rows[y];
-            uint8* dest = destData.getLinePointer (y);
+            const int pixelStride = batchData->pixelStride;
 
             if (hasAlphaChan)
             {
-                for (int i = (int) width; --i >= 0;)
+                for (int i = sourceWidth; --i >= 0;)
                 {
                     ((PixelARGB*) dest)->setARGB (src[3], src[0], src[1], src[2]);
                     ((PixelARGB*) dest)->premultiply();
-                    dest += destData.pixelStride;
+                    dest += pixelStride;
                     src += 4;
                 }
             }
             else
             {
-                for (int i = (int) width; --i >= 0;)
+                for (int i = sourceWidth; --i >= 0;)
                 {
                     ((PixelRGB*) dest)->setARGB (0, src[0], src[1], src[2]);
-                    dest += destData.pixelStride;
+                    dest += pixelStride;
                     src += 4;
                 }
             }
         }
 
-        return image;
-    }
+        void accumulate (const uint8* src) noexcept
+        {
+            uint32* sum = sums;
+
+            for (int x = 0; x < sourceWidth; x += scale)
+            {
+                const int numInBlock = jmin (scale, sourceWidth - x);
+
+                for (int i = 0; i < numInBlock; ++i)
+                {
+                    if (src[3] == 0xff)
+                    {
+                        sum[0] += 0xff;
+                        sum[1] += src[0];
+                        sum[2] += src[1];
+                        sum[3] += src[2];
+                    }
+                    else
+                    {
+                        PixelARGB p;
+                        p.setARGB (src[3], src[0], src[1], src[2]);
+                        p.premultiply();
+
+                        sum[0] += p.getAlpha();
+                        sum[1] += p.getRed();
+                        sum[2] += p.getGreen();
+                        sum[3] += p.getBlue();
+                    }
+
+                    src += 4;
+                }
 
-    static Image readImage (InputStream& in, png_structp pngReadStruct, png_infop pngInfoStruct)
+                sum += 4;
+            }
+        }
+
+        void writeBlockAverages (uint8* dest) noexcept
+        {
+            const int pixelStride = batchData->pixelStride;
+            uint32* sum = sums;
+
+            for (int x = 0; x < sourceWidth; x += scale)
+            {
+                const uint32 count = (uint32) (rowsInBlock * jmin (scale, sourceWidth - x));
+                const uint32 half = count / 2;
+
+                const uint8 a = (uint8) ((sum[0] + half) / count);
+                const uint8 r = (uint8) ((sum[1] + half) / count);
+                const uint8 g = (uint8) ((sum[2] + half) / count);
+                const uint8 b = (uint8) ((sum[3] + half) / count);
+
+                if (hasAlphaChan)
+                    ((PixelARGB*) dest)->setARGB (a, r, g, b);
+                else
+                    ((PixelRGB*) dest)->setARGB (0, r, g, b);
+
+                sum[0] = sum[1] = sum[2] = sum[3] = 0;
+                sum += 4;
+                dest += pixelStride;
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (ImageRowWriter)
+    };
+
+    //==============================================================================
+    static Image readImage (InputStream& in, png_structp pngReadStruct, png_infop pngInfoStruct,
+                            const Image& destImage, int scale, ImageFileFormat::DecodeListener* listener)
     {
         jmp_buf errorJumpBuf;
         png_set_error_fn (pngReadStruct, &errorJumpBuf, errorCallback, warningCallback);
@@ -434,29 +615,69 @@ namespace PNGHelpers
         if (readHeader (in, pngReadStruct, pngInfoStruct, errorJumpBuf,
                         width, height, bitDepth, colorType, interlaceType))
         {
-            // Load the image into a temp buffer..
+            const bool hasAlphaChan = (colorType & PNG_COLOR_MASK_ALPHA) != 0 || pngInfoStruct->num_trans > 0;
+            const int destWidth  = ImageFileFormat::getScaledSize ((int) width,  scale);
+            const int destHeight = ImageFileFormat::getScaledSize ((int) height, scale);
+
+            Image image;
+
+            if (destImage.getWidth() == destWidth && destImage.getHeight() == destHeight
+                 && (destImage.isARGB() || destImage.isRGB()))
+            {
+                image = destImage;
+            }
+            else
+            {
+                image = Image (hasAlphaChan ? Image::ARGB : Image::RGB, destWidth, destHeight, hasAlphaChan);
+                image.getProperties()->set ("originalImageHadAlpha", image.hasAlphaChannel());
+            }
+
+            ImageRowWriter writer (image, (int) width, (int) height, scale, listener);
             const size_t lineStride = width * 4;
-            HeapBlock<uint8> tempBuffer (height * lineStride);
-            HeapBlock<png_bytep> rows (height);
+
+            if (interlaceType != PNG_INTERLACE_NONE)
+            {
+                // interlaced images arrive in several passes, so they need the whole temp buffer..
+                HeapBlock<uint8> tempBuffer (height * lineStride);
+                HeapBlock<png_bytep> rows (height);
+
+                for (size_t y = 0; y < height; ++y)
+                    rows[y] = (png_bytep) (tempBuffer + lineStride * y);
+
+                if (! readImageData (pngReadStruct, pngInfoStruct, errorJumpBuf, rows))
+                    return Image();
+
+                for (size_t y = 0; y < height; ++y)
+                    if (! writer.addRow (rows[y]))
+                        return Image();
+
+                return image;
+            }
+
+            // ..but others can be converted a row at a time, straight into the image
+            HeapBlock<uint8> row (lineStride);
+
+            if (! startReadingRows (pngReadStruct, pngInfoStruct, errorJumpBuf))
+                return Image();
 
             for (size_t y = 0; y < height; ++y)
-                rows[y] = (png_bytep) (tempBuffer + lineStride * y);
+                if (! (readRow (pngReadStruct, errorJumpBuf, row) && writer.addRow (row)))
+                    return Image();
 
-            if (readImageData (pngReadStruct, pngInfoStruct, errorJumpBuf, rows))
-                return createImageFromData ((colorType & PNG_COLOR_MASK_ALPHA) != 0 || pngInfoStruct->num_trans > 0,
-                                            (int) width, (int) height, rows);
+            if (finishReading (pngReadStruct, pngInfoStruct, errorJumpBuf))
+                return image;
         }
 
         return Image();
     }
 
-    static Image readImage (InputStream& in)
+    static Image readImage (InputStream& in, const Image& destImage, int scale, ImageFileFormat::DecodeListener* listener)
     {
         if (png_structp pngReadStruct = png_create_read_struct (PNG_LIBPNG_VER_STRING, 0, 0, 0))
         {
             if (png_infop pngInfoStruct = png_create_info_struct (pngReadStruct))
             {
-                Image image (readImage (in, pngReadStruct, pngInfoStruct));
+                Image image (readImage (in, pngReadStruct, pngInfoStruct, destImage, scale, listener));
                 png_destroy_read_struct (&pngReadStruct, &pngInfoStruct, 0);
                 return image;
             }
@@ -466,6 +687,38 @@ namespace PNGHelpers
 
         return Image();
     }
+
+    static bool readHeaderOnly (InputStream& in, int& width, int& height, bool& hasAlphaChannel)
+    {
+        bool ok = false;
+
+        if (png_structp pngReadStruct = png_create_read_struct (PNG_LIBPNG_VER_STRING, 0, 0, 0))
+        {
+            png_infop pngInfoStruct = png_create_info_struct (pngReadStruct);
+
+            if (pngInfoStruct != nullptr)
+            {
+                jmp_buf errorJumpBuf;
+                png_set_error_fn (pngReadStruct, &errorJumpBuf, errorCallback, warningCallback);
+
+                png_uint_32 w = 0, h = 0;
+                int bitDepth = 0, colorType = 0, interlaceType = 0;
+
+                if (readHeader (in, pngReadStruct, pngInfoStruct, errorJumpBuf,
+                                w, h, bitDepth, colorType, interlaceType))
+                {
+                    width = (int) w;
+                    height = (int) h;
+                    hasAlphaChannel = (colorType & PNG_COLOR_MASK_ALPHA) != 0 || pngInfoStruct->num_trans > 0;
+                    ok = width > 0 && height > 0;
+                }
+            }
+
+            png_destroy_read_struct (&pngReadStruct, pngInfoStruct != nullptr ? &pngInfoStruct : nullptr, 0);
+        }
+
+        return ok;
+    }
    #endif
 }
 
@@ -496,7 +749,27 @@ Image PNGImageFormat::decodeImage (InputStream& in)
    #if JUCE_USING_COREIMAGE_LOADER
     return juce_loadWithCoreImage (in);
    #else
-    return PNGHelpers::readImage (in);
+    return PNGHelpers::readImage (in, Image(), 1, nullptr);
+   #endif
+}
+
+bool PNGImageFormat::readImageHeader (InputStream& in, int& width, int& height, bool& hasAlphaChannel)
+{
+   #if JUCE_USING_COREIMAGE_LOADER
+    return ImageFileFormat::readImageHeader (in, width, height, hasAlphaChannel);
+   #else
+    return PNGHelpers::readHeaderOnly (in, width, height, hasAlphaChannel);
+   #endif
+}
+
+Image PNGImageFormat::decodeImageIncrementally (InputStream& in, const Image& destImage,
+                                                int scaleDenominator, DecodeListener* listener)
+{
+   #if JUCE_USING_COREIMAGE_LOADER
+    return ImageFileFormat::decodeImageIncrementally (in, destImage, scaleDenominator, listener);
+   #else
+    jassert (scaleDenominator == 1 || scaleDenominator == 2 || scaleDenominator == 4 || scaleDenominator == 8);
+    return PNGHelpers::readImage (in, destImage, jlimit (1, 8, scaleDenominator), listener);
    #endif
 }
 
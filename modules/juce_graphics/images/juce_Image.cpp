@@ -292,12 +292,165 @@ Image Image::createCopy() const
     return Image();
 }
 
+//==============================================================================
+/*  Shrinks an image by averaging all the source pixels that each destination pixel
+    covers, weighted by how much of each one it covers. Unlike the renderer's resampling,
+    which only looks at the four pixels nearest to each sample, nothing gets skipped, so
+    detail doesn't alias however much the image is shrunk.
+*/
+class AreaAveragingDownscaler
+{
+public:
+    AreaAveragingDownscaler (const Image::BitmapData& src, const Image::BitmapData& dst)
+        : srcData (src), destData (dst), channels (src.pixelStride),
+          columns (src.width, dst.width), rows (src.height, dst.height)
+    {
+        jassert (src.pixelStride == dst.pixelStride);
+    }
+
+    void scale()
+    {
+        const int minRowsPerBand = 8;
+        ThreadPool* const pool = DeferredRendererThreadPool::getInstanceForHelperJobs();
+        const int numBands = pool == nullptr || srcData.width * srcData.height < 256 * 256 ? 1
+                               : jlimit (1, SystemStats::getNumCpus(), destData.height / minRowsPerBand);
+
+        OwnedArray<BandJob> jobs;
+
+        for (int i = 1; i < numBands; ++i)
+        {
+            BandJob* job = jobs.add (new BandJob (*this, Range<int> ((destData.height * i) / numBands,
+                                                                     (destData.height * (i + 1)) / numBands)));
+            pool->addJob (job, false);
+        }
+
+        scaleRows (Range<int> (0, destData.height / numBands));
+
+        for (int i = 0; i < jobs.size(); ++i)
+            pool->waitForJobToFinish (jobs.getUnchecked (i), -1);
+    }
+
+private:
+    // The source pixels that each destination pixel along one axis is made from, and their weights
+    struct Axis
+    {
+        Axis (int srcSize, int destSize)  : first ((size_t) destSize), num ((size_t) destSize)
+        {
+            const double ratio = srcSize / (double) destSize;
+            Array<float> allWeights;
+
+            for (int i = 0; i < destSize; ++i)
+            {
+                const double start = i * ratio, end = jmin ((double) srcSize, (i + 1) * ratio);
+                first[i] = (int) start;
+                num[i] = jmax (1, jmin (srcSize, (int) std::ceil (end)) - first[i]);
+
+                for (int j = first[i]; j < first[i] + num[i]; ++j)
+                    allWeights.add ((float) ((jmin (end, j + 1.0) - jmax (start, (double) j)) / ratio));
+            }
+
+            weights.malloc ((size_t) allWeights.size());
+            memcpy (weights, allWeights.getRawDataPointer(), sizeof (float) * (size_t) allWeights.size());
+        }
+
+        HeapBlock<int> first, num;
+        HeapBlock<float> weights;
+    };
+
+    class BandJob  : public ThreadPoolJob
+    {
+    public:
+        BandJob (AreaAveragingDownscaler& d, Range<int> r)
+            : ThreadPoolJob ("Image downscaling"), owner (d), rowRange (r) {}
+
+        JobStatus runJob() override
+        {
+            owner.scaleRows (rowRange);
+            return jobHasFinished;
+        }
+
+    private:
+        AreaAveragingDownscaler& owner;
+        const Range<int> rowRange;
+
+        JUCE_DECLARE_NON_COPYABLE (BandJob)
+    };
+
+    const Image::BitmapData& srcData;
+    const Image::BitmapData& destData;
+    const int channels;
+    const Axis columns, rows;
+
+    void scaleRows (Range<int> destRows) const noexcept
+    {
+        const int lineLength = srcData.width * channels;
+        HeapBlock<float> line ((size_t) lineLength), sum ((size_t) lineLength);
+
+        const float* rowWeights = rows.weights;
+
+        for (int y = 0; y < destRows.getStart(); ++y)
+            rowWeights += rows.num[y];
+
+        for (int y = destRows.getStart(); y < destRows.getEnd(); ++y)
+        {
+            // first the source lines are averaged into one..
+            zeromem (sum, sizeof (float) * (size_t) lineLength);
+
+            for (int i = 0; i < rows.num[y]; ++i)
+            {
+                const uint8* src = srcData.getLinePointer (rows.first[y] + i);
+
+                for (int j = 0; j < lineLength; ++j)
+                    line[j] = src[j];
+
+                RenderingHelpers::PixelSpans::multiplyAdd (sum, line, *rowWeights++, lineLength);
+            }
+
+            // ..and then the pixels along that line
+            uint8* dest = destData.getLinePointer (y);
+            const float* columnWeights = columns.weights;
+
+            for (int x = 0; x < destData.width; ++x)
+            {
+                const float* src = sum + columns.first[x] * channels;
+                float total[4] = { 0 };
+
+                for (int i = 0; i < columns.num[x]; ++i)
+                {
+                    const float weight = *columnWeights++;
+
+                    for (int c = 0; c < channels; ++c)
+                        total[c] += *src++ * weight;
+                }
+
+                for (int c = 0; c < channels; ++c)
+                    *dest++ = (uint8) jlimit (0, 0xff, roundToInt (total[c]));
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (AreaAveragingDownscaler)
+};
+
 Image Image::rescaled (const int newWidth, const int newHeight, const Graphics::ResamplingQuality quality) const
 {
     if (image == nullptr || (image->width == newWidth && image->height == newHeight))
         return *this;
 
     const ScopedPointer<ImageType> type (image->createType());
+
+    if (quality == Graphics::highResamplingQuality
+         && newWidth > 0 && newHeight > 0 && newWidth <= image->width && newHeight <= image->height)
+    {
+        Image newImage (type->create (image->pixelFormat, newWidth, newHeight, false));
+
+        const BitmapData srcData (*this, BitmapData::readOnly);
+        const BitmapData destData (newImage, BitmapData::writeOnly);
+        AreaAveragingDownscaler (srcData, destData).scale();
+
+        return newImage;
+    }
+
     Image newImage (type->create (image->pixelFormat, newWidth, newHeight, hasAlphaChannel()));
 
     Graphics g (newImage);
@@ -674,3 +827,193 @@ void Image::moveImageSection (int dx, int dy,
         }
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ImageRescalingTests  : public UnitTest
+{
+public:
+    ImageRescalingTests() : UnitTest ("Image::rescaled") {}
+
+    static Image createImage (Random& r, Image::PixelFormat format, int w, int h)
+    {
+        Image image (format, w, h, true);
+
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                image.setPixelAt (x, y, Colour ((uint32) r.nextInt()));
+
+        return image;
+    }
+
+    // Shrinks an image by a whole number of pixels in each direction, by averaging blocks of them
+    static Image shrinkByBlocks (const Image& source, int factor)
+    {
+        const Image::BitmapData src (source, Image::BitmapData::readOnly);
+        Image result (source.getFormat(), source.getWidth() / factor, source.getHeight() / factor, false);
+        const Image::BitmapData dest (result, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < dest.height; ++y)
+        {
+            for (int x = 0; x < dest.width; ++x)
+            {
+                for (int c = 0; c < src.pixelStride; ++c)
+                {
+                    int total = 0;
+
+                    for (int yy = 0; yy < factor; ++yy)
+                        for (int xx = 0; xx < factor; ++xx)
+                            total += src.getPixelPointer (x * factor + xx, y * factor + yy)[c];
+
+                    dest.getPixelPointer (x, y)[c] = (uint8) roundToInt (total / (double) (factor * factor));
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // Shrinks an image from one of a pool's threads
+    struct RescalingJob  : public ThreadPoolJob
+    {
+        RescalingJob (const Image& s)  : ThreadPoolJob ("Test rescale"), source (s) {}
+
+        JobStatus runJob() override
+        {
+            result = source.rescaled (source.getWidth() / 3, source.getHeight() / 3, Graphics::highResamplingQuality);
+            return jobHasFinished;
+        }
+
+        const Image source;
+        Image result;
+    };
+
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        int maxDiff = 0;
+
+        for (int y = 0; y < da.height; ++y)
+            for (int i = 0; i < da.width * da.pixelStride; ++i)
+                maxDiff = jmax (maxDiff, std::abs (da.getLinePointer (y)[i] - db.getLinePointer (y)[i]));
+
+        return maxDiff;
+    }
+
+    void runTest() override
+    {
+        Random r (0xabcd);
+        const Image::PixelFormat formats[] = { Image::ARGB, Image::RGB, Image::SingleChannel };
+
+        beginTest ("Shrinking averages whole blocks of pixels");
+        {
+            for (int format = 0; format < numElementsInArray (formats); ++format)
+            {
+                const Image source (createImage (r, formats[format], 360, 240));
+
+                for (int factor = 2; factor <= 6; ++factor)
+                {
+                    const Image shrunk (source.rescaled (360 / factor, 240 / factor, Graphics::highResamplingQuality));
+
+                    expect (shrunk.getFormat() == source.getFormat());
+                    expect (getMaxDifference (shrinkByBlocks (source, factor), shrunk) <= 1);
+                }
+            }
+        }
+
+        beginTest ("Shrinking on the renderer's own threads");
+        {
+            const Image source (createImage (r, Image::ARGB, 900, 600));
+            const Image expected (source.rescaled (300, 200, Graphics::highResamplingQuality));
+
+            // (with every thread in the pool busy, none of them can wait for help from the others)
+            ThreadPool& pool = *DeferredRendererThreadPool::getInstance();
+            OwnedArray<RescalingJob> jobs;
+
+            for (int i = 0; i < SystemStats::getNumCpus() * 2; ++i)
+                pool.addJob (jobs.add (new RescalingJob (source)), false);
+
+            for (int i = 0; i < jobs.size(); ++i)
+            {
+                expect (pool.waitForJobToFinish (jobs.getUnchecked (i), 20000));
+                expectEquals (getMaxDifference (expected, jobs.getUnchecked (i)->result), 0);
+            }
+        }
+
+        beginTest ("Fine detail doesn't alias");
+        {
+            Image checkerboard (Image::RGB, 401, 301, true);
+
+            for (int y = 0; y < checkerboard.getHeight(); ++y)
+                for (int x = 0; x < checkerboard.getWidth(); ++x)
+                    checkerboard.setPixelAt (x, y, ((x + y) & 1) != 0 ? Colours::white : Colours::black);
+
+            const Image shrunk (checkerboard.rescaled (37, 29, Graphics::highResamplingQuality));
+            int minLevel = 255, maxLevel = 0;
+
+            for (int y = 0; y < shrunk.getHeight(); ++y)
+            {
+                for (int x = 0; x < shrunk.getWidth(); ++x)
+                {
+                    minLevel = jmin (minLevel, (int) shrunk.getPixelAt (x, y).getRed());
+                    maxLevel = jmax (maxLevel, (int) shrunk.getPixelAt (x, y).getRed());
+                }
+            }
+
+            expect (minLevel >= 125 && maxLevel <= 130);
+        }
+
+        beginTest ("Solid colours stay solid");
+        {
+            Image solid (Image::ARGB, 333, 217, false);
+            solid.clear (solid.getBounds(), Colours::orange.withAlpha (0.6f));
+            const Image shrunk (solid.rescaled (101, 13, Graphics::highResamplingQuality));
+
+            bool allTheSame = true;
+
+            for (int y = 0; y < shrunk.getHeight(); ++y)
+                for (int x = 0; x < shrunk.getWidth(); ++x)
+                    allTheSame = allTheSame && shrunk.getPixelAt (x, y) == solid.getPixelAt (0, 0);
+
+            expect (allTheSame);
+        }
+
+        beginTest ("Thumbnail benchmark");
+        {
+            const Image source (createImage (r, Image::ARGB, 2048, 1536));
+            const int sizes[][2] = { { 1024, 768 }, { 256, 192 }, { 64, 48 } };
+
+            for (int i = 0; i < numElementsInArray (sizes); ++i)
+            {
+                const int w = sizes[i][0], h = sizes[i][1];
+                Image resampled (Image::ARGB, w, h, true);
+
+                double start = Time::getMillisecondCounterHiRes();
+
+                {
+                    Graphics g (resampled);
+                    g.setImageResamplingQuality (Graphics::highResamplingQuality);
+                    g.drawImageTransformed (source, AffineTransform::scale (w / (float) source.getWidth(), h / (float) source.getHeight()), false);
+                }
+
+                const double resamplingTime = Time::getMillisecondCounterHiRes() - start;
+
+                start = Time::getMillisecondCounterHiRes();
+                source.rescaled (w, h, Graphics::highResamplingQuality);
+                const double averagingTime = Time::getMillisecondCounterHiRes() - start;
+
+                const double sourcePixels = source.getWidth() * (double) source.getHeight();
+
+                logMessage ("2048x1536 -> " + String (w) + "x" + String (h) + ": resampling " + String (resamplingTime, 2)
+                              + " ms, area-averaging " + String (averagingTime, 2) + " ms ("
+                              + String (sourcePixels / (averagingTime * 1000.0), 1) + " source Mpixels/sec)");
+            }
+        }
+    }
+};
+
+static ImageRescalingTests imageRescalingTests;
+
+#endif
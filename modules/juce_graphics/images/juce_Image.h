@@ -195,6 +195,11 @@ public:
 
         Note that if the new size is identical to the existing image, this will just return
         a reference to the original image, and won't actually create a duplicate.
+
+        When an image is shrunk with Graphics::highResamplingQuality, each new pixel is the
+        average of all the pixels it covers, which avoids the aliasing that resampling gives
+        when an image is reduced to less than half its size. This is the best choice for
+        things like thumbnails.
     */
     Image rescaled (int newWidth, int newHeight,
                     Graphics::ResamplingQuality quality = Graphics::mediumResamplingQuality) const;
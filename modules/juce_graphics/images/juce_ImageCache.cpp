@@ -22,29 +22,73 @@
   ==============================================================================
 */
 
+class ImageCache::ImageFuture::SharedState  : public ReferenceCountedObject
+{
+public:
+    SharedState() : ready (true) {}
+
+    void setResult (const Image& result)
+    {
+        image = result;
+        ready.signal();
+    }
+
+    WaitableEvent ready;
+    Image image;
+
+    typedef ReferenceCountedObjectPtr<SharedState> Ptr;
+};
+
+//==============================================================================
 class ImageCache::Pimpl     : private Timer,
+                              private AsyncUpdater,
                               private DeletedAtShutdown
 {
 public:
-    Pimpl()  : cacheTimeout (5000)
+    Pimpl()  : cacheTimeout (5000), maxBytes (0), bytesUsed (0),
+               numHits (0), numMisses (0), numEvictions (0),
+               mostRecent (nullptr), leastRecent (nullptr)
     {
     }
 
     ~Pimpl()
     {
+        if (loaderPool != nullptr)
+            loaderPool->removeAllJobs (true, 10000);
+
+        loaderPool = nullptr;
+        loads.clear();
+        cancelPendingUpdate();
+
+        while (mostRecent != nullptr)
+            removeItem (mostRecent);
+
         clearSingletonInstance();
     }
 
     Image getFromHashCode (const int64 hashCode)
     {
         const ScopedLock sl (lock);
+        const Image image (findCachedImage (hashCode));
 
-        for (int i = images.size(); --i >= 0;)
-        {
-            const Item* const item = images.getUnchecked(i);
+        if (image.isValid())
+            ++numHits;
+        else
+            ++numMisses;
 
-            if (item->hashCode == hashCode)
-                return item->image;
+        return image;
+    }
+
+    /** Returns a cached image and marks it as recently used, without counting the lookup
+        in the statistics. The lock must be held.
+    */
+    Image findCachedImage (const int64 hashCode)
+    {
+        if (Item* const item = itemsByHash [hashCode])
+        {
+            item->lastUseTime = Time::getApproximateMillisecondCounter();
+            moveToFront (item);
+            return item->image;
         }
 
         return Image();
@@ -57,13 +101,29 @@ public:
             if (! isTimerRunning())
                 startTimer (2000);
 
-            Item* const item = new Item();
-            item->hashCode = hashCode;
+            const ScopedLock sl (lock);
+
+            Item* item = itemsByHash [hashCode];
+
+            if (item != nullptr)
+            {
+                bytesUsed -= item->numBytes;
+                unlink (item);
+            }
+            else
+            {
+                item = new Item();
+                item->hashCode = hashCode;
+                itemsByHash.set (hashCode, item);
+            }
+
             item->image = image;
+            item->numBytes = getMemoryUsage (image);
             item->lastUseTime = Time::getApproximateMillisecondCounter();
+            bytesUsed += item->numBytes;
+            linkAtFront (item);
 
-            const ScopedLock sl (lock);
-            images.add (item);
+            applySizeLimit (item);
         }
     }
 
@@ -73,22 +133,27 @@ public:
 
         const ScopedLock sl (lock);
 
-        for (int i = images.size(); --i >= 0;)
+        for (Item* item = leastRecent; item != nullptr;)
         {
-            Item* const item = images.getUnchecked(i);
+            Item* const next = item->moreRecent;
 
             if (item->image.getReferenceCount() <= 1)
             {
                 if (now > item->lastUseTime + cacheTimeout || now < item->lastUseTime - 1000)
-                    images.remove (i);
+                {
+                    removeItem (item);
+                    ++numEvictions;
+                }
             }
             else
             {
                 item->lastUseTime = now; // multiply-referenced, so this image is still in use.
             }
+
+            item = next;
         }
 
-        if (images.size() == 0)
+        if (mostRecent == nullptr)
             stopTimer();
     }
 
@@ -96,26 +161,444 @@ public:
     {
         const ScopedLock sl (lock);
 
-        for (int i = images.size(); --i >= 0;)
-            if (images.getUnchecked(i)->image.getReferenceCount() <= 1)
-                images.remove (i);
+        for (Item* item = leastRecent; item != nullptr;)
+        {
+            Item* const next = item->moreRecent;
+
+            if (item->image.getReferenceCount() <= 1)
+                removeItem (item);
+
+            item = next;
+        }
     }
 
-    struct Item
+    void setMaximumCacheSize (int64 newMaxBytes)
+    {
+        const ScopedLock sl (lock);
+        maxBytes = newMaxBytes;
+        applySizeLimit();
+    }
+
+    Statistics getStatistics()
+    {
+        const ScopedLock sl (lock);
+
+        Statistics stats;
+        stats.numHits = numHits;
+        stats.numMisses = numMisses;
+        stats.numEvictions = numEvictions;
+        stats.numImages = itemsByHash.size();
+        stats.numBytes = bytesUsed;
+        stats.maximumBytes = maxBytes;
+        return stats;
+    }
+
+    void resetStatistics()
+    {
+        const ScopedLock sl (lock);
+        numHits = numMisses = numEvictions = 0;
+    }
+
+    /** Roughly how much memory an image's pixels take up, as the software image
+        type would lay them out.
+    */
+    static int64 getMemoryUsage (const Image& image) noexcept
+    {
+        const int pixelStride = image.isARGB() ? 4 : (image.isRGB() ? 3 : 1);
+        const int lineStride = (pixelStride * image.getWidth() + 3) & ~3;
+
+        return lineStride * (int64) image.getHeight();
+    }
+
+    //==============================================================================
+    class BackgroundLoad  : public ThreadPoolJob,
+                            private ImageFileFormat::DecodeListener
     {
+    public:
+        BackgroundLoad (Pimpl& p, const File& f, int64 hash, const Image& im)
+            : ThreadPoolJob ("ImageCache load"), owner (p), file (f), hashCode (hash),
+              image (im), isBeingReported (false)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            FileInputStream stream (file);
+
+            if (stream.openedOk())
+            {
+                BufferedInputStream in (stream, 8192);
+
+                if (ImageFileFormat* const format = ImageFileFormat::findImageFormatForStream (in))
+                {
+                    // JPEGs can be decoded at 1/8 size for a fraction of the cost, which
+                    // gives a blurry but recognisable placeholder almost immediately..
+                    if (wantsPreview() && dynamic_cast<JPEGImageFormat*> (format) != nullptr && image.getWidth() >= 64)
+                    {
+                        const Image preview (format->decodeImageIncrementally (in, Image(), 8, this));
+
+                        if (preview.isValid() && ! shouldExit())
+                        {
+                            {
+                                Graphics g (image);
+                                g.setImageResamplingQuality (Graphics::mediumResamplingQuality);
+                                g.drawImage (preview, image.getBounds().toFloat());
+                            }
+
+                            owner.loadProgressed (*this);
+                        }
+
+                        in.setPosition (0);
+                    }
+
+                    // ..which the full-resolution rows then replace as they arrive
+                    if (! shouldExit())
+                        succeeded = format->decodeImageIncrementally (in, image, 1, this).isValid() ? 1 : 0;
+                }
+            }
+
+            {
+                const ScopedLock sl (owner.lock);
+                isFinished = 1;
+
+                if (succeeded.get() != 0)
+                    owner.addImageToCache (image, hashCode);
+
+                for (int i = 0; i < futures.size(); ++i)
+                    futures.getUnchecked (i)->setResult (succeeded.get() != 0 ? image : Image());
+
+                futures.clear();
+            }
+
+            owner.loadProgressed (*this);
+            return jobHasFinished;
+        }
+
+        Pimpl& owner;
+        const File file;
+        const int64 hashCode;
         Image image;
-        int64 hashCode;
-        uint32 lastUseTime;
+        Array<Listener*> listeners;
+        ReferenceCountedArray<ImageFuture::SharedState> futures;
+        Atomic<int> hasProgressed, isFinished, succeeded;
+        bool isBeingReported;   // (set while handleAsyncUpdate is using it without the lock held)
+
+    private:
+        bool wantsPreview() const
+        {
+            // (nobody's drawing the image if it was only asked for with getFromFileAsync)
+            const ScopedLock sl (owner.lock);
+            return listeners.size() > 0;
+        }
+
+        void imageRowsDecoded (const Image& decoded, Range<int>) override
+        {
+            if (decoded == image)
+                owner.loadProgressed (*this);
+        }
+
+        bool shouldStopDecoding() override
+        {
+            return shouldExit();
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (BackgroundLoad)
     };
 
+    /** Returns the load for this file that's in progress, or hasn't yet told its
+        listeners that it's finished. The lock must be held.
+    */
+    BackgroundLoad* findLoad (const int64 hashCode) const noexcept
+    {
+        for (int i = loads.size(); --i >= 0;)
+            if (loads.getUnchecked (i)->hashCode == hashCode)
+                return loads.getUnchecked (i);
+
+        return nullptr;
+    }
+
+    /** Reads the size of an image from its file, without decoding it. */
+    static bool readImageHeader (const File& file, int& width, int& height, bool& hasAlphaChannel)
+    {
+        FileInputStream stream (file);
+
+        if (! stream.openedOk())
+            return false;
+
+        BufferedInputStream in (stream, 8192);
+        ImageFileFormat* const format = ImageFileFormat::findImageFormatForStream (in);
+
+        return format != nullptr && format->readImageHeader (in, width, height, hasAlphaChannel);
+    }
+
+    /** Starts loading a file into a blank image of the given size. The lock must be held. */
+    BackgroundLoad* startLoad (const File& file, const int64 hashCode, int width, int height, bool hasAlphaChannel)
+    {
+        removeFinishedLoadsWithoutListeners();
+
+        Image image (hasAlphaChannel ? Image::ARGB : Image::RGB, width, height, true);
+        image.getProperties()->set ("originalImageHadAlpha", hasAlphaChannel);
+
+        BackgroundLoad* const load = new BackgroundLoad (*this, file, hashCode, image);
+        loads.add (load);
+
+        if (loaderPool == nullptr)
+            loaderPool = new ThreadPool (2);
+
+        loaderPool->addJob (load, false);
+        return load;
+    }
+
+    /** Finds the load that's in progress for this file, or starts a new one, and adds the
+        listener and future (either of which can be null) to it.
+
+        This returns the image that's being loaded, or the cached image if there is one, or
+        an invalid image if the file can't be read. The file's header is read without the
+        lock held, so the lock mustn't be held by the caller either.
+    */
+    Image joinLoad (const File& file, const int64 hashCode, Listener* listener, ImageFuture::SharedState* future)
+    {
+        int width = 0, height = 0;
+        bool hasAlphaChannel = false, hasReadHeader = false;
+
+        for (;;)
+        {
+            {
+                const ScopedLock sl (lock);
+
+                // (a load that has just finished is already in the cache, but a new listener
+                // still needs to hear about it, along with the others)
+                BackgroundLoad* load = findLoad (hashCode);
+
+                if (load == nullptr)
+                {
+                    // (another thread might have finished loading it while the header was being read)
+                    const Image cached (hasReadHeader ? findCachedImage (hashCode) : getFromHashCode (hashCode));
+
+                    if (cached.isValid())
+                    {
+                        if (future != nullptr)
+                            future->setResult (cached);
+
+                        return cached;
+                    }
+
+                    if (hasReadHeader)
+                        load = startLoad (file, hashCode, width, height, hasAlphaChannel);
+                }
+
+                if (load != nullptr)
+                {
+                    if (listener != nullptr)
+                        load->listeners.addIfNotAlreadyThere (listener);
+
+                    if (future != nullptr)
+                    {
+                        if (load->isFinished.get() != 0)
+                            future->setResult (load->succeeded.get() != 0 ? load->image : Image());
+                        else
+                            load->futures.add (future);
+                    }
+
+                    return load->image;
+                }
+            }
+
+            if (! readImageHeader (file, width, height, hasAlphaChannel))
+            {
+                if (future != nullptr)
+                    future->setResult (Image());
+
+                return Image();
+            }
+
+            hasReadHeader = true;
+        }
+    }
+
+    Image getFromFileInBackground (const File& file, Listener* listener)
+    {
+        return joinLoad (file, file.hashCode64(), listener, nullptr);
+    }
+
+    ImageFuture getFromFileAsync (const File& file)
+    {
+        ImageFuture::SharedState::Ptr state (new ImageFuture::SharedState());
+        joinLoad (file, file.hashCode64(), nullptr, state);
+        return ImageFuture (state);
+    }
+
+    // Finished loads are normally removed when their listeners are called, but if
+    // they're only used through getFromFileAsync, nobody might be running the message loop.
+    void removeFinishedLoadsWithoutListeners()
+    {
+        for (int i = loads.size(); --i >= 0;)
+        {
+            BackgroundLoad* const load = loads.getUnchecked (i);
+
+            if (load->isFinished.get() != 0 && load->listeners.size() == 0 && ! load->isBeingReported)
+            {
+                loaderPool->waitForJobToFinish (load, -1);
+                loads.remove (i);
+            }
+        }
+    }
+
+    void removeListener (Listener* listener)
+    {
+        const ScopedLock sl (lock);
+
+        for (int i = loads.size(); --i >= 0;)
+            loads.getUnchecked (i)->listeners.removeAllInstancesOf (listener);
+    }
+
+    void loadProgressed (BackgroundLoad& load)
+    {
+        load.hasProgressed = 1;
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        // The listeners are called (and finished jobs waited for) without the lock held, so
+        // the loads that have progressed are marked to stop other threads removing them meanwhile
+        Array<BackgroundLoad*> progressedLoads;
+
+        {
+            const ScopedLock sl (lock);
+
+            for (int i = loads.size(); --i >= 0;)
+            {
+                BackgroundLoad* const load = loads.getUnchecked (i);
+
+                if (load->hasProgressed.exchange (0) != 0)
+                {
+                    load->isBeingReported = true;
+                    progressedLoads.add (load);
+                }
+            }
+        }
+
+        for (int i = 0; i < progressedLoads.size(); ++i)
+        {
+            BackgroundLoad* const load = progressedLoads.getUnchecked (i);
+            const bool finished = load->isFinished.get() != 0;
+
+            if (finished)
+                loaderPool->waitForJobToFinish (load, -1);
+
+            const Image image (load->image);
+
+            for (int j = getNumListeners (*load); --j >= 0;)
+                if (Listener* const l = getListener (*load, j))
+                    l->imageLoadProgressed (image, finished);
+
+            const ScopedLock sl (lock);
+
+            if (finished)
+                loads.removeObject (load);
+            else
+                load->isBeingReported = false;
+        }
+    }
+
+    // (a listener's callback may remove other listeners, so the list is re-checked for each one)
+    int getNumListeners (const BackgroundLoad& load) const
+    {
+        const ScopedLock sl (lock);
+        return load.listeners.size();
+    }
+
+    Listener* getListener (const BackgroundLoad& load, int index) const
+    {
+        const ScopedLock sl (lock);
+        return load.listeners [index];
+    }
+
     unsigned int cacheTimeout;
 
     juce_DeclareSingleton_SingleThreaded_Minimal (ImageCache::Pimpl)
 
 private:
-    OwnedArray<Item> images;
+    //==============================================================================
+    struct Item
+    {
+        Image image;
+        int64 hashCode, numBytes;
+        uint32 lastUseTime;
+        Item* lessRecent;
+        Item* moreRecent;
+    };
+
+    // The items are kept in a list in order of use, so that the least recently used
+    // ones can be found quickly when the cache is over its size limit.
+    HashMap<int64, Item*> itemsByHash;
+    int64 maxBytes, bytesUsed, numHits, numMisses, numEvictions;
+    Item* mostRecent;
+    Item* leastRecent;
+
+    OwnedArray<BackgroundLoad> loads;
+    ScopedPointer<ThreadPool> loaderPool;
     CriticalSection lock;
 
+    void linkAtFront (Item* item) noexcept
+    {
+        item->lessRecent = mostRecent;
+        item->moreRecent = nullptr;
+
+        if (mostRecent != nullptr)
+            mostRecent->moreRecent = item;
+        else
+            leastRecent = item;
+
+        mostRecent = item;
+    }
+
+    void unlink (Item* item) noexcept
+    {
+        if (item->lessRecent != nullptr)  item->lessRecent->moreRecent = item->moreRecent;
+        else                              leastRecent = item->moreRecent;
+
+        if (item->moreRecent != nullptr)  item->moreRecent->lessRecent = item->lessRecent;
+        else                              mostRecent = item->lessRecent;
+    }
+
+    void moveToFront (Item* item) noexcept
+    {
+        if (item != mostRecent)
+        {
+            unlink (item);
+            linkAtFront (item);
+        }
+    }
+
+    void removeItem (Item* item)
+    {
+        unlink (item);
+        itemsByHash.remove (item->hashCode);
+        bytesUsed -= item->numBytes;
+        delete item;
+    }
+
+    void applySizeLimit (const Item* itemToKeep = nullptr)
+    {
+        // Images that are still being used elsewhere are kept, because dropping them
+        // wouldn't free any memory, it'd just stop them being shared. The image that's
+        // just been added is kept too, so that a finished load is always in the cache.
+        for (Item* item = leastRecent; item != nullptr && maxBytes > 0 && bytesUsed > maxBytes;)
+        {
+            Item* const next = item->moreRecent;
+
+            if (item != itemToKeep && item->image.getReferenceCount() <= 1)
+            {
+                removeItem (item);
+                ++numEvictions;
+            }
+
+            item = next;
+        }
+    }
+
     JUCE_DECLARE_NON_COPYABLE (Pimpl)
 };
 
@@ -164,6 +647,38 @@ Image ImageCache::getFromMemory (const void* imageData, const int dataSize)
     return image;
 }
 
+Image ImageCache::getFromFileInBackground (const File& file, Listener* listener)
+{
+    return Pimpl::getInstance()->getFromFileInBackground (file, listener);
+}
+
+void ImageCache::removeListener (Listener* listener)
+{
+    if (Pimpl::getInstanceWithoutCreating() != nullptr)
+        Pimpl::getInstanceWithoutCreating()->removeListener (listener);
+}
+
+ImageCache::ImageFuture ImageCache::getFromFileAsync (const File& file)
+{
+    return Pimpl::getInstance()->getFromFileAsync (file);
+}
+
+void ImageCache::setMaximumCacheSize (int64 maxBytes)
+{
+    jassert (maxBytes >= 0);
+    Pimpl::getInstance()->setMaximumCacheSize (maxBytes);
+}
+
+ImageCache::Statistics ImageCache::getStatistics()
+{
+    return Pimpl::getInstance()->getStatistics();
+}
+
+void ImageCache::resetStatistics()
+{
+    Pimpl::getInstance()->resetStatistics();
+}
+
 void ImageCache::setCacheTimeout (const int millisecs)
 {
     jassert (millisecs >= 0);
@@ -174,3 +689,355 @@ void ImageCache::releaseUnusedImages()
 {
     Pimpl::getInstance()->releaseUnusedImages();
 }
+
+//==============================================================================
+ImageCache::ImageFuture::ImageFuture() noexcept {}
+ImageCache::ImageFuture::ImageFuture (SharedState* s) noexcept  : state (s) {}
+ImageCache::ImageFuture::ImageFuture (const ImageFuture& other) noexcept  : state (other.state) {}
+ImageCache::ImageFuture::~ImageFuture() {}
+
+ImageCache::ImageFuture& ImageCache::ImageFuture::operator= (const ImageFuture& other) noexcept
+{
+    state = other.state;
+    return *this;
+}
+
+bool ImageCache::ImageFuture::isValid() const noexcept
+{
+    return state != nullptr;
+}
+
+bool ImageCache::ImageFuture::isReady() const
+{
+    return state != nullptr && state->ready.wait (0);
+}
+
+bool ImageCache::ImageFuture::wait (int timeoutMilliseconds) const
+{
+    return state != nullptr && state->ready.wait (timeoutMilliseconds);
+}
+
+Image ImageCache::ImageFuture::getImage() const
+{
+    if (state == nullptr)
+        return Image();
+
+    state->ready.wait (-1);
+    return state->image;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ImageCacheTests  : public UnitTest
+{
+public:
+    ImageCacheTests() : UnitTest ("ImageCache") {}
+
+    static Image createImage (Image::PixelFormat format, int w, int h, Colour colour)
+    {
+        Image image (format, w, h, false);
+        image.clear (image.getBounds(), colour);
+        return image;
+    }
+
+    void runTest() override
+    {
+        const int64 baseHash = 0x5eed000000000000LL;
+
+        ImageCache::releaseUnusedImages();
+        ImageCache::resetStatistics();
+
+        beginTest ("Lookups by hash code");
+        {
+            const int numImages = 1000;
+
+            for (int i = 0; i < numImages; ++i)
+                ImageCache::addImageToCache (createImage (Image::ARGB, 2, 2, Colour ((uint32) i | 0xff000000)), baseHash + i);
+
+            bool allFound = true;
+
+            for (int i = 0; i < numImages; ++i)
+                allFound = allFound && ImageCache::getFromHashCode (baseHash + i).getPixelAt (0, 0)
+                                         == Colour ((uint32) i | 0xff000000);
+
+            expect (allFound);
+            expect (ImageCache::getFromHashCode (baseHash - 1).isNull());
+
+            // re-adding a hash code replaces the old image rather than adding another
+            ImageCache::addImageToCache (createImage (Image::ARGB, 2, 2, Colours::red), baseHash);
+            expect (ImageCache::getFromHashCode (baseHash).getPixelAt (0, 0) == Colours::red);
+
+            const ImageCache::Statistics stats (ImageCache::getStatistics());
+            expectEquals (stats.numHits, (int64) numImages + 1);
+            expectEquals (stats.numMisses, (int64) 1);
+            expectEquals (stats.numImages, numImages);
+
+            ImageCache::releaseUnusedImages();
+            expectEquals (ImageCache::getStatistics().numImages, 0);
+        }
+
+        beginTest ("Memory accounting");
+        {
+            ImageCache::addImageToCache (createImage (Image::ARGB, 10, 10, Colours::red), baseHash);
+            expectEquals (ImageCache::getStatistics().numBytes, (int64) 400);
+
+            ImageCache::addImageToCache (createImage (Image::RGB, 10, 10, Colours::red), baseHash + 1);
+            expectEquals (ImageCache::getStatistics().numBytes, (int64) (400 + 320));
+
+            ImageCache::addImageToCache (createImage (Image::SingleChannel, 10, 10, Colours::red), baseHash + 2);
+            expectEquals (ImageCache::getStatistics().numBytes, (int64) (400 + 320 + 120));
+
+            ImageCache::addImageToCache (createImage (Image::SingleChannel, 10, 10, Colours::red), baseHash);
+            expectEquals (ImageCache::getStatistics().numBytes, (int64) (120 + 320 + 120));
+
+            ImageCache::releaseUnusedImages();
+            expectEquals (ImageCache::getStatistics().numBytes, (int64) 0);
+        }
+
+        beginTest ("Least-recently-used images are evicted to fit the size limit");
+        {
+            ImageCache::resetStatistics();
+            ImageCache::setMaximumCacheSize (4 * 400);
+
+            for (int i = 0; i < 4; ++i)
+                ImageCache::addImageToCache (createImage (Image::ARGB, 10, 10, Colours::red), baseHash + i);
+
+            ImageCache::getFromHashCode (baseHash); // (makes 1 the least recently used)
+
+            ImageCache::addImageToCache (createImage (Image::ARGB, 10, 10, Colours::red), baseHash + 4);
+            expect (ImageCache::getFromHashCode (baseHash + 1).isNull());
+            expect (ImageCache::getFromHashCode (baseHash).isValid());
+            expectEquals (ImageCache::getStatistics().numEvictions, (int64) 1);
+
+            // 2 is now the least recently used, but it's still in use so 3 goes instead
+            const Image inUse (ImageCache::getFromHashCode (baseHash + 2));
+            ImageCache::getFromHashCode (baseHash + 3);
+            ImageCache::getFromHashCode (baseHash);
+            ImageCache::getFromHashCode (baseHash + 4);
+            ImageCache::getFromHashCode (baseHash + 2);
+            ImageCache::getFromHashCode (baseHash + 3);
+            ImageCache::getFromHashCode (baseHash);
+            ImageCache::getFromHashCode (baseHash + 4);
+
+            ImageCache::addImageToCache (createImage (Image::ARGB, 10, 10, Colours::red), baseHash + 5);
+            expect (ImageCache::getFromHashCode (baseHash + 2) == inUse);
+            expect (ImageCache::getFromHashCode (baseHash + 3).isNull());
+            expectEquals (ImageCache::getStatistics().numEvictions, (int64) 2);
+            expectLessOrEqual (ImageCache::getStatistics().numBytes, (int64) (4 * 400));
+
+            // shrinking the limit evicts straight away
+            ImageCache::setMaximumCacheSize (400);
+            expectEquals (ImageCache::getStatistics().numImages, 1);
+
+            // the newest image is never the one that's evicted, even if it doesn't fit on its own
+            ImageCache::setMaximumCacheSize (100);
+            ImageCache::addImageToCache (createImage (Image::ARGB, 10, 10, Colours::red), baseHash + 6);
+            expect (ImageCache::getFromHashCode (baseHash + 6).isValid());
+
+            ImageCache::setMaximumCacheSize (0);
+            ImageCache::releaseUnusedImages();
+        }
+
+        beginTest ("Async loading");
+        {
+            TemporaryFile temp (".png");
+            const Image original (createImage (Image::ARGB, 120, 80, Colours::orange.withAlpha (0.5f)));
+
+            {
+                FileOutputStream out (temp.getFile());
+                PNGImageFormat png;
+                png.writeImageToStream (original, out);
+            }
+
+            const ImageCache::ImageFuture future (ImageCache::getFromFileAsync (temp.getFile()));
+            expect (future.isValid());
+
+            const Image image (future.getImage());
+            expect (future.isReady());
+            expect (image.getBounds() == original.getBounds());
+            expect (image.getPixelAt (60, 40) == ImageFileFormat::loadFrom (temp.getFile()).getPixelAt (60, 40));
+
+            // once it's loaded, it's in the cache
+            expect (ImageCache::getFromFile (temp.getFile()) == image);
+
+            const ImageCache::ImageFuture cached (ImageCache::getFromFileAsync (temp.getFile()));
+            expect (cached.isReady());
+            expect (cached.getImage() == image);
+
+            const ImageCache::ImageFuture missing (ImageCache::getFromFileAsync (temp.getFile().getSiblingFile ("doesnt_exist.png")));
+            expect (missing.wait (1000));
+            expect (missing.getImage().isNull());
+        }
+
+        beginTest ("Benchmark: lookups");
+        {
+            const int numImages = 10000;
+
+            for (int i = 0; i < numImages; ++i)
+                ImageCache::addImageToCache (createImage (Image::ARGB, 1, 1, Colours::red), baseHash + i);
+
+            Random r (0x1234);
+            const int numLookups = 100000;
+            int numFound = 0;
+            const double start = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numLookups; ++i)
+                numFound += ImageCache::getFromHashCode (baseHash + r.nextInt (numImages)).isValid() ? 1 : 0;
+
+            const double elapsed = Time::getMillisecondCounterHiRes() - start;
+            expectEquals (numFound, numLookups);
+
+            logMessage (String (numLookups) + " lookups among " + String (numImages) + " images: "
+                          + String (elapsed, 1) + "ms (" + String (elapsed * 1.0e6 / numLookups, 0) + "ns each)");
+
+            ImageCache::releaseUnusedImages();
+        }
+    }
+};
+
+static ImageCacheTests imageCacheTests;
+
+#endif
+
+//==============================================================================
+#if JUCE_UNIT_TESTS && JUCE_MODAL_LOOPS_PERMITTED
+
+class ImageCacheBackgroundLoadingTests  : public UnitTest
+{
+public:
+    ImageCacheBackgroundLoadingTests() : UnitTest ("ImageCache background loading") {}
+
+    struct ProgressListener  : public ImageCache::Listener
+    {
+        ProgressListener() : numCallbacks (0), finished (false) {}
+
+        void imageLoadProgressed (const Image& image, bool isFinished) override
+        {
+            lastImage = image;
+            ++numCallbacks;
+            finished = isFinished;
+        }
+
+        bool waitUntilFinished()
+        {
+            for (int i = 0; i < 1000 && ! finished; ++i)
+                MessageManager::getInstance()->runDispatchLoopUntil (10);
+
+            return finished;
+        }
+
+        Image lastImage;
+        int numCallbacks;
+        bool finished;
+    };
+
+    // Waits for another file to load when its own one has finished
+    struct ChainedListener  : public ProgressListener
+    {
+        ChainedListener (const File& f) : nextFile (f), nextLoadFinished (false) {}
+
+        void imageLoadProgressed (const Image& image, bool isFinished) override
+        {
+            if (isFinished)
+            {
+                const ImageCache::ImageFuture next (ImageCache::getFromFileAsync (nextFile));
+                nextLoadFinished = next.wait (5000) && next.getImage().isValid();
+            }
+
+            ProgressListener::imageLoadProgressed (image, isFinished);
+        }
+
+        const File nextFile;
+        bool nextLoadFinished;
+    };
+
+    void checkLoad (ImageFileFormat& format, const Image& original)
+    {
+        TemporaryFile temp (format.getFormatName() == "JPEG" ? ".jpg" : ".png");
+
+        {
+            FileOutputStream out (temp.getFile());
+            expect (format.writeImageToStream (original, out));
+        }
+
+        const Image expected (ImageFileFormat::loadFrom (temp.getFile()));
+
+        ProgressListener listener, otherListener;
+        const Image image (ImageCache::getFromFileInBackground (temp.getFile(), &listener));
+
+        expect (image.getBounds() == original.getBounds());
+        expect (image.hasAlphaChannel() == expected.hasAlphaChannel());
+
+        // asking again while it's still loading should join the same load
+        expect (ImageCache::getFromFileInBackground (temp.getFile(), &otherListener) == image);
+
+        expect (listener.waitUntilFinished());
+        expect (otherListener.finished);
+        expect (listener.lastImage == image);
+        expectGreaterThan (listener.numCallbacks, 0);
+
+        bool allSame = true;
+
+        for (int y = 0; y < image.getHeight(); ++y)
+            for (int x = 0; x < image.getWidth(); ++x)
+                allSame = allSame && image.getPixelAt (x, y) == expected.getPixelAt (x, y);
+
+        expect (allSame);
+
+        // now it's finished, it should be in the cache
+        ProgressListener unusedListener;
+        expect (ImageCache::getFromFileInBackground (temp.getFile(), &unusedListener) == image);
+        expect (ImageCache::getFromFile (temp.getFile()) == image);
+        expectEquals (unusedListener.numCallbacks, 0);
+    }
+
+    void runTest() override
+    {
+        Image original (Image::ARGB, 300, 200, true);
+
+        {
+            Graphics g (original);
+            g.setGradientFill (ColourGradient (Colours::red, 0.0f, 0.0f, Colours::blue.withAlpha (0.5f), 300.0f, 200.0f, false));
+            g.fillAll();
+        }
+
+        beginTest ("JPEG");
+        JPEGImageFormat jpeg;
+        checkLoad (jpeg, original);
+
+        beginTest ("PNG");
+        PNGImageFormat png;
+        checkLoad (png, original);
+
+        beginTest ("Unreadable files");
+        {
+            TemporaryFile temp (".png");
+            temp.getFile().replaceWithText ("not an image");
+
+            ProgressListener listener;
+            expect (ImageCache::getFromFileInBackground (temp.getFile(), &listener).isNull());
+        }
+
+        beginTest ("Listeners can wait for other loads");
+        {
+            TemporaryFile first (".png"), second (".png");
+
+            {
+                FileOutputStream out1 (first.getFile()), out2 (second.getFile());
+                expect (png.writeImageToStream (original, out1));
+                expect (png.writeImageToStream (original.rescaled (150, 100), out2));
+            }
+
+            // (the second load can only finish if the listeners aren't called with the cache locked)
+            ChainedListener listener (second.getFile());
+            expect (ImageCache::getFromFileInBackground (first.getFile(), &listener).isValid());
+            expect (listener.waitUntilFinished());
+            expect (listener.nextLoadFinished);
+        }
+    }
+};
+
+static ImageCacheBackgroundLoadingTests imageCacheBackgroundLoadingTests;
+
+#endif
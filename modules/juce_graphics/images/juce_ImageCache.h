@@ -37,7 +37,8 @@
     Another advantage is that after images are released, they will be kept in
     memory for a few seconds before it is actually deleted, so if you're repeatedly
     loading/deleting the same image, it'll reduce the chances of having to reload it
-    each time.
+    each time. To stop a large number of images using unbounded memory, a limit
+    can be set with setMaximumCacheSize().
 
     @see Image, ImageFileFormat
 */
@@ -78,6 +79,131 @@ public:
     */
     static Image getFromMemory (const void* imageData, int dataSize);
 
+    //==============================================================================
+    /** Receives callbacks as images that were requested with getFromFileInBackground()
+        are decoded.
+    */
+    class JUCE_API  Listener
+    {
+    public:
+        /** Destructor. */
+        virtual ~Listener() {}
+
+        /** Called on the message thread when more of the image has been decoded, and
+            finally with isFinished = true when it's complete (or has failed).
+
+            The image is the same object that getFromFileInBackground() returned, so
+            just repainting whatever draws it is enough.
+        */
+        virtual void imageLoadProgressed (const Image& image, bool isFinished) = 0;
+    };
+
+    /** Starts loading an image on a background thread, returning an image of the right
+        size straight away so that it can be laid out and drawn before it's ready.
+
+        If the image is already in the cache, it's returned and the listener isn't called.
+        Otherwise, only the header of the file is read on the calling thread, and a blank
+        image of the correct size is returned. A background thread then fills that same image
+        in: for JPEGs a coarse 1/8-scale preview is decoded and stretched over it first, and
+        then the full-resolution rows are written over that as they're decoded. When it's
+        finished, the image is added to the cache.
+
+        Because the pixels are written in-place while you may be drawing the image, a frame
+        may show a mix of preview and final rows; this is just refined on the next repaint.
+
+        @param file         the file to load
+        @param listener     if not null, this is called on the message thread as the image is
+                            decoded. Remove it with removeListener() before deleting it.
+        @returns            the image being loaded, or an invalid image if the file's header
+                            can't be read
+    */
+    static Image getFromFileInBackground (const File& file, Listener* listener);
+
+    /** Stops a listener from receiving any more callbacks from background loads. */
+    static void removeListener (Listener* listener);
+
+    //==============================================================================
+    /** A handle to an image that's being loaded by getFromFileAsync().
+
+        These are cheap to copy, and all copies refer to the same load.
+    */
+    class JUCE_API  ImageFuture
+    {
+    public:
+        /** Creates an invalid future that doesn't refer to any load. */
+        ImageFuture() noexcept;
+        ImageFuture (const ImageFuture&) noexcept;
+        ImageFuture& operator= (const ImageFuture&) noexcept;
+        ~ImageFuture();
+
+        /** Returns false if this was default-constructed. */
+        bool isValid() const noexcept;
+
+        /** Returns true if the load has finished, so that getImage() won't block. */
+        bool isReady() const;
+
+        /** Waits for the load to finish.
+            @returns true if it finished before the timeout (a negative timeout waits forever)
+        */
+        bool wait (int timeoutMilliseconds) const;
+
+        /** Waits for the load to finish, and returns the image, which will be invalid
+            if the file couldn't be loaded.
+        */
+        Image getImage() const;
+
+        /** @internal */
+        class SharedState;
+        /** @internal */
+        explicit ImageFuture (SharedState*) noexcept;
+
+    private:
+        ReferenceCountedObjectPtr<SharedState> state;
+    };
+
+    /** Loads an image from a file on a background thread, (or just returns the image
+        if it's already cached).
+
+        This is like getFromFile(), but returns straight away with a future that can be
+        polled or waited on from any thread. The image is added to the cache when it's
+        been loaded. If the same file is already being loaded by getFromFileInBackground(),
+        the future just waits for that load to finish.
+
+        Only the file's header is read on the calling thread.
+    */
+    static ImageFuture getFromFileAsync (const File& file);
+
+    //==============================================================================
+    /** Sets the maximum amount of memory that the cached images' pixels should use.
+
+        When adding an image pushes the total over this limit, the least recently used
+        images that aren't being referenced anywhere else are removed until it fits again.
+        Images that are still in use elsewhere are kept, because dropping them wouldn't free
+        any memory, and so is the one that has just been added, so an image that has just
+        been loaded (e.g. by getFromFileAsync()) can always be found in the cache. A value of 0 (the default) means there's no limit, and images are only
+        removed by the timeout set with setCacheTimeout().
+    */
+    static void setMaximumCacheSize (int64 maxBytes);
+
+    /** Some counters describing how well the cache is doing.
+        @see getStatistics, resetStatistics
+    */
+    struct Statistics
+    {
+        int64 numHits;          /**< The number of lookups that found an image. */
+        int64 numMisses;        /**< The number of lookups that didn't find an image. */
+        int64 numEvictions;     /**< The number of images removed because of the size limit or timeout. */
+        int numImages;          /**< The number of images currently in the cache. */
+        int64 numBytes;         /**< The approximate number of bytes used by the cached images' pixels. */
+        int64 maximumBytes;     /**< The limit set with setMaximumCacheSize(), or 0. */
+    };
+
+    /** Returns the cache's current statistics. */
+    static Statistics getStatistics();
+
+    /** Sets the hit, miss and eviction counters back to zero. */
+    static void resetStatistics();
+
     //==============================================================================
     /** Checks the cache for an image with a particular hashcode.
 
@@ -98,13 +98,195 @@ void ImageConvolutionKernel::createGaussianBlur (const float radius)
 }
 
 //==============================================================================
+bool ImageConvolutionKernel::isSeparable() const
+{
+    HeapBlock<float> rowValues, columnValues;
+    return getSeparableValues (rowValues, columnValues);
+}
+
+bool ImageConvolutionKernel::getSeparableValues (HeapBlock<float>& rowValues, HeapBlock<float>& columnValues) const
+{
+    // A separable kernel is the product of a row and a column, so every row of it is
+    // a multiple of its largest row, which is the row through its largest value.
+    int largest = 0;
+
+    for (int i = size * size; --i > 0;)
+        if (std::abs (values[i]) > std::abs (values[largest]))
+            largest = i;
+
+    const float largestValue = values[largest];
+
+    if (largestValue == 0)
+        return false;
+
+    const int largestX = largest % size, largestY = largest / size;
+    rowValues.malloc ((size_t) size);
+    columnValues.malloc ((size_t) size);
+
+    for (int i = 0; i < size; ++i)
+    {
+        rowValues[i] = values [i + largestY * size];
+        columnValues[i] = values [largestX + i * size] / largestValue;
+    }
+
+    const float tolerance = std::abs (largestValue) * 1.0e-5f;
+
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+            if (std::abs (values [x + y * size] - rowValues[x] * columnValues[y]) > tolerance)
+                return false;
+
+    return true;
+}
+
+//==============================================================================
+/*  Filters a band of rows of the destination area.
+
+    Each source line is converted to floats, with zeros for the pixels that lie outside the
+    image, so that each tap of the kernel is a multiply-add over the whole line, whatever the
+    number of channels. A separable kernel is applied to the lines horizontally as they're
+    read, and then vertically to the filtered lines, rather than needing size * size taps.
+*/
+class ImageConvolutionKernel::BandFilter
+{
+public:
+    BandFilter (const Image::BitmapData& src, const Image::BitmapData& dst, const Rectangle<int>& destArea,
+                const float* kernelValues, const float* rows, const float* columns, int kernelSize)
+        : srcData (src), destData (dst), area (destArea),
+          values (kernelValues), rowValues (rows), columnValues (columns),
+          size (kernelSize), centre (kernelSize >> 1),
+          channels (dst.pixelStride),
+          lineLength (destArea.getWidth() * channels),
+          paddedLength ((destArea.getWidth() + kernelSize - 1) * channels),
+          sourceLine ((size_t) paddedLength),
+          lines ((size_t) (kernelSize * (rows != nullptr ? lineLength : paddedLength))),
+          lineNumbers ((size_t) kernelSize),
+          result ((size_t) lineLength)
+    {
+        for (int i = 0; i < size; ++i)
+            lineNumbers[i] = std::numeric_limits<int>::min();
+    }
+
+    void filterRows (Range<int> rows) noexcept
+    {
+        for (int y = rows.getStart(); y < rows.getEnd(); ++y)
+        {
+            zeromem (result, sizeof (float) * (size_t) lineLength);
+
+            for (int yy = 0; yy < size; ++yy)
+            {
+                const int sy = y + yy - centre;
+
+                if (! isPositiveAndBelow (sy, srcData.height))
+                    continue;
+
+                const float* const line = getLine (sy);
+
+                if (rowValues != nullptr)
+                {
+                    RenderingHelpers::PixelSpans::multiplyAdd (result, line, columnValues[yy], lineLength);
+                }
+                else
+                {
+                    for (int xx = 0; xx < size; ++xx)
+                        RenderingHelpers::PixelSpans::multiplyAdd (result, line + xx * channels, values [xx + yy * size], lineLength);
+                }
+            }
+
+            uint8* dest = destData.getLinePointer (y - area.getY());
+
+            for (int i = 0; i < lineLength; ++i)
+                dest[i] = (uint8) jlimit (0, 0xff, roundToInt (result[i]));
+        }
+    }
+
+private:
+    const Image::BitmapData& srcData;
+    const Image::BitmapData& destData;
+    const Rectangle<int> area;
+    const float* const values;
+    const float* const rowValues;
+    const float* const columnValues;
+    const int size, centre, channels, lineLength, paddedLength;
+    HeapBlock<float> sourceLine, lines;
+    HeapBlock<int> lineNumbers;
+    HeapBlock<float> result;
+
+    // Returns the source line, already filtered horizontally if the kernel is separable.
+    // The last 'size' lines are kept, as they're all that the next row needs.
+    const float* getLine (int sy) noexcept
+    {
+        const int slot = sy % size;
+        const bool isSeparable = rowValues != nullptr;
+        float* const line = lines + slot * (isSeparable ? lineLength : paddedLength);
+
+        if (lineNumbers[slot] != sy)
+        {
+            lineNumbers[slot] = sy;
+            float* const converted = isSeparable ? sourceLine.getData() : line;
+            zeromem (converted, sizeof (float) * (size_t) paddedLength);
+
+            const int startX = area.getX() - centre;
+            const int firstX = jmax (0, startX);
+            const int lastX = jmin (srcData.width, startX + area.getWidth() + size - 1);
+
+            const uint8* src = srcData.getPixelPointer (firstX, sy);
+            float* dest = converted + (firstX - startX) * channels;
+
+            for (int x = firstX; x < lastX; ++x, src += srcData.pixelStride)
+                for (int c = 0; c < channels; ++c)
+                    *dest++ = src[c];
+
+            if (isSeparable)
+            {
+                zeromem (line, sizeof (float) * (size_t) lineLength);
+
+                for (int xx = 0; xx < size; ++xx)
+                    RenderingHelpers::PixelSpans::multiplyAdd (line, converted + xx * channels, rowValues[xx], lineLength);
+            }
+        }
+
+        return line;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (BandFilter)
+};
+
+class ImageConvolutionKernel::BandJob  : public ThreadPoolJob
+{
+public:
+    BandJob (const Image::BitmapData& src, const Image::BitmapData& dst, const Rectangle<int>& area,
+             const float* values, const float* rows, const float* columns, int size, Range<int> r)
+        : ThreadPoolJob ("Image convolution"), filter (src, dst, area, values, rows, columns, size), rowRange (r)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        filter.filterRows (rowRange);
+        return jobHasFinished;
+    }
+
+private:
+    BandFilter filter;
+    const Range<int> rowRange;
+
+    JUCE_DECLARE_NON_COPYABLE (BandJob)
+};
+
 void ImageConvolutionKernel::applyToImage (Image& destImage,
                                            const Image& sourceImage,
                                            const Rectangle<int>& destinationArea) const
 {
+    Image source (sourceImage);
+
     if (sourceImage == destImage)
     {
         destImage.duplicateIfShared();
+
+        // the filter reads pixels around the ones it writes, so needs them left untouched
+        if (source == destImage)
+            source = sourceImage.createCopy();
     }
     else
     {
@@ -119,172 +301,266 @@ void ImageConvolutionKernel::applyToImage (Image& destImage,
 
     const Rectangle<int> area (destinationArea.getIntersection (destImage.getBounds()));
 
-    if (area.isEmpty())
+    if (area.isEmpty() || size <= 0)
         return;
 
-    const int right = area.getRight();
-    const int bottom = area.getBottom();
-
     const Image::BitmapData destData (destImage, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
                                       Image::BitmapData::writeOnly);
-    uint8* line = destData.data;
+    const Image::BitmapData srcData (source, Image::BitmapData::readOnly);
 
-    const Image::BitmapData srcData (sourceImage, Image::BitmapData::readOnly);
+    HeapBlock<float> rowValues, columnValues;
+    const bool separable = size > 1 && getSeparableValues (rowValues, columnValues);
+    const float* const rows    = separable ? rowValues.getData() : nullptr;
+    const float* const columns = separable ? columnValues.getData() : nullptr;
 
-    if (destData.pixelStride == 4)
+    // Bands of rows are shared out between the renderer's worker threads, if there's enough work
+    const int minRowsPerBand = 16;
+    const int64 numTaps = separable ? 2 * size : size * size;
+    ThreadPool* const pool = DeferredRendererThreadPool::getInstanceForHelperJobs();
+    const int numBands = pool == nullptr || area.getWidth() * (int64) area.getHeight() * numTaps < 256 * 1024 ? 1
+                           : jlimit (1, SystemStats::getNumCpus(), area.getHeight() / minRowsPerBand);
+
+    OwnedArray<BandJob> jobs;
+
+    for (int i = 1; i < numBands; ++i)
     {
-        for (int y = area.getY(); y < bottom; ++y)
-        {
-            uint8* dest = line;
-            line += destData.lineStride;
+        const Range<int> bandRows (area.getY() + (area.getHeight() * i) / numBands,
+                                   area.getY() + (area.getHeight() * (i + 1)) / numBands);
 
-            for (int x = area.getX(); x < right; ++x)
-            {
-                float c1 = 0;
-                float c2 = 0;
-                float c3 = 0;
-                float c4 = 0;
+        BandJob* job = jobs.add (new BandJob (srcData, destData, area, values, rows, columns, size, bandRows));
+        pool->addJob (job, false);
+    }
 
-                for (int yy = 0; yy < size; ++yy)
-                {
-                    const int sy = y + yy - (size >> 1);
+    {
+        BandFilter filter (srcData, destData, area, values, rows, columns, size);
+        filter.filterRows (Range<int> (area.getY(), area.getY() + area.getHeight() / numBands));
+    }
 
-                    if (sy >= srcData.height)
-                        break;
+    for (int i = 0; i < jobs.size(); ++i)
+        pool->waitForJobToFinish (jobs.getUnchecked (i), -1);
+}
 
-                    if (sy >= 0)
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ImageConvolutionKernelTests  : public UnitTest
+{
+public:
+    ImageConvolutionKernelTests() : UnitTest ("ImageConvolutionKernel") {}
+
+    // The kernel applied one pixel at a time, the way it always used to be
+    static Image referenceConvolution (const ImageConvolutionKernel& kernel, const Image& source, const Rectangle<int>& area)
+    {
+        Image result (source.createCopy());
+        const Image::BitmapData srcData (source, Image::BitmapData::readOnly);
+        const Image::BitmapData destData (result, Image::BitmapData::readWrite);
+        const int size = kernel.getKernelSize();
+
+        for (int y = area.getY(); y < area.getBottom(); ++y)
+        {
+            for (int x = area.getX(); x < area.getRight(); ++x)
+            {
+                for (int c = 0; c < srcData.pixelStride; ++c)
+                {
+                    float total = 0;
+
+                    for (int yy = 0; yy < size; ++yy)
                     {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+                        const int sy = y + yy - (size >> 1);
 
                         for (int xx = 0; xx < size; ++xx)
                         {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                                c2 += kernelMult * *src++;
-                                c3 += kernelMult * *src++;
-                                c4 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 4;
-                            }
-
-                            ++sx;
+                            const int sx = x + xx - (size >> 1);
+
+                            if (isPositiveAndBelow (sx, srcData.width) && isPositiveAndBelow (sy, srcData.height))
+                                total += kernel.getKernelValue (xx, yy) * srcData.getPixelPointer (sx, sy)[c];
                         }
                     }
-                }
 
-                *dest++ = (uint8) jmin (0xff, roundToInt (c1));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c2));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c3));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c4));
+                    destData.getPixelPointer (x, y)[c] = (uint8) jlimit (0, 0xff, roundToInt (total));
+                }
             }
         }
+
+        return result;
+    }
+
+    static Image createImage (Random& r, Image::PixelFormat format, int w, int h)
+    {
+        Image image (format, w, h, true);
+        Graphics g (image);
+
+        for (int i = 0; i < 30; ++i)
+        {
+            g.setColour (Colour ((uint32) r.nextInt()));
+            g.fillEllipse (r.nextFloat() * w, r.nextFloat() * h, r.nextFloat() * w * 0.4f, r.nextFloat() * h * 0.4f);
+        }
+
+        return image;
+    }
+
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        int maxDiff = 0;
+
+        for (int y = 0; y < da.height; ++y)
+            for (int i = 0; i < da.width * da.pixelStride; ++i)
+                maxDiff = jmax (maxDiff, std::abs (da.getLinePointer (y)[i] - db.getLinePointer (y)[i]));
+
+        return maxDiff;
     }
-    else if (destData.pixelStride == 3)
+
+    static Image applied (const ImageConvolutionKernel& kernel, const Image& source, const Rectangle<int>& area)
     {
-        for (int y = area.getY(); y < bottom; ++y)
+        Image result (source.createCopy());
+        kernel.applyToImage (result, source, area);
+        return result;
+    }
+
+    // Applies a kernel to a copy of an image from one of a pool's threads
+    struct FilteringJob  : public ThreadPoolJob
+    {
+        FilteringJob (const ImageConvolutionKernel& k, const Image& s)
+            : ThreadPoolJob ("Test convolution"), kernel (k), source (s) {}
+
+        JobStatus runJob() override
         {
-            uint8* dest = line;
-            line += destData.lineStride;
+            result = applied (kernel, source, source.getBounds());
+            return jobHasFinished;
+        }
 
-            for (int x = area.getX(); x < right; ++x)
+        const ImageConvolutionKernel& kernel;
+        const Image source;
+        Image result;
+    };
+
+    void runTest() override
+    {
+        Random r (0xc0ffee);
+        const Image::PixelFormat formats[] = { Image::ARGB, Image::RGB, Image::SingleChannel };
+
+        beginTest ("Separable kernels are recognised");
+        {
+            for (int size = 1; size < 12; ++size)
             {
-                float c1 = 0;
-                float c2 = 0;
-                float c3 = 0;
+                ImageConvolutionKernel gaussian (size);
+                gaussian.createGaussianBlur (size * 0.4f);
+                expect (gaussian.isSeparable());
+            }
+
+            ImageConvolutionKernel sharpen (3);
+            sharpen.setKernelValue (1, 1, 5.0f);
+            sharpen.setKernelValue (0, 1, -1.0f);
+            sharpen.setKernelValue (2, 1, -1.0f);
+            sharpen.setKernelValue (1, 0, -1.0f);
+            sharpen.setKernelValue (1, 2, -1.0f);
+            expect (! sharpen.isSeparable());
 
-                for (int yy = 0; yy < size; ++yy)
+            expect (! ImageConvolutionKernel (5).isSeparable());
+        }
+
+        beginTest ("Kernels match the per-pixel convolution");
+        {
+            for (int format = 0; format < numElementsInArray (formats); ++format)
+            {
+                const Image source (createImage (r, formats[format], 301, 203));
+
+                for (int size = 1; size <= 9; size += 2 + (size > 3 ? 2 : 0))
                 {
-                    const int sy = y + yy - (size >> 1);
+                    ImageConvolutionKernel random (size);
 
-                    if (sy >= srcData.height)
-                        break;
+                    for (int y = 0; y < size; ++y)
+                        for (int x = 0; x < size; ++x)
+                            random.setKernelValue (x, y, r.nextFloat() * 0.4f - 0.1f);
 
-                    if (sy >= 0)
-                    {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+                    ImageConvolutionKernel gaussian (size + 1);
+                    gaussian.createGaussianBlur (size * 0.5f);
 
-                        for (int xx = 0; xx < size; ++xx)
-                        {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                                c2 += kernelMult * *src++;
-                                c3 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 3;
-                            }
-
-                            ++sx;
-                        }
+                    const Rectangle<int> areas[] = { source.getBounds(), Rectangle<int> (17, 3, 250, 190), Rectangle<int> (290, 190, 40, 40) };
+
+                    for (int i = 0; i < numElementsInArray (areas); ++i)
+                    {
+                        expect (getMaxDifference (referenceConvolution (random,   source, areas[i].getIntersection (source.getBounds())),
+                                                  applied (random, source, areas[i])) <= 1);
+                        expect (getMaxDifference (referenceConvolution (gaussian, source, areas[i].getIntersection (source.getBounds())),
+                                                  applied (gaussian, source, areas[i])) <= 1);
                     }
                 }
+            }
+        }
+
+        beginTest ("Filtering an image in place");
+        {
+            const Image source (createImage (r, Image::ARGB, 150, 100));
+            ImageConvolutionKernel kernel (7);
+            kernel.createGaussianBlur (3.0f);
 
-                *dest++ = (uint8) roundToInt (c1);
-                *dest++ = (uint8) roundToInt (c2);
-                *dest++ = (uint8) roundToInt (c3);
+            const Image expected (applied (kernel, source, source.getBounds()));
+            Image inPlace (source.createCopy());
+            kernel.applyToImage (inPlace, inPlace, inPlace.getBounds());
+
+            expectEquals (getMaxDifference (expected, inPlace), 0);
+        }
+
+        beginTest ("Filtering on the renderer's own threads");
+        {
+            const Image source (createImage (r, Image::ARGB, 400, 300));
+            ImageConvolutionKernel kernel (7);
+            kernel.createGaussianBlur (3.0f);
+
+            const Image expected (applied (kernel, source, source.getBounds()));
+
+            // (with every thread in the pool busy, none of them can wait for help from the others)
+            ThreadPool& pool = *DeferredRendererThreadPool::getInstance();
+            OwnedArray<FilteringJob> jobs;
+
+            for (int i = 0; i < SystemStats::getNumCpus() * 2; ++i)
+                pool.addJob (jobs.add (new FilteringJob (kernel, source)), false);
+
+            for (int i = 0; i < jobs.size(); ++i)
+            {
+                expect (pool.waitForJobToFinish (jobs.getUnchecked (i), 20000));
+                expectEquals (getMaxDifference (expected, jobs.getUnchecked (i)->result), 0);
             }
         }
-    }
-    else if (destData.pixelStride == 1)
-    {
-        for (int y = area.getY(); y < bottom; ++y)
+
+        beginTest ("Convolution benchmark");
         {
-            uint8* dest = line;
-            line += destData.lineStride;
+            const Image source (createImage (r, Image::ARGB, 640, 480));
+            const Rectangle<int> area (source.getBounds());
+            const double numPixels = area.getWidth() * (double) area.getHeight();
 
-            for (int x = area.getX(); x < right; ++x)
+            for (int size = 3; size <= 15; size = size * 2 + 1)
             {
-                float c1 = 0;
+                ImageConvolutionKernel separable (size), nonSeparable (size);
+                separable.createGaussianBlur (size * 0.4f);
+                nonSeparable.createGaussianBlur (size * 0.4f);
+                nonSeparable.setKernelValue (0, 0, nonSeparable.getKernelValue (0, 0) + 0.01f);
 
-                for (int yy = 0; yy < size; ++yy)
-                {
-                    const int sy = y + yy - (size >> 1);
+                double start = Time::getMillisecondCounterHiRes();
+                referenceConvolution (separable, source, area);
+                const double referenceTime = Time::getMillisecondCounterHiRes() - start;
 
-                    if (sy >= srcData.height)
-                        break;
+                Image dest (source.createCopy());
 
-                    if (sy >= 0)
-                    {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+                start = Time::getMillisecondCounterHiRes();
+                nonSeparable.applyToImage (dest, source, area);
+                const double nonSeparableTime = Time::getMillisecondCounterHiRes() - start;
 
-                        for (int xx = 0; xx < size; ++xx)
-                        {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 3;
-                            }
-
-                            ++sx;
-                        }
-                    }
-                }
+                start = Time::getMillisecondCounterHiRes();
+                separable.applyToImage (dest, source, area);
+                const double separableTime = Time::getMillisecondCounterHiRes() - start;
 
-                *dest++ = (uint8) roundToInt (c1);
+                logMessage (String (size) + "x" + String (size) + " kernel: per-pixel " + String (numPixels / (referenceTime * 1000.0), 1)
+                              + " Mpixels/sec, vectorised " + String (numPixels / (nonSeparableTime * 1000.0), 1)
+                              + " Mpixels/sec, separable " + String (numPixels / (separableTime * 1000.0), 1) + " Mpixels/sec");
             }
         }
     }
-}
+};
+
+static ImageConvolutionKernelTests imageConvolutionKernelTests;
+
+#endif
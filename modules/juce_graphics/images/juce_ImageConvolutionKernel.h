@@ -86,6 +86,14 @@ public:
     */
     int getKernelSize() const               { return size; }
 
+    /** Returns true if the kernel is the product of a single row and column of values,
+        as a gaussian blur is.
+
+        applyToImage() spots these kernels for itself, and applies them as a horizontal
+        pass followed by a vertical one, which needs far fewer calculations per pixel.
+    */
+    bool isSeparable() const;
+
     //==============================================================================
     /** Applies the kernel to an image.
 
@@ -94,6 +102,10 @@ public:
                                 the destination, but if different, it must be exactly the same
                                 size and format.
         @param destinationArea  the region of the image to apply the filter to
+
+        Pixels beyond the edges of the source image are treated as being black and
+        transparent. Large areas are split into bands which are filtered on several
+        threads at once.
     */
     void applyToImage (Image& destImage,
                        const Image& sourceImage,
@@ -104,6 +116,11 @@ private:
     HeapBlock<float> values;
     const int size;
 
+    class BandFilter;
+    class BandJob;
+
+    bool getSeparableValues (HeapBlock<float>& rowValues, HeapBlock<float>& columnValues) const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImageConvolutionKernel)
 };
 
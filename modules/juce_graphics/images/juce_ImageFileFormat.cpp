@@ -71,6 +71,49 @@ ImageFileFormat* ImageFileFormat::findImageFormatForFileExtension (const File& f
     return nullptr;
 }
 
+//==============================================================================
+bool ImageFileFormat::readImageHeader (InputStream& input, int& width, int& height, bool& hasAlphaChannel)
+{
+    const Image image (decodeImage (input));
+
+    width = image.getWidth();
+    height = image.getHeight();
+    hasAlphaChannel = image.hasAlphaChannel();
+    return image.isValid();
+}
+
+Image ImageFileFormat::decodeImageIncrementally (InputStream& input, const Image& destImage,
+                                                 int scaleDenominator, DecodeListener* listener)
+{
+    jassert (scaleDenominator == 1 || scaleDenominator == 2 || scaleDenominator == 4 || scaleDenominator == 8);
+
+    Image image (decodeImage (input));
+
+    if (image.isValid() && scaleDenominator > 1)
+        image = image.rescaled (getScaledSize (image.getWidth(),  scaleDenominator),
+                                getScaledSize (image.getHeight(), scaleDenominator),
+                                Graphics::highResamplingQuality);
+
+    if (image.isValid() && destImage.getBounds() == image.getBounds()
+         && (destImage.isARGB() || destImage.isRGB()))
+    {
+        Image dest (destImage);
+        dest.clear (dest.getBounds());
+
+        {
+            Graphics g (dest);
+            g.drawImageAt (image, 0, 0);
+        }
+
+        image = dest;
+    }
+
+    if (image.isValid() && listener != nullptr)
+        listener->imageRowsDecoded (image, Range<int> (0, image.getHeight()));
+
+    return image;
+}
+
 //==============================================================================
 Image ImageFileFormat::loadFrom (InputStream& input)
 {
@@ -103,3 +146,225 @@ Image ImageFileFormat::loadFrom (const void* rawData, const size_t numBytes)
 
     return Image();
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ImageDecodingTests  : public UnitTest
+{
+public:
+    ImageDecodingTests() : UnitTest ("Image decoding") {}
+
+    // Something with smooth areas and edges, so that it compresses like a photo
+    static Image createImage (int w, int h, bool withAlpha)
+    {
+        Image image (withAlpha ? Image::ARGB : Image::RGB, w, h, true);
+        Graphics g (image);
+
+        g.setGradientFill (ColourGradient (Colours::darkblue, 0.0f, 0.0f,
+                                           Colours::orange, (float) w, (float) h, false));
+        g.fillRect (0, 0, w, h);
+
+        Random r (0x1234);
+
+        for (int i = 0; i < 40; ++i)
+        {
+            g.setColour (Colour ((uint32) r.nextInt()).withAlpha (withAlpha ? 0.6f : 1.0f));
+            g.fillEllipse (r.nextFloat() * w, r.nextFloat() * h, r.nextFloat() * w / 4.0f, r.nextFloat() * h / 4.0f);
+        }
+
+        return image;
+    }
+
+    static MemoryBlock encode (ImageFileFormat& format, const Image& image)
+    {
+        MemoryOutputStream out;
+        format.writeImageToStream (image, out);
+        return out.getMemoryBlock();
+    }
+
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        int maxDiff = 0;
+
+        for (int y = 0; y < a.getHeight(); ++y)
+        {
+            for (int x = 0; x < a.getWidth(); ++x)
+            {
+                const PixelARGB pa (a.getPixelAt (x, y).getPixelARGB());
+                const PixelARGB pb (b.getPixelAt (x, y).getPixelARGB());
+
+                maxDiff = jmax (maxDiff, std::abs (pa.getAlpha() - pb.getAlpha()), std::abs (pa.getRed()  - pb.getRed()));
+                maxDiff = jmax (maxDiff, std::abs (pa.getGreen() - pb.getGreen()), std::abs (pa.getBlue() - pb.getBlue()));
+            }
+        }
+
+        return maxDiff;
+    }
+
+    static double getMeanDifference (const Image& a, const Image& b)
+    {
+        double total = 0;
+
+        for (int y = 0; y < a.getHeight(); ++y)
+        {
+            for (int x = 0; x < a.getWidth(); ++x)
+            {
+                const PixelARGB pa (a.getPixelAt (x, y).getPixelARGB());
+                const PixelARGB pb (b.getPixelAt (x, y).getPixelARGB());
+
+                total += std::abs (pa.getRed()  - pb.getRed()) + std::abs (pa.getGreen() - pb.getGreen())
+                       + std::abs (pa.getBlue() - pb.getBlue());
+            }
+        }
+
+        return total / (3.0 * a.getWidth() * a.getHeight());
+    }
+
+    struct RowRecorder  : public ImageFileFormat::DecodeListener
+    {
+        RowRecorder (int stopAfter = -1) : numCallbacks (0), stopAfterCallbacks (stopAfter) {}
+
+        void imageRowsDecoded (const Image&, Range<int> rows) override
+        {
+            ranges.add (rows);
+            ++numCallbacks;
+        }
+
+        bool shouldStopDecoding() override
+        {
+            return stopAfterCallbacks >= 0 && numCallbacks >= stopAfterCallbacks;
+        }
+
+        bool coversContiguously (int height) const
+        {
+            int next = 0;
+
+            for (int i = 0; i < ranges.size(); ++i)
+            {
+                if (ranges.getReference (i).getStart() != next)
+                    return false;
+
+                next = ranges.getReference (i).getEnd();
+            }
+
+            return next == height;
+        }
+
+        Array<Range<int> > ranges;
+        int numCallbacks, stopAfterCallbacks;
+    };
+
+    void checkIncrementalDecode (ImageFileFormat& format, const Image& original)
+    {
+        MemoryBlock data (encode (format, original));
+        const size_t imageSize = data.getSize();
+        data.append ("trailing", 8);
+
+        {
+            MemoryInputStream in (data, false);
+            int w = 0, h = 0;
+            bool hasAlpha = false;
+            expect (format.readImageHeader (in, w, h, hasAlpha));
+            expect (w == original.getWidth() && h == original.getHeight());
+            expect (hasAlpha == (original.hasAlphaChannel() && format.getFormatName() == "PNG"));
+        }
+
+        MemoryInputStream in1 (data, false);
+        const Image reference (format.decodeImage (in1));
+        expect (reference.isValid());
+
+        RowRecorder recorder;
+        MemoryInputStream in2 (data, false);
+        const Image incremental (format.decodeImageIncrementally (in2, Image(), 1, &recorder));
+
+        expect (incremental.getBounds() == reference.getBounds());
+        expectEquals (getMaxDifference (incremental, reference), 0);
+        expect (recorder.ranges.size() > 1);
+        expect (recorder.coversContiguously (reference.getHeight()));
+        expectEquals ((int) in2.getPosition(), (int) imageSize);
+
+        Image dest (Image::ARGB, reference.getWidth(), reference.getHeight(), true);
+        MemoryInputStream in3 (data, false);
+        const Image intoDest (format.decodeImageIncrementally (in3, dest, 1, nullptr));
+        expect (intoDest == dest);
+        expectEquals (getMaxDifference (dest, reference), 0);
+
+        RowRecorder stopper (1);
+        MemoryInputStream in4 (data, false);
+        expect (format.decodeImageIncrementally (in4, Image(), 1, &stopper).isNull());
+        expectEquals (stopper.numCallbacks, 1);
+    }
+
+    void checkScaledDecode (ImageFileFormat& format, const Image& original, double maxMeanDifference)
+    {
+        const MemoryBlock data (encode (format, original));
+
+        MemoryInputStream in (data, false);
+        const Image full (format.decodeImage (in));
+
+        for (int scale = 2; scale <= 8; scale *= 2)
+        {
+            MemoryInputStream scaledIn (data, false);
+            const Image scaled (format.decodeImageIncrementally (scaledIn, Image(), scale, nullptr));
+
+            expectEquals (scaled.getWidth(),  ImageFileFormat::getScaledSize (original.getWidth(),  scale));
+            expectEquals (scaled.getHeight(), ImageFileFormat::getScaledSize (original.getHeight(), scale));
+
+            const Image shrunk (full.rescaled (scaled.getWidth(), scaled.getHeight(), Graphics::highResamplingQuality));
+            expectLessOrEqual (getMeanDifference (scaled, shrunk), maxMeanDifference);
+        }
+    }
+
+    void runTest() override
+    {
+        JPEGImageFormat jpeg;
+        PNGImageFormat png;
+
+        beginTest ("Reading rows incrementally matches decodeImage");
+        checkIncrementalDecode (jpeg, createImage (203, 150, false));
+        checkIncrementalDecode (png, createImage (203, 150, false));
+        checkIncrementalDecode (png, createImage (203, 150, true));
+
+        beginTest ("Reduced-size decoding approximates a shrunk full-size decode");
+        checkScaledDecode (jpeg, createImage (512, 384, false), 5.0);
+        checkScaledDecode (png, createImage (512, 384, true), 1.0);
+        checkScaledDecode (png, createImage (200, 152, false), 1.0);
+
+        beginTest ("Benchmark: decoding");
+        {
+            const Image original (createImage (2048, 1536, false));
+            const MemoryBlock jpegData (encode (jpeg, original));
+            const MemoryBlock pngData (encode (png, original));
+            const double mpixels = original.getWidth() * original.getHeight() / 1.0e6;
+
+            for (int scale = 1; scale <= 8; scale *= 2)
+            {
+                const double jpegTime = timeDecodes (jpeg, jpegData, scale);
+                const double pngTime = timeDecodes (png, pngData, scale);
+
+                logMessage ("2048x1536 at 1/" + String (scale)
+                              + ": JPEG " + String (jpegTime * 1000.0, 1) + "ms (" + String (mpixels / jpegTime, 1) + " Mpixels/s)"
+                              + ", PNG " + String (pngTime * 1000.0, 1) + "ms (" + String (mpixels / pngTime, 1) + " Mpixels/s)");
+            }
+        }
+    }
+
+    static double timeDecodes (ImageFileFormat& format, const MemoryBlock& data, int scale)
+    {
+        const int numRuns = 3;
+        const double start = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            MemoryInputStream in (data, false);
+            format.decodeImageIncrementally (in, Image(), scale, nullptr);
+        }
+
+        return (Time::getMillisecondCounterHiRes() - start) / (1000.0 * numRuns);
+    }
+};
+
+static ImageDecodingTests imageDecodingTests;
+
+#endif
@@ -82,6 +82,59 @@ public:
     */
     virtual Image decodeImage (InputStream& input) = 0;
 
+    //==============================================================================
+    /** Receives the rows of an image while it's being decoded.
+        @see decodeImageIncrementally
+    */
+    class JUCE_API  DecodeListener
+    {
+    public:
+        /** Destructor. */
+        virtual ~DecodeListener() {}
+
+        /** Called from the decoding thread each time some more rows have been written
+            into the image.
+        */
+        virtual void imageRowsDecoded (const Image& image, Range<int> rows) = 0;
+
+        /** If this returns true, the decoder gives up and returns an invalid image. */
+        virtual bool shouldStopDecoding()           { return false; }
+    };
+
+    /** Reads just enough of a stream to find the size of the image in it, and whether it
+        has an alpha channel, without decoding the pixels.
+
+        The default implementation has to decode the whole image to find out, but the
+        PNG and JPEG formats only read the header.
+
+        @returns    true if the stream contains an image that this format can decode
+    */
+    virtual bool readImageHeader (InputStream& input, int& width, int& height, bool& hasAlphaChannel);
+
+    /** Decodes an image a row at a time, optionally at a reduced size.
+
+        @param input            the stream to read, positioned at the start of the image data
+        @param destImage        if this is an ARGB or RGB image with the same size as the decoded
+                                image will have (see getScaledSize()), the rows are written straight
+                                into it, so that it can be drawn while it's being decoded; otherwise
+                                a new image is created
+        @param scaleDenominator 1, 2, 4 or 8, to shrink the image by this factor. JPEGs are shrunk
+                                while they're decoded, which is much quicker than decoding them at
+                                full size. Other formats are decoded and then shrunk.
+        @param listener         if not null, this is told as each batch of rows is decoded
+        @returns                the decoded image, or an invalid image if it fails or is stopped
+    */
+    virtual Image decodeImageIncrementally (InputStream& input, const Image& destImage,
+                                            int scaleDenominator, DecodeListener* listener);
+
+    /** Returns the size that a dimension of an image becomes when it's decoded with the
+        given scale denominator.
+    */
+    static int getScaledSize (int size, int scaleDenominator) noexcept
+    {
+        return (size + scaleDenominator - 1) / scaleDenominator;
+    }
+
     //==============================================================================
     /** Attempts to write an image to a stream.
 
@@ -155,6 +208,8 @@ public:
     bool usesFileExtension (const File&) override;
     bool canUnderstand (InputStream&) override;
     Image decodeImage (InputStream&) override;
+    bool readImageHeader (InputStream&, int&, int&, bool&) override;
+    Image decodeImageIncrementally (InputStream&, const Image&, int, DecodeListener*) override;
     bool writeImageToStream (const Image&, OutputStream&) override;
 };
 
@@ -185,6 +240,8 @@ public:
     bool usesFileExtension (const File&) override;
     bool canUnderstand (InputStream&) override;
     Image decodeImage (InputStream&) override;
+    bool readImageHeader (InputStream&, int&, int&, bool&) override;
+    Image decodeImageIncrementally (InputStream&, const Image&, int, DecodeListener*) override;
     bool writeImageToStream (const Image&, OutputStream&) override;
 
 private:
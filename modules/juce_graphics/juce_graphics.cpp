@@ -97,6 +97,49 @@
 
 #undef SIZEOF
 
+#if JUCE_MINGW && ! defined (__SSE2__)
+ #define JUCE_USE_SSE_INTRINSICS 0
+#endif
+
+#ifndef JUCE_USE_SSE_INTRINSICS
+ #define JUCE_USE_SSE_INTRINSICS 1
+#endif
+
+#if ! JUCE_INTEL || JUCE_BIG_ENDIAN
+ #undef JUCE_USE_SSE_INTRINSICS
+#endif
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+
+ #ifndef JUCE_USE_AVX2_INTRINSICS
+  #if (JUCE_MSVC && _MSC_VER >= 1800) || JUCE_CLANG || (JUCE_GCC && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+   #define JUCE_USE_AVX2_INTRINSICS 1
+  #endif
+ #endif
+
+ #if JUCE_USE_AVX2_INTRINSICS
+  #include <immintrin.h>
+ #endif
+#else
+ #undef JUCE_USE_AVX2_INTRINSICS
+#endif
+
+#if __ARM_NEON__ && ! JUCE_BIG_ENDIAN && ! defined (JUCE_USE_ARM_NEON)
+ #define JUCE_USE_ARM_NEON 1
+#endif
+
+#if TARGET_IPHONE_SIMULATOR
+ #ifdef JUCE_USE_ARM_NEON
+  #undef JUCE_USE_ARM_NEON
+ #endif
+ #define JUCE_USE_ARM_NEON 0
+#endif
+
+#if JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
 #if (JUCE_MAC || JUCE_IOS) && USE_COREGRAPHICS_RENDERING && JUCE_USE_COREIMAGE_LOADER
  #define JUCE_USING_COREIMAGE_LOADER 1
 #else
@@ -120,6 +163,8 @@ namespace juce
 #include "contexts/juce_GraphicsContext.cpp"
 #include "contexts/juce_LowLevelGraphicsPostScriptRenderer.cpp"
 #include "contexts/juce_LowLevelGraphicsSoftwareRenderer.cpp"
+#include "contexts/juce_LowLevelGraphicsDeferredSoftwareRenderer.cpp"
+#include "native/juce_RenderingHelpers.cpp"
 #include "images/juce_Image.cpp"
 #include "images/juce_ImageCache.cpp"
 #include "images/juce_ImageConvolutionKernel.cpp"
@@ -0,0 +1,1330 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+
+namespace RenderingHelpers
+{
+namespace PixelSpans
+{
+    struct Scalar
+    {
+        static void blendColour (PixelARGB* dest, const PixelARGB colour, int numPixels) noexcept
+        {
+            while (--numPixels >= 0)
+                (dest++)->blend (colour);
+        }
+
+        static void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept
+        {
+            while (--numPixels >= 0)
+                (dest++)->blend (*src++);
+        }
+
+        static void blendPixelsWithAlpha (PixelARGB* dest, const PixelARGB* src, int numPixels, const uint32 extraAlpha) noexcept
+        {
+            while (--numPixels >= 0)
+                (dest++)->blend (*src++, extraAlpha);
+        }
+
+        static void resampleBilinear (PixelARGB* dest, const Image::BitmapData& srcData, const int* positions, int numPixels) noexcept
+        {
+            while (--numPixels >= 0)
+            {
+                const int hiResX = *positions++;
+                const int hiResY = *positions++;
+                const uint32 subPixelX = (uint32) (hiResX & 255);
+                const uint32 subPixelY = (uint32) (hiResY & 255);
+
+                const uint8* src = srcData.getPixelPointer (hiResX >> 8, hiResY >> 8);
+                const uint32 w00 = (256 - subPixelX) * (256 - subPixelY);
+                const uint32 w10 = subPixelX * (256 - subPixelY);
+                const uint32 w11 = subPixelX * subPixelY;
+                const uint32 w01 = (256 - subPixelX) * subPixelY;
+
+                const uint8* const s00 = src;
+                const uint8* const s10 = src + srcData.pixelStride;
+                const uint8* const s01 = src + srcData.lineStride;
+                const uint8* const s11 = s01 + srcData.pixelStride;
+
+                uint8* d = reinterpret_cast<uint8*> (dest++);
+
+                for (int i = 0; i < 4; ++i)
+                    d[i] = (uint8) ((256 * 128 + w00 * s00[i] + w10 * s10[i] + w11 * s11[i] + w01 * s01[i]) >> 16);
+            }
+        }
+
+        static void multiplyAdd (float* dest, const float* src, const float multiplier, int num) noexcept
+        {
+            while (--num >= 0)
+                *dest++ += *src++ * multiplier;
+        }
+    };
+
+   #if JUCE_USE_SSE_INTRINSICS
+    //==============================================================================
+    /*  Pixels are unpacked into 16-bit lanes, two per register, where each step of
+        PixelARGB::blend() can be done for all the components at once: the products
+        of 8-bit values and alphas of up to 0x100 always fit, and packing with unsigned
+        saturation does the same job as clampPixelComponents().
+    */
+    struct SSE2
+    {
+        static forcedinline __m128i unpackLo (const __m128i p) noexcept   { return _mm_unpacklo_epi8 (p, _mm_setzero_si128()); }
+        static forcedinline __m128i unpackHi (const __m128i p) noexcept   { return _mm_unpackhi_epi8 (p, _mm_setzero_si128()); }
+
+        static forcedinline __m128i inverseAlpha (const __m128i p) noexcept
+        {
+            return _mm_sub_epi16 (_mm_set1_epi16 (0x100), _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (p, 0xff), 0xff));
+        }
+
+        static forcedinline __m128i blend (const __m128i d, const __m128i s, const __m128i invAlpha) noexcept
+        {
+            return _mm_add_epi16 (s, _mm_srli_epi16 (_mm_mullo_epi16 (d, invAlpha), 8));
+        }
+
+        static forcedinline __m128i blend4 (const __m128i d, const __m128i sLo, const __m128i sHi) noexcept
+        {
+            return _mm_packus_epi16 (blend (unpackLo (d), sLo, inverseAlpha (sLo)),
+                                     blend (unpackHi (d), sHi, inverseAlpha (sHi)));
+        }
+
+        static forcedinline __m128i load4 (const PixelARGB* p) noexcept           { return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p)); }
+        static forcedinline void store4 (PixelARGB* p, const __m128i v) noexcept  { _mm_storeu_si128 (reinterpret_cast<__m128i*> (p), v); }
+        static forcedinline __m128i load1 (const uint8* p) noexcept               { return _mm_cvtsi32_si128 (*reinterpret_cast<const int*> (p)); }
+
+        static void blendColour (PixelARGB* dest, const PixelARGB colour, int numPixels) noexcept
+        {
+            const __m128i s = unpackLo (_mm_set1_epi32 ((int) colour.getNativeARGB()));
+            const __m128i invAlpha = inverseAlpha (s);
+
+            for (; numPixels >= 4; numPixels -= 4, dest += 4)
+            {
+                const __m128i d = load4 (dest);
+                store4 (dest, _mm_packus_epi16 (blend (unpackLo (d), s, invAlpha),
+                                                blend (unpackHi (d), s, invAlpha)));
+            }
+
+            Scalar::blendColour (dest, colour, numPixels);
+        }
+
+        static void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept
+        {
+            for (; numPixels >= 4; numPixels -= 4, dest += 4, src += 4)
+            {
+                const __m128i s = load4 (src);
+                store4 (dest, blend4 (load4 (dest), unpackLo (s), unpackHi (s)));
+            }
+
+            Scalar::blendPixels (dest, src, numPixels);
+        }
+
+        static void blendPixelsWithAlpha (PixelARGB* dest, const PixelARGB* src, int numPixels, const uint32 extraAlpha) noexcept
+        {
+            const __m128i alpha = _mm_set1_epi16 ((short) extraAlpha);
+
+            for (; numPixels >= 4; numPixels -= 4, dest += 4, src += 4)
+            {
+                const __m128i s = load4 (src);
+                store4 (dest, blend4 (load4 (dest),
+                                      _mm_srli_epi16 (_mm_mullo_epi16 (unpackLo (s), alpha), 8),
+                                      _mm_srli_epi16 (_mm_mullo_epi16 (unpackHi (s), alpha), 8)));
+            }
+
+            Scalar::blendPixelsWithAlpha (dest, src, numPixels, extraAlpha);
+        }
+
+        // Each weight is split into its x and y factors, so that every product fits into
+        // the 16x16 -> 32 bit multiplies and gives exactly the same sums as the scalar code.
+        static void resampleBilinear (PixelARGB* dest, const Image::BitmapData& srcData, const int* positions, int numPixels) noexcept
+        {
+            const int pixelStride = srcData.pixelStride;
+            const int lineStride  = srcData.lineStride;
+            const __m128i rounding = _mm_set1_epi32 (256 * 128);
+
+            while (--numPixels >= 0)
+            {
+                const int hiResX = *positions++;
+                const int hiResY = *positions++;
+                const short subPixelX = (short) (hiResX & 255);
+                const short subPixelY = (short) (hiResY & 255);
+
+                const uint8* src = srcData.getPixelPointer (hiResX >> 8, hiResY >> 8);
+
+                const __m128i top    = unpackLo (_mm_unpacklo_epi32 (load1 (src), load1 (src + pixelStride)));
+                const __m128i bottom = unpackLo (_mm_unpacklo_epi32 (load1 (src + lineStride), load1 (src + lineStride + pixelStride)));
+
+                const __m128i t = _mm_mullo_epi16 (top,    _mm_set1_epi16 ((short) (256 - subPixelY)));
+                const __m128i b = _mm_mullo_epi16 (bottom, _mm_set1_epi16 (subPixelY));
+
+                const short leftWeight = (short) (256 - subPixelX);
+                const __m128i xWeights = _mm_set_epi16 (subPixelX, subPixelX, subPixelX, subPixelX,
+                                                        leftWeight, leftWeight, leftWeight, leftWeight);
+
+                const __m128i tLo = _mm_mullo_epi16 (t, xWeights), tHi = _mm_mulhi_epu16 (t, xWeights);
+                const __m128i bLo = _mm_mullo_epi16 (b, xWeights), bHi = _mm_mulhi_epu16 (b, xWeights);
+
+                __m128i sum = _mm_add_epi32 (_mm_add_epi32 (_mm_unpacklo_epi16 (tLo, tHi), _mm_unpackhi_epi16 (tLo, tHi)),
+                                             _mm_add_epi32 (_mm_unpacklo_epi16 (bLo, bHi), _mm_unpackhi_epi16 (bLo, bHi)));
+
+                sum = _mm_srli_epi32 (_mm_add_epi32 (sum, rounding), 16);
+                sum = _mm_packs_epi32 (sum, sum);
+
+                *reinterpret_cast<int*> (dest++) = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+            }
+        }
+
+        static void multiplyAdd (float* dest, const float* src, const float multiplier, int num) noexcept
+        {
+            const __m128 m = _mm_set1_ps (multiplier);
+
+            for (; num >= 4; num -= 4, dest += 4, src += 4)
+                _mm_storeu_ps (dest, _mm_add_ps (_mm_loadu_ps (dest), _mm_mul_ps (_mm_loadu_ps (src), m)));
+
+            Scalar::multiplyAdd (dest, src, multiplier, num);
+        }
+    };
+   #endif
+
+   #if JUCE_USE_AVX2_INTRINSICS
+    //==============================================================================
+   #if JUCE_MSVC
+    #define JUCE_AVX2_FUNCTION
+   #else
+    #define JUCE_AVX2_FUNCTION __attribute__ ((target ("avx2")))
+   #endif
+
+    /*  The same as the SSE2 versions, but eight pixels at a time. The unpacking and
+        packing instructions work within each 128-bit half, so they cancel each other out
+        without needing any extra permutes.
+    */
+    struct AVX2
+    {
+        static forcedinline JUCE_AVX2_FUNCTION __m256i unpackLo (const __m256i p) noexcept   { return _mm256_unpacklo_epi8 (p, _mm256_setzero_si256()); }
+        static forcedinline JUCE_AVX2_FUNCTION __m256i unpackHi (const __m256i p) noexcept   { return _mm256_unpackhi_epi8 (p, _mm256_setzero_si256()); }
+
+        static forcedinline JUCE_AVX2_FUNCTION __m256i inverseAlpha (const __m256i p) noexcept
+        {
+            return _mm256_sub_epi16 (_mm256_set1_epi16 (0x100), _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (p, 0xff), 0xff));
+        }
+
+        static forcedinline JUCE_AVX2_FUNCTION __m256i blend (const __m256i d, const __m256i s, const __m256i invAlpha) noexcept
+        {
+            return _mm256_add_epi16 (s, _mm256_srli_epi16 (_mm256_mullo_epi16 (d, invAlpha), 8));
+        }
+
+        static forcedinline JUCE_AVX2_FUNCTION __m256i blend8 (const __m256i d, const __m256i sLo, const __m256i sHi) noexcept
+        {
+            return _mm256_packus_epi16 (blend (unpackLo (d), sLo, inverseAlpha (sLo)),
+                                        blend (unpackHi (d), sHi, inverseAlpha (sHi)));
+        }
+
+        static forcedinline JUCE_AVX2_FUNCTION __m256i load8 (const PixelARGB* p) noexcept           { return _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p)); }
+        static forcedinline JUCE_AVX2_FUNCTION void store8 (PixelARGB* p, const __m256i v) noexcept  { _mm256_storeu_si256 (reinterpret_cast<__m256i*> (p), v); }
+
+        static JUCE_AVX2_FUNCTION void blendColour (PixelARGB* dest, const PixelARGB colour, int numPixels) noexcept
+        {
+            const __m256i s = unpackLo (_mm256_set1_epi32 ((int) colour.getNativeARGB()));
+            const __m256i invAlpha = inverseAlpha (s);
+
+            for (; numPixels >= 8; numPixels -= 8, dest += 8)
+            {
+                const __m256i d = load8 (dest);
+                store8 (dest, _mm256_packus_epi16 (blend (unpackLo (d), s, invAlpha),
+                                                   blend (unpackHi (d), s, invAlpha)));
+            }
+
+            Scalar::blendColour (dest, colour, numPixels);
+        }
+
+        static JUCE_AVX2_FUNCTION void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept
+        {
+            for (; numPixels >= 8; numPixels -= 8, dest += 8, src += 8)
+            {
+                const __m256i s = load8 (src);
+                store8 (dest, blend8 (load8 (dest), unpackLo (s), unpackHi (s)));
+            }
+
+            Scalar::blendPixels (dest, src, numPixels);
+        }
+
+        static JUCE_AVX2_FUNCTION void blendPixelsWithAlpha (PixelARGB* dest, const PixelARGB* src, int numPixels, const uint32 extraAlpha) noexcept
+        {
+            const __m256i alpha = _mm256_set1_epi16 ((short) extraAlpha);
+
+            for (; numPixels >= 8; numPixels -= 8, dest += 8, src += 8)
+            {
+                const __m256i s = load8 (src);
+                store8 (dest, blend8 (load8 (dest),
+                                      _mm256_srli_epi16 (_mm256_mullo_epi16 (unpackLo (s), alpha), 8),
+                                      _mm256_srli_epi16 (_mm256_mullo_epi16 (unpackHi (s), alpha), 8)));
+            }
+
+            Scalar::blendPixelsWithAlpha (dest, src, numPixels, extraAlpha);
+        }
+
+        static void resampleBilinear (PixelARGB* dest, const Image::BitmapData& srcData, const int* positions, int numPixels) noexcept
+        {
+            SSE2::resampleBilinear (dest, srcData, positions, numPixels);
+        }
+
+        static JUCE_AVX2_FUNCTION void multiplyAdd (float* dest, const float* src, const float multiplier, int num) noexcept
+        {
+            const __m256 m = _mm256_set1_ps (multiplier);
+
+            for (; num >= 8; num -= 8, dest += 8, src += 8)
+                _mm256_storeu_ps (dest, _mm256_add_ps (_mm256_loadu_ps (dest), _mm256_mul_ps (_mm256_loadu_ps (src), m)));
+
+            Scalar::multiplyAdd (dest, src, multiplier, num);
+        }
+    };
+
+    #undef JUCE_AVX2_FUNCTION
+   #endif
+
+   #if JUCE_USE_ARM_NEON
+    //==============================================================================
+    /*  Eight pixels at a time, de-interleaved into one register per component. */
+    struct NEON
+    {
+        static forcedinline uint8x8_t blend (const uint8x8_t d, const uint16x8_t s, const uint16x8_t invAlpha) noexcept
+        {
+            return vqmovn_u16 (vaddq_u16 (s, vshrq_n_u16 (vmulq_u16 (vmovl_u8 (d), invAlpha), 8)));
+        }
+
+        static forcedinline void blend8 (PixelARGB* dest, const uint16x8_t* s) noexcept
+        {
+            const uint16x8_t invAlpha = vsubq_u16 (vdupq_n_u16 (0x100), s[PixelARGB::indexA]);
+            uint8x8x4_t d = vld4_u8 (reinterpret_cast<const uint8*> (dest));
+
+            for (int i = 0; i < 4; ++i)
+                d.val[i] = blend (d.val[i], s[i], invAlpha);
+
+            vst4_u8 (reinterpret_cast<uint8*> (dest), d);
+        }
+
+        static void blendColour (PixelARGB* dest, const PixelARGB colour, int numPixels) noexcept
+        {
+            const uint8* const c = reinterpret_cast<const uint8*> (&colour);
+            uint16x8_t s[4];
+
+            for (int i = 0; i < 4; ++i)
+                s[i] = vdupq_n_u16 (c[i]);
+
+            for (; numPixels >= 8; numPixels -= 8, dest += 8)
+                blend8 (dest, s);
+
+            Scalar::blendColour (dest, colour, numPixels);
+        }
+
+        static void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept
+        {
+            for (; numPixels >= 8; numPixels -= 8, dest += 8, src += 8)
+            {
+                const uint8x8x4_t p = vld4_u8 (reinterpret_cast<const uint8*> (src));
+                uint16x8_t s[4];
+
+                for (int i = 0; i < 4; ++i)
+                    s[i] = vmovl_u8 (p.val[i]);
+
+                blend8 (dest, s);
+            }
+
+            Scalar::blendPixels (dest, src, numPixels);
+        }
+
+        static void blendPixelsWithAlpha (PixelARGB* dest, const PixelARGB* src, int numPixels, const uint32 extraAlpha) noexcept
+        {
+            const uint16x8_t alpha = vdupq_n_u16 ((uint16) extraAlpha);
+
+            for (; numPixels >= 8; numPixels -= 8, dest += 8, src += 8)
+            {
+                const uint8x8x4_t p = vld4_u8 (reinterpret_cast<const uint8*> (src));
+                uint16x8_t s[4];
+
+                for (int i = 0; i < 4; ++i)
+                    s[i] = vshrq_n_u16 (vmulq_u16 (vmovl_u8 (p.val[i]), alpha), 8);
+
+                blend8 (dest, s);
+            }
+
+            Scalar::blendPixelsWithAlpha (dest, src, numPixels, extraAlpha);
+        }
+
+        static void resampleBilinear (PixelARGB* dest, const Image::BitmapData& srcData, const int* positions, int numPixels) noexcept
+        {
+            Scalar::resampleBilinear (dest, srcData, positions, numPixels);
+        }
+
+        static void multiplyAdd (float* dest, const float* src, const float multiplier, int num) noexcept
+        {
+            const float32x4_t m = vdupq_n_f32 (multiplier);
+
+            for (; num >= 4; num -= 4, dest += 4, src += 4)
+                vst1q_f32 (dest, vaddq_f32 (vld1q_f32 (dest), vmulq_f32 (vld1q_f32 (src), m)));
+
+            Scalar::multiplyAdd (dest, src, multiplier, num);
+        }
+    };
+   #endif
+
+    //==============================================================================
+    struct Implementation
+    {
+        template <class Kernels>
+        static Implementation create (const char* name) noexcept
+        {
+            Implementation i;
+            i.name = name;
+            i.blendColour = Kernels::blendColour;
+            i.blendPixels = Kernels::blendPixels;
+            i.blendPixelsWithAlpha = Kernels::blendPixelsWithAlpha;
+            i.resampleBilinear = Kernels::resampleBilinear;
+            i.multiplyAdd = Kernels::multiplyAdd;
+            return i;
+        }
+
+        // Returns the implementations that this CPU can run, fastest first.
+        static Array<Implementation> getAvailable()
+        {
+            Array<Implementation> available;
+
+           #if JUCE_USE_AVX2_INTRINSICS
+            if (SystemStats::hasAVX2())
+                available.add (create<AVX2> ("AVX2"));
+           #endif
+
+           #if JUCE_USE_SSE_INTRINSICS
+            if (SystemStats::hasSSE2())
+                available.add (create<SSE2> ("SSE2"));
+           #endif
+
+           #if JUCE_USE_ARM_NEON
+            available.add (create<NEON> ("NEON"));
+           #endif
+
+            available.add (create<Scalar> ("scalar"));
+            return available;
+        }
+
+        static Implementation& getActive()
+        {
+            static Implementation active (getAvailable().getFirst());
+            return active;
+        }
+
+        bool operator== (const Implementation& other) const noexcept   { return blendColour == other.blendColour; }
+
+        const char* name;
+        void (*blendColour) (PixelARGB*, PixelARGB, int);
+        void (*blendPixels) (PixelARGB*, const PixelARGB*, int);
+        void (*blendPixelsWithAlpha) (PixelARGB*, const PixelARGB*, int, uint32);
+        void (*resampleBilinear) (PixelARGB*, const Image::BitmapData&, const int*, int);
+        void (*multiplyAdd) (float*, const float*, float, int);
+    };
+
+    void blendColour (PixelARGB* dest, PixelARGB colour, int numPixels) noexcept
+    {
+        Implementation::getActive().blendColour (dest, colour, numPixels);
+    }
+
+    void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept
+    {
+        Implementation::getActive().blendPixels (dest, src, numPixels);
+    }
+
+    void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels, uint32 extraAlpha) noexcept
+    {
+        Implementation::getActive().blendPixelsWithAlpha (dest, src, numPixels, extraAlpha);
+    }
+
+    void resampleBilinear (PixelARGB* dest, const Image::BitmapData& src, const int* hiResPositions, int numPixels) noexcept
+    {
+        Implementation::getActive().resampleBilinear (dest, src, hiResPositions, numPixels);
+    }
+
+    void multiplyAdd (float* dest, const float* src, float multiplier, int num) noexcept
+    {
+        Implementation::getActive().multiplyAdd (dest, src, multiplier, num);
+    }
+}
+
+juce_ImplementSingleton (PathEdgeTableCache)
+juce_ImplementSingleton (GlyphArrangementCache)
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class PixelSpanTests  : public UnitTest
+{
+public:
+    PixelSpanTests() : UnitTest ("RenderingHelpers::PixelSpans") {}
+
+    typedef RenderingHelpers::PixelSpans::Implementation Implementation;
+
+    struct ScopedImplementation
+    {
+        ScopedImplementation (const Implementation& i)  : original (Implementation::getActive())  { Implementation::getActive() = i; }
+        ~ScopedImplementation()  { Implementation::getActive() = original; }
+
+        const Implementation original;
+    };
+
+    static PixelARGB createRandomPixel (Random& r)
+    {
+        // plenty of fully opaque and fully transparent pixels, as they're the edge cases
+        const int type = r.nextInt (4);
+        const uint8 alpha = type == 0 ? (uint8) 0 : (type == 1 ? (uint8) 0xff : (uint8) r.nextInt (256));
+
+        PixelARGB p (alpha, (uint8) r.nextInt (256), (uint8) r.nextInt (256), (uint8) r.nextInt (256));
+        p.premultiply();
+        return p;
+    }
+
+    static void fillRandomly (Random& r, HeapBlock<PixelARGB>& pixels, int num)
+    {
+        pixels.malloc ((size_t) num);
+
+        for (int i = 0; i < num; ++i)
+            pixels[i] = createRandomPixel (r);
+    }
+
+    static bool pixelsMatch (const PixelARGB* a, const PixelARGB* b, int num)
+    {
+        return memcmp (a, b, sizeof (PixelARGB) * (size_t) num) == 0;
+    }
+
+    void testBlending (const Implementation& implementation)
+    {
+        ScopedImplementation scope (implementation);
+        Random r (0x1234);
+        HeapBlock<PixelARGB> original, src, expected, actual;
+
+        for (int numPixels = 0; numPixels < 100; numPixels += (numPixels < 40 ? 1 : 13))
+        {
+            for (int offset = 0; offset < 4; ++offset)
+            {
+                const int total = numPixels + offset;
+                fillRandomly (r, original, total);
+                fillRandomly (r, src, total);
+                expected.malloc ((size_t) total);
+                actual.malloc ((size_t) total);
+
+                const PixelARGB colour (createRandomPixel (r));
+                const uint32 extraAlpha = (uint32) r.nextInt (257);
+
+                memcpy (expected, original, sizeof (PixelARGB) * (size_t) total);
+                memcpy (actual, original, sizeof (PixelARGB) * (size_t) total);
+
+                for (int i = offset; i < total; ++i)
+                    expected[i].blend (colour);
+
+                RenderingHelpers::PixelSpans::blendColour (actual + offset, colour, numPixels);
+                expect (pixelsMatch (expected, actual, total));
+
+                for (int i = offset; i < total; ++i)
+                    expected[i].blend (src[i]);
+
+                RenderingHelpers::PixelSpans::blendPixels (actual + offset, src + offset, numPixels);
+                expect (pixelsMatch (expected, actual, total));
+
+                for (int i = offset; i < total; ++i)
+                    expected[i].blend (src[i], extraAlpha);
+
+                RenderingHelpers::PixelSpans::blendPixels (actual + offset, src + offset, numPixels, extraAlpha);
+                expect (pixelsMatch (expected, actual, total));
+            }
+        }
+    }
+
+    void testResampling (const Implementation& implementation, const Implementation& reference)
+    {
+        Random r (0x4321);
+        Image source (Image::ARGB, 37, 23, false);
+
+        for (int y = 0; y < source.getHeight(); ++y)
+            for (int x = 0; x < source.getWidth(); ++x)
+                source.setPixelAt (x, y, Colour ((uint32) r.nextInt()));
+
+        const Image::BitmapData srcData (source, Image::BitmapData::readOnly);
+        const int numPixels = 500;
+        HeapBlock<int> positions ((size_t) numPixels * 2);
+
+        for (int i = 0; i < numPixels; ++i)
+        {
+            positions[i * 2]     = r.nextInt ((source.getWidth()  - 1) * 256);
+            positions[i * 2 + 1] = r.nextInt ((source.getHeight() - 1) * 256);
+        }
+
+        HeapBlock<PixelARGB> expected ((size_t) numPixels), actual ((size_t) numPixels);
+        reference.resampleBilinear (expected, srcData, positions, numPixels);
+        implementation.resampleBilinear (actual, srcData, positions, numPixels);
+
+        expect (pixelsMatch (expected, actual, numPixels));
+    }
+
+    void testMultiplyAdd (const Implementation& implementation, const Implementation& reference)
+    {
+        Random r (0x2468);
+        const int num = 301;
+        HeapBlock<float> src ((size_t) num), expected ((size_t) num), actual ((size_t) num);
+
+        for (int i = 0; i < num; ++i)
+        {
+            src[i] = r.nextFloat() * 255.0f;
+            expected[i] = actual[i] = r.nextFloat() * 1000.0f;
+        }
+
+        for (int offset = 0; offset < 8; ++offset)
+        {
+            const float multiplier = r.nextFloat() * 2.0f - 1.0f;
+            reference.multiplyAdd (expected + offset, src + offset, multiplier, num - offset * 37);
+            implementation.multiplyAdd (actual + offset, src + offset, multiplier, num - offset * 37);
+        }
+
+        bool matches = true;
+
+        for (int i = 0; i < num; ++i)
+            matches = matches && std::abs (expected[i] - actual[i]) <= 1.0e-3f;
+
+        expect (matches);
+    }
+
+    static Image createSprite()
+    {
+        Image sprite (Image::ARGB, 160, 120, true);
+        Graphics g (sprite);
+        g.setGradientFill (ColourGradient (Colours::yellow, 0, 0, Colours::blue.withAlpha (0.4f), 160.0f, 120.0f, true));
+        g.fillEllipse (4.0f, 4.0f, 152.0f, 112.0f);
+        g.setColour (Colours::red.withAlpha (0.7f));
+        g.drawLine (0, 0, 160.0f, 120.0f, 5.0f);
+        return sprite;
+    }
+
+    // The kinds of fill that go through the span functions
+    static void drawScene (Graphics& g, const Image& sprite, int w, int h)
+    {
+        const float fw = (float) w, fh = (float) h;
+
+        g.setGradientFill (ColourGradient (Colour (0xff203040), 0, 0, Colour (0xff607080), 0, fh, false));
+        g.fillAll();
+
+        g.setGradientFill (ColourGradient (Colours::green.withAlpha (0.6f), 10.0f, 20.0f, Colours::pink.withAlpha (0.3f), fw, fh * 0.7f, false));
+        g.fillRoundedRectangle (5.0f, 5.0f, fw * 0.8f, fh * 0.5f, 12.0f);
+
+        g.setGradientFill (ColourGradient (Colours::white.withAlpha (0.5f), fw * 0.5f, fh * 0.5f, Colours::transparentBlack, fw * 0.9f, fh * 0.5f, true));
+        g.fillEllipse (fw * 0.2f, fh * 0.2f, fw * 0.6f, fh * 0.6f);
+
+        g.setColour (Colours::orange.withAlpha (0.45f));
+        g.fillRect (w / 3, 7, w / 2, h / 3);
+        g.fillEllipse (3.3f, fh * 0.4f, fw * 0.5f, fh * 0.5f);
+
+        g.drawImageAt (sprite, 17, 11);
+        g.setOpacity (0.6f);
+        g.drawImageAt (sprite, w / 2, h / 2);
+        g.drawImageTransformed (sprite, AffineTransform::rotation (0.4f).scaled (1.7f, 1.3f).translated (fw * 0.3f, 2.0f));
+
+        g.setImageResamplingQuality (Graphics::highResamplingQuality);
+        g.setOpacity (1.0f);
+        g.drawImageTransformed (sprite, AffineTransform::scale (2.3f).translated (4.5f, fh * 0.35f));
+        g.setTiledImageFill (sprite, 3, 5, 0.5f);
+        g.fillRect (0, h * 3 / 4, w, h / 4);
+    }
+
+    static Image renderScene (const Implementation& implementation, const Image& sprite, int w, int h)
+    {
+        ScopedImplementation scope (implementation);
+        Image image (Image::ARGB, w, h, true);
+        Graphics g (image);
+        drawScene (g, sprite, w, h);
+        return image;
+    }
+
+    void runTest() override
+    {
+        const Array<Implementation> implementations (Implementation::getAvailable());
+        const Implementation& reference = implementations.getReference (implementations.size() - 1);
+
+        beginTest ("Span blending matches PixelARGB::blend");
+        {
+            for (int i = 0; i < implementations.size(); ++i)
+            {
+                logMessage (String ("Testing ") + implementations.getReference (i).name);
+                testBlending (implementations.getReference (i));
+            }
+        }
+
+        beginTest ("Bilinear resampling matches the scalar code");
+        {
+            for (int i = 0; i < implementations.size(); ++i)
+                testResampling (implementations.getReference (i), reference);
+        }
+
+        beginTest ("Float multiply-add matches the scalar code");
+        {
+            for (int i = 0; i < implementations.size(); ++i)
+                testMultiplyAdd (implementations.getReference (i), reference);
+        }
+
+        beginTest ("Rendering is identical with every implementation");
+        {
+            const Image sprite (createSprite());
+            const Image expected (renderScene (reference, sprite, 333, 251));
+
+            for (int i = 0; i < implementations.size(); ++i)
+                expect (RenderingHelpers::imagesAreIdentical (expected, renderScene (implementations.getReference (i), sprite, 333, 251)));
+        }
+
+        beginTest ("Fill-rate benchmark");
+        {
+            const Image sprite (createSprite());
+            const int w = 1024, h = 768, numFrames = 10;
+            const char* const fillNames[] = { "solid colour", "gradient", "image", "resampled image" };
+
+            for (int fill = 0; fill < numElementsInArray (fillNames); ++fill)
+            {
+                String results;
+
+                for (int i = 0; i < implementations.size(); ++i)
+                {
+                    ScopedImplementation scope (implementations.getReference (i));
+                    Image image (Image::ARGB, w, h, true);
+                    Graphics g (image);
+                    g.setImageResamplingQuality (Graphics::highResamplingQuality);
+
+                    const double start = Time::getMillisecondCounterHiRes();
+
+                    for (int frame = 0; frame < numFrames; ++frame)
+                    {
+                        switch (fill)
+                        {
+                            case 0:  g.setColour (Colours::orange.withAlpha (0.5f)); g.fillRect (0, 0, w, h); break;
+                            case 1:  g.setGradientFill (ColourGradient (Colours::red.withAlpha (0.7f), 0, 0, Colours::blue.withAlpha (0.2f), (float) w, (float) h, false));
+                                     g.fillRect (0, 0, w, h); break;
+                            case 2:  g.setOpacity (0.8f);
+                                     for (int y = 0; y < h; y += sprite.getHeight())
+                                         for (int x = 0; x < w; x += sprite.getWidth())
+                                             g.drawImageAt (sprite, x, y);
+                                     break;
+                            default: g.setOpacity (0.8f); g.drawImage (sprite, 0, 0, w, h, 0, 0, sprite.getWidth(), sprite.getHeight()); break;
+                        }
+                    }
+
+                    const double seconds = (Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+                    results << implementations.getReference (i).name << " "
+                            << String (w * h * (double) numFrames / (seconds * 1.0e6), 1) << " Mpixels/sec  ";
+                }
+
+                logMessage (String (fillNames[fill]) + ": " + results);
+            }
+        }
+    }
+};
+
+static PixelSpanTests pixelSpanTests;
+
+//==============================================================================
+class PathEdgeTableCacheTests  : public UnitTest
+{
+public:
+    PathEdgeTableCacheTests() : UnitTest ("RenderingHelpers::PathEdgeTableCache") {}
+
+    typedef RenderingHelpers::PathEdgeTableCache Cache;
+    typedef RenderingHelpers::CacheHelpers::ScopedCacheState<Cache> ScopedCacheState;
+
+    // A panel of knobs, meters and a waveform, which only changes in the way a real UI would:
+    // the meter levels move, and everything else gets redrawn the same every frame.
+    static void drawPanel (Graphics& g, int frame, int w, int h)
+    {
+        g.fillAll (Colour (0xff202428));
+
+        Path waveform;
+        waveform.startNewSubPath (0, h * 0.8f);
+
+        for (int x = 0; x < w; x += 3)
+            waveform.lineTo ((float) x, h * 0.8f + 30.0f * std::sin (x * 0.05f) * std::cos (x * 0.013f));
+
+        g.setColour (Colours::lightgreen);
+        g.strokePath (waveform, PathStrokeType (1.5f));
+
+        for (int i = 0; i < 48; ++i)
+        {
+            Graphics::ScopedSaveState ss (g);
+            g.setOrigin (10 + (i % 12) * 60, 10 + (i / 12) * 70);
+
+            // each knob is a component, drawing the same shapes in its own coordinates
+            const float angle = -2.4f + (i % 7) * 0.7f;
+            Path arc;
+            arc.addCentredArc (25.0f, 25.0f, 20.0f, 20.0f, 0.0f, -2.4f, angle, true);
+
+            g.setColour (Colour (0xff404850));
+            g.fillEllipse (7.0f, 7.0f, 36.0f, 36.0f);
+            g.setColour (Colours::orange);
+            g.strokePath (arc, PathStrokeType (4.0f, PathStrokeType::curved, PathStrokeType::rounded));
+
+            Path pointer;
+            pointer.addRoundedRectangle (-2.0f, -18.0f, 4.0f, 14.0f, 2.0f);
+            g.setColour (Colours::white);
+            g.fillPath (pointer, AffineTransform::rotation (angle).translated (25.0f, 25.0f));
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const float level = 0.5f + 0.5f * std::sin (frame * 0.3f + i);
+            g.setGradientFill (ColourGradient (Colours::red, 0, 300.0f, Colours::green, 0, 400.0f, false));
+            g.fillRoundedRectangle (10.0f + i * 20.0f, 400.0f - level * 100.0f, 14.0f, level * 100.0f, 3.0f);
+        }
+    }
+
+    static Image renderPanel (bool useCache, const RectangleList<int>& clip, int numFrames)
+    {
+        const ScopedCacheState state (useCache);
+        Image image (Image::ARGB, 760, 520, true);
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            Graphics g (image);
+            g.reduceClipRegion (clip);
+            drawPanel (g, frame, image.getWidth(), image.getHeight());
+        }
+
+        return image;
+    }
+
+    void runTest() override
+    {
+        beginTest ("Cached shapes are drawn identically");
+        {
+            RectangleList<int> clip (Rectangle<int> (0, 0, 760, 520));
+            expect (RenderingHelpers::imagesAreIdentical (renderPanel (false, clip, 3), renderPanel (true, clip, 3)));
+
+            clip.subtract (Rectangle<int> (33, 41, 300, 17));
+            clip.subtract (Rectangle<int> (201, 0, 13, 520));
+            clip.subtract (Rectangle<int> (0, 300, 500, 9));
+            expect (RenderingHelpers::imagesAreIdentical (renderPanel (false, clip, 3), renderPanel (true, clip, 3)));
+        }
+
+        beginTest ("Translated shapes re-use the same table");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::ARGB, 200, 200, true);
+            Graphics g (image);
+
+            Path p;
+            p.addStar (Point<float> (20.0f, 20.0f), 7, 8.0f, 19.0f);
+
+            for (int i = 0; i < 10; ++i)
+            {
+                g.fillPath (p, AffineTransform::translation ((float) (i * 13), (float) (i * 7)));
+                g.strokePath (p, PathStrokeType (2.0f), AffineTransform::translation (0.25f, 0.5f).translated ((float) (i * 5), 0.0f));
+            }
+
+            // each shape is hashed the second time it turns up, and kept the third time
+            const Cache::Statistics stats (state.cache.getStatistics());
+            expectEquals (stats.numEntries, 2);
+            expectEquals ((int) stats.hits, 14);
+            expectEquals ((int) stats.misses, 6);
+        }
+
+        beginTest ("Changing the transform or stroke makes a new entry");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::ARGB, 200, 200, true);
+            Graphics g (image);
+
+            Path p;
+            p.addEllipse (10.0f, 10.0f, 50.0f, 30.0f);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                g.fillPath (p);
+                g.fillPath (p, AffineTransform::scale (1.5f));
+                g.fillPath (p, AffineTransform::translation (0.5f, 0.0f));
+                g.strokePath (p, PathStrokeType (1.0f));
+                g.strokePath (p, PathStrokeType (2.0f));
+                g.strokePath (p, PathStrokeType (2.0f, PathStrokeType::beveled));
+            }
+
+            expectEquals (state.cache.getStatistics().numEntries, 6);
+            expectEquals ((int) state.cache.getStatistics().hits, 0);
+        }
+
+        beginTest ("Shapes with the same bounds are kept apart");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::ARGB, 100, 100, true);
+            Graphics g (image);
+
+            Path square, diamond;
+            square.addRectangle (10.0f, 10.0f, 40.0f, 40.0f);
+            diamond.addTriangle (30.0f, 10.0f, 50.0f, 30.0f, 10.0f, 30.0f);
+            diamond.addTriangle (10.0f, 30.0f, 50.0f, 30.0f, 30.0f, 50.0f);
+
+            for (int i = 0; i < 4; ++i)
+            {
+                g.fillPath (square);
+                g.fillPath (diamond);
+            }
+
+            // (the diamond gets hashed the first time, as the square has the same bounds)
+            expectEquals (state.cache.getStatistics().numEntries, 2);
+            expectEquals ((int) state.cache.getStatistics().hits, 3);
+        }
+
+        beginTest ("Shapes that are too big aren't kept");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::ARGB, 200, 200, true);
+            Graphics g (image);
+
+            Path big;
+            big.addEllipse (-3000.0f, 10.0f, 6000.0f, 100.0f);
+
+            Path small;
+            small.addEllipse (10.0f, 10.0f, 50.0f, 30.0f);
+
+            for (int i = 0; i < 5; ++i)
+            {
+                g.fillPath (big);
+                g.fillPath (small);
+            }
+
+            // (the entry's size includes its copy of the path, as well as its edge-table)
+            const Cache::Statistics stats (state.cache.getStatistics());
+            expectEquals (stats.numEntries, 1);
+            expectEquals ((int) stats.hits, 2);
+            expect (stats.numBytes > RenderingHelpers::CacheHelpers::getPathDataSize (small));
+        }
+
+        beginTest ("Memory limit");
+        {
+            const ScopedCacheState state (true);
+            state.cache.setMaximumSize (64 * 1024);
+
+            const RectangleList<int> clip (Rectangle<int> (0, 0, 760, 520));
+            Image image (Image::ARGB, 760, 520, true);
+
+            for (int frame = 0; frame < 3; ++frame)
+            {
+                Graphics g (image);
+                drawPanel (g, frame, image.getWidth(), image.getHeight());
+            }
+
+            const Cache::Statistics stats (state.cache.getStatistics());
+            expect (stats.numBytes <= 64 * 1024);
+            expect (stats.numEntries > 0);
+        }
+
+        beginTest ("Vector UI redraw benchmark");
+        {
+            const RectangleList<int> clip (Rectangle<int> (0, 0, 760, 520));
+            const int numFrames = 30;
+
+            double start = Time::getMillisecondCounterHiRes();
+            renderPanel (false, clip, numFrames);
+            const double uncachedTime = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+
+            const ScopedCacheState state (true);
+            Image image (Image::ARGB, 760, 520, true);
+            start = Time::getMillisecondCounterHiRes();
+
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                Graphics g (image);
+                drawPanel (g, frame, image.getWidth(), image.getHeight());
+            }
+
+            const double cachedTime = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+            const Cache::Statistics stats (state.cache.getStatistics());
+
+            logMessage ("Uncached " + String (uncachedTime, 2) + " ms/frame, cached " + String (cachedTime, 2)
+                          + " ms/frame, hit rate " + String (stats.getHitRate() * 100.0, 1) + "%, "
+                          + String (stats.numEntries) + " entries using " + File::descriptionOfSizeInBytes ((int64) stats.numBytes));
+        }
+    }
+};
+
+static PathEdgeTableCacheTests pathEdgeTableCacheTests;
+
+//==============================================================================
+class GlyphCacheTests  : public UnitTest
+{
+public:
+    GlyphCacheTests() : UnitTest ("RenderingHelpers::GlyphCache") {}
+
+    typedef RenderingHelpers::SoftwareRendererSavedState::GlyphCacheType Cache;
+    typedef RenderingHelpers::SoftwareRendererSavedState::CachedGlyphType Glyph;
+
+    // A screenful of log output in a couple of fonts, the kind of thing a text-heavy UI redraws
+    static void drawLog (Graphics& g, int w, int h, int frame)
+    {
+        g.fillAll (Colours::black);
+
+        const Font fonts[] = { Font (Font::getDefaultMonospacedFontName(), 12.0f, Font::plain),
+                               Font (Font::getDefaultMonospacedFontName(), 12.0f, Font::bold),
+                               Font (14.0f), Font (11.0f, Font::italic) };
+
+        const int lineHeight = 14;
+
+        for (int line = 0; line * lineHeight < h; ++line)
+        {
+            const int n = line + frame;
+            g.setFont (fonts [n % numElementsInArray (fonts)]);
+            g.setColour (n % 5 == 0 ? Colours::orange : Colours::lightgrey);
+            g.drawSingleLineText ("[" + String (1000 + n) + "] worker " + String (n % 7) + ": processed block 0x"
+                                    + String::toHexString (n * 7919) + " in " + String (n % 97) + "." + String (n % 13)
+                                    + "ms, queue depth " + String (n % 31) + " {}()<>[]~!@#$%^&*",
+                                  4, line * lineHeight + 12);
+        }
+
+        ignoreUnused (w);
+    }
+
+    static Image renderLog (int numFrames)
+    {
+        Image image (Image::ARGB, 800, 600, true);
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            Graphics g (image);
+            drawLog (g, image.getWidth(), image.getHeight(), frame);
+        }
+
+        return image;
+    }
+
+    struct ScopedCapacity
+    {
+        ScopedCapacity (int newCapacity) : cache (Cache::getInstance()), oldCapacity (cache.getCapacity())
+        {
+            cache.reset();
+            cache.setCapacity (newCapacity);
+        }
+
+        ~ScopedCapacity()
+        {
+            cache.setCapacity (oldCapacity);
+            cache.reset();
+        }
+
+        Cache& cache;
+        const int oldCapacity;
+    };
+
+    class LookupThread  : public Thread
+    {
+    public:
+        LookupThread (Cache& c, int seed)  : Thread ("glyph lookups"), cache (c), random (seed), numWrong (0) {}
+
+        void run() override
+        {
+            const Font fonts[] = { Font (10.0f), Font (13.0f, Font::bold), Font (17.0f) };
+
+            for (int i = 0; i < 3000; ++i)
+            {
+                const Font& font = fonts [random.nextInt (numElementsInArray (fonts))];
+                const int glyphNumber = random.nextInt (60) + 30;
+
+                ReferenceCountedObjectPtr<Glyph> glyph (cache.findOrCreateGlyph (font, glyphNumber));
+
+                if (glyph == nullptr || glyph->glyph != glyphNumber || glyph->font != font)
+                    ++numWrong;
+            }
+        }
+
+        Cache& cache;
+        Random random;
+        int numWrong;
+    };
+
+    void runTest() override
+    {
+        const Font font (15.0f);
+
+        beginTest ("Hits and misses");
+        {
+            Cache cache;
+            Array<int> glyphs;
+            Array<float> xOffsets;
+            font.getGlyphPositions ("hello world", glyphs, xOffsets);
+
+            for (int pass = 0; pass < 2; ++pass)
+                for (int i = 0; i < glyphs.size(); ++i)
+                    cache.findOrCreateGlyph (font, glyphs[i]);
+
+            // h, e, l, o, space, w, r, d
+            const Cache::Statistics stats (cache.getStatistics());
+            expectEquals (stats.numGlyphs, 8);
+            expectEquals ((int) stats.misses, 8);
+            expectEquals ((int) stats.hits, 2 * glyphs.size() - 8);
+
+            cache.resetStatistics();
+            expectEquals ((int) cache.getStatistics().hits, 0);
+
+            cache.reset();
+            expectEquals (cache.getStatistics().numGlyphs, 0);
+        }
+
+        beginTest ("Equal fonts share glyphs");
+        {
+            Cache cache;
+            cache.findOrCreateGlyph (font, 40);
+
+            // (this font is equal to the first, but ends up with a typeface object of its own)
+            Typeface::clearTypefaceCache();
+            const Font equalFont (15.0f);
+            expect (equalFont == font && equalFont.getTypeface() != font.getTypeface());
+
+            cache.resetStatistics();
+            cache.findOrCreateGlyph (equalFont, 40);
+            expectEquals ((int) cache.getStatistics().hits, 1);
+            expectEquals (cache.getStatistics().numGlyphs, 1);
+        }
+
+        beginTest ("Least-recently-used glyphs are evicted");
+        {
+            Cache cache;
+            cache.setCapacity (32);
+
+            ReferenceCountedObjectPtr<Glyph> held (cache.findOrCreateGlyph (Font (9.0f), 40));
+
+            for (int i = 0; i < 400; ++i)
+                cache.findOrCreateGlyph (Font (10.0f + (i % 20)), 40 + i / 20);
+
+            expectLessOrEqual (cache.getStatistics().numGlyphs, 32);
+
+            cache.resetStatistics();
+            cache.findOrCreateGlyph (Font (10.0f + (399 % 20)), 40 + 399 / 20);
+            expectEquals ((int) cache.getStatistics().hits, 1);
+
+            for (int i = 0; i < 100; ++i)
+                cache.findOrCreateGlyph (Font (10.0f + (i % 20)), 40 + i / 20);
+
+            expectEquals ((int) cache.getStatistics().hits, 1);
+
+            // a glyph that someone is still holding is never recycled
+            expect (cache.findOrCreateGlyph (Font (9.0f), 40) == held);
+            expect (held->font == Font (9.0f) && held->glyph == 40);
+
+            // shrinking the capacity discards glyphs straight away
+            cache.setCapacity (8);
+            expectLessOrEqual (cache.getStatistics().numGlyphs, 8);
+        }
+
+        beginTest ("Pre-warming");
+        {
+            Cache cache;
+            expectEquals (cache.prewarm (font, "abc"), 3);
+            expectEquals (cache.prewarm (font, 'a', 'z'), 23);
+            expectEquals (cache.prewarm (font, "cab"), 0);
+
+            const Cache::Statistics stats (cache.getStatistics());
+            expectEquals (stats.numGlyphs, 26);
+            expectEquals ((int) (stats.hits + stats.misses), 0);
+
+            cache.prewarm (font, " ");
+
+            Array<int> glyphs;
+            Array<float> xOffsets;
+            font.getGlyphPositions ("the quick brown fox jumps over the lazy dog", glyphs, xOffsets);
+
+            for (int i = 0; i < glyphs.size(); ++i)
+                cache.findOrCreateGlyph (font, glyphs[i]);
+
+            expectEquals ((int) cache.getStatistics().misses, 0);
+        }
+
+        beginTest ("Lookups from several threads");
+        {
+            Cache cache;
+            cache.setCapacity (64);
+
+            OwnedArray<LookupThread> threads;
+
+            for (int i = 0; i < 4; ++i)
+                threads.add (new LookupThread (cache, i + 1))->startThread();
+
+            int numWrong = 0;
+
+            for (int i = 0; i < threads.size(); ++i)
+            {
+                threads[i]->waitForThreadToExit (-1);
+                numWrong += threads[i]->numWrong;
+            }
+
+            expectEquals (numWrong, 0);
+            expectLessOrEqual (cache.getStatistics().numGlyphs, 64);
+        }
+
+        beginTest ("Text is drawn identically whatever the capacity");
+        {
+            Image reference;
+
+            {
+                const ScopedCapacity sc (Cache::defaultCapacity);
+                reference = renderLog (2);
+            }
+
+            const ScopedCapacity sc (16);
+            expect (RenderingHelpers::imagesAreIdentical (renderLog (2), reference));
+            expectGreaterThan ((int) sc.cache.getStatistics().misses, 200);
+        }
+
+        beginTest ("Benchmark: text rendering");
+        {
+            const int numFrames = 20;
+            const int capacities[] = { 120, Cache::defaultCapacity };
+
+            for (int i = 0; i < numElementsInArray (capacities); ++i)
+            {
+                const ScopedCapacity sc (capacities[i]);
+                renderLog (1);
+                sc.cache.resetStatistics();
+
+                const double start = Time::getMillisecondCounterHiRes();
+                renderLog (numFrames);
+                const double elapsed = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+                const Cache::Statistics stats (sc.cache.getStatistics());
+
+                logMessage ("Capacity " + String (capacities[i]) + ": " + String (elapsed, 2) + " ms per 800x600 frame of text, hit rate "
+                              + String (stats.getHitRate() * 100.0, 1) + "%, " + String (stats.numGlyphs) + " glyphs cached");
+            }
+        }
+    }
+};
+
+static GlyphCacheTests glyphCacheTests;
+
+//==============================================================================
+class GlyphArrangementCacheTests  : public UnitTest
+{
+public:
+    GlyphArrangementCacheTests() : UnitTest ("RenderingHelpers::GlyphArrangementCache") {}
+
+    typedef RenderingHelpers::GlyphArrangementCache Cache;
+    typedef RenderingHelpers::CacheHelpers::ScopedCacheState<Cache, int> ScopedCacheState;
+
+    // Uses every entry point that goes through the cache
+    static void drawLabels (Graphics& g)
+    {
+        g.fillAll (Colours::white);
+        g.setColour (Colours::black);
+
+        for (int i = 0; i < 20; ++i)
+        {
+            g.setFont (Font (10.0f + (i % 4) * 2.0f, i % 3 == 0 ? Font::bold : Font::plain));
+            const String label ("Label " + String (i % 5) + " with some text");
+
+            g.drawText (label, 5, i * 20, 90, 18, Justification::centred, true);
+            g.drawText (label, Rectangle<float> (100.5f, i * 20.25f, 70.0f, 18.0f), Justification::right, false);
+            g.drawFittedText (label + " that needs fitting", 180, i * 20, 60, 18, Justification::centredLeft, 2, 0.7f);
+            g.drawSingleLineText (label, 330, i * 20 + 14, Justification::horizontallyCentred);
+            g.drawSingleLineText (label, 500, i * 20 + 14, Justification::right);
+        }
+
+        g.drawMultiLineText ("A longer piece of text that will be broken into lines, "
+                             "so that multi-line layouts get cached too.", 520, 20, 120);
+    }
+
+    static Image renderLabels (bool useCache, int numFrames)
+    {
+        const ScopedCacheState state (useCache);
+        Image image (Image::RGB, 650, 420, true);
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            Graphics g (image);
+            drawLabels (g);
+        }
+
+        return image;
+    }
+
+    void runTest() override
+    {
+        beginTest ("Cached layouts are drawn identically");
+        expect (RenderingHelpers::imagesAreIdentical (renderLabels (false, 1), renderLabels (true, 3)));
+
+        beginTest ("Repeated text is laid out once");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::RGB, 650, 420, true);
+
+            for (int frame = 0; frame < 3; ++frame)
+            {
+                Graphics g (image);
+                drawLabels (g);
+            }
+
+            // every call in a frame draws something different, so each frame after the first is all hits
+            const Cache::Statistics stats (state.cache.getStatistics());
+            expectEquals (stats.numEntries, 101);
+            expectEquals ((int) stats.misses, 101);
+            expectEquals ((int) stats.hits, 202);
+        }
+
+        beginTest ("Anything that affects the layout makes a new entry");
+        {
+            const ScopedCacheState state (true);
+            Image image (Image::RGB, 200, 200, true);
+            Graphics g (image);
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                g.setFont (12.0f);
+                g.drawText ("abc", 0, 0, 100, 20, Justification::left, true);
+                g.drawText ("abc", 0, 0, 100, 20, Justification::right, true);
+                g.drawText ("abc", 0, 0, 100, 20, Justification::left, false);
+                g.drawText ("abc", 0, 0, 101, 20, Justification::left, true);
+                g.drawText ("abd", 0, 0, 100, 20, Justification::left, true);
+                g.drawFittedText ("abc", 0, 0, 100, 20, Justification::left, 1);
+                g.setFont (13.0f);
+                g.drawText ("abc", 0, 0, 100, 20, Justification::left, true);
+            }
+
+            expectEquals (state.cache.getStatistics().numEntries, 7);
+            expectEquals ((int) state.cache.getStatistics().hits, 7);
+        }
+
+        beginTest ("Size limit");
+        {
+            const ScopedCacheState state (true);
+            state.cache.setMaximumSize (500);
+
+            Image image (Image::RGB, 200, 200, true);
+            Graphics g (image);
+
+            for (int i = 0; i < 1000; ++i)
+                g.drawText ("Item " + String (i), 0, 0, 100, 20, Justification::left, true);
+
+            expectLessOrEqual (state.cache.getStatistics().numGlyphs, 500);
+            expectGreaterThan (state.cache.getStatistics().numEntries, 10);
+        }
+    }
+};
+
+static GlyphArrangementCacheTests glyphArrangementCacheTests;
+
+#endif
@@ -136,19 +136,26 @@ public:
 };
 
 //==============================================================================
-/** Holds a cache of recently-used glyph objects of some type. */
+/** Holds a cache of recently-used glyph objects of some type.
+
+    The glyphs are spread across several independently-locked shards by a hash of their
+    font and glyph number, so that threads drawing text at the same time rarely have to
+    wait for each other. Each shard discards its least-recently-used glyphs once the
+    cache is full.
+*/
 template <class CachedGlyphType, class RenderTargetType>
 class GlyphCache  : private DeletedAtShutdown
 {
 public:
     GlyphCache()
     {
-        reset();
+        setCapacity (defaultCapacity);
     }
 
     ~GlyphCache()
     {
-        getSingletonPointer() = nullptr;
+        if (getSingletonPointer() == this)
+            getSingletonPointer() = nullptr;
     }
 
     static GlyphCache& getInstance()
@@ -162,104 +169,318 @@ public:
     }
 
     //==============================================================================
+    enum { defaultCapacity = 1024 };
+
+    /** Removes all the cached glyphs and resets the statistics. */
     void reset()
     {
-        const ScopedLock sl (lock);
-        glyphs.clear();
-        addNewGlyphSlots (120);
-        hits.set (0);
-        misses.set (0);
+        for (int i = 0; i < numShards; ++i)
+            shards[i].clear();
+    }
+
+    /** Sets the number of glyphs that will be kept.
+
+        If more than this are being held by callers (e.g. a deferred renderer that
+        hasn't finished drawing), the cache grows past it until they're released.
+    */
+    void setCapacity (int maxNumGlyphs)
+    {
+        jassert (maxNumGlyphs > 0);
+        const int newCapacity = jmax ((int) numShards, maxNumGlyphs);
+        capacity = newCapacity;
+
+        for (int i = 0; i < numShards; ++i)
+            shards[i].setCapacity ((newCapacity + numShards - 1) / numShards);
     }
 
+    int getCapacity() const noexcept                { return capacity.get(); }
+
     void drawGlyph (RenderTargetType& target, const Font& font, const int glyphNumber, Point<float> pos)
     {
         if (ReferenceCountedObjectPtr<CachedGlyphType> glyph = findOrCreateGlyph (font, glyphNumber))
-        {
-            glyph->lastAccessCount = ++accessCounter;
             glyph->draw (target, pos);
-        }
     }
 
+    /** Returns the cached glyph for a font, generating it if necessary.
+        A glyph won't be recycled for another font while something still holds a
+        reference to it, so the caller can safely draw it after the lock is released.
+    */
     ReferenceCountedObjectPtr<CachedGlyphType> findOrCreateGlyph (const Font& font, int glyphNumber)
     {
-        const ScopedLock sl (lock);
+        const uint32 hash = getHash (font, glyphNumber);
+        bool wasCreated;
+        return shards [hash >> (32 - shardBits)].findOrCreate (font, glyphNumber, hash, true, wasCreated);
+    }
+
+    /** Generates the glyphs needed to draw some text, so that drawing it later won't
+        have to wait for them to be rendered.
+
+        The font must be the one that the glyphs will actually be rendered with, i.e. with
+        any scaling of the graphics context (such as the display's scale factor) applied
+        to its height.
 
-        if (CachedGlyphType* g = findExistingGlyph (font, glyphNumber))
+        @returns the number of glyphs that weren't already cached
+    */
+    int prewarm (const Font& font, const String& text)
+    {
+        Array<int> glyphNumbers;
+        Array<float> xOffsets;
+        font.getGlyphPositions (text, glyphNumbers, xOffsets);
+
+        int numAdded = 0;
+
+        for (int i = 0; i < glyphNumbers.size(); ++i)
         {
-            ++hits;
-            return g;
+            const int glyphNumber = glyphNumbers.getUnchecked (i);
+            const uint32 hash = getHash (font, glyphNumber);
+            bool wasCreated;
+
+            shards [hash >> (32 - shardBits)].findOrCreate (font, glyphNumber, hash, false, wasCreated);
+
+            if (wasCreated)
+                ++numAdded;
         }
 
-        ++misses;
-        CachedGlyphType* g = getGlyphForReuse();
-        jassert (g != nullptr);
-        g->generate (font, glyphNumber);
-        return g;
+        return numAdded;
     }
 
-private:
-    friend struct ContainerDeletePolicy<CachedGlyphType>;
-    ReferenceCountedArray<CachedGlyphType> glyphs;
-    Atomic<int> accessCounter, hits, misses;
-    CriticalSection lock;
+    /** Generates the glyphs for a range of characters.
+        @see prewarm
+    */
+    int prewarm (const Font& font, juce_wchar firstCharacter, juce_wchar lastCharacter)
+    {
+        String text;
+        text.preallocateBytes ((size_t) (lastCharacter - firstCharacter + 1) * 4);
+
+        for (juce_wchar c = firstCharacter; c <= lastCharacter; ++c)
+            text += c;
 
-    CachedGlyphType* findExistingGlyph (const Font& font, int glyphNumber) const
+        return prewarm (font, text);
+    }
+
+    struct Statistics
     {
-        for (int i = 0; i < glyphs.size(); ++i)
-        {
-            CachedGlyphType* const g = glyphs.getUnchecked (i);
+        int64 hits, misses;
+        int numGlyphs;
+
+        double getHitRate() const noexcept      { return hits + misses > 0 ? hits / (double) (hits + misses) : 0.0; }
+    };
+
+    Statistics getStatistics() const
+    {
+        Statistics stats = { 0, 0, 0 };
 
-            if (g->glyph == glyphNumber && g->font == font)
-                return g;
+        for (int i = 0; i < numShards; ++i)
+        {
+            const ScopedLock sl (shards[i].lock);
+            stats.hits += shards[i].hits;
+            stats.misses += shards[i].misses;
+            stats.numGlyphs += shards[i].entries.size();
         }
 
-        return nullptr;
+        return stats;
     }
 
-    CachedGlyphType* getGlyphForReuse()
+    void resetStatistics()
     {
-        if (hits.value + misses.value > glyphs.size() * 16)
+        for (int i = 0; i < numShards; ++i)
         {
-            if (misses.value * 2 > hits.value)
-                addNewGlyphSlots (32);
-
-            hits.set (0);
-            misses.set (0);
+            const ScopedLock sl (shards[i].lock);
+            shards[i].hits = shards[i].misses = 0;
         }
+    }
 
-        if (CachedGlyphType* g = findLeastRecentlyUsedGlyph())
-            return g;
+private:
+    friend struct ContainerDeletePolicy<CachedGlyphType>;
 
-        addNewGlyphSlots (32);
-        return glyphs.getLast();
-    }
+    enum { shardBits = 3, numShards = 1 << shardBits };
 
-    void addNewGlyphSlots (int num)
+    //==============================================================================
+    struct Entry
     {
-        glyphs.ensureStorageAllocated (glyphs.size() + num);
-
-        while (--num >= 0)
-            glyphs.add (new CachedGlyphType());
-    }
+        ReferenceCountedObjectPtr<CachedGlyphType> glyph;
+        uint32 hash;
+        Entry* nextInBucket;
+        Entry* lessRecent;
+        Entry* moreRecent;
+    };
 
-    CachedGlyphType* findLeastRecentlyUsedGlyph() const noexcept
+    // Each shard is a hash table whose entries are also kept in a list in order of use.
+    struct Shard
     {
-        CachedGlyphType* oldest = nullptr;
-        int oldestCounter = std::numeric_limits<int>::max();
+        Shard() : numBuckets (0), maxEntries (0), mostRecent (nullptr), leastRecent (nullptr), hits (0), misses (0) {}
+
+        // (the pointer that's returned must be created while the lock is held, so that the
+        // glyph can't be recycled before the caller gets its reference)
+        ReferenceCountedObjectPtr<CachedGlyphType> findOrCreate (const Font& font, int glyphNumber, uint32 hash,
+                                                                 bool countStatistics, bool& wasCreated)
+        {
+            const ScopedLock sl (lock);
+            wasCreated = false;
+
+            Entry** bucket = buckets + (hash & (uint32) (numBuckets - 1));
+
+            for (Entry* e = *bucket; e != nullptr; e = e->nextInBucket)
+            {
+                if (e->hash == hash && e->glyph->glyph == glyphNumber && e->glyph->font == font)
+                {
+                    if (countStatistics)
+                        ++hits;
+
+                    moveToFront (e);
+                    return e->glyph;
+                }
+            }
+
+            if (countStatistics)
+                ++misses;
+
+            wasCreated = true;
+            Entry* e = getEntryForReuse();
+            e->glyph->generate (font, glyphNumber);
+            e->hash = hash;
+            e->nextInBucket = *bucket;
+            *bucket = e;
+            linkAtFront (e);
+
+            return e->glyph;
+        }
+
+        void setCapacity (int newMaxEntries)
+        {
+            const ScopedLock sl (lock);
+            maxEntries = newMaxEntries;
+
+            for (Entry* e = leastRecent; e != nullptr && entries.size() > maxEntries;)
+            {
+                Entry* const next = e->moreRecent;
+
+                if (e->glyph->getReferenceCount() == 1)
+                {
+                    removeFromBucket (e);
+                    unlink (e);
+                    entries.removeObject (e);
+                }
+
+                e = next;
+            }
+
+            numBuckets = nextPowerOfTwo (jmax (16, maxEntries));
+            buckets.calloc ((size_t) numBuckets);
+
+            for (int i = 0; i < entries.size(); ++i)
+            {
+                Entry* const entry = entries.getUnchecked (i);
+                Entry** bucket = buckets + (entry->hash & (uint32) (numBuckets - 1));
+                entry->nextInBucket = *bucket;
+                *bucket = entry;
+            }
+        }
+
+        void clear()
+        {
+            const ScopedLock sl (lock);
+            entries.clear();
+            zeromem (buckets, sizeof (Entry*) * (size_t) numBuckets);
+            mostRecent = leastRecent = nullptr;
+            hits = misses = 0;
+        }
+
+        Entry* getEntryForReuse()
+        {
+            if (entries.size() >= maxEntries)
+            {
+                // (a glyph that someone's still holding can't be regenerated for a different font)
+                for (Entry* e = leastRecent; e != nullptr; e = e->moreRecent)
+                {
+                    if (e->glyph->getReferenceCount() == 1)
+                    {
+                        removeFromBucket (e);
+                        unlink (e);
+                        return e;
+                    }
+                }
+            }
+
+            Entry* const e = entries.add (new Entry());
+            e->glyph = new CachedGlyphType();
+            return e;
+        }
+
+        void removeFromBucket (Entry* e) noexcept
+        {
+            for (Entry** p = buckets + (e->hash & (uint32) (numBuckets - 1)); *p != nullptr; p = &((*p)->nextInBucket))
+            {
+                if (*p == e)
+                {
+                    *p = e->nextInBucket;
+                    break;
+                }
+            }
+        }
+
+        void linkAtFront (Entry* e) noexcept
+        {
+            e->lessRecent = mostRecent;
+            e->moreRecent = nullptr;
+
+            if (mostRecent != nullptr)
+                mostRecent->moreRecent = e;
+            else
+                leastRecent = e;
+
+            mostRecent = e;
+        }
 
-        for (int i = glyphs.size() - 1; --i >= 0;)
+        void unlink (Entry* e) noexcept
         {
-            CachedGlyphType* const glyph = glyphs.getUnchecked(i);
+            if (e->lessRecent != nullptr)  e->lessRecent->moreRecent = e->moreRecent;
+            else                           leastRecent = e->moreRecent;
+
+            if (e->moreRecent != nullptr)  e->moreRecent->lessRecent = e->lessRecent;
+            else                           mostRecent = e->lessRecent;
+        }
 
-            if (glyph->lastAccessCount <= oldestCounter
-                 && glyph->getReferenceCount() == 1)
+        void moveToFront (Entry* e) noexcept
+        {
+            if (e != mostRecent)
             {
-                oldestCounter = glyph->lastAccessCount;
-                oldest = glyph;
+                unlink (e);
+                linkAtFront (e);
             }
         }
 
-        return oldest;
+        CriticalSection lock;
+        OwnedArray<Entry> entries;
+        HeapBlock<Entry*> buckets;
+        int numBuckets, maxEntries;
+        Entry* mostRecent;
+        Entry* leastRecent;
+        int64 hits, misses;
+
+        JUCE_DECLARE_NON_COPYABLE (Shard)
+    };
+
+    Shard shards [numShards];
+    Atomic<int> capacity;   // (set on one thread, but may be read by the others while they draw)
+
+    static uint32 getHash (const Font& font, int glyphNumber) noexcept
+    {
+        // This only uses things that Font::operator== compares, because fonts that are equal
+        // don't necessarily share a Typeface object (and asking for one may have to load it).
+        uint64 h = (uint64) (uint32) font.getTypefaceName().hashCode();
+        h = (h ^ (uint64) (uint32) font.getTypefaceStyle().hashCode()) * 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (uint64) floatBits (font.getHeight())) * 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (uint64) floatBits (font.getHorizontalScale())) * 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (uint64) (uint32) glyphNumber) * 0x9e3779b97f4a7c15ULL;
+        return (uint32) (h >> 32);
+    }
+
+    static uint32 floatBits (float f) noexcept
+    {
+        union { float asFloat; uint32 asInt; } u;
+        u.asFloat = f;
+        return u.asInt;
     }
 
     static GlyphCache*& getSingletonPointer() noexcept
@@ -277,7 +498,7 @@ template <class RendererType>
 class CachedGlyphEdgeTable  : public ReferenceCountedObject
 {
 public:
-    CachedGlyphEdgeTable() : glyph (0), lastAccessCount (0) {}
+    CachedGlyphEdgeTable() : glyph (0) {}
 
     void draw (RendererType& state, Point<float> pos) const
     {
@@ -303,7 +524,7 @@ public:
 
     Font font;
     ScopedPointer<EdgeTable> edgeTable;
-    int glyph, lastAccessCount;
+    int glyph;
     bool snapToIntegerCoordinate;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedGlyphEdgeTable)
@@ -463,6 +684,20 @@ namespace GradientPixelIterators
                             : lookupTable [jlimit (0, numEntries, (x * scale - start) >> (int) numScaleBits)];
         }
 
+        void getPixels (PixelARGB* dest, const int x, int numPixels) const noexcept
+        {
+            if (vertical)
+            {
+                while (--numPixels >= 0)
+                    *dest++ = linePix;
+            }
+            else
+            {
+                for (int pos = x * scale - start; --numPixels >= 0; pos += scale)
+                    *dest++ = lookupTable [jlimit (0, numEntries, pos >> (int) numScaleBits)];
+            }
+        }
+
     private:
         const PixelARGB* const lookupTable;
         const int numEntries;
@@ -509,6 +744,12 @@ namespace GradientPixelIterators
             return lookupTable [x >= maxDist ? numEntries : roundToInt (std::sqrt (x) * invScale)];
         }
 
+        void getPixels (PixelARGB* dest, int x, int numPixels) const noexcept
+        {
+            while (--numPixels >= 0)
+                *dest++ = getPixel (x++);
+        }
+
     protected:
         const PixelARGB* const lookupTable;
         const int numEntries;
@@ -553,6 +794,12 @@ namespace GradientPixelIterators
             return lookupTable [jmin (numEntries, roundToInt (std::sqrt (x) * invScale))];
         }
 
+        void getPixels (PixelARGB* dest, int x, int numPixels) const noexcept
+        {
+            while (--numPixels >= 0)
+                *dest++ = getPixel (x++);
+        }
+
     private:
         double tM10, tM00, lineYM01, lineYM11;
         const AffineTransform inverseTransform;
@@ -561,6 +808,80 @@ namespace GradientPixelIterators
     };
 }
 
+//==============================================================================
+/** Vectorised versions of the inner blending loops used by the EdgeTableFillers.
+
+    These only deal with tightly-packed ARGB pixels. The inline helpers return false when
+    they're given a format, stride or run-length that they don't handle, and the caller
+    then falls back to its normal per-pixel loop. When they do run, the results are
+    bit-for-bit identical to the PixelARGB::blend() code that they replace.
+
+    The SSE2, AVX2 or NEON implementation is chosen at runtime according to what the
+    CPU supports.
+*/
+namespace PixelSpans
+{
+    /** Runs shorter than this are left to the scalar code. */
+    enum { minimumRunLength = 4 };
+
+    /** Performs dest[i].blend (colour) for a run of pixels. */
+    void blendColour (PixelARGB* dest, PixelARGB colour, int numPixels) noexcept;
+
+    /** Performs dest[i].blend (src[i]) for a run of pixels. */
+    void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels) noexcept;
+
+    /** Performs dest[i].blend (src[i], extraAlpha) for a run of pixels. */
+    void blendPixels (PixelARGB* dest, const PixelARGB* src, int numPixels, uint32 extraAlpha) noexcept;
+
+    /** Fills a run of pixels with the same bilinear-interpolated samples as
+        TransformedImageFill::render4PixelAverage().
+
+        The positions are pairs of (x, y) source coordinates in 1/256ths of a pixel, which
+        must all lie inside the image with room for the pixel to their right and below.
+    */
+    void resampleBilinear (PixelARGB* dest, const Image::BitmapData& src, const int* hiResPositions, int numPixels) noexcept;
+
+    /** Performs dest[i] += src[i] * multiplier for a run of floats, as used by the image filters. */
+    void multiplyAdd (float* dest, const float* src, float multiplier, int num) noexcept;
+
+    //==============================================================================
+    template <class DestPixelType>
+    forcedinline bool blend (DestPixelType*, int, PixelARGB, int) noexcept    { return false; }
+
+    template <class DestPixelType, class SrcPixelType>
+    forcedinline bool blend (DestPixelType*, int, const SrcPixelType*, int, int) noexcept    { return false; }
+
+    template <class DestPixelType, class SrcPixelType>
+    forcedinline bool blend (DestPixelType*, int, const SrcPixelType*, int, int, uint32) noexcept    { return false; }
+
+    forcedinline bool blend (PixelARGB* dest, int destStride, PixelARGB colour, int numPixels) noexcept
+    {
+        if (destStride != (int) sizeof (PixelARGB) || numPixels < minimumRunLength)
+            return false;
+
+        blendColour (dest, colour, numPixels);
+        return true;
+    }
+
+    forcedinline bool blend (PixelARGB* dest, int destStride, const PixelARGB* src, int srcStride, int numPixels) noexcept
+    {
+        if (destStride != (int) sizeof (PixelARGB) || srcStride != (int) sizeof (PixelARGB) || numPixels < minimumRunLength)
+            return false;
+
+        blendPixels (dest, src, numPixels);
+        return true;
+    }
+
+    forcedinline bool blend (PixelARGB* dest, int destStride, const PixelARGB* src, int srcStride, int numPixels, uint32 extraAlpha) noexcept
+    {
+        if (destStride != (int) sizeof (PixelARGB) || srcStride != (int) sizeof (PixelARGB) || numPixels < minimumRunLength)
+            return false;
+
+        blendPixels (dest, src, numPixels, extraAlpha);
+        return true;
+    }
+}
+
 #define JUCE_PERFORM_PIXEL_OP_LOOP(op) \
 { \
     const int destStride = destData.pixelStride;  \
@@ -652,7 +973,8 @@ namespace EdgeTableFillers
 
         inline void blendLine (PixelType* dest, const PixelARGB colour, int width) const noexcept
         {
-            JUCE_PERFORM_PIXEL_OP_LOOP (blend (colour))
+            if (! PixelSpans::blend (dest, destData.pixelStride, colour, width))
+                JUCE_PERFORM_PIXEL_OP_LOOP (blend (colour))
         }
 
         forcedinline void replaceLine (PixelRGB* dest, const PixelARGB colour, int width) const noexcept
@@ -749,6 +1071,9 @@ namespace EdgeTableFillers
         {
             PixelType* dest = getPixel (x);
 
+            if (blendSpans (dest, x, width, alphaLevel))
+                return;
+
             if (alphaLevel < 0xff)
                 JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++), (uint32) alphaLevel))
             else
@@ -758,7 +1083,9 @@ namespace EdgeTableFillers
         void handleEdgeTableLineFull (int x, int width) const noexcept
         {
             PixelType* dest = getPixel (x);
-            JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++)))
+
+            if (! blendSpans (dest, x, width, 0xff))
+                JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++)))
         }
 
     private:
@@ -770,6 +1097,35 @@ namespace EdgeTableFillers
             return addBytesToPointer (linePixels, x * destData.pixelStride);
         }
 
+        template <class DestPixelType>
+        forcedinline bool blendSpans (DestPixelType*, int, int, int) const noexcept    { return false; }
+
+        bool blendSpans (PixelARGB* dest, int x, int width, const int alphaLevel) const noexcept
+        {
+            if (destData.pixelStride != (int) sizeof (PixelARGB) || width < PixelSpans::minimumRunLength)
+                return false;
+
+            PixelARGB span [128];
+
+            while (width > 0)
+            {
+                const int num = jmin (width, (int) numElementsInArray (span));
+
+                GradientType::getPixels (span, x, num);
+
+                if (alphaLevel < 0xff)
+                    PixelSpans::blendPixels (dest, span, num, (uint32) alphaLevel);
+                else
+                    PixelSpans::blendPixels (dest, span, num);
+
+                x += num;
+                dest += num;
+                width -= num;
+            }
+
+            return true;
+        }
+
         JUCE_DECLARE_NON_COPYABLE (Gradient)
     };
 
@@ -833,7 +1189,10 @@ namespace EdgeTableFillers
                 jassert (x >= 0 && x + width <= srcData.width);
 
                 if (alphaLevel < 0xfe)
-                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++), (uint32) alphaLevel))
+                {
+                    if (! PixelSpans::blend (dest, destData.pixelStride, getSrcPixel (x), srcData.pixelStride, width, (uint32) alphaLevel))
+                        JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++), (uint32) alphaLevel))
+                }
                 else
                     copyRow (dest, getSrcPixel (x), width);
             }
@@ -856,7 +1215,10 @@ namespace EdgeTableFillers
                 jassert (x >= 0 && x + width <= srcData.width);
 
                 if (extraAlpha < 0xfe)
-                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++), (uint32) extraAlpha))
+                {
+                    if (! PixelSpans::blend (dest, destData.pixelStride, getSrcPixel (x), srcData.pixelStride, width, (uint32) extraAlpha))
+                        JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++), (uint32) extraAlpha))
+                }
                 else
                     copyRow (dest, getSrcPixel (x), width);
             }
@@ -902,7 +1264,7 @@ namespace EdgeTableFillers
             {
                 memcpy (dest, src, (size_t) (width * srcStride));
             }
-            else
+            else if (! PixelSpans::blend (dest, destStride, src, srcStride, width))
             {
                 do
                 {
@@ -933,7 +1295,8 @@ namespace EdgeTableFillers
               quality (q),
               maxX (src.width  - 1),
               maxY (src.height - 1),
-              scratchSize (2048)
+              scratchSize (2048),
+              positionsSize (0)
         {
             scratchBuffer.malloc (scratchSize);
         }
@@ -976,9 +1339,15 @@ namespace EdgeTableFillers
             alphaLevel >>= 8;
 
             if (alphaLevel < 0xfe)
-                JUCE_PERFORM_PIXEL_OP_LOOP (blend (*span++, (uint32) alphaLevel))
+            {
+                if (! PixelSpans::blend (dest, destData.pixelStride, span, (int) sizeof (SrcPixelType), width, (uint32) alphaLevel))
+                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*span++, (uint32) alphaLevel))
+            }
             else
-                JUCE_PERFORM_PIXEL_OP_LOOP (blend (*span++))
+            {
+                if (! PixelSpans::blend (dest, destData.pixelStride, span, (int) sizeof (SrcPixelType), width))
+                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*span++))
+            }
         }
 
         forcedinline void handleEdgeTableLineFull (const int x, int width) noexcept
@@ -1014,6 +1383,11 @@ namespace EdgeTableFillers
         {
             this->interpolator.setStartOfLine ((float) x, (float) y, numPixels);
 
+            if (quality != Graphics::lowResamplingQuality && ! repeatPattern
+                 && numPixels >= PixelSpans::minimumRunLength
+                 && generateBilinear (dest, x, numPixels))
+                return;
+
             do
             {
                 int hiResX, hiResY;
@@ -1083,6 +1457,40 @@ namespace EdgeTableFillers
             } while (--numPixels > 0);
         }
 
+        template <class PixelType>
+        forcedinline bool generateBilinear (PixelType*, int, int) noexcept    { return false; }
+
+        // When a whole span samples from inside the image, its positions can all be
+        // interpolated in one vectorised pass.
+        bool generateBilinear (PixelARGB* dest, const int x, const int numPixels) noexcept
+        {
+            if (numPixels > (int) positionsSize)
+            {
+                positionsSize = (size_t) numPixels;
+                positions.malloc (positionsSize * 2);
+            }
+
+            int* p = positions;
+
+            for (int i = 0; i < numPixels; ++i)
+            {
+                int hiResX, hiResY;
+                this->interpolator.next (hiResX, hiResY);
+
+                if (! (isPositiveAndBelow (hiResX >> 8, maxX) && isPositiveAndBelow (hiResY >> 8, maxY)))
+                {
+                    this->interpolator.setStartOfLine ((float) x, (float) y, numPixels);
+                    return false;
+                }
+
+                *p++ = hiResX;
+                *p++ = hiResY;
+            }
+
+            PixelSpans::resampleBilinear (dest, srcData, positions, numPixels);
+            return true;
+        }
+
         //==============================================================================
         void render4PixelAverage (PixelARGB* const dest, const uint8* src, const int subPixelX, const int subPixelY) noexcept
         {
@@ -1292,72 +1700,40 @@ namespace EdgeTableFillers
             TransformedImageSpanInterpolator (const AffineTransform& transform,
                                               const float offsetFloat, const int offsetInt) noexcept
                 : inverseTransform (transform.inverted()),
+                  xStep (toFixedPoint (inverseTransform.mat00)),
+                  yStep (toFixedPoint (inverseTransform.mat10)),
                   pixelOffset (offsetFloat), pixelOffsetInt (offsetInt)
             {}
 
+            // Each position is worked out from the start of its line rather than from the start
+            // of the span, so a pixel always samples the same source position however the edge
+            // table happens to have split its line into spans.
             void setStartOfLine (float sx, float sy, const int numPixels) noexcept
             {
                 jassert (numPixels > 0);
+                ignoreUnused (numPixels);
 
-                sx += pixelOffset;
-                sy += pixelOffset;
-                float x1 = sx, y1 = sy;
-                sx += (float) numPixels;
-                inverseTransform.transformPoints (x1, y1, sx, sy);
+                const double lineY = sy + pixelOffset;
 
-                xBresenham.set ((int) (x1 * 256.0f), (int) (sx * 256.0f), numPixels, pixelOffsetInt);
-                yBresenham.set ((int) (y1 * 256.0f), (int) (sy * 256.0f), numPixels, pixelOffsetInt);
+                x = toFixedPoint (inverseTransform.mat01 * lineY + inverseTransform.mat02
+                                    + inverseTransform.mat00 * (double) pixelOffset) + xStep * (int64) sx;
+                y = toFixedPoint (inverseTransform.mat11 * lineY + inverseTransform.mat12
+                                    + inverseTransform.mat10 * (double) pixelOffset) + yStep * (int64) sx;
             }
 
-            void next (int& px, int& py) noexcept
+            forcedinline void next (int& px, int& py) noexcept
             {
-                px = xBresenham.n;  xBresenham.stepToNext();
-                py = yBresenham.n;  yBresenham.stepToNext();
+                px = (int) (x >> 16) + pixelOffsetInt;  x += xStep;
+                py = (int) (y >> 16) + pixelOffsetInt;  y += yStep;
             }
 
         private:
-            class BresenhamInterpolator
-            {
-            public:
-                BresenhamInterpolator() noexcept {}
-
-                void set (const int n1, const int n2, const int steps, const int offsetInt) noexcept
-                {
-                    numSteps = steps;
-                    step = (n2 - n1) / numSteps;
-                    remainder = modulo = (n2 - n1) % numSteps;
-                    n = n1 + offsetInt;
-
-                    if (modulo <= 0)
-                    {
-                        modulo += numSteps;
-                        remainder += numSteps;
-                        --step;
-                    }
-
-                    modulo -= numSteps;
-                }
-
-                forcedinline void stepToNext() noexcept
-                {
-                    modulo += remainder;
-                    n += step;
-
-                    if (modulo > 0)
-                    {
-                        modulo -= numSteps;
-                        ++n;
-                    }
-                }
-
-                int n;
-
-            private:
-                int numSteps, step, modulo, remainder;
-            };
+            // positions are held in 1/256ths of a pixel, with 16 bits of extra precision
+            static int64 toFixedPoint (double v) noexcept   { return (int64) std::floor (v * (256.0 * 65536.0)); }
 
             const AffineTransform inverseTransform;
-            BresenhamInterpolator xBresenham, yBresenham;
+            const int64 xStep, yStep;
+            int64 x, y;
             const float pixelOffset;
             const int pixelOffsetInt;
 
@@ -1375,6 +1751,8 @@ namespace EdgeTableFillers
         DestPixelType* linePixels;
         HeapBlock<SrcPixelType> scratchBuffer;
         size_t scratchSize;
+        HeapBlock<int> positions;
+        size_t positionsSize;
 
         JUCE_DECLARE_NON_COPYABLE (TransformedImageFill)
     };
@@ -1545,49 +1923,774 @@ namespace EdgeTableFillers
 }
 
 //==============================================================================
-template <class SavedStateType>
-struct ClipRegions
+/** Returns the area that a path should be rasterised into for it to be clipped to the
+    given bounds.
+
+    An EdgeTable clamps any edges that lie beyond its right-hand side onto its last pixel
+    column, which leaves that column very slightly less than fully covered. So that a pixel's
+    value never depends on how far the clip extends to its right (e.g. when the same drawing
+    is rendered in several horizontal strips), a path that crosses the right-hand edge of the
+    clip is rasterised across its own width and then clipped back afterwards.
+*/
+inline Rectangle<int> getPathRasterisingBounds (const Rectangle<int>& clipBounds, const Path& path, const AffineTransform& transform)
 {
-    class Base  : public SingleThreadedReferenceCountedObject
-    {
-    public:
-        Base() {}
-        virtual ~Base() {}
+    const int pathRight = path.getBoundsTransformed (transform).getSmallestIntegerContainer().getRight() + 1;
 
-        typedef ReferenceCountedObjectPtr<Base> Ptr;
+    if (pathRight <= clipBounds.getRight())
+        return clipBounds;
 
-        virtual Ptr clone() const = 0;
-        virtual Ptr applyClipTo (const Ptr& target) const = 0;
+    // (keeps the edge-table's sub-pixel coordinates within range for absurdly large paths)
+    return clipBounds.withRight (jmax (clipBounds.getRight(), jmin (pathRight, 0x3fffff)));
+}
 
-        virtual Ptr clipToRectangle (const Rectangle<int>&) = 0;
-        virtual Ptr clipToRectangleList (const RectangleList<int>&) = 0;
-        virtual Ptr excludeClipRectangle (const Rectangle<int>&) = 0;
-        virtual Ptr clipToPath (const Path&, const AffineTransform&) = 0;
-        virtual Ptr clipToEdgeTable (const EdgeTable& et) = 0;
-        virtual Ptr clipToImageAlpha (const Image&, const AffineTransform&, const Graphics::ResamplingQuality) = 0;
-        virtual void translate (Point<int> delta) = 0;
+//==============================================================================
+/** Bits and pieces that are shared by the renderers' caches of shapes, shadows and layouts.
 
-        virtual bool clipRegionIntersects (const Rectangle<int>&) const = 0;
-        virtual Rectangle<int> getClipBounds() const = 0;
+    These caches are all lazily-created singletons (see juce_DeclareSingleton) which may be
+    used by several rendering threads at once, and they all find their entries by a 64-bit
+    hash and throw away the least recently used ones when they get too big.
+*/
+namespace CacheHelpers
+{
+    /** The starting value for a hash that's built up with addToHash(). */
+    const uint64 initialHash = (uint64) 0xcbf29ce484222325ULL;
 
-        virtual void fillRectWithColour (SavedStateType&, const Rectangle<int>&, const PixelARGB colour, bool replaceContents) const = 0;
-        virtual void fillRectWithColour (SavedStateType&, const Rectangle<float>&, const PixelARGB colour) const = 0;
-        virtual void fillAllWithColour (SavedStateType&, const PixelARGB colour, bool replaceContents) const = 0;
-        virtual void fillAllWithGradient (SavedStateType&, ColourGradient&, const AffineTransform&, bool isIdentity) const = 0;
-        virtual void renderImageTransformed (SavedStateType&, const Image&, const int alpha, const AffineTransform&, Graphics::ResamplingQuality, bool tiledFill) const = 0;
-        virtual void renderImageUntransformed (SavedStateType&, const Image&, const int alpha, int x, int y, bool tiledFill) const = 0;
-    };
+    /** Adds a value to a 64-bit FNV-1a hash. */
+    inline void addToHash (uint64& hash, uint32 value) noexcept
+    {
+        hash = (hash ^ value) * (uint64) 0x100000001b3ULL;
+    }
 
-    //==============================================================================
-    class EdgeTableRegion  : public Base
+    inline void addToHash (uint64& hash, float value) noexcept
     {
-    public:
-        EdgeTableRegion (const EdgeTable& e)            : edgeTable (e) {}
-        EdgeTableRegion (const Rectangle<int>& r)       : edgeTable (r) {}
-        EdgeTableRegion (const Rectangle<float>& r)     : edgeTable (r) {}
-        EdgeTableRegion (const RectangleList<int>& r)   : edgeTable (r) {}
+        uint32 bits;
+        memcpy (&bits, &value, sizeof (bits));
+        addToHash (hash, bits);
+    }
+
+    inline void addToHash (uint64& hash, const AffineTransform& t) noexcept
+    {
+        addToHash (hash, t.mat00); addToHash (hash, t.mat01); addToHash (hash, t.mat02);
+        addToHash (hash, t.mat10); addToHash (hash, t.mat11); addToHash (hash, t.mat12);
+    }
+
+    inline void addToHash (uint64& hash, const Path& path) noexcept
+    {
+        addToHash (hash, (uint32) path.isUsingNonZeroWinding());
+
+        for (Path::Iterator i (path); i.next();)
+        {
+            addToHash (hash, (uint32) i.elementType);
+            addToHash (hash, i.x1); addToHash (hash, i.y1);
+            addToHash (hash, i.x2); addToHash (hash, i.y2);
+            addToHash (hash, i.x3); addToHash (hash, i.y3);
+        }
+    }
+
+    /** Returns roughly how much memory a copy of a path's elements takes up. */
+    inline size_t getPathDataSize (const Path& path) noexcept
+    {
+        size_t numFloats = 0;
+
+        // (each element is stored as a marker, followed by its coordinates)
+        for (Path::Iterator i (path); i.next();)
+        {
+            switch (i.elementType)
+            {
+                case Path::Iterator::quadraticTo:   numFloats += 5; break;
+                case Path::Iterator::cubicTo:       numFloats += 7; break;
+                case Path::Iterator::closePath:     numFloats += 1; break;
+                default:                            numFloats += 3; break;
+            }
+        }
+
+        return numFloats * sizeof (float);
+    }
+
+    struct AccessRecord
+    {
+        int64 lastAccessCount, key;
+
+        bool operator< (const AccessRecord& other) const noexcept   { return lastAccessCount < other.lastAccessCount; }
+    };
+
+    /** Throws away a cache's least recently used entries until the total size of the ones
+        that are left is no more than targetSize.
+
+        The map's values must be pointers to objects that have a lastAccessCount member, and
+        a getSize() method that returns the amount they add to totalSize.
+    */
+    template <typename EntryPtr, typename SizeType>
+    void removeLeastRecentlyUsed (HashMap<int64, EntryPtr>& entries, SizeType& totalSize, SizeType targetSize)
+    {
+        if (totalSize <= targetSize || entries.size() == 0)
+            return;
+
+        Array<AccessRecord> records;
+        records.ensureStorageAllocated (entries.size());
+
+        for (typename HashMap<int64, EntryPtr>::Iterator i (entries); i.next();)
+        {
+            const AccessRecord r = { i.getValue()->lastAccessCount, i.getKey() };
+            records.add (r);
+        }
+
+        std::sort (records.begin(), records.end());
+
+        for (int i = 0; i < records.size() && totalSize > targetSize; ++i)
+        {
+            const int64 key = records.getReference (i).key;
+            totalSize -= entries [key]->getSize();
+            entries.remove (key);
+        }
+    }
+
+   #if JUCE_UNIT_TESTS
+    /** Used by the unit tests to start with an empty cache, and put its settings back afterwards. */
+    template <class CacheType, typename SizeType = size_t>
+    struct ScopedCacheState
+    {
+        ScopedCacheState (bool enabled)
+            : cache (*CacheType::getInstance()), wasEnabled (cache.isEnabled()), originalSize (cache.getMaximumSize())
+        {
+            cache.clear();
+            cache.resetStatistics();
+            cache.setEnabled (enabled);
+        }
+
+        ~ScopedCacheState()
+        {
+            cache.setEnabled (wasEnabled);
+            cache.setMaximumSize (originalSize);
+            cache.clear();
+        }
+
+        CacheType& cache;
+        const bool wasEnabled;
+        const SizeType originalSize;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedCacheState)
+    };
+   #endif
+}
+
+#if JUCE_UNIT_TESTS
+/** Used by the unit tests to check that two ways of drawing something produce exactly the same pixels. */
+inline bool imagesAreIdentical (const Image& a, const Image& b)
+{
+    if (a.getBounds() != b.getBounds() || a.getFormat() != b.getFormat())
+        return false;
+
+    const Image::BitmapData da (a, Image::BitmapData::readOnly);
+    const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+    for (int y = 0; y < da.height; ++y)
+        if (memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (da.width * da.pixelStride)) != 0)
+            return false;
+
+    return true;
+}
+#endif
+
+//==============================================================================
+/** Keeps the rasterised edge-tables of paths that get filled or stroked over and over.
+
+    Things like meters, knobs and waveform overlays tend to redraw exactly the same shapes
+    on every frame. Once a shape has been drawn a few times with the same transform (and the
+    same stroke, for a stroked path), its EdgeTable is kept here, so that later draws skip the
+    stroking, flattening and scan-conversion. A cached table covers the whole shape, so it
+    can be used with any clip region, and a shape that has only moved by a whole number of
+    pixels re-uses the same table shifted into place.
+
+    Shapes that are only drawn once cost very little: a path's data isn't hashed until
+    something with the same bounds and drawing parameters has been drawn recently.
+
+    The cache is shared by all the software renderers, and throws away the least recently
+    used tables when it goes over its memory limit.
+*/
+class PathEdgeTableCache  : private DeletedAtShutdown
+{
+public:
+    PathEdgeTableCache()
+        : maxBytes (8 * 1024 * 1024), bytesUsed (0), accessCounter (0),
+          hits (0), misses (0), nextRecentBoundsIndex (0), nextRecentIndex (0), nextRejectedIndex (0),
+          enabled (1)
+    {
+        zeromem (recentBounds, sizeof (recentBounds));
+        zeromem (recentlySeen, sizeof (recentlySeen));
+        zeromem (rejected, sizeof (rejected));
+    }
+
+    ~PathEdgeTableCache()
+    {
+        clearSingletonInstance();
+    }
+
+    juce_DeclareSingleton (PathEdgeTableCache, false)
+
+    //==============================================================================
+    /** A cached shape. The edge-table is null until the shape has been rasterised. */
+    struct Entry  : public ReferenceCountedObject
+    {
+        Entry (const Path& p, const PathStrokeType& s, const AffineTransform& pt,
+               float accuracy, const AffineTransform& t, bool stroked, int64 boundsKey)
+            : path (p), strokeType (s), pathTransform (pt), transform (t),
+              extraAccuracy (accuracy), isStroke (stroked), lastAccessCount (0),
+              pathDataSize (CacheHelpers::getPathDataSize (p)), quickKey (boundsKey)
+        {
+        }
+
+        bool matches (const Path& p, const PathStrokeType* s, const AffineTransform& pt,
+                      float accuracy, const AffineTransform& t) const noexcept
+        {
+            return isStroke == (s != nullptr) && transform == t && path == p
+                    && (s == nullptr || (strokeType == *s && pathTransform == pt && extraAccuracy == accuracy));
+        }
+
+        size_t getSize() const noexcept
+        {
+            return sizeof (*this) + pathDataSize + (edgeTable != nullptr ? edgeTable->getAllocatedSize() : 0);
+        }
+
+        const Path path;
+        const PathStrokeType strokeType;
+        const AffineTransform pathTransform, transform;
+        const float extraAccuracy;
+        const bool isStroke;
+        ScopedPointer<EdgeTable> edgeTable;
+        int64 lastAccessCount;
+        const size_t pathDataSize;
+        const int64 quickKey;
+
+        JUCE_DECLARE_NON_COPYABLE (Entry)
+    };
+
+    typedef ReferenceCountedObjectPtr<Entry> EntryPtr;
+
+    /** Returns the cached edge-table for a filled path, if there is one.
+
+        If the path has been drawn with this transform before, this returns an entry whose
+        edge-table must be moved by the given whole-pixel offset, otherwise it returns nullptr
+        and the caller should rasterise the path itself.
+    */
+    EntryPtr findFilledPath (const Path& path, const AffineTransform& transform, Point<int>& offset)
+    {
+        return find (path, nullptr, AffineTransform(), 1.0f, transform, offset);
+    }
+
+    /** Returns the cached edge-table for a stroked path, if there is one.
+
+        The stroke parameters are the ones that would be passed to PathStrokeType::createStrokedPath(),
+        and the transform is the one that the resulting path would then be filled with.
+        @see findFilledPath
+    */
+    EntryPtr findStrokedPath (const Path& path, const PathStrokeType& strokeType, const AffineTransform& pathTransform,
+                              float extraAccuracy, const AffineTransform& transform, Point<int>& offset)
+    {
+        return find (path, &strokeType, pathTransform, extraAccuracy, transform, offset);
+    }
+
+    //==============================================================================
+    /** Returns the whole-pixel part of a transform's translation.
+
+        Shapes are always rasterised with just the fractional part of their translation,
+        and then moved by this amount, so that they come out the same wherever they're drawn.
+    */
+    static Point<int> getWholePixelOffset (const AffineTransform& t) noexcept
+    {
+        return Point<int> ((int) std::floor (t.getTranslationX()),
+                           (int) std::floor (t.getTranslationY()));
+    }
+
+    /** Changes the amount of memory that the cached tables may use. */
+    void setMaximumSize (size_t numBytes)
+    {
+        const ScopedLock sl (lock);
+        maxBytes = numBytes;
+        removeLeastRecentlyUsed (maxBytes);
+    }
+
+    size_t getMaximumSize() const noexcept          { return maxBytes; }
+
+    /** Turns the cache on or off; while it's off, every path is rasterised from scratch. */
+    void setEnabled (bool shouldBeEnabled) noexcept { enabled = shouldBeEnabled ? 1 : 0; }
+    bool isEnabled() const noexcept                 { return enabled.get() != 0; }
+
+    /** Removes all the cached tables. */
+    void clear()
+    {
+        const ScopedLock sl (lock);
+        entries.clear();
+        cachedQuickKeys.clear();
+        bytesUsed = 0;
+        zeromem (recentBounds, sizeof (recentBounds));
+        zeromem (recentlySeen, sizeof (recentlySeen));
+        zeromem (rejected, sizeof (rejected));
+    }
+
+    struct Statistics
+    {
+        int64 hits, misses;
+        int numEntries;
+        size_t numBytes;
+
+        double getHitRate() const noexcept      { return hits + misses > 0 ? hits / (double) (hits + misses) : 0.0; }
+    };
+
+    Statistics getStatistics() const
+    {
+        const ScopedLock sl (lock);
+        Statistics s = { hits, misses, entries.size(), bytesUsed };
+        return s;
+    }
+
+    void resetStatistics()
+    {
+        const ScopedLock sl (lock);
+        hits = misses = 0;
+    }
+
+private:
+    HashMap<int64, EntryPtr> entries;
+    HashMap<int64, bool> cachedQuickKeys;
+    size_t maxBytes, bytesUsed;
+    int64 accessCounter, hits, misses;
+    enum { numRecentBounds = 128, numRecentlySeen = 128, numRejected = 32 };
+    int64 recentBounds [numRecentBounds], recentlySeen [numRecentlySeen], rejected [numRejected];
+    int nextRecentBoundsIndex, nextRecentIndex, nextRejectedIndex;
+    Atomic<int> enabled;
+    CriticalSection lock;
+
+    static bool contains (const int64* keys, int numKeys, int64 key) noexcept
+    {
+        return std::find (keys, keys + numKeys, key) != keys + numKeys;
+    }
+
+    EntryPtr find (const Path& path, const PathStrokeType* strokeType, const AffineTransform& pathTransform,
+                   float extraAccuracy, const AffineTransform& transform, Point<int>& offset)
+    {
+        if (enabled.get() == 0)
+            return nullptr;
+
+        offset = getWholePixelOffset (transform);
+        const AffineTransform shapeTransform (transform.translated (-offset.toFloat()));
+
+        // Hashing the whole path costs about as much as a pass over its data, so a shape only gets
+        // that far if something with the same bounds and drawing parameters has turned up recently,
+        // or is already in the cache.
+        const int64 quickKey = createQuickKey (path, strokeType, pathTransform, extraAccuracy, shapeTransform);
+
+        {
+            const ScopedLock sl (lock);
+
+            if (! cachedQuickKeys.contains (quickKey) && ! contains (recentBounds, numRecentBounds, quickKey))
+            {
+                ++misses;
+                recentBounds [nextRecentBoundsIndex] = quickKey;
+                nextRecentBoundsIndex = (nextRecentBoundsIndex + 1) % numRecentBounds;
+                return nullptr;
+            }
+        }
+
+        const int64 key = createKey (path, strokeType, pathTransform, extraAccuracy, shapeTransform);
+
+        {
+            const ScopedLock sl (lock);
+
+            if (Entry* e = entries [key])
+            {
+                if (e->matches (path, strokeType, pathTransform, extraAccuracy, shapeTransform))
+                {
+                    ++hits;
+                    e->lastAccessCount = ++accessCounter;
+                    return e;
+                }
+
+                ++misses;
+                return nullptr;
+            }
+
+            ++misses;
+
+            // a shape needs to turn up twice before it's worth keeping, and one that has
+            // already turned out to be too big isn't rasterised for the cache again
+            if (contains (rejected, numRejected, key))
+                return nullptr;
+
+            if (! contains (recentlySeen, numRecentlySeen, key))
+            {
+                recentlySeen [nextRecentIndex] = key;
+                nextRecentIndex = (nextRecentIndex + 1) % numRecentlySeen;
+                return nullptr;
+            }
+        }
+
+        EntryPtr e (new Entry (path, strokeType != nullptr ? *strokeType : PathStrokeType (0.0f),
+                               pathTransform, extraAccuracy, shapeTransform, strokeType != nullptr, quickKey));
+        rasterise (*e);
+
+        const ScopedLock sl (lock);
+
+        if (e->edgeTable == nullptr)
+        {
+            rejected [nextRejectedIndex] = key;
+            nextRejectedIndex = (nextRejectedIndex + 1) % numRejected;
+            return nullptr;
+        }
+
+        if (Entry* existing = entries [key])
+            bytesUsed -= existing->getSize();
+
+        entries.set (key, e);
+        cachedQuickKeys.set (quickKey, true);
+        bytesUsed += e->getSize();
+        e->lastAccessCount = ++accessCounter;
+
+        // Going a quarter below the limit means that the entries only need sorting
+        // once in a while, rather than every time something new is added.
+        if (bytesUsed > maxBytes)
+            removeLeastRecentlyUsed (maxBytes - maxBytes / 4);
+
+        return e;
+    }
+
+    void removeLeastRecentlyUsed (size_t targetSize)
+    {
+        if (bytesUsed <= targetSize)
+            return;
+
+        CacheHelpers::removeLeastRecentlyUsed (entries, bytesUsed, targetSize);
+        cachedQuickKeys.clear();
+
+        for (HashMap<int64, EntryPtr>::Iterator i (entries); i.next();)
+            cachedQuickKeys.set (i.getValue()->quickKey, true);
+    }
+
+    void rasterise (Entry& e) const
+    {
+        Path stroke;
+
+        if (e.isStroke)
+            e.strokeType.createStrokedPath (stroke, e.path, e.pathTransform, e.extraAccuracy);
+
+        const Path& shape = e.isStroke ? stroke : e.path;
+        const Rectangle<int> shapeBounds (shape.getBoundsTransformed (e.transform).getSmallestIntegerContainer());
+
+        // huge shapes are usually clipped down to a small part of themselves, so they're
+        // better off being rasterised each time
+        if (shapeBounds.isEmpty() || shapeBounds.getWidth() > 4096 || shapeBounds.getHeight() > 4096)
+            return;
+
+        e.edgeTable = new EdgeTable (getPathRasterisingBounds (shapeBounds, shape, e.transform), shape, e.transform);
+        e.edgeTable->optimiseTable();
+
+        if (e.edgeTable->getAllocatedSize() > maxBytes / 8)
+            e.edgeTable = nullptr;
+    }
+
+    static int64 createKey (const Path& path, const PathStrokeType* strokeType, const AffineTransform& pathTransform,
+                            float extraAccuracy, const AffineTransform& transform) noexcept
+    {
+        using namespace CacheHelpers;
+
+        uint64 hash = initialHash;
+        addToHash (hash, transform);
+        addToHash (hash, path);
+
+        if (strokeType != nullptr)
+        {
+            addToHash (hash, strokeType->getStrokeThickness());
+            addToHash (hash, (uint32) strokeType->getJointStyle());
+            addToHash (hash, (uint32) strokeType->getEndStyle());
+            addToHash (hash, pathTransform);
+            addToHash (hash, extraAccuracy);
+        }
+
+        return (int64) hash;
+    }
+
+    /** A key that's much cheaper to work out than createKey(), as it only looks at the path's
+        bounds, but which is the same for all the shapes that createKey() could match.
+    */
+    static int64 createQuickKey (const Path& path, const PathStrokeType* strokeType, const AffineTransform& pathTransform,
+                                 float extraAccuracy, const AffineTransform& transform) noexcept
+    {
+        using namespace CacheHelpers;
+
+        const Rectangle<float> bounds (path.getBounds());
+        uint64 hash = initialHash;
+        addToHash (hash, transform);
+        addToHash (hash, (uint32) path.isUsingNonZeroWinding());
+        addToHash (hash, bounds.getX());     addToHash (hash, bounds.getY());
+        addToHash (hash, bounds.getWidth()); addToHash (hash, bounds.getHeight());
+
+        if (strokeType != nullptr)
+        {
+            addToHash (hash, strokeType->getStrokeThickness());
+            addToHash (hash, (uint32) strokeType->getJointStyle());
+            addToHash (hash, (uint32) strokeType->getEndStyle());
+            addToHash (hash, pathTransform);
+            addToHash (hash, extraAccuracy);
+        }
+
+        return (int64) hash;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PathEdgeTableCache)
+};
+
+//==============================================================================
+/** Keeps the glyph arrangements that the Graphics text-drawing methods lay out, so that
+    text which is drawn the same way again doesn't have to be shaped and broken into
+    lines again.
+
+    An arrangement is found by the method that made it, and all the parameters that
+    were passed to it: the font, the string and the position and size of the area.
+    Components are drawn at their own origin, so the same label in the same place in
+    many rows of a table will share one entry.
+*/
+class GlyphArrangementCache  : private DeletedAtShutdown
+{
+public:
+    GlyphArrangementCache()
+        : maxGlyphs (100000), numGlyphs (0), accessCounter (0), hits (0), misses (0), enabled (1)
+    {
+    }
+
+    ~GlyphArrangementCache()
+    {
+        clearSingletonInstance();
+    }
+
+    juce_DeclareSingleton (GlyphArrangementCache, false)
+
+    //==============================================================================
+    /** The Graphics methods whose layouts are cached. */
+    enum LayoutType
+    {
+        singleLineText,
+        multiLineText,
+        curtailedText,
+        fittedText
+    };
+
+    /** Everything that affects the way a piece of text gets laid out. */
+    struct Key
+    {
+        Key (LayoutType t, const Font& f, const String& s, Rectangle<float> a,
+             int flags, int maxLines, float minScale)
+            : type (t), font (f), text (s), area (a),
+              justificationFlags (flags), maximumLines (maxLines), minimumHorizontalScale (minScale)
+        {
+        }
+
+        bool operator== (const Key& other) const noexcept
+        {
+            return type == other.type && area == other.area
+                    && justificationFlags == other.justificationFlags
+                    && maximumLines == other.maximumLines
+                    && minimumHorizontalScale == other.minimumHorizontalScale
+                    && font == other.font && text == other.text;
+        }
+
+        int64 getHash() const noexcept
+        {
+            using namespace CacheHelpers;
+            const uint64 textHash = (uint64) text.hashCode64();
+            uint64 hash = initialHash;
+            addToHash (hash, (uint32) type);
+            addToHash (hash, (uint32) textHash);
+            addToHash (hash, (uint32) (textHash >> 32));
+            addToHash (hash, (uint32) font.getTypefaceName().hashCode());
+            addToHash (hash, (uint32) font.getTypefaceStyle().hashCode());
+            addToHash (hash, font.getHeight());
+            addToHash (hash, font.getHorizontalScale());
+            addToHash (hash, (uint32) font.getStyleFlags());
+            addToHash (hash, area.getX());     addToHash (hash, area.getY());
+            addToHash (hash, area.getWidth()); addToHash (hash, area.getHeight());
+            addToHash (hash, (uint32) justificationFlags);
+            addToHash (hash, (uint32) maximumLines);
+            addToHash (hash, minimumHorizontalScale);
+            return (int64) hash;
+        }
+
+        LayoutType type;
+        Font font;
+        String text;
+        Rectangle<float> area;
+        int justificationFlags, maximumLines;
+        float minimumHorizontalScale;
+    };
+
+    /** A laid-out piece of text. Once it's been added to the cache it mustn't be changed. */
+    struct Entry  : public ReferenceCountedObject
+    {
+        Entry (const Key& k) : key (k), xOffset (0), lastAccessCount (0) {}
+
+        int getSize() const noexcept    { return glyphs.getNumGlyphs(); }
+
+        const Key key;
+        GlyphArrangement glyphs;
+        float xOffset;  /**< The shift that drawSingleLineText() applies to justify the line. */
+        int64 lastAccessCount;
+
+        JUCE_DECLARE_NON_COPYABLE (Entry)
+    };
+
+    typedef ReferenceCountedObjectPtr<Entry> EntryPtr;
+
+    /** Returns the cached layout for this key, or nullptr if there isn't one. */
+    EntryPtr find (const Key& key)
+    {
+        if (enabled.get() == 0)
+            return nullptr;
+
+        const ScopedLock sl (lock);
+
+        if (Entry* e = entries [key.getHash()])
+        {
+            if (e->key == key)
+            {
+                ++hits;
+                e->lastAccessCount = ++accessCounter;
+                return e;
+            }
+        }
+
+        ++misses;
+        return nullptr;
+    }
+
+    /** Stores a newly laid-out entry, unless its text is too long to be worth keeping. */
+    void add (Entry* e)
+    {
+        jassert (e != nullptr);
+
+        if (enabled.get() == 0 || e->key.text.length() > maxTextLength)
+            return;
+
+        const int64 hash = e->key.getHash();
+        const ScopedLock sl (lock);
+
+        if (Entry* existing = entries [hash])
+            numGlyphs -= existing->getSize();
+
+        entries.set (hash, e);
+        numGlyphs += e->getSize();
+        e->lastAccessCount = ++accessCounter;
+
+        // Going a quarter below the limit means that the entries only need sorting
+        // once in a while, rather than every time something new is added.
+        if (numGlyphs > maxGlyphs)
+            CacheHelpers::removeLeastRecentlyUsed (entries, numGlyphs, maxGlyphs - maxGlyphs / 4);
+    }
+
+    //==============================================================================
+    /** Changes the total number of glyphs that the cached arrangements may hold. */
+    void setMaximumSize (int maxNumGlyphs)
+    {
+        const ScopedLock sl (lock);
+        maxGlyphs = maxNumGlyphs;
+        CacheHelpers::removeLeastRecentlyUsed (entries, numGlyphs, maxGlyphs);
+    }
+
+    int getMaximumSize() const noexcept             { return maxGlyphs; }
+
+    /** Turns the cache on or off; while it's off, all text is laid out from scratch. */
+    void setEnabled (bool shouldBeEnabled) noexcept { enabled = shouldBeEnabled ? 1 : 0; }
+    bool isEnabled() const noexcept                 { return enabled.get() != 0; }
+
+    /** Removes all the cached layouts. */
+    void clear()
+    {
+        const ScopedLock sl (lock);
+        entries.clear();
+        numGlyphs = 0;
+    }
+
+    struct Statistics
+    {
+        int64 hits, misses;
+        int numEntries, numGlyphs;
+
+        double getHitRate() const noexcept      { return hits + misses > 0 ? hits / (double) (hits + misses) : 0.0; }
+    };
+
+    Statistics getStatistics() const
+    {
+        const ScopedLock sl (lock);
+        Statistics s = { hits, misses, entries.size(), numGlyphs };
+        return s;
+    }
+
+    void resetStatistics()
+    {
+        const ScopedLock sl (lock);
+        hits = misses = 0;
+    }
+
+private:
+    HashMap<int64, EntryPtr> entries;
+    int maxGlyphs, numGlyphs;
+    int64 accessCounter, hits, misses;
+    Atomic<int> enabled;
+    CriticalSection lock;
+
+    enum { maxTextLength = 1000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GlyphArrangementCache)
+};
+
+//==============================================================================
+template <class SavedStateType>
+struct ClipRegions
+{
+    class Base  : public SingleThreadedReferenceCountedObject
+    {
+    public:
+        Base() {}
+        virtual ~Base() {}
+
+        typedef ReferenceCountedObjectPtr<Base> Ptr;
+
+        virtual Ptr clone() const = 0;
+        virtual Ptr applyClipTo (const Ptr& target) const = 0;
+
+        virtual Ptr clipToRectangle (const Rectangle<int>&) = 0;
+        virtual Ptr clipToRectangleList (const RectangleList<int>&) = 0;
+        virtual Ptr excludeClipRectangle (const Rectangle<int>&) = 0;
+        virtual Ptr clipToPath (const Path&, const AffineTransform&) = 0;
+        virtual Ptr clipToEdgeTable (const EdgeTable& et) = 0;
+        virtual Ptr clipToImageAlpha (const Image&, const AffineTransform&, const Graphics::ResamplingQuality) = 0;
+        virtual void translate (Point<int> delta) = 0;
+
+        virtual bool clipRegionIntersects (const Rectangle<int>&) const = 0;
+        virtual Rectangle<int> getClipBounds() const = 0;
+
+        virtual void fillRectWithColour (SavedStateType&, const Rectangle<int>&, const PixelARGB colour, bool replaceContents) const = 0;
+        virtual void fillRectWithColour (SavedStateType&, const Rectangle<float>&, const PixelARGB colour) const = 0;
+        virtual void fillAllWithColour (SavedStateType&, const PixelARGB colour, bool replaceContents) const = 0;
+        virtual void fillAllWithGradient (SavedStateType&, ColourGradient&, const AffineTransform&, bool isIdentity) const = 0;
+        virtual void renderImageTransformed (SavedStateType&, const Image&, const int alpha, const AffineTransform&, Graphics::ResamplingQuality, bool tiledFill) const = 0;
+        virtual void renderImageUntransformed (SavedStateType&, const Image&, const int alpha, int x, int y, bool tiledFill) const = 0;
+    };
+
+    //==============================================================================
+    class EdgeTableRegion  : public Base
+    {
+    public:
+        EdgeTableRegion (const EdgeTable& e)            : edgeTable (e) {}
+        EdgeTableRegion (const Rectangle<int>& r)       : edgeTable (r) {}
+        EdgeTableRegion (const Rectangle<float>& r)     : edgeTable (r) {}
+        EdgeTableRegion (const RectangleList<int>& r)   : edgeTable (r) {}
         EdgeTableRegion (const RectangleList<float>& r) : edgeTable (r) {}
-        EdgeTableRegion (const Rectangle<int>& bounds, const Path& p, const AffineTransform& t) : edgeTable (bounds, p, t) {}
+        EdgeTableRegion (const Rectangle<int>& bounds, const Path& p, const AffineTransform& t)
+            : edgeTable (getPathRasterisingBounds (bounds, p, t), p, t)
+        {
+            if (edgeTable.getMaximumBounds() != bounds)
+                edgeTable.clipToRectangle (bounds);
+        }
+
         EdgeTableRegion (const EdgeTableRegion& other)  : Base(), edgeTable (other.edgeTable) {}
 
         typedef typename Base::Ptr Ptr;
@@ -1620,7 +2723,7 @@ struct ClipRegions
 
         Ptr clipToPath (const Path& p, const AffineTransform& transform)
         {
-            EdgeTable et (edgeTable.getMaximumBounds(), p, transform);
+            EdgeTable et (getPathRasterisingBounds (edgeTable.getMaximumBounds(), p, transform), p, transform);
             edgeTable.clipToEdgeTable (et);
             return edgeTable.isEmpty() ? nullptr : this;
         }
@@ -1661,7 +2764,7 @@ struct ClipRegions
             {
                 Path p;
                 p.addRectangle (0, 0, (float) srcData.width, (float) srcData.height);
-                EdgeTable et2 (edgeTable.getMaximumBounds(), p, transform);
+                EdgeTable et2 (getPathRasterisingBounds (edgeTable.getMaximumBounds(), p, transform), p, transform);
                 edgeTable.clipToEdgeTable (et2);
             }
 
@@ -2271,7 +3374,70 @@ public:
             const Rectangle<int> clipRect (clip->getClipBounds());
 
             if (path.getBoundsTransformed (trans).getSmallestIntegerContainer().intersects (clipRect))
-                fillShape (new EdgeTableRegionType (clipRect, path, trans), false);
+            {
+                Point<int> offset;
+
+                if (PathEdgeTableCache::EntryPtr cached = PathEdgeTableCache::getInstance()->findFilledPath (path, trans, offset))
+                    fillCachedEdgeTable (*cached->edgeTable, offset, clipRect);
+                else
+                    fillShape (createPathRegion (clipRect, path, trans), false);
+            }
+        }
+    }
+
+    void strokePath (const Path& path, const PathStrokeType& strokeType, const AffineTransform& t)
+    {
+        if (clip != nullptr)
+        {
+            AffineTransform pathTransform (t), trans (transform.getTransform());
+
+            // When the context is only translated, the whole-pixel part of the path's own
+            // translation can be moved into the fill, so that a stroke drawn in different
+            // places still finds the same cached table
+            if (transform.isOnlyTranslated)
+            {
+                const Point<float> offset (PathEdgeTableCache::getWholePixelOffset (t).toFloat());
+                pathTransform = t.translated (-offset);
+                trans = trans.translated (offset);
+            }
+
+            const float extraAccuracy = transform.getPhysicalPixelScaleFactor();
+            const Rectangle<int> clipRect (clip->getClipBounds());
+            Point<int> offset;
+
+            if (PathEdgeTableCache::EntryPtr cached = PathEdgeTableCache::getInstance()->findStrokedPath (path, strokeType, pathTransform,
+                                                                                                      extraAccuracy, trans, offset))
+            {
+                fillCachedEdgeTable (*cached->edgeTable, offset, clipRect);
+            }
+            else
+            {
+                Path stroke;
+                strokeType.createStrokedPath (stroke, path, pathTransform, extraAccuracy);
+
+                if (stroke.getBoundsTransformed (trans).getSmallestIntegerContainer().intersects (clipRect))
+                    fillShape (createPathRegion (clipRect, stroke, trans), false);
+            }
+        }
+    }
+
+    EdgeTableRegionType* createPathRegion (const Rectangle<int>& clipRect, const Path& path, const AffineTransform& trans)
+    {
+        const Point<int> offset (PathEdgeTableCache::getWholePixelOffset (trans));
+
+        EdgeTableRegionType* region = new EdgeTableRegionType (clipRect - offset, path, trans.translated (-offset.toFloat()));
+        region->edgeTable.translate ((float) offset.x, offset.y);
+        return region;
+    }
+
+    void fillCachedEdgeTable (const EdgeTable& edgeTable, Point<int> offset, const Rectangle<int>& clipRect)
+    {
+        if ((edgeTable.getMaximumBounds() + offset).intersects (clipRect))
+        {
+            EdgeTableRegionType* region = new EdgeTableRegionType (edgeTable);
+            region->edgeTable.translate ((float) offset.x, offset.y);
+            region->edgeTable.clipToRectangle (clipRect);
+            fillShape (region, false);
         }
     }
 
@@ -2474,7 +3640,8 @@ public:
         }
     }
 
-    typedef GlyphCache<CachedGlyphEdgeTable<SoftwareRendererSavedState>, SoftwareRendererSavedState> GlyphCacheType;
+    typedef CachedGlyphEdgeTable<SoftwareRendererSavedState> CachedGlyphType;
+    typedef GlyphCache<CachedGlyphType, SoftwareRendererSavedState> GlyphCacheType;
 
     static void clearGlyphCache()
     {
@@ -2482,47 +3649,75 @@ public:
     }
 
     //==============================================================================
-    void drawGlyph (int glyphNumber, const AffineTransform& trans)
+    /** A glyph that has been looked up for the current font and transform, ready to draw.
+        It's either a cached glyph and the device position to draw it at, or an edge-table
+        made specially for a transform that the glyph cache can't handle.
+    */
+    struct PreparedGlyph
+    {
+        ReferenceCountedObjectPtr<CachedGlyphType> cachedGlyph;
+        Point<float> position;
+        ScopedPointer<EdgeTable> edgeTable;
+    };
+
+    void prepareGlyph (PreparedGlyph& result, int glyphNumber, const AffineTransform& trans) const
     {
-        if (clip != nullptr)
+        if (trans.isOnlyTranslation() && ! transform.isRotated)
         {
-            if (trans.isOnlyTranslation() && ! transform.isRotated)
-            {
-                GlyphCacheType& cache = GlyphCacheType::getInstance();
-
-                Point<float> pos (trans.getTranslationX(), trans.getTranslationY());
-
-                if (transform.isOnlyTranslated)
-                {
-                    cache.drawGlyph (*this, font, glyphNumber, pos + transform.offset.toFloat());
-                }
-                else
-                {
-                    pos = transform.transformed (pos);
-
-                    Font f (font);
-                    f.setHeight (font.getHeight() * transform.complexTransform.mat11);
+            GlyphCacheType& cache = GlyphCacheType::getInstance();
 
-                    const float xScale = transform.complexTransform.mat00 / transform.complexTransform.mat11;
-                    if (std::abs (xScale - 1.0f) > 0.01f)
-                        f.setHorizontalScale (xScale);
+            Point<float> pos (trans.getTranslationX(), trans.getTranslationY());
 
-                    cache.drawGlyph (*this, f, glyphNumber, pos);
-                }
+            if (transform.isOnlyTranslated)
+            {
+                result.cachedGlyph = cache.findOrCreateGlyph (font, glyphNumber);
+                result.position = pos + transform.offset.toFloat();
             }
             else
             {
-                const float fontHeight = font.getHeight();
+                pos = transform.transformed (pos);
 
-                AffineTransform t (transform.getTransformWith (AffineTransform::scale (fontHeight * font.getHorizontalScale(), fontHeight)
-                                                                               .followedBy (trans)));
+                Font f (font);
+                f.setHeight (font.getHeight() * transform.complexTransform.mat11);
 
-                const ScopedPointer<EdgeTable> et (font.getTypeface()->getEdgeTableForGlyph (glyphNumber, t, fontHeight));
+                const float xScale = transform.complexTransform.mat00 / transform.complexTransform.mat11;
+                if (std::abs (xScale - 1.0f) > 0.01f)
+                    f.setHorizontalScale (xScale);
 
-                if (et != nullptr)
-                    fillShape (new EdgeTableRegionType (*et), false);
+                result.cachedGlyph = cache.findOrCreateGlyph (f, glyphNumber);
+                result.position = pos;
             }
         }
+        else
+        {
+            const float fontHeight = font.getHeight();
+
+            AffineTransform t (transform.getTransformWith (AffineTransform::scale (fontHeight * font.getHorizontalScale(), fontHeight)
+                                                                           .followedBy (trans)));
+
+            result.edgeTable = font.getTypeface()->getEdgeTableForGlyph (glyphNumber, t, fontHeight);
+        }
+    }
+
+    void drawPreparedGlyph (const PreparedGlyph& glyph)
+    {
+        if (clip != nullptr)
+        {
+            if (glyph.cachedGlyph != nullptr)
+                glyph.cachedGlyph->draw (*this, glyph.position);
+            else if (glyph.edgeTable != nullptr)
+                fillShape (new EdgeTableRegionType (*glyph.edgeTable), false);
+        }
+    }
+
+    void drawGlyph (int glyphNumber, const AffineTransform& trans)
+    {
+        if (clip != nullptr)
+        {
+            PreparedGlyph glyph;
+            prepareGlyph (glyph, glyphNumber, trans);
+            drawPreparedGlyph (glyph);
+        }
     }
 
     Rectangle<int> getMaximumBounds() const     { return image.getBounds(); }
@@ -2667,6 +3862,7 @@ public:
     void fillRect (const Rectangle<float>& r) override                           { stack->fillRect (r); }
     void fillRectList (const RectangleList<float>& list) override                { stack->fillRectList (list); }
     void fillPath (const Path& path, const AffineTransform& t) override          { stack->fillPath (path, t); }
+    void strokePath (const Path& path, const PathStrokeType& s, const AffineTransform& t) override { stack->strokePath (path, s, t); }
     void drawImage (const Image& im, const AffineTransform& t) override          { stack->drawImage (im, t); }
     void drawGlyph (int glyphNumber, const AffineTransform& t) override          { stack->drawGlyph (glyphNumber, t); }
     void drawLine (const Line<float>& line) override                             { stack->drawLine (line); }
@@ -1968,6 +1968,7 @@ void Component::paintComponentAndChildren (Graphics& g)
 
     if (flags.dontClipGraphicsFlag)
     {
+        const ComponentPeer::ScopedComponentPaintTimer timer (*this, true);
         paint (g);
     }
     else
@@ -1975,7 +1976,10 @@ void Component::paintComponentAndChildren (Graphics& g)
         g.saveState();
 
         if (! (ComponentHelpers::clipObscuredRegions (*this, g, clipBounds, Point<int>()) && g.isClipEmpty()))
+        {
+            const ComponentPeer::ScopedComponentPaintTimer timer (*this, true);
             paint (g);
+        }
 
         g.restoreState();
     }
@@ -2029,7 +2033,12 @@ void Component::paintComponentAndChildren (Graphics& g)
     }
 
     g.saveState();
-    paintOverChildren (g);
+
+    {
+        const ComponentPeer::ScopedComponentPaintTimer timer (*this, false);
+        paintOverChildren (g);
+    }
+
     g.restoreState();
 }
 
@@ -785,6 +785,8 @@ public:
         // scale factor
         Point<int> topLeftScaled;
         double dpi, scale;
+        // refresh rate in Hz, or 0 if it isn't known
+        double refreshRate;
         bool isMain;
     };
 
@@ -911,6 +913,17 @@ public:
         return getInstance();
     }
 
+    /** Returns the refresh rate of the display that contains most of this area,
+        or 0 if it isn't known.
+    */
+    static double getRefreshRateForArea (const Rectangle<int>& scaledBounds)
+    {
+        if (instance == nullptr || instance->infos.size() == 0)
+            return 0.0;
+
+        return instance->findDisplayForRect (scaledBounds, true).refreshRate;
+    }
+
 private:
     //==============================================================================
     static DisplayGeometry* instance;
@@ -1091,6 +1104,28 @@ private:
    #endif
 
 
+   #if JUCE_USE_XRANDR
+    static double getRefreshRate (const XRRScreenResources& screens, RRMode mode) noexcept
+    {
+        for (int i = 0; i < screens.nmode; ++i)
+        {
+            const XRRModeInfo& info = screens.modes[i];
+
+            if (info.id == mode && info.hTotal > 0 && info.vTotal > 0)
+            {
+                double linesPerFrame = info.vTotal;
+
+                if ((info.modeFlags & RR_DoubleScan) != 0)  linesPerFrame *= 2.0;
+                if ((info.modeFlags & RR_Interlace) != 0)   linesPerFrame /= 2.0;
+
+                return info.dotClock / (info.hTotal * linesPerFrame);
+            }
+        }
+
+        return 0.0;
+    }
+   #endif
+
     static double getDisplayDPI (int index)
     {
         double dpiX = (DisplayWidth  (display, index) * 25.4) / DisplayWidthMM  (display, index);
@@ -1208,6 +1243,7 @@ private:
                                     e.topLeftScaled = e.totalBounds.getTopLeft();
                                     e.isMain = (mainDisplay == screens->outputs[j]) && (i == 0);
                                     e.dpi = getDisplayDPI (0);
+                                    e.refreshRate = getRefreshRate (*screens, crtc->mode);
 
                                     // The raspberry pi returns a zero sized display, so we need to guard for divide-by-zero
                                     if (output->mm_width > 0 && output->mm_height > 0)
@@ -1250,6 +1286,7 @@ private:
                         e.isMain = (index == 0);
                         e.scale = masterScale;
                         e.dpi = getDisplayDPI (0); // (all screens share the same DPI)
+                        e.refreshRate = 0.0;
 
                         infos.add (e);
                     }
@@ -1282,6 +1319,7 @@ private:
                         e.isMain = (infos.size() == 0);
                         e.scale = masterScale;
                         e.dpi = getDisplayDPI (i);
+                        e.refreshRate = 0.0;
 
                         infos.add (e);
                     }
@@ -1298,6 +1336,7 @@ private:
                 e.isMain = true;
                 e.scale = masterScale;
                 e.dpi = getDisplayDPI (0);
+                e.refreshRate = 0.0;
 
                 infos.add (e);
             }
@@ -1405,6 +1444,61 @@ void ContainerDeletePolicy<XRRCrtcInfo>::destroy (XRRCrtcInfo* ptr)
 }
 #endif
 
+//==============================================================================
+namespace RepaintRegionHelpers
+{
+    /** Returns the number of pixels that would be painted needlessly if these two
+        areas were replaced by the rectangle that encloses them both.
+    */
+    static int64 getAreaWastedByMerging (const Rectangle<int>& a, const Rectangle<int>& b) noexcept
+    {
+        const Rectangle<int> u (a.getUnion (b)), i (a.getIntersection (b));
+
+        return u.getWidth() * (int64) u.getHeight() + i.getWidth() * (int64) i.getHeight()
+                - a.getWidth() * (int64) a.getHeight() - b.getWidth() * (int64) b.getHeight();
+    }
+
+    /** Adds an area to a list of regions that need repainting.
+
+        Each separate rectangle costs a fixed overhead to paint (the component tree has to be
+        walked, the clip set up and the pixels sent to the server), so the new area is merged with
+        whichever existing rectangle wastes the fewest pixels, as long as the waste costs less than
+        that overhead. If the list already holds maxRectangles, the cheapest merge happens anyway.
+    */
+    static void addArea (Array<Rectangle<int> >& regions, Rectangle<int> area,
+                         int64 costOfExtraRectangle, int maxRectangles)
+    {
+        if (area.isEmpty())
+            return;
+
+        for (;;)
+        {
+            int bestIndex = -1;
+            int64 bestCost = std::numeric_limits<int64>::max();
+
+            for (int i = 0; i < regions.size(); ++i)
+            {
+                const int64 cost = getAreaWastedByMerging (regions.getReference (i), area);
+
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestIndex = i;
+                }
+            }
+
+            if (bestIndex < 0 || (bestCost > costOfExtraRectangle && regions.size() < maxRectangles))
+                break;
+
+            // the merged area may now be worth merging with some of the others too
+            area = area.getUnion (regions.getReference (bestIndex));
+            regions.remove (bestIndex);
+        }
+
+        regions.add (area);
+    }
+}
+
 //==============================================================================
 namespace PixmapHelpers
 {
@@ -1913,6 +2007,12 @@ public:
         repainter->performAnyPendingRepaintsNow();
     }
 
+    /** Returns the number of milliseconds that repaints are spaced out by. */
+    double getFrameInterval() const
+    {
+        return repainter->getFrameInterval();
+    }
+
     void setIcon (const Image& newIcon) override
     {
         const int dataSize = newIcon.getWidth() * newIcon.getHeight() + 2;
@@ -2530,11 +2630,18 @@ public:
 
 private:
     //==============================================================================
+    /*  Collects the areas that need repainting and paints them once per display frame.
+
+        Repaint requests that arrive between frames are merged into a few rectangles (see
+        RepaintRegionHelpers::addArea), and the frames are paced to the refresh rate of the
+        display that the window is on, so a burst of small repaints from something like a
+        level meter costs one paint per frame rather than one per timer tick.
+    */
     class LinuxRepaintManager   : public Timer
     {
     public:
         LinuxRepaintManager (LinuxComponentPeer& p)
-            : peer (p), lastTimeImageUsed (0)
+            : peer (p), lastTimeImageUsed (0), lastFrameTime (0), frameScheduled (false)
         {
            #if JUCE_USE_XSHM
             shmPaintsPending = 0;
@@ -2563,9 +2670,8 @@ private:
                 return;
            #endif
 
-            if (! regionsNeedingRepaint.isEmpty())
+            if (frameScheduled)
             {
-                stopTimer();
                 performAnyPendingRepaintsNow();
             }
             else if (Time::getApproximateMillisecondCounter() > lastTimeImageUsed + 3000)
@@ -2577,10 +2683,13 @@ private:
 
         void repaint (const Rectangle<int>& area)
         {
-            if (! isTimerRunning())
-                startTimer (repaintTimerPeriod);
+            ++peer.paintStats.numRepaintRequests;
+
+            RepaintRegionHelpers::addArea (regionsNeedingRepaint, area * peer.currentScaleFactor,
+                                           costOfExtraRectangle, maxRectangles);
 
-            regionsNeedingRepaint.add (area * peer.currentScaleFactor);
+            if (! (frameScheduled || regionsNeedingRepaint.isEmpty()))
+                scheduleNextFrame();
         }
 
         void performAnyPendingRepaintsNow()
@@ -2588,13 +2697,24 @@ private:
            #if JUCE_USE_XSHM
             if (shmPaintsPending != 0)
             {
-                startTimer (repaintTimerPeriod);
+                // (notifyPaintCompleted() will reschedule the frame)
                 return;
             }
            #endif
 
-            RectangleList<int>  originalRepaintRegion (regionsNeedingRepaint);
-            regionsNeedingRepaint.clear();
+            Array<Rectangle<int> > rectangles;
+            rectangles.swapWith (regionsNeedingRepaint);
+
+            // anything that gets repainted from here on will be in the next frame
+            frameScheduled = false;
+            lastFrameTime = Time::getMillisecondCounterHiRes();
+            startTimer (imageReleaseCheckPeriod);
+
+            RectangleList<int> originalRepaintRegion;
+
+            for (const Rectangle<int>* i = rectangles.begin(), * const e = rectangles.end(); i != e; ++i)
+                originalRepaintRegion.add (*i);
+
             const Rectangle<int> totalArea (originalRepaintRegion.getBounds());
 
             if (! totalArea.isEmpty())
@@ -2613,8 +2733,6 @@ private:
                                                      false, (unsigned int) peer.depth, peer.visual));
                 }
 
-                startTimer (repaintTimerPeriod);
-
                 RectangleList<int> adjustedList (originalRepaintRegion);
                 adjustedList.offsetAll (-totalArea.getX(), -totalArea.getY());
 
@@ -2629,6 +2747,7 @@ private:
                     peer.handlePaint (*context);
                 }
 
+                // (the merged regions can overlap, but the rectangles in the list don't)
                 for (const Rectangle<int>* i = originalRepaintRegion.begin(), * const e = originalRepaintRegion.end(); i != e; ++i)
                 {
                     XBitmapImage* xbitmap = static_cast<XBitmapImage*> (image.getPixelData());
@@ -2637,35 +2756,67 @@ private:
                         ++shmPaintsPending;
                    #endif
 
+                    xbitmap->blitToWindow (peer.windowH,
+                                           i->getX(), i->getY(),
+                                           (unsigned int) i->getWidth(),
+                                           (unsigned int) i->getHeight(),
+                                           i->getX() - totalArea.getX(), i->getY() - totalArea.getY());
 
-                   xbitmap->blitToWindow (peer.windowH,
-                                          i->getX(), i->getY(),
-                                          (unsigned int) i->getWidth(),
-                                          (unsigned int) i->getHeight(),
-                                          i->getX() - totalArea.getX(), i->getY() - totalArea.getY());
+                    peer.paintStats.numPixelsPainted += i->getWidth() * (int64) i->getHeight();
                 }
+
+                peer.paintStats.numRectanglesPainted += rectangles.size();
             }
 
             lastTimeImageUsed = Time::getApproximateMillisecondCounter();
-            startTimer (repaintTimerPeriod);
         }
 
        #if JUCE_USE_XSHM
-        void notifyPaintCompleted() noexcept        { --shmPaintsPending; }
+        void notifyPaintCompleted() noexcept
+        {
+            if (--shmPaintsPending == 0 && frameScheduled)
+                scheduleNextFrame();
+        }
        #endif
 
+        /** Returns the time between frames for the display that the window is on. */
+        double getFrameInterval() const
+        {
+            const double refreshRate = DisplayGeometry::getRefreshRateForArea (peer.bounds);
+
+            // (the rates of some virtual displays are unknown or meaningless)
+            return 1000.0 / (refreshRate >= 20.0 && refreshRate <= 500.0 ? refreshRate : (double) defaultRefreshRate);
+        }
+
     private:
-        enum { repaintTimerPeriod = 1000 / 100 };
+        enum
+        {
+            defaultRefreshRate = 60,
+            imageReleaseCheckPeriod = 1000,
+            costOfExtraRectangle = 64 * 64,
+            maxRectangles = 16
+        };
 
         LinuxComponentPeer& peer;
         Image image;
         uint32 lastTimeImageUsed;
-        RectangleList<int> regionsNeedingRepaint;
+        double lastFrameTime;
+        bool frameScheduled;
+        Array<Rectangle<int> > regionsNeedingRepaint;
 
        #if JUCE_USE_XSHM
         bool useARGBImagesForRendering;
         int shmPaintsPending;
        #endif
+
+        void scheduleNextFrame()
+        {
+            frameScheduled = true;
+
+            const double timeUntilNextFrame = lastFrameTime + getFrameInterval() - Time::getMillisecondCounterHiRes();
+            startTimer (jmax (1, roundToInt (timeUntilNextFrame)));
+        }
+
         JUCE_DECLARE_NON_COPYABLE (LinuxRepaintManager)
     };
 
@@ -3730,6 +3881,10 @@ ComponentPeer* Component::createNewPeer (int styleFlags, void* nativeWindowToAtt
 //==============================================================================
 void Desktop::Displays::findDisplays (float masterScale)
 {
+    // (without an X connection there are no displays to find, and this list stays empty)
+    if (display == nullptr)
+        return;
+
     DisplayGeometry& geometry = DisplayGeometry::getOrCreateInstance (display, masterScale);
 
     // add the main display first
@@ -4236,3 +4391,164 @@ const int KeyPress::playKey                 = ((int) 0xffeeff00) | Keys::extende
 const int KeyPress::stopKey                 = ((int) 0xffeeff01) | Keys::extendedKeyModifier;
 const int KeyPress::fastForwardKey          = ((int) 0xffeeff02) | Keys::extendedKeyModifier;
 const int KeyPress::rewindKey               = ((int) 0xffeeff03) | Keys::extendedKeyModifier;
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class LinuxRepaintTests  : public UnitTest
+{
+public:
+    LinuxRepaintTests() : UnitTest ("Linux repaint scheduling") {}
+
+    enum { costOfExtraRectangle = 64 * 64, maxRectangles = 16, numBars = 32 };
+
+    static Rectangle<int> getBarArea (int bar, int level)
+    {
+        return Rectangle<int> (bar * 12, 20 + level % 30, 10, 60);
+    }
+
+    static Array<Rectangle<int> > addAll (const Array<Rectangle<int> >& areas)
+    {
+        Array<Rectangle<int> > regions;
+
+        for (int i = 0; i < areas.size(); ++i)
+            RepaintRegionHelpers::addArea (regions, areas.getReference (i), costOfExtraRectangle, maxRectangles);
+
+        return regions;
+    }
+
+    // A row of level meters, each of which repaints itself separately
+    struct MeterStrip  : public Component
+    {
+        MeterStrip() : numPaints (0) {}
+
+        void paint (Graphics& g) override
+        {
+            ++numPaints;
+            g.fillAll (Colours::black);
+            g.setColour (Colours::green);
+
+            for (int i = 0; i < numBars; ++i)
+                g.fillRect (getBarArea (i, numPaints + i));
+        }
+
+        int numPaints;
+    };
+
+    void runTest() override
+    {
+        beginTest ("Merging repaint regions");
+        {
+            Array<Rectangle<int> > bars;
+            Rectangle<int> allBars;
+
+            for (int i = 0; i < numBars; ++i)
+            {
+                bars.add (getBarArea (i, i * 7));
+                allBars = allBars.getUnion (bars.getLast());
+            }
+
+            Array<Rectangle<int> > regions (addAll (bars));
+            expectEquals (regions.size(), 1);
+            expect (regions[0] == allBars);
+
+            Array<Rectangle<int> > distant;
+            distant.add (Rectangle<int> (0, 0, 10, 10));
+            distant.add (Rectangle<int> (500, 500, 10, 10));
+            distant.add (Rectangle<int> (2, 2, 5, 5));
+            distant.add (Rectangle<int> (500, 0, 0, 10));
+
+            regions = addAll (distant);
+            expectEquals (regions.size(), 2);
+            expect (regions.contains (distant[0]) && regions.contains (distant[1]));
+        }
+
+        beginTest ("Every area stays covered and the rectangle limit is respected");
+        {
+            Random r (getRandom());
+            Array<Rectangle<int> > areas;
+
+            for (int i = 0; i < 200; ++i)
+                areas.add (Rectangle<int> (r.nextInt (2000), r.nextInt (2000), 1 + r.nextInt (20), 1 + r.nextInt (20)));
+
+            const Array<Rectangle<int> > regions (addAll (areas));
+            expectLessOrEqual (regions.size(), (int) maxRectangles);
+
+            for (int i = 0; i < areas.size(); ++i)
+            {
+                bool covered = false;
+
+                for (int j = 0; j < regions.size() && ! covered; ++j)
+                    covered = regions.getReference (j).contains (areas.getReference (i));
+
+                expect (covered);
+            }
+        }
+
+       #if JUCE_MODAL_LOOPS_PERMITTED
+        beginTest ("Frame pacing and paint statistics");
+
+        if (display == nullptr)
+        {
+            logMessage ("Skipped: this needs an X display (e.g. run the tests under Xvfb)");
+            return;
+        }
+
+        MeterStrip meters;
+        meters.setBounds (100, 100, numBars * 12, 120);
+        meters.addToDesktop (0);
+        meters.setVisible (true);
+        MessageManager::getInstance()->runDispatchLoopUntil (300);
+
+        ComponentPeer* const peer = meters.getPeer();
+        expect (peer != nullptr);
+
+        if (peer != nullptr)
+        {
+            peer->setComponentPaintTimingEnabled (true);
+            peer->resetPaintStatistics();
+            meters.numPaints = 0;
+
+            const int numBursts = 20;
+            const double startTime = Time::getMillisecondCounterHiRes();
+
+            for (int burst = 0; burst < numBursts; ++burst)
+            {
+                for (int i = 0; i < numBars; ++i)
+                    meters.repaint (getBarArea (i, burst * 3 + i));
+
+                MessageManager::getInstance()->runDispatchLoopUntil (5);
+            }
+
+            MessageManager::getInstance()->runDispatchLoopUntil (200);
+            const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+
+            const ComponentPeer::PaintStatistics& stats = peer->getPaintStatistics();
+            expectEquals (stats.numRepaintRequests, numBursts * (int) numBars);
+            expectGreaterThan (stats.numFrames, 0);
+            expectEquals (stats.numFrames, meters.numPaints);
+
+            // all the bars in a frame get merged, and no more than one frame gets painted per refresh
+            expectEquals (stats.numRectanglesPainted, stats.numFrames);
+            expectLessOrEqual (stats.numFrames, numBursts);
+            expectLessOrEqual (stats.numFrames, (int) (elapsed / static_cast<LinuxComponentPeer*> (peer)->getFrameInterval()) + 1);
+
+            const ComponentPeer::PaintStatistics::ComponentTime* const t = stats.getTimeFor (&meters);
+            expect (t != nullptr);
+
+            if (t != nullptr)
+                expectEquals (t->numPaints, stats.numFrames);
+
+            logMessage (String (stats.numRepaintRequests) + " repaints painted as " + String (stats.numFrames)
+                          + " frames in " + String (elapsed, 1) + " ms, average paint time "
+                          + String (stats.getAverageFrameMilliseconds(), 3) + " ms");
+        }
+
+        meters.removeFromDesktop();
+       #endif
+    }
+};
+
+static LinuxRepaintTests linuxRepaintTests;
+
+#endif
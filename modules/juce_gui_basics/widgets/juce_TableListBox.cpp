@@ -486,3 +486,110 @@ Component* TableListBoxModel::refreshComponentForCell (int, int, bool, Component
     jassert (existingComponentToUpdate == nullptr); // indicates a failure in the code that recycles the components
     return nullptr;
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class TableListBoxTests  : public UnitTest
+{
+public:
+    TableListBoxTests() : UnitTest ("TableListBox") {}
+
+    // A table of the kind that gets repainted many times a second: lots of short labels,
+    // most of which are the same as ones in other rows.
+    struct Model  : public TableListBoxModel
+    {
+        Model() : numCellsPainted (0) {}
+
+        int getNumRows() override       { return numRows; }
+
+        void paintRowBackground (Graphics& g, int row, int, int, bool) override
+        {
+            g.fillAll (row % 2 == 0 ? Colours::white : Colour (0xfff0f0f4));
+        }
+
+        void paintCell (Graphics& g, int row, int column, int width, int height, bool) override
+        {
+            static const char* const states[] = { "OK", "Pending", "Failed", "Retrying", "-" };
+
+            String text;
+
+            if (column == 1)       text = "Job " + String (row);
+            else if (column == 2)  text = states [row % numElementsInArray (states)];
+            else                   text = String ((row * 7 + column * 13) % 50) + "." + String (column % 10);
+
+            g.setColour (Colours::black);
+            g.setFont (11.0f);
+            g.drawText (text, 2, 0, width - 4, height, column == 1 ? Justification::centredLeft
+                                                                   : Justification::centredRight, true);
+            ++numCellsPainted;
+        }
+
+        enum { numRows = 500, numColumns = 20 };
+        int numCellsPainted;
+    };
+
+    typedef RenderingHelpers::GlyphArrangementCache LayoutCache;
+
+    void runTest() override
+    {
+        beginTest ("Benchmark: painting a 10,000 cell table");
+
+        // (components can't be created on a machine that has no screen, e.g. a Linux
+        // build server with no X display)
+        if (Desktop::getInstance().getDisplays().displays.size() == 0)
+        {
+            logMessage ("Skipped: there's no display");
+            return;
+        }
+
+        Model model;
+        TableListBox table ("table", &model);
+        table.setRowHeight (12);
+        table.setHeaderHeight (20);
+
+        for (int i = 1; i <= Model::numColumns; ++i)
+            table.getHeader().addColumn ("Col " + String (i), i, 50);
+
+        table.setSize (Model::numColumns * 50 + 20, 20 + Model::numRows * 12 + 4);
+        table.setVisible (true);
+        table.updateContent();
+
+        LayoutCache& cache = *LayoutCache::getInstance();
+        const bool wasEnabled = cache.isEnabled();
+        const int numFrames = 3;
+        Image images[2];
+        double times[2];
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            cache.clear();
+            cache.setEnabled (pass == 1);
+            images[pass] = table.createComponentSnapshot (table.getLocalBounds()); // (warms up the glyph caches)
+
+            model.numCellsPainted = 0;
+            cache.resetStatistics();
+            const double start = Time::getMillisecondCounterHiRes();
+
+            for (int frame = 0; frame < numFrames; ++frame)
+                images[pass] = table.createComponentSnapshot (table.getLocalBounds());
+
+            times[pass] = (Time::getMillisecondCounterHiRes() - start) / numFrames;
+            expectEquals (model.numCellsPainted, numFrames * Model::numRows * Model::numColumns);
+        }
+
+        const LayoutCache::Statistics stats (cache.getStatistics());
+        cache.setEnabled (wasEnabled);
+        cache.clear();
+
+        expect (RenderingHelpers::imagesAreIdentical (images[0], images[1]), "cached text should be drawn identically");
+        expectGreaterThan (stats.getHitRate(), 0.99);
+
+        logMessage ("Without layout cache " + String (times[0], 1) + " ms per frame, with it "
+                      + String (times[1], 1) + " ms per frame (" + String (stats.numEntries) + " layouts cached)");
+    }
+};
+
+static TableListBoxTests tableListBoxTests;
+
+#endif
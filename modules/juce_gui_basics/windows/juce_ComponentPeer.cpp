@@ -31,7 +31,8 @@ ComponentPeer::ComponentPeer (Component& comp, const int flags)
       constrainer (nullptr),
       lastDragAndDropCompUnderMouse (nullptr),
       uniqueID (lastUniquePeerID += 2), // increment by 2 so that this can never hit 0
-      isWindowMinimised (false)
+      isWindowMinimised (false),
+      componentPaintTimingEnabled (false)
 {
     Desktop::getInstance().peers.add (this);
 }
@@ -129,12 +130,24 @@ void ComponentPeer::handlePaint (LowLevelGraphicsContext& contextToPaintTo)
     }
   #endif
 
+    ComponentPeer* const previousPeerBeingTimed = peerBeingTimed;
+    peerBeingTimed = componentPaintTimingEnabled ? this : nullptr;
+    const double startTime = Time::getMillisecondCounterHiRes();
+
     JUCE_TRY
     {
         component.paintEntireComponent (g, true);
     }
     JUCE_CATCH_EXCEPTION
 
+    const double frameTime = Time::getMillisecondCounterHiRes() - startTime;
+    peerBeingTimed = previousPeerBeingTimed;
+
+    ++paintStats.numFrames;
+    paintStats.totalMilliseconds += frameTime;
+    paintStats.lastFrameMilliseconds = frameTime;
+    paintStats.longestFrameMilliseconds = jmax (paintStats.longestFrameMilliseconds, frameTime);
+
   #if JUCE_ENABLE_REPAINT_DEBUGGING
    #ifdef JUCE_IS_REPAINT_DEBUGGING_ACTIVE
     if (JUCE_IS_REPAINT_DEBUGGING_ACTIVE)
@@ -160,6 +173,79 @@ void ComponentPeer::handlePaint (LowLevelGraphicsContext& contextToPaintTo)
     jassert (roundToInt (10.1f) == 10);
 }
 
+//==============================================================================
+ComponentPeer::PaintStatistics::PaintStatistics() noexcept
+    : numFrames (0), numRepaintRequests (0), numRectanglesPainted (0), numPixelsPainted (0),
+      totalMilliseconds (0), lastFrameMilliseconds (0), longestFrameMilliseconds (0)
+{
+}
+
+double ComponentPeer::PaintStatistics::getAverageFrameMilliseconds() const noexcept
+{
+    return numFrames > 0 ? totalMilliseconds / numFrames : 0.0;
+}
+
+const ComponentPeer::PaintStatistics::ComponentTime* ComponentPeer::PaintStatistics::getTimeFor (const Component* c) const noexcept
+{
+    for (const ComponentTime* t = componentTimes.begin(), * const e = componentTimes.end(); t != e; ++t)
+        if (t->component == c)
+            return t;
+
+    return nullptr;
+}
+
+void ComponentPeer::resetPaintStatistics()
+{
+    paintStats = PaintStatistics();
+    componentTimeIndexes.clear();
+}
+
+void ComponentPeer::setComponentPaintTimingEnabled (bool shouldTimeComponents) noexcept
+{
+    componentPaintTimingEnabled = shouldTimeComponents;
+}
+
+ComponentPeer* ComponentPeer::peerBeingTimed = nullptr;
+
+void ComponentPeer::addComponentPaintTime (Component& c, double milliseconds, bool isCallToPaint)
+{
+    const int index = componentTimeIndexes [&c];
+    Array<PaintStatistics::ComponentTime>& times = paintStats.componentTimes;
+
+    // (the index could also be left over from a deleted component that was at the same address)
+    if (isPositiveAndBelow (index, times.size()) && times.getReference (index).component == &c)
+    {
+        PaintStatistics::ComponentTime& t = times.getReference (index);
+        t.numPaints += isCallToPaint ? 1 : 0;
+        t.totalMilliseconds += milliseconds;
+    }
+    else
+    {
+        PaintStatistics::ComponentTime t;
+        t.component = &c;
+        t.componentName = c.getName();
+        t.numPaints = isCallToPaint ? 1 : 0;
+        t.totalMilliseconds = milliseconds;
+
+        componentTimeIndexes.set (&c, times.size());
+        times.add (t);
+    }
+}
+
+ComponentPeer::ScopedComponentPaintTimer::ScopedComponentPaintTimer (Component& c, bool isPaint) noexcept
+    : peer (peerBeingTimed), component (c),
+      startTime (peerBeingTimed != nullptr ? Time::getMillisecondCounterHiRes() : 0.0),
+      isCallToPaint (isPaint)
+{
+}
+
+ComponentPeer::ScopedComponentPaintTimer::~ScopedComponentPaintTimer()
+{
+    if (peer != nullptr)
+        peer->addComponentPaintTime (component, Time::getMillisecondCounterHiRes() - startTime, isCallToPaint);
+}
+
+//==============================================================================
 Component* ComponentPeer::getTargetForKeyPress()
 {
     Component* c = Component::getCurrentlyFocusedComponent();
@@ -310,6 +310,90 @@ public:
     /** Changes the window's transparency. */
     virtual void setAlpha (float newAlpha) = 0;
 
+    //==============================================================================
+    /** Some counters that describe how much work the peer has been doing to keep its
+        window up-to-date.
+        @see getPaintStatistics, setComponentPaintTimingEnabled
+    */
+    struct JUCE_API  PaintStatistics
+    {
+        PaintStatistics() noexcept;
+
+        /** The time that a component has spent in its own paint() and paintOverChildren()
+            methods, not including the time taken by its children.
+        */
+        struct ComponentTime
+        {
+            WeakReference<Component> component;  /**< This will be null if the component has been deleted. */
+            String componentName;
+            int numPaints;                       /**< The number of times that its paint() method was called. */
+            double totalMilliseconds;
+        };
+
+        /** The number of times that the window has been painted. */
+        int numFrames;
+
+        /** The number of areas passed to repaint(). Not all platforms keep track of this. */
+        int numRepaintRequests;
+
+        /** The number of rectangles that the repaint requests were merged into before being
+            painted. Not all platforms keep track of this.
+        */
+        int numRectanglesPainted;
+
+        /** The total area of the rectangles that were painted. Not all platforms keep track of this. */
+        int64 numPixelsPainted;
+
+        /** The time taken to paint the component tree, in milliseconds. */
+        double totalMilliseconds, lastFrameMilliseconds, longestFrameMilliseconds;
+
+        /** The per-component breakdown of the paint times, sorted in the order in which
+            the components were first painted. This is only filled-in while
+            setComponentPaintTimingEnabled() is turned on.
+        */
+        Array<ComponentTime> componentTimes;
+
+        /** Returns the mean time taken per frame. */
+        double getAverageFrameMilliseconds() const noexcept;
+
+        /** Returns the entry for a component in componentTimes, or nullptr if it hasn't been painted. */
+        const ComponentTime* getTimeFor (const Component*) const noexcept;
+    };
+
+    /** Returns the painting counters for this window. */
+    const PaintStatistics& getPaintStatistics() const noexcept          { return paintStats; }
+
+    /** Resets all the painting counters to zero. */
+    void resetPaintStatistics();
+
+    /** Turns on timing of the individual components' paint methods.
+        This is off by default, because it adds a couple of timer reads to each component
+        that gets painted. The results appear in PaintStatistics::componentTimes.
+    */
+    void setComponentPaintTimingEnabled (bool shouldTimeComponents) noexcept;
+
+    /** Returns true if setComponentPaintTimingEnabled() has been turned on. */
+    bool isComponentPaintTimingEnabled() const noexcept                 { return componentPaintTimingEnabled; }
+
+    /** @internal
+        Used by Component to time its paint calls when component timing has been enabled
+        for the peer that's currently painting.
+    */
+    class JUCE_API  ScopedComponentPaintTimer
+    {
+    public:
+        ScopedComponentPaintTimer (Component&, bool isCallToPaint) noexcept;
+        ~ScopedComponentPaintTimer();
+
+    private:
+        ComponentPeer* const peer;
+        Component& component;
+        const double startTime;
+        const bool isCallToPaint;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedComponentPaintTimer)
+    };
+
     //==============================================================================
     void handleMouseEvent (int touchIndex, Point<float> positionWithinPeer, ModifierKeys newMods, float pressure, int64 time);
     void handleMouseWheel (int touchIndex, Point<float> positionWithinPeer, int64 time, const MouseWheelDetails&);
@@ -361,14 +445,19 @@ protected:
     const int styleFlags;
     Rectangle<int> lastNonFullscreenBounds;
     ComponentBoundsConstrainer* constrainer;
+    PaintStatistics paintStats;
 
 private:
     //==============================================================================
     WeakReference<Component> lastFocusedComponent, dragAndDropTargetComponent;
     Component* lastDragAndDropCompUnderMouse;
     const uint32 uniqueID;
-    bool isWindowMinimised;
+    bool isWindowMinimised, componentPaintTimingEnabled;
+    HashMap<const Component*, int> componentTimeIndexes;
+    static ComponentPeer* peerBeingTimed;
+
     Component* getTargetForKeyPress();
+    void addComponentPaintTime (Component&, double milliseconds, bool isCallToPaint);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentPeer)
 };